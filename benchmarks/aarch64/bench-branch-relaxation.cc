@@ -0,0 +1,103 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/branch-relaxation-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program compares veneers with branch relaxation on a large function.
+// The function is made of blocks, each ending in a `tbz` to the start of a
+// later block. Most branches are short, but some skip far enough to be out of
+// range.
+//
+// For each method, the size of the generated code and the time taken to
+// generate it are printed.
+
+static const int kBlocks = 4096;
+static const int kInstructionsPerBlock = 8;
+// One branch in `kFarBranchPeriod` skips `kFarSkip` blocks, which is out of
+// range of `tbz`.
+static const int kFarBranchPeriod = 16;
+static const int kFarSkip = 1200;
+
+static void GenerateFunction(MacroAssembler* masm) {
+  std::vector<Label> labels(kBlocks + kFarSkip + 1);
+  for (int i = 0; i < kBlocks; i++) {
+    masm->Bind(&labels[i]);
+    for (int j = 0; j < kInstructionsPerBlock; j++) {
+      masm->Add(x0, x0, j);
+    }
+    int skip = ((i % kFarBranchPeriod) == 0) ? kFarSkip : 2;
+    masm->Tbz(x1, i % 64, &labels[i + skip]);
+  }
+  for (size_t i = kBlocks; i < labels.size(); i++) {
+    masm->Bind(&labels[i]);
+  }
+  masm->Ret();
+}
+
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  // Share the run time evenly between the methods, but always generate the
+  // function at least once.
+  double time_per_method = static_cast<double>(cli.GetRunTimeInSeconds()) / 2;
+
+  BenchTimer total_timer;
+  size_t total_iterations = 0;
+  for (int relax = 0; relax < 2; relax++) {
+    MacroAssembler masm;
+    BenchTimer timer;
+    size_t iterations = 0;
+    do {
+      masm.Reset();
+      if (relax) {
+        BranchRelaxation relaxation(&masm);
+        relaxation.Generate(GenerateFunction);
+      } else {
+        GenerateFunction(&masm);
+      }
+      masm.FinalizeCode();
+      iterations++;
+    } while (timer.GetElapsedSeconds() < time_per_method);
+    double us_per_function = (timer.GetElapsedSeconds() * 1e6) / iterations;
+    printf("%-10s %" PRIu64 " bytes, %.1f us per function.\n",
+           relax ? "Relaxation" : "Veneers",
+           static_cast<uint64_t>(masm.GetSizeOfCodeGenerated()),
+           us_per_function);
+    total_iterations += iterations;
+  }
+
+  cli.PrintResults(total_iterations, total_timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
@@ -0,0 +1,116 @@
+// Copyright 2019, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+static const int kContextCount = 1000;
+
+// Run every context in turn for `slice` instructions, for RUN_TIME seconds,
+// and print the simulated instruction and context switch rates.
+static size_t Run(Simulator* simulator,
+                  std::vector<SimContext>* contexts,
+                  uint64_t slice,
+                  uint32_t run_time) {
+  BenchTimer timer;
+  size_t rounds = 0;
+  do {
+    for (SimContext& context : *contexts) {
+      simulator->RestoreContext(context);
+      simulator->RunFor(slice);
+      simulator->SaveContext(&context);
+    }
+    rounds++;
+  } while (!timer.HasRunFor(run_time));
+
+  double switches = static_cast<double>(rounds) * contexts->size();
+  double seconds = timer.GetElapsedSeconds();
+  printf("Slice %-6" PRIu64
+         " %8.3f million instructions, %8.3f million switches per second\n",
+         slice,
+         switches * slice / seconds / 1e6,
+         switches / seconds / 1e6);
+  return rounds;
+}
+
+// This program measures the cost of multiplexing many simulated contexts on a
+// single Simulator, with different numbers of instructions per time slice.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  // Each context runs an endless loop of simple integer instructions.
+  MacroAssembler masm;
+  Label loop;
+  masm.Bind(&loop);
+  masm.Add(x0, x0, 1);
+  masm.Add(x1, x1, x0);
+  masm.Cmp(x1, x2);
+  masm.B(&loop);
+  masm.FinalizeCode();
+  const Instruction* code = masm.GetBuffer()->GetStartAddress<Instruction*>();
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  std::vector<SimContext> contexts(kContextCount);
+  for (int i = 0; i < kContextCount; i++) {
+    simulator.ResetState();
+    simulator.WriteXRegister(0, i);
+    simulator.WriteXRegister(1, 0);
+    simulator.WritePc(code, Simulator::NoBranchLog);
+    simulator.SaveContext(&contexts[i]);
+  }
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  const uint64_t kSlices[] = {10, 100, 1000, 10000};
+  for (uint64_t slice : kSlices) {
+    iterations +=
+        Run(&simulator, &contexts, slice, cli.GetRunTimeInSeconds());
+  }
+
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
+
+#else   // VIXL_INCLUDE_SIMULATOR_AARCH64
+int main(void) {
+  printf("This benchmark requires AArch64 simulator support.\n");
+  return EXIT_FAILURE;
+}
+#endif  // VIXL_INCLUDE_SIMULATOR_AARCH64
@@ -0,0 +1,142 @@
+// Copyright 2019, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+typedef void (MacroAssembler::*Crc32Signature)(const Register& rd,
+                                               const Register& rn,
+                                               const Register& rm);
+
+struct Crc32Kernel {
+  const char* name;
+  Crc32Signature op;
+  int size_log2;
+};
+
+static const Crc32Kernel kKernels[] = {
+    {"CRC32B", &MacroAssembler::Crc32b, 0},
+    {"CRC32H", &MacroAssembler::Crc32h, 1},
+    {"CRC32W", &MacroAssembler::Crc32w, 2},
+    {"CRC32X", &MacroAssembler::Crc32x, 3},
+    {"CRC32CB", &MacroAssembler::Crc32cb, 0},
+    {"CRC32CH", &MacroAssembler::Crc32ch, 1},
+    {"CRC32CW", &MacroAssembler::Crc32cw, 2},
+    {"CRC32CX", &MacroAssembler::Crc32cx, 3},
+};
+
+// Checksum x1 bytes at x0, using `kernel`'s instruction. The loop is unrolled
+// so that the CRC instructions dominate.
+static void Generate(MacroAssembler* masm, const Crc32Kernel& kernel) {
+  const int kUnroll = 8;
+  int size = 1 << kernel.size_log2;
+  Register value = (kernel.size_log2 == 3) ? Register(x2) : Register(w2);
+  masm->Mov(w3, 0xffffffff);
+  Label loop;
+  masm->Bind(&loop);
+  for (int i = 0; i < kUnroll; i++) {
+    MemOperand operand(x0, size, PostIndex);
+    switch (kernel.size_log2) {
+      case 0:
+        masm->Ldrb(value, operand);
+        break;
+      case 1:
+        masm->Ldrh(value, operand);
+        break;
+      default:
+        masm->Ldr(value, operand);
+        break;
+    }
+    (masm->*kernel.op)(w3, w3, value);
+  }
+  masm->Subs(x1, x1, kUnroll * size);
+  masm->B(ne, &loop);
+  masm->Mvn(w0, w3);
+  masm->Ret();
+}
+
+// This program measures how quickly the simulator executes each CRC32 and
+// CRC32C instruction, in bytes of simulated input per second. Each kernel runs
+// for RUN_TIME seconds.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  std::vector<uint8_t> data(16 * KBytes);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.SetCPUFeatures(CPUFeatures::All());
+
+  BenchTimer total_timer;
+  size_t total_iterations = 0;
+  for (size_t i = 0; i < ArrayLength(kKernels); i++) {
+    MacroAssembler masm;
+    masm.SetCPUFeatures(CPUFeatures::All());
+    Generate(&masm, kKernels[i]);
+    masm.FinalizeCode();
+
+    BenchTimer timer;
+    size_t iterations = 0;
+    do {
+      simulator.WriteXRegister(0, reinterpret_cast<uintptr_t>(data.data()));
+      simulator.WriteXRegister(1, data.size());
+      simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+      iterations++;
+    } while (!timer.HasRunFor(cli.GetRunTimeInSeconds()));
+
+    double bytes = static_cast<double>(iterations) * data.size();
+    printf("%-8s %8.3f MB/s (simulated)\n",
+           kKernels[i].name,
+           bytes / timer.GetElapsedSeconds() / MBytes);
+    total_iterations += iterations;
+  }
+
+  cli.PrintResults(total_iterations, total_timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
+
+#else   // VIXL_INCLUDE_SIMULATOR_AARCH64
+int main(void) {
+  printf("This benchmark requires AArch64 simulator support.\n");
+  return EXIT_FAILURE;
+}
+#endif  // VIXL_INCLUDE_SIMULATOR_AARCH64
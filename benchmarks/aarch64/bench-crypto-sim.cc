@@ -0,0 +1,200 @@
+// Copyright 2019, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+static const uint32_t kSHA256Constants[64] =
+    {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+     0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+     0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+     0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+     0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+     0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+     0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+     0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+     0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+     0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+     0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// Encrypt x1 16-byte blocks at x0 in place, with AES-128 in ECB mode. The
+// round keys are arbitrary; only the throughput matters here.
+static void GenerateAES(MacroAssembler* masm) {
+  for (int i = 0; i <= 10; i++) {
+    masm->Movi(VRegister(i + 16, kFormat2D), 0x0123456789abcdef * i, i);
+  }
+  Label loop;
+  masm->Bind(&loop);
+  masm->Ld1(v0.V16B(), MemOperand(x0));
+  for (int i = 0; i < 9; i++) {
+    masm->Aese(v0.V16B(), VRegister(i + 16, kFormat16B));
+    masm->Aesmc(v0.V16B(), v0.V16B());
+  }
+  masm->Aese(v0.V16B(), v25.V16B());
+  masm->Eor(v0.V16B(), v0.V16B(), v26.V16B());
+  masm->St1(v0.V16B(), MemOperand(x0, 16, PostIndex));
+  masm->Subs(x1, x1, 1);
+  masm->B(ne, &loop);
+  masm->Ret();
+}
+
+// Hash x1 64-byte blocks at x0 with the SHA-256 compression function.
+static void GenerateSHA256(MacroAssembler* masm) {
+  masm->Movi(v0.V2D(), 0xa54ff53a3c6ef372, 0xbb67ae856a09e667);
+  masm->Movi(v1.V2D(), 0x5be0cd191f83d9ab, 0x9b05688c510e527f);
+  Label loop;
+  masm->Bind(&loop);
+  masm->Mov(x2, reinterpret_cast<uintptr_t>(kSHA256Constants));
+  masm->Ld1(v4.V16B(),
+            v5.V16B(),
+            v6.V16B(),
+            v7.V16B(),
+            MemOperand(x0, 64, PostIndex));
+  for (int i = 4; i < 8; i++) {
+    masm->Rev32(VRegister(i, kFormat16B), VRegister(i, kFormat16B));
+  }
+  masm->Mov(v20, v0);
+  masm->Mov(v21, v1);
+  for (int i = 0; i < 16; i++) {
+    VRegister w0 = VRegister(4 + (i % 4), kFormat4S);
+    VRegister w1 = VRegister(4 + ((i + 1) % 4), kFormat4S);
+    VRegister w2 = VRegister(4 + ((i + 2) % 4), kFormat4S);
+    VRegister w3 = VRegister(4 + ((i + 3) % 4), kFormat4S);
+    masm->Ld1(v16.V4S(), MemOperand(x2, 16, PostIndex));
+    masm->Add(v16.V4S(), v16.V4S(), w0);
+    if (i < 12) {
+      masm->Sha256su0(w0, w1);
+      masm->Sha256su1(w0, w2, w3);
+    }
+    masm->Mov(v2, v0);
+    masm->Sha256h(q0, q1, v16.V4S());
+    masm->Sha256h2(q1, q2, v16.V4S());
+  }
+  masm->Add(v0.V4S(), v0.V4S(), v20.V4S());
+  masm->Add(v1.V4S(), v1.V4S(), v21.V4S());
+  masm->Subs(x1, x1, 1);
+  masm->B(ne, &loop);
+  masm->Ret();
+}
+
+// Multiply x1 16-byte blocks at x0 by a constant, as in GHASH, but without
+// the reduction.
+static void GenerateGHASH(MacroAssembler* masm) {
+  masm->Movi(v1.V2D(), 0x66e94bd4ef8a2c3b, 0x884cfa59ca342b2e);
+  masm->Movi(v2.V2D(), 0, 0);
+  Label loop;
+  masm->Bind(&loop);
+  masm->Ld1(v0.V16B(), MemOperand(x0, 16, PostIndex));
+  masm->Eor(v0.V16B(), v0.V16B(), v2.V16B());
+  masm->Pmull(q3, v0.V1D(), v1.V1D());
+  masm->Pmull2(q4, v0.V2D(), v1.V2D());
+  masm->Ext(v5.V16B(), v1.V16B(), v1.V16B(), 8);
+  masm->Pmull(q6, v0.V1D(), v5.V1D());
+  masm->Pmull2(q7, v0.V2D(), v5.V2D());
+  masm->Eor(v6.V16B(), v6.V16B(), v7.V16B());
+  masm->Eor(v2.V16B(), v3.V16B(), v4.V16B());
+  masm->Eor(v2.V16B(), v2.V16B(), v6.V16B());
+  masm->Subs(x1, x1, 1);
+  masm->B(ne, &loop);
+  masm->Ret();
+}
+
+typedef void (*KernelGenerator)(MacroAssembler* masm);
+
+// Run `generator`'s kernel repeatedly over `data`, and print the simulated
+// throughput. Return the number of iterations.
+static size_t Run(const char* name,
+                  KernelGenerator generator,
+                  size_t block_size,
+                  std::vector<uint8_t>* data,
+                  uint32_t run_time) {
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  generator(&masm);
+  masm.FinalizeCode();
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.SetCPUFeatures(CPUFeatures::All());
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  do {
+    simulator.WriteXRegister(0, reinterpret_cast<uintptr_t>(data->data()));
+    simulator.WriteXRegister(1, data->size() / block_size);
+    simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+    iterations++;
+  } while (!timer.HasRunFor(run_time));
+
+  double bytes = static_cast<double>(iterations) * data->size();
+  printf("%-8s %8.3f MB/s (simulated)\n",
+         name,
+         bytes / timer.GetElapsedSeconds() / MBytes);
+  return iterations;
+}
+
+// This program measures how quickly the simulator executes common AES,
+// SHA-256 and carry-less multiply (GHASH) kernels, in bytes of simulated
+// input per second. Each kernel runs for RUN_TIME seconds.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  std::vector<uint8_t> data(16 * KBytes);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<uint8_t>(i * 7);
+  }
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  iterations += Run("AES", GenerateAES, 16, &data, cli.GetRunTimeInSeconds());
+  iterations +=
+      Run("SHA-256", GenerateSHA256, 64, &data, cli.GetRunTimeInSeconds());
+  iterations +=
+      Run("GHASH", GenerateGHASH, 16, &data, cli.GetRunTimeInSeconds());
+
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
+
+#else   // VIXL_INCLUDE_SIMULATOR_AARCH64
+int main(void) {
+  printf("This benchmark requires AArch64 simulator support.\n");
+  return EXIT_FAILURE;
+}
+#endif  // VIXL_INCLUDE_SIMULATOR_AARCH64
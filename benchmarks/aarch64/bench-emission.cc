@@ -0,0 +1,184 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "globals-vixl.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program measures how quickly instructions can be emitted, for several
+// classes of instruction, through:
+//  - the MacroAssembler, with checks for every instruction,
+//  - the Assembler, in one ExactAssemblyScope for each batch of instructions,
+//  - an InstructionStreamScope, from instructions encoded in advance.
+//
+// For each class and each method, the number of instructions emitted per
+// second is printed.
+
+namespace {
+
+struct InstructionClass {
+  const char* name;
+  void (*emit_macro)(MacroAssembler* masm, int i);
+  void (*emit_raw)(MacroAssembler* masm, int i);
+};
+
+void MacroAddImm(MacroAssembler* masm, int i) {
+  masm->Add(x0, x1, i & 0xfff);
+}
+void RawAddImm(MacroAssembler* masm, int i) { masm->add(x0, x1, i & 0xfff); }
+
+void MacroLogicalImm(MacroAssembler* masm, int i) {
+  masm->And(x0, x1, UINT64_C(0xff) << (i & 0x3f));
+}
+void RawLogicalImm(MacroAssembler* masm, int i) {
+  masm->and_(x0, x1, UINT64_C(0xff) << (i & 0x3f));
+}
+
+void MacroMoveWide(MacroAssembler* masm, int i) {
+  masm->Mov(x0, static_cast<uint64_t>(i & 0xffff) << 16);
+}
+void RawMoveWide(MacroAssembler* masm, int i) {
+  masm->movz(x0, i & 0xffff, 16);
+}
+
+void MacroLoadStore(MacroAssembler* masm, int i) {
+  masm->Ldr(x0, MemOperand(x1, (i & 0xff) * 8));
+}
+void RawLoadStore(MacroAssembler* masm, int i) {
+  masm->ldr(x0, MemOperand(x1, (i & 0xff) * 8));
+}
+
+void MacroFP(MacroAssembler* masm, int i) {
+  masm->Fadd(d0, d1, VRegister(i & 0x1f, kDRegSize));
+}
+void RawFP(MacroAssembler* masm, int i) {
+  masm->fadd(d0, d1, VRegister(i & 0x1f, kDRegSize));
+}
+
+const InstructionClass kClasses[] = {
+    {"add (imm)", MacroAddImm, RawAddImm},
+    {"logical (imm)", MacroLogicalImm, RawLogicalImm},
+    {"move wide", MacroMoveWide, RawMoveWide},
+    {"load/store", MacroLoadStore, RawLoadStore},
+    {"fp", MacroFP, RawFP},
+};
+
+enum Method { kMacroAssembler, kAssembler, kStream, kNumberOfMethods };
+const char* kMethodNames[] = {"MacroAssembler", "Assembler", "Stream"};
+
+const int kBatchSize = 1024;
+const int kBatchesPerFunction = 64;
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  const int class_count = sizeof(kClasses) / sizeof(kClasses[0]);
+  // Share the run time evenly between the classes and methods, but always
+  // generate each function at least once.
+  double time_per_run = static_cast<double>(cli.GetRunTimeInSeconds()) /
+                        (class_count * kNumberOfMethods);
+
+  BenchTimer total_timer;
+  uint64_t total_iterations = 0;
+  for (int c = 0; c < class_count; c++) {
+    const InstructionClass& instruction_class = kClasses[c];
+
+    // Encode one batch in advance, for the stream.
+    MacroAssembler encoder;
+    encoder.SetCPUFeatures(CPUFeatures::All());
+    {
+      ExactAssemblyScope scope(&encoder, kBatchSize * kInstructionSize);
+      for (int i = 0; i < kBatchSize; i++) {
+        instruction_class.emit_raw(&encoder, i);
+      }
+    }
+    encoder.FinalizeCode();
+    std::vector<Instr> encodings(kBatchSize);
+    memcpy(encodings.data(),
+           encoder.GetBuffer()->GetStartAddress<const void*>(),
+           kBatchSize * kInstructionSize);
+
+    size_t sizes[kNumberOfMethods];
+    for (int method = 0; method < kNumberOfMethods; method++) {
+      MacroAssembler masm;
+      masm.SetCPUFeatures(CPUFeatures::All());
+      BenchTimer timer;
+      uint64_t iterations = 0;
+      do {
+        masm.Reset();
+        for (int batch = 0; batch < kBatchesPerFunction; batch++) {
+          switch (method) {
+            case kMacroAssembler:
+              for (int i = 0; i < kBatchSize; i++) {
+                instruction_class.emit_macro(&masm, i);
+              }
+              break;
+            case kAssembler: {
+              ExactAssemblyScope scope(&masm, kBatchSize * kInstructionSize);
+              for (int i = 0; i < kBatchSize; i++) {
+                instruction_class.emit_raw(&masm, i);
+              }
+              break;
+            }
+            case kStream: {
+              InstructionStreamScope stream(&masm, kBatchSize);
+              for (int i = 0; i < kBatchSize; i++) {
+                stream.Emit(encodings[i]);
+              }
+              break;
+            }
+          }
+        }
+        masm.FinalizeCode();
+        iterations++;
+      } while (timer.GetElapsedSeconds() < time_per_run);
+      double instructions =
+          static_cast<double>(iterations) * kBatchesPerFunction * kBatchSize;
+      printf("%-14s %-15s %7.1f M instructions per second.\n",
+             instruction_class.name,
+             kMethodNames[method],
+             instructions / (timer.GetElapsedSeconds() * 1e6));
+      sizes[method] = masm.GetSizeOfCodeGenerated();
+      total_iterations += iterations;
+    }
+    // Every method generates the same amount of code.
+    VIXL_CHECK(sizes[kMacroAssembler] == sizes[kAssembler]);
+    VIXL_CHECK(sizes[kAssembler] == sizes[kStream]);
+  }
+
+  cli.PrintResults(total_iterations, total_timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
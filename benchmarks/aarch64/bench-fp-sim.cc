@@ -0,0 +1,147 @@
+// Copyright 2019, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+typedef void (*KernelGenerator)(MacroAssembler* masm);
+
+static const int kUnroll = 16;
+static const int kInstructionsPerUnroll = 6;
+
+// Each kernel converges, so that the values stay normal.
+static void GenerateScalar(MacroAssembler* masm) {
+  masm->Fmov(d0, 1.0);
+  masm->Fmov(d1, 1.0000001);
+  masm->Fmov(d2, 0.5);
+  for (int i = 0; i < kUnroll; i++) {
+    masm->Fadd(d3, d0, d1);
+    masm->Fsub(d4, d3, d2);
+    masm->Fmul(d5, d4, d1);
+    masm->Fdiv(d6, d5, d1);
+    masm->Fmadd(d0, d6, d2, d2);
+    masm->Fsqrt(d7, d0);
+  }
+}
+
+static void GenerateVector(MacroAssembler* masm) {
+  masm->Fmov(v0.V4S(), 1.0f);
+  masm->Fmov(v1.V4S(), 0.25f);
+  masm->Movi(v6.V4S(), 0);
+  masm->Fmov(v2.V2D(), 1.0);
+  masm->Fmov(v7.V2D(), 0.5);
+  for (int i = 0; i < kUnroll; i++) {
+    masm->Fadd(v3.V4S(), v0.V4S(), v1.V4S());
+    masm->Fmul(v4.V4S(), v3.V4S(), v1.V4S());
+    masm->Fmla(v4.V4S(), v3.V4S(), v1.V4S());
+    masm->Fadd(v0.V4S(), v4.V4S(), v6.V4S());
+    masm->Fmul(v5.V2D(), v2.V2D(), v7.V2D());
+    masm->Fadd(v2.V2D(), v5.V2D(), v7.V2D());
+  }
+}
+
+// Run `generator`'s instructions in a loop, x0 times, with the given SVE vector
+// length, and print the number of simulated FP instructions per second.
+static size_t Run(const char* name,
+                  KernelGenerator generator,
+                  unsigned vector_length,
+                  uint32_t run_time) {
+  const int kInstructionsPerLoop = kInstructionsPerUnroll * kUnroll;
+  const int64_t kLoopsPerRun = 1000;
+
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  Label loop;
+  masm.Bind(&loop);
+  generator(&masm);
+  masm.Subs(x0, x0, 1);
+  masm.B(ne, &loop);
+  masm.Ret();
+  masm.FinalizeCode();
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.SetCPUFeatures(CPUFeatures::All());
+  simulator.SetVectorLengthInBits(vector_length);
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  do {
+    simulator.WriteXRegister(0, kLoopsPerRun);
+    simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+    iterations++;
+  } while (!timer.HasRunFor(run_time));
+
+  double instructions = static_cast<double>(iterations) * kLoopsPerRun *
+                        kInstructionsPerLoop;
+  printf("%-8s VL%-4u %8.3f million FP instructions per second\n",
+         name,
+         vector_length,
+         instructions / timer.GetElapsedSeconds() / 1e6);
+  return iterations;
+}
+
+// This program measures how quickly the simulator executes common scalar and
+// vector floating-point arithmetic instructions, when no NaNs are involved.
+// None of the kernels use SVE, but the simulated vector registers are as large
+// as the configured vector length, so they are run with several lengths. Each
+// configuration runs for RUN_TIME seconds.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  const unsigned kVectorLengths[] = {kZRegMinSize, 512, kZRegMaxSize};
+  for (unsigned vl : kVectorLengths) {
+    iterations +=
+        Run("Scalar", GenerateScalar, vl, cli.GetRunTimeInSeconds());
+  }
+  for (unsigned vl : kVectorLengths) {
+    iterations +=
+        Run("Vector", GenerateVector, vl, cli.GetRunTimeInSeconds());
+  }
+
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
+
+#else   // VIXL_INCLUDE_SIMULATOR_AARCH64
+int main(void) {
+  printf("This benchmark requires AArch64 simulator support.\n");
+  return EXIT_FAILURE;
+}
+#endif  // VIXL_INCLUDE_SIMULATOR_AARCH64
@@ -0,0 +1,97 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program focuses on loading constants through the literal pool, with
+// literal deduplication enabled. Most of the constants are repeated, as is
+// typical of generated code that refers to the same tags, masks or addresses
+// many times, so the pool stays small and is emitted rarely.
+
+static const size_t kBufferSize = 256 * KBytes;
+// Number of `Ldr` macros per group; each group uses the same constants.
+static const int kLoadsPerGroup = 8;
+// Number of distinct groups of constants.
+static const int kDistinctGroups = 16;
+
+static void GenerateCode(MacroAssembler* masm) {
+  const size_t bytes_per_group = kLoadsPerGroup * kInstructionSize;
+  // Leave enough space for the literal pools, even without deduplication.
+  const size_t max_groups = (kBufferSize / 4) / bytes_per_group;
+  for (size_t i = 0; i < max_groups; ++i) {
+    uint64_t base = 0x0123456789abcdef + (i % kDistinctGroups);
+    masm->Ldr(x0, base);
+    masm->Ldr(x1, base ^ 0xffff0000ffff0000);
+    masm->Ldr(w2, 0x12345678 + (i % kDistinctGroups));
+    masm->Ldr(w3, 0x87654321);
+    masm->Ldr(d0, 1.5 + (i % kDistinctGroups));
+    masm->Ldr(s1, 0.1f);
+    masm->Ldr(q2, 0x0f0f0f0f0f0f0f0f, base);
+    masm->Ldr(x4, 0x0000ffff0000ffff);
+  }
+  masm->FinalizeCode();
+}
+
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  MacroAssembler masm(kBufferSize);
+  masm.GetLiteralPool()->SetDeduplication(true);
+
+  BenchTimer timer;
+
+  size_t iterations = 0;
+  do {
+    masm.Reset();
+    GenerateCode(&masm);
+    iterations++;
+  } while (!timer.HasRunFor(cli.GetRunTimeInSeconds()));
+
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+
+  // Report the effect of deduplication by generating the same code without it.
+  uint64_t deduplicated_size = masm.GetSizeOfCodeGenerated();
+  uint64_t saved = masm.GetLiteralPool()->GetDeduplicatedSize() / iterations;
+  MacroAssembler reference(kBufferSize);
+  GenerateCode(&reference);
+  uint64_t reference_size = reference.GetSizeOfCodeGenerated();
+  printf("Code size: %" PRIu64 " bytes (%" PRIu64
+         " without deduplication). Literal bytes saved: %" PRIu64 ".\n",
+         deduplicated_size,
+         reference_size,
+         saved);
+
+  return cli.GetExitCode();
+}
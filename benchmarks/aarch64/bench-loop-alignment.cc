@@ -0,0 +1,133 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program measures the effect of loop alignment on the throughput of a
+// small loop. The loop header is deliberately misaligned, and then aligned
+// with each supported loop alignment in turn.
+//
+// The code runs natively on AArch64 hosts, and in the Simulator otherwise. The
+// Simulator doesn't model instruction fetch, so there it only shows the cost
+// of the padding.
+
+static const uint64_t kLoopIterations = 1000;
+
+static void GenerateLoop(MacroAssembler* masm) {
+  Label loop;
+  masm->Mov(x1, kLoopIterations);
+  masm->Mov(x2, 0);
+  // Put the loop header one instruction past a 64-byte boundary, so that it
+  // is as far as possible from the next boundary for every alignment, and
+  // each alignment needs a different amount of padding.
+  while (!IsAligned(masm->GetCursorOffset() - kInstructionSize, 64)) {
+    masm->Nop();
+  }
+  masm->Bind(&loop, kLoopHeaderHint);
+  masm->Add(x2, x2, x1);
+  masm->Eor(x3, x2, Operand(x1, LSL, 3));
+  masm->Add(x2, x2, Operand(x3, LSR, 7));
+  masm->Sub(x1, x1, 1);
+  masm->Cbnz(x1, &loop);
+  masm->Mov(x0, x2);
+  masm->Ret();
+}
+
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  const int alignments[] = {4, 16, 32, 64};
+  const int count = sizeof(alignments) / sizeof(alignments[0]);
+  double time_per_alignment =
+      static_cast<double>(cli.GetRunTimeInSeconds()) / count;
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  Decoder decoder;
+  Simulator simulator(&decoder);
+#elif !defined(__aarch64__) || !defined(VIXL_CODE_BUFFER_MMAP)
+  printf("This benchmark requires AArch64 simulator support, or an AArch64 "
+         "host with VIXL_CODE_BUFFER_MMAP.\n");
+  return EXIT_FAILURE;
+#endif
+
+  BenchTimer total_timer;
+  size_t total_iterations = 0;
+  uint64_t expected_result = 0;
+  for (int i = 0; i < count; i++) {
+    MacroAssembler masm;
+    if (alignments[i] > static_cast<int>(kInstructionSize)) {
+      masm.SetLabelAlignment(kLoopHeaderHint, alignments[i]);
+    }
+    GenerateLoop(&masm);
+    masm.FinalizeCode();
+    const Instruction* start =
+        masm.GetBuffer()->GetStartAddress<const Instruction*>();
+
+    BenchTimer timer;
+    size_t iterations = 0;
+    uint64_t result;
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+    do {
+      simulator.RunFrom(start);
+      iterations++;
+    } while (timer.GetElapsedSeconds() < time_per_alignment);
+    result = simulator.ReadXRegister(0);
+#else
+    masm.GetBuffer()->SetExecutable();
+    typedef uint64_t (*LoopFunction)();
+    LoopFunction function = reinterpret_cast<LoopFunction>(
+        reinterpret_cast<uintptr_t>(start));
+    do {
+      result = function();
+      iterations++;
+    } while (timer.GetElapsedSeconds() < time_per_alignment);
+    masm.GetBuffer()->SetWritable();
+#endif
+    // Every layout must compute the same result.
+    if (i == 0) expected_result = result;
+    VIXL_CHECK(result == expected_result);
+
+    double ns_per_iteration = (timer.GetElapsedSeconds() * 1e9) /
+                              (iterations * kLoopIterations);
+    printf("Alignment %2d: %" PRIu64 " bytes, %.2f ns per loop iteration.\n",
+           alignments[i],
+           static_cast<uint64_t>(masm.GetSizeOfCodeGenerated()),
+           ns_per_iteration);
+    total_iterations += iterations;
+  }
+
+  cli.PrintResults(total_iterations, total_timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
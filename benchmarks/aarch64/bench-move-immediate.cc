@@ -0,0 +1,83 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program focuses on materialising 64-bit immediates with `Mov`.
+//
+// Half of the immediates are drawn from a small set of constants, as a JIT
+// would use for tags and masks, and the other half are pseudo-random values
+// shaped like pointers, so that most of them are unique.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  const size_t buffer_size = 256 * KBytes;
+  // Leave space for the longest sequences.
+  const size_t mov_count = buffer_size / (4 * kInstructionSize);
+  MacroAssembler masm(buffer_size);
+
+  static const uint64_t kConstants[] = {0xfff8000000000000,
+                                        0x0000ffffffffffff,
+                                        0x5555123455555555,
+                                        0x000fff001234ff00,
+                                        0x7ff0000000000001,
+                                        0x123456789abcdef0,
+                                        0x00ff00ff00ff1234,
+                                        0x0000800000000000};
+
+  BenchTimer timer;
+
+  uint64_t seed = 42;
+  size_t iterations = 0;
+  do {
+    masm.Reset();
+    for (size_t i = 0; i < mov_count; ++i) {
+      uint64_t imm;
+      if ((i % 2) == 0) {
+        imm = kConstants[(i / 2) % ArrayLength(kConstants)];
+      } else {
+        // A linear congruential generator is good enough here.
+        seed = (seed * UINT64_C(6364136223846793005)) +
+               UINT64_C(1442695040888963407);
+        imm = (seed >> 16) & 0x00007ffffffffff8;
+      }
+      masm.Mov(x0, imm);
+    }
+    masm.FinalizeCode();
+    iterations++;
+  } while (!timer.HasRunFor(cli.GetRunTimeInSeconds()));
+
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
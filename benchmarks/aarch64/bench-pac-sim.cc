@@ -0,0 +1,107 @@
+// Copyright 2019, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// Call a non-leaf function x0 times. It signs its return address, as if it
+// were compiled with -mbranch-protection=pac-ret, and calls two leaf functions
+// which do the same. Each call therefore signs and authenticates a return
+// address.
+static void Generate(MacroAssembler* masm) {
+  Label outer, inner, loop;
+
+  masm->Push(lr, xzr);
+  masm->Bind(&loop);
+  masm->Bl(&outer);
+  masm->Subs(x0, x0, 1);
+  masm->B(ne, &loop);
+  masm->Pop(xzr, lr);
+  masm->Ret();
+
+  masm->Bind(&outer);
+  masm->Paciasp();
+  masm->Push(lr, xzr);
+  masm->Bl(&inner);
+  masm->Bl(&inner);
+  masm->Pop(xzr, lr);
+  masm->Retaa();
+
+  masm->Bind(&inner);
+  masm->Paciasp();
+  masm->Add(x1, x1, 1);
+  masm->Retaa();
+}
+
+// This program measures how quickly the simulator executes function calls
+// that use pointer authentication to protect their return addresses.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  const int kCallsPerRun = 3;
+  const int64_t kIterationsPerRun = 10000;
+
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  Generate(&masm);
+  masm.FinalizeCode();
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.SetCPUFeatures(CPUFeatures::All());
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  do {
+    simulator.WriteXRegister(0, kIterationsPerRun);
+    simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+    iterations++;
+  } while (!timer.HasRunFor(cli.GetRunTimeInSeconds()));
+
+  double calls =
+      static_cast<double>(iterations) * kIterationsPerRun * kCallsPerRun;
+  printf("%g calls per second\n", calls / timer.GetElapsedSeconds());
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
+
+#else   // VIXL_INCLUDE_SIMULATOR_AARCH64
+int main(void) {
+  printf("This benchmark requires AArch64 simulator support.\n");
+  return EXIT_FAILURE;
+}
+#endif  // VIXL_INCLUDE_SIMULATOR_AARCH64
@@ -0,0 +1,119 @@
+// Copyright 2019, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#include "bench-utils.h"
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+static const uint64_t kInstructionsPerRun = 1000000;
+
+// Run `code` from the same initial state until RUN_TIME seconds have passed,
+// and print the simulated instruction rate.
+static size_t Run(Simulator* simulator,
+                  const Instruction* code,
+                  Simulator::ReplayMode mode,
+                  SimReplayLog* log,
+                  uint32_t run_time) {
+  static const char* kModeNames[] = {"disabled", "record", "replay"};
+  BenchTimer timer;
+  size_t runs = 0;
+  do {
+    if (mode == Simulator::kRecord) log->Clear();
+    if (mode == Simulator::kReplay) log->Rewind();
+    simulator->ResetState();
+    simulator->SetReplayLog(mode, log);
+    simulator->WritePc(code, Simulator::NoBranchLog);
+    simulator->RunFor(kInstructionsPerRun);
+    runs++;
+  } while (!timer.HasRunFor(run_time));
+  simulator->SetReplayLog(Simulator::kReplayDisabled, NULL);
+
+  double seconds = timer.GetElapsedSeconds();
+  printf("Replay %-8s %8.3f million instructions per second\n",
+         kModeNames[mode],
+         runs * kInstructionsPerRun / seconds / 1e6);
+  return runs;
+}
+
+// This program measures the cost of recording and replaying the
+// nondeterministic inputs of a simulation, for code that uses RNDR and
+// exclusive accesses heavily.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  uint64_t data[2] = {0, 0};
+
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures(CPUFeatures::kRNG));
+  Label loop;
+  masm.Mov(x2, reinterpret_cast<uintptr_t>(&data[0]));
+  masm.Mov(x3, reinterpret_cast<uintptr_t>(&data[1]));
+  masm.Bind(&loop);
+  masm.Mrs(x0, RNDR);
+  masm.Ldxr(x1, MemOperand(x2));
+  masm.Str(x0, MemOperand(x3));
+  masm.Add(x1, x1, x0);
+  masm.Stxr(w4, x1, MemOperand(x2));
+  masm.Add(x5, x5, x4);
+  masm.Add(x6, x6, 1);
+  masm.B(&loop);
+  masm.FinalizeCode();
+  const Instruction* code = masm.GetBuffer()->GetStartAddress<Instruction*>();
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  SimReplayLog log;
+
+  BenchTimer timer;
+  size_t iterations = 0;
+  uint32_t run_time = cli.GetRunTimeInSeconds();
+  iterations +=
+      Run(&simulator, code, Simulator::kReplayDisabled, NULL, run_time);
+  iterations += Run(&simulator, code, Simulator::kRecord, &log, run_time);
+  printf("Log size: %zu bytes per million instructions\n",
+         log.GetSizeInBytes());
+  iterations += Run(&simulator, code, Simulator::kReplay, &log, run_time);
+
+  cli.PrintResults(iterations, timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
+
+#else   // VIXL_INCLUDE_SIMULATOR_AARCH64
+int main(void) {
+  printf("This benchmark requires AArch64 simulator support.\n");
+  return EXIT_FAILURE;
+}
+#endif  // VIXL_INCLUDE_SIMULATOR_AARCH64
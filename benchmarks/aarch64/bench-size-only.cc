@@ -0,0 +1,81 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program compares real code generation with size-only measurement of the
+// same code, using the MacroAssembler. The code is the same mix as in
+// bench-mixed-masm, including branches, literals and pools.
+//
+// For each mode, the size of the generated code and the time taken to generate
+// it are printed. The sizes must match.
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  const size_t code_size = 256 * KBytes;
+
+  // Share the run time evenly between the modes, but always generate the code
+  // at least once.
+  double time_per_mode = static_cast<double>(cli.GetRunTimeInSeconds()) / 2;
+
+  BenchTimer total_timer;
+  size_t total_iterations = 0;
+  size_t sizes[2];
+  for (int size_only = 0; size_only < 2; size_only++) {
+    MacroAssembler masm;
+    masm.SetCPUFeatures(CPUFeatures::All());
+    masm.SetSizeOnly(size_only != 0);
+    BenchTimer timer;
+    size_t iterations = 0;
+    do {
+      masm.Reset();
+      // Use a new generator each time, so that the code is always the same.
+      BenchCodeGenerator generator(&masm);
+      generator.Generate(code_size);
+      masm.FinalizeCode();
+      iterations++;
+    } while (timer.GetElapsedSeconds() < time_per_mode);
+    double us_per_function = (timer.GetElapsedSeconds() * 1e6) / iterations;
+    sizes[size_only] = masm.GetSizeOfCodeGenerated();
+    printf("%-10s %" PRIu64 " bytes, %.1f us per function.\n",
+           size_only ? "Size-only" : "Real",
+           static_cast<uint64_t>(sizes[size_only]),
+           us_per_function);
+    total_iterations += iterations;
+  }
+  VIXL_CHECK(sizes[0] == sizes[1]);
+
+  cli.PrintResults(total_iterations, total_timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
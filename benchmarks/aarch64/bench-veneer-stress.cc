@@ -0,0 +1,109 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "globals-vixl.h"
+
+#include "aarch64/instructions-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+
+#include "bench-utils.h"
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+// This program stresses the veneer pool bookkeeping with very large numbers of
+// pending forward branches. Each group of branches targets its own label, and
+// the labels are only bound at the end of the function, so the number of
+// unresolved branches grows up to the size of the function (or as far as the
+// branch ranges permit, after which veneers are emitted).
+//
+// The time per branch is printed for each function size. It should stay
+// roughly constant as the number of pending branches grows.
+
+static const size_t kBranchesPerLabel = 16;
+
+static void GenerateFunction(MacroAssembler* masm, size_t branches) {
+  std::vector<Label> labels(branches / kBranchesPerLabel + 1);
+  for (size_t i = 0; i < branches; i++) {
+    Label* label = &labels[i / kBranchesPerLabel];
+    switch (i % 4) {
+      case 0:
+        masm->Tbz(x0, i % 64, label);
+        break;
+      case 1:
+        masm->Cbz(x1, label);
+        break;
+      case 2:
+        masm->B(ne, label);
+        break;
+      case 3:
+        masm->Tbnz(w2, i % 32, label);
+        break;
+    }
+  }
+  for (size_t i = 0; i < labels.size(); i++) {
+    masm->Bind(&labels[i]);
+  }
+  masm->FinalizeCode();
+}
+
+int main(int argc, char* argv[]) {
+  BenchCLI cli(argc, argv);
+  if (cli.ShouldExitEarly()) return cli.GetExitCode();
+
+  static const size_t kSizes[] = {1000, 10000, 100000, 1000000};
+  static const size_t kNumberOfSizes = sizeof(kSizes) / sizeof(kSizes[0]);
+  // Share the run time evenly between the function sizes, but always generate
+  // each function at least once.
+  double time_per_size =
+      static_cast<double>(cli.GetRunTimeInSeconds()) / kNumberOfSizes;
+
+  BenchTimer total_timer;
+  size_t total_iterations = 0;
+  for (size_t s = 0; s < kNumberOfSizes; s++) {
+    size_t branches = kSizes[s];
+    MacroAssembler masm;
+    BenchTimer timer;
+    size_t iterations = 0;
+    do {
+      masm.Reset();
+      GenerateFunction(&masm, branches);
+      iterations++;
+    } while (timer.GetElapsedSeconds() < time_per_size);
+    double ns_per_branch =
+        (timer.GetElapsedSeconds() * 1e9) / (iterations * branches);
+    printf("%7" PRIu64 " branches: %" PRIu64
+           " iteration%s, %.1f ns per branch.\n",
+           static_cast<uint64_t>(branches),
+           static_cast<uint64_t>(iterations),
+           (iterations == 1) ? "" : "s",
+           ns_per_branch);
+    total_iterations += iterations;
+  }
+
+  cli.PrintResults(total_iterations, total_timer.GetElapsedSeconds());
+  return cli.GetExitCode();
+}
@@ -0,0 +1,248 @@
+// Copyright 2020, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "aarch64/decoder-aarch64.h"
+#include "aarch64/disasm-aarch64.h"
+#include "aarch64/feature-audit-aarch64.h"
+
+// This example is interactive, and isn't tested systematically.
+#ifndef TEST_EXAMPLES
+
+using namespace vixl;
+using namespace vixl::aarch64;
+
+void PrintUsage(char const* name) {
+  printf("Usage: %s [OPTION]... <FILE>\n", name);
+  printf("\n");
+  printf("Report the CPU features required by each function in a file of\n");
+  printf("raw A64 or C64 code.\n");
+  printf("\n");
+  printf(
+      "Options:\n"
+      "  --symbols <file>\n"
+      "    Split the code into functions using a symbol list, with one symbol\n"
+      "    per line in the format printed by `nm`: a hexadecimal address,\n"
+      "    an optional type, and a name. Each function ends where the next\n"
+      "    one starts. Without a symbol list, the whole file is audited as\n"
+      "    one function.\n"
+      "\n"
+      "  --base <address>\n"
+      "    The address of the start of the file, as used by the symbols.\n"
+      "    Defaults to 0.\n"
+      "\n"
+      "  --baseline <feature>[,<feature>]...\n"
+      "    The features of the oldest core that the code must run on, named\n"
+      "    as in the report (for example 'FP,NEON,CRC32'). The first use of\n"
+      "    each other feature is reported, and the exit status is 1 if there\n"
+      "    are any.\n"
+      "\n"
+      "  --threads <n>\n"
+      "    The number of threads to use. Defaults to one per core.\n"
+      "\n"
+      "  --a64\n"
+      "    Decode the code as A64. This is the default.\n"
+      "\n"
+      "  --c64\n"
+      "    Decode the code as C64.\n"
+      "\n");
+  printf("Example:\n");
+  printf("  $ objcopy -O binary --only-section=.text foo.so foo.text\n");
+  printf("  $ nm --defined-only foo.so | grep -i ' t ' > foo.syms\n");
+  printf("  $ %s --base 0x1000 --symbols foo.syms --baseline FP,NEON "
+         "foo.text\n",
+         name);
+}
+
+bool ParseFeatures(const char* arg, CPUFeatures* features) {
+  std::stringstream list(arg);
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    bool found = false;
+    CPUFeatures all = CPUFeatures::All();
+    for (CPUFeatures::Feature feature : all) {
+      std::ostringstream feature_name;
+      feature_name << feature;
+      if (strcasecmp(feature_name.str().c_str(), name.c_str()) == 0) {
+        features->Combine(feature);
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      printf("Unknown feature: '%s'.\n", name.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+struct Symbol {
+  uint64_t address;
+  std::string name;
+  bool operator<(const Symbol& other) const { return address < other.address; }
+};
+
+bool ReadSymbols(const char* filename, std::vector<Symbol>* symbols) {
+  std::ifstream file(filename);
+  if (!file) {
+    printf("Cannot open '%s'.\n", filename);
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (fields >> token) tokens.push_back(token);
+    if ((tokens.size() < 2) || (tokens.size() > 3)) continue;
+    char* end;
+    Symbol symbol;
+    symbol.address = strtoull(tokens[0].c_str(), &end, 16);
+    if (*end != '\0') continue;
+    symbol.name = tokens.back();
+    symbols->push_back(symbol);
+  }
+  std::stable_sort(symbols->begin(), symbols->end());
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  const char* code_file = NULL;
+  const char* symbol_file = NULL;
+  uint64_t base = 0;
+  CPUFeatures baseline;
+  int threads = 0;
+  ISA isa = ISA::A64;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    bool has_value = (i + 1) < argc;
+    if ((strcmp(arg, "--help") == 0) || (strcmp(arg, "-h") == 0)) {
+      PrintUsage(argv[0]);
+      return 0;
+    } else if ((strcmp(arg, "--symbols") == 0) && has_value) {
+      symbol_file = argv[++i];
+    } else if ((strcmp(arg, "--base") == 0) && has_value) {
+      base = strtoull(argv[++i], NULL, 0);
+    } else if ((strcmp(arg, "--baseline") == 0) && has_value) {
+      if (!ParseFeatures(argv[++i], &baseline)) return 2;
+    } else if ((strcmp(arg, "--threads") == 0) && has_value) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(arg, "--a64") == 0) {
+      isa = ISA::A64;
+    } else if (strcmp(arg, "--c64") == 0) {
+      isa = ISA::C64;
+    } else if ((arg[0] != '-') && (code_file == NULL)) {
+      code_file = arg;
+    } else {
+      PrintUsage(argv[0]);
+      return 2;
+    }
+  }
+  if (code_file == NULL) {
+    PrintUsage(argv[0]);
+    return 2;
+  }
+
+  // Read the code into an aligned buffer. A trailing partial instruction is
+  // ignored.
+  std::ifstream file(code_file, std::ios::binary);
+  if (!file) {
+    printf("Cannot open '%s'.\n", code_file);
+    return 2;
+  }
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+  std::vector<Instr> code(bytes.size() / kInstructionSize);
+  if (!code.empty()) memcpy(code.data(), bytes.data(), code.size() * 4);
+  const Instruction* start = reinterpret_cast<const Instruction*>(code.data());
+  const Instruction* end = start + (code.size() * kInstructionSize);
+  uint64_t size = code.size() * kInstructionSize;
+
+  FeatureAudit audit(baseline);
+  if (symbol_file == NULL) {
+    audit.AddFunction(code_file, start, end, isa);
+  } else {
+    std::vector<Symbol> symbols;
+    if (!ReadSymbols(symbol_file, &symbols)) return 2;
+    for (size_t i = 0; i < symbols.size(); i++) {
+      uint64_t offset = symbols[i].address - base;
+      uint64_t next = (i + 1 < symbols.size()) ? symbols[i + 1].address - base
+                                               : size;
+      // Ignore symbols outside the code, and misaligned symbols.
+      if ((symbols[i].address < base) || (offset >= size)) continue;
+      if ((offset % kInstructionSize) != 0) continue;
+      next = std::min(AlignDown(next, kInstructionSize), size);
+      audit.AddFunction(symbols[i].name, start + offset, start + next, isa);
+    }
+  }
+  audit.Run(threads);
+
+  // Print the minimal features of each function, and the first use of each
+  // feature outside the baseline.
+  Decoder decoder;
+  Disassembler disasm;
+  decoder.AppendVisitor(&disasm);
+  for (int i = 0; i < audit.GetNumberOfFunctions(); i++) {
+    const FeatureAudit::Function& function = audit.GetFunction(i);
+    std::cout << function.name << ": {";
+    if (!function.features.HasNoFeatures()) {
+      std::cout << " " << function.features;
+    }
+    std::cout << " }\n";
+    for (const FeatureAudit::FirstUse& use : function.first_uses) {
+      if (baseline.Has(use.first)) continue;
+      decoder.Decode(use.second, isa);
+      char address[32];
+      snprintf(address,
+               sizeof(address),
+               "0x%016" PRIx64,
+               base + static_cast<uint64_t>(use.second - start));
+      std::cout << "  " << use.first << ": " << address << "  "
+                << disasm.GetOutput() << "\n";
+    }
+  }
+  CPUFeatures required = audit.GetRequiredFeatures();
+  std::cout << "Required: {";
+  if (!required.HasNoFeatures()) std::cout << " " << required;
+  std::cout << " }\n";
+
+  return audit.IsCompatible() ? 0 : 1;
+}
+
+#endif  // TEST_EXAMPLES
@@ -71,19 +71,20 @@ void Assembler::BindToOffset(Label* label, ptrdiff_t offset) {
   // This requires that `label` has a known target ISA.
   label->Bind(offset);
 
+  if (IsSizeOnly()) {
+    // There is no code to patch.
+    label->ClearAllLinks();
+    return;
+  }
+
   Instruction* target = GetLabelAddress<Instruction*>(label);
   ISA target_isa = label->GetISA();
 
-  int isa_mask = kInstructionSize - 1;
-  for (Label::LabelLinksIterator it(label); !it.Done(); it.Advance()) {
-    ptrdiff_t link = *it.Current();
-    // Only instructions can be links, so the source must be either A64 or C64.
-    VIXL_ASSERT((link & isa_mask) <= 1);
-    ISA source_isa = ((link & isa_mask) == 1) ? ISA::C64 : ISA::A64;
+  for (Label::LabelLinksIterator it(label, GetBuffer()); !it.Done();
+       it.Advance()) {
     Instruction* source =
-        GetBuffer()->GetOffsetAddress<Instruction*>(link & ~isa_mask);
-
-    source->SetImmPCOffsetTarget(target, source_isa, target_isa);
+        GetBuffer()->GetOffsetAddress<Instruction*>(it.GetCurrentOffset());
+    source->SetImmPCOffsetTarget(target, it.GetCurrentISA(), target_isa);
   }
   label->ClearAllLinks();
 }
@@ -95,39 +96,208 @@ void Assembler::BindToOffset(Label* label, ptrdiff_t offset) {
 // multiple of 1 << element_shift, then calculating the (scaled) offset between
 // them. This matches the semantics of adrp, for example.
 template <int element_shift>
-ptrdiff_t Assembler::LinkAndGetOffsetTo(Label* label) {
+ptrdiff_t Assembler::LinkAndGetOffsetTo(Label* label, int chain_field_width) {
   VIXL_STATIC_ASSERT(element_shift >= 0);
   VIXL_STATIC_ASSERT(element_shift < (sizeof(ptrdiff_t) * 8));
 
   if (label->IsBound()) {
-    uint64_t label_offset = GetLabelAddress<uint64_t>(label) >> element_shift;
+    uint64_t label_address;
+    uint64_t pc_address;
+    if (IsSizeOnly()) {
+      // Real buffers are page-aligned, so offsets give the same results.
+      label_address = label->GetLocation();
+      pc_address = GetCursorOffset();
+    } else {
+      label_address = GetLabelAddress<uint64_t>(label);
+      pc_address = GetCursorAddress<uint64_t>();
+    }
+    uint64_t label_offset = label_address >> element_shift;
     uint64_t interwork_offset =
         static_cast<uint64_t>(label->GetInterworkOffset()) >> element_shift;
-    uint64_t pc_offset = GetCursorAddress<uint64_t>() >> element_shift;
+    uint64_t pc_offset = pc_address >> element_shift;
     return RawbitsToInt64(label_offset + interwork_offset - pc_offset);
-  } else {
-    label->AddLink(GetBuffer()->GetCursorOffset(), GetISA());
-    return 0;
   }
+
+  if (!link_labels_) return 0;
+
+  ptrdiff_t cursor = GetBuffer()->GetCursorOffset();
+  // In size-only mode, there is no code to hold the chain.
+  if ((chain_field_width > 0) && !IsSizeOnly()) {
+    // Try to add the instruction to the in-code chain. The value to encode is
+    // the offset to the previous link, in instructions, or 0 if there isn't
+    // one.
+    ptrdiff_t chain_offset = 0;
+    if (label->link_chain_head_ != Label::kNoLinkChain) {
+      chain_offset = (label->link_chain_head_ - cursor) / kInstructionSize;
+      VIXL_ASSERT(chain_offset < 0);
+    }
+    if (IsIntN(chain_field_width, chain_offset)) {
+      label->link_chain_head_ = cursor;
+      return chain_offset;
+    }
+  }
+  label->AddLink(cursor, GetISA());
+  return 0;
 }
 
 
-ptrdiff_t Assembler::LinkAndGetByteOffsetTo(Label* label) {
+ptrdiff_t Assembler::LinkAndGetByteOffsetTo(Label* label,
+                                            int chain_field_width) {
   // The target can be either code or data, so don't call EnsureISA.
-  return LinkAndGetOffsetTo<0>(label);
+  return LinkAndGetOffsetTo<0>(label, chain_field_width);
 }
 
 
-ptrdiff_t Assembler::LinkAndGetBranchOffsetTo(Label* label) {
+ptrdiff_t Assembler::LinkAndGetBranchOffsetTo(Label* label,
+                                              ImmBranchType branch_type) {
   // The target ISA should be the same as the current ISA.
-  label->EnsureISA(GetISA());
-  return LinkAndGetOffsetTo<kInstructionSizeLog2>(label);
+  if (link_labels_ || label->IsBound()) label->EnsureISA(GetISA());
+  return LinkAndGetOffsetTo<kInstructionSizeLog2>(
+      label,
+      Instruction::GetImmBranchRangeBitwidth(branch_type));
 }
 
 
-ptrdiff_t Assembler::LinkAndGetPageOffsetTo(Label* label) {
+ptrdiff_t Assembler::LinkAndGetPageOffsetTo(Label* label,
+                                            int chain_field_width) {
   // The target can be either code or data, so don't call EnsureISA.
-  return LinkAndGetOffsetTo<kPageSizeLog2>(label);
+  return LinkAndGetOffsetTo<kPageSizeLog2>(label, chain_field_width);
+}
+
+
+void Assembler::EmitVeneer(ptrdiff_t branch_offset, Label* label) {
+  VIXL_ASSERT(!label->IsBound());
+  if (IsSizeOnly()) {
+    // Links are never chained in size-only mode, and there is nothing to
+    // patch.
+    bool deleted = label->DeleteLink(branch_offset, label->GetISA());
+    VIXL_ASSERT(deleted);
+    USE(deleted);
+    b(label);
+    return;
+  }
+
+  Instruction* branch = GetInstructionAt(branch_offset);
+  Instruction* veneer = GetCursorAddress<Instruction*>();
+  // The source/target ISA makes a difference for `bx #4` and variants of
+  // `adr`. None of those are handled by veneers, so we just pretend that we
+  // are branching from A64 to A64.
+  VIXL_ASSERT(!branch->IsPCRelAddressing());
+  VIXL_ASSERT(!branch->IsMorelloBX());
+
+  if (label->DeleteLink(branch_offset, label->GetISA())) {
+    // The branch was not chained, so the veneer is simply a new link.
+    branch->SetImmPCOffsetTarget(veneer, ISA::A64, ISA::A64);
+    b(label);
+    return;
+  }
+
+  // The veneer takes the place of the branch in the in-code chain. Links that
+  // refer to the branch will find the veneer through the (forward) offset
+  // that the branch now holds.
+  ptrdiff_t delta = Label::GetLinkChainDelta(branch);
+  VIXL_ASSERT(delta <= 0);
+  ptrdiff_t chain_offset = 0;
+  if (delta != 0) {
+    chain_offset =
+        (branch_offset + delta - GetCursorOffset()) / kInstructionSize;
+  }
+  VIXL_ASSERT(Instruction::IsValidImmPCOffset(UncondBranchType, chain_offset));
+  label->EnsureISA(GetISA());
+  branch->SetImmPCOffsetTarget(veneer, ISA::A64, ISA::A64);
+  b(static_cast<int>(chain_offset));
+}
+
+
+ptrdiff_t Label::GetLinkChainDelta(const Instruction* link) {
+  int64_t offset;
+  if (link->IsPCRelAddressing()) {
+    // `adr` and `adrp` also hold an offset in instructions.
+    offset = link->GetImmPCRel();
+  } else {
+    switch (link->GetBranchType()) {
+      case CondBranchType:
+        offset = link->GetImmCondBranch();
+        break;
+      case UncondBranchType:
+        offset = link->GetImmUncondBranch();
+        break;
+      case CompareBranchType:
+        offset = link->GetImmCmpBranch();
+        break;
+      case TestBranchType:
+        offset = link->GetImmTestBranch();
+        break;
+      default:
+        VIXL_UNREACHABLE();
+        offset = 0;
+    }
+  }
+  return offset * kInstructionSize;
+}
+
+
+Label::LabelLinksIterator::LabelLinksIterator(Label* label,
+                                              const CodeBuffer* buffer)
+    : label_(label),
+      buffer_(buffer),
+      chain_link_(kNoLinkChain),
+      next_chain_link_(kNoLinkChain),
+      links_it_(&label->links_) {
+  MoveToChainLink(label->link_chain_head_);
+}
+
+
+void Label::LabelLinksIterator::Advance() {
+  VIXL_ASSERT(!Done());
+  if (chain_link_ != kNoLinkChain) {
+    MoveToChainLink(next_chain_link_);
+  } else {
+    ++links_it_;
+  }
+}
+
+
+ptrdiff_t Label::LabelLinksIterator::GetCurrentOffset() {
+  VIXL_ASSERT(!Done());
+  if (chain_link_ != kNoLinkChain) return chain_link_;
+  // Other links encode the source ISA in the bottom bit.
+  return AlignDown(*links_it_, kInstructionSize);
+}
+
+
+ISA Label::LabelLinksIterator::GetCurrentISA() {
+  VIXL_ASSERT(!Done());
+  if (chain_link_ == kNoLinkChain) {
+    ptrdiff_t link = *links_it_;
+    // Only instructions can be links, so the source must be either A64 or C64.
+    VIXL_ASSERT((link % kInstructionSize) <= 1);
+    return ((link % kInstructionSize) == 1) ? ISA::C64 : ISA::A64;
+  }
+  const Instruction* link =
+      buffer_->GetOffsetAddress<const Instruction*>(chain_link_);
+  if (link->IsPCRelAddressing() &&
+      (link->Mask(PCRelAddressingMask) == ADRP)) {
+    return ISA::A64;
+  }
+  return label_->GetISA();
+}
+
+
+void Label::LabelLinksIterator::MoveToChainLink(ptrdiff_t offset) {
+  while (offset != kNoLinkChain) {
+    const Instruction* link =
+        buffer_->GetOffsetAddress<const Instruction*>(offset);
+    ptrdiff_t delta = GetLinkChainDelta(link);
+    if (delta <= 0) {
+      chain_link_ = offset;
+      next_chain_link_ = (delta == 0) ? kNoLinkChain : (offset + delta);
+      return;
+    }
+    // This branch was redirected to a veneer; follow it.
+    offset += delta;
+  }
+  chain_link_ = kNoLinkChain;
 }
 
 
@@ -135,7 +305,7 @@ void Assembler::place(RawLiteral* literal) {
   VIXL_ASSERT(!literal->IsPlaced());
 
   // Patch instructions using this literal.
-  if (literal->IsUsed()) {
+  if (literal->IsUsed() && !IsSizeOnly()) {
     Instruction* target = GetCursorAddress<Instruction*>();
     ptrdiff_t offset = literal->GetLastUse();
     bool done;
@@ -294,14 +464,14 @@ void Assembler::b(int64_t imm19, Condition cond) {
 
 
 void Assembler::b(Label* label) {
-  int64_t offset = LinkAndGetBranchOffsetTo(label);
+  int64_t offset = LinkAndGetBranchOffsetTo(label, UncondBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(UncondBranchType, offset));
   b(static_cast<int>(offset));
 }
 
 
 void Assembler::b(Label* label, Condition cond) {
-  int64_t offset = LinkAndGetBranchOffsetTo(label);
+  int64_t offset = LinkAndGetBranchOffsetTo(label, CondBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(CondBranchType, offset));
   b(static_cast<int>(offset), cond);
 }
@@ -311,7 +481,7 @@ void Assembler::bl(int64_t imm26) { Emit(BL | ImmUncondBranch(imm26)); }
 
 
 void Assembler::bl(Label* label) {
-  int64_t offset = LinkAndGetBranchOffsetTo(label);
+  int64_t offset = LinkAndGetBranchOffsetTo(label, UncondBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(UncondBranchType, offset));
   bl(static_cast<int>(offset));
 }
@@ -323,7 +493,7 @@ void Assembler::cbz(const Register& rt, int64_t imm19) {
 
 
 void Assembler::cbz(const Register& rt, Label* label) {
-  int64_t offset = LinkAndGetBranchOffsetTo(label);
+  int64_t offset = LinkAndGetBranchOffsetTo(label, CompareBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(CompareBranchType, offset));
   cbz(rt, static_cast<int>(offset));
 }
@@ -335,7 +505,7 @@ void Assembler::cbnz(const Register& rt, int64_t imm19) {
 
 
 void Assembler::cbnz(const Register& rt, Label* label) {
-  int64_t offset = LinkAndGetBranchOffsetTo(label);
+  int64_t offset = LinkAndGetBranchOffsetTo(label, CompareBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(CompareBranchType, offset));
   cbnz(rt, static_cast<int>(offset));
 }
@@ -454,7 +624,7 @@ void Assembler::tbz(const Register& rt, unsigned bit_pos, int64_t imm14) {
 
 
 void Assembler::tbz(const Register& rt, unsigned bit_pos, Label* label) {
-  ptrdiff_t offset = LinkAndGetBranchOffsetTo(label);
+  ptrdiff_t offset = LinkAndGetBranchOffsetTo(label, TestBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(TestBranchType, offset));
   tbz(rt, bit_pos, static_cast<int>(offset));
 }
@@ -467,7 +637,7 @@ void Assembler::tbnz(const Register& rt, unsigned bit_pos, int64_t imm14) {
 
 
 void Assembler::tbnz(const Register& rt, unsigned bit_pos, Label* label) {
-  ptrdiff_t offset = LinkAndGetBranchOffsetTo(label);
+  ptrdiff_t offset = LinkAndGetBranchOffsetTo(label, TestBranchType);
   VIXL_ASSERT(Instruction::IsValidImmPCOffset(TestBranchType, offset));
   tbnz(rt, bit_pos, static_cast<int>(offset));
 }
@@ -482,7 +652,8 @@ void Assembler::adr(const Register& xd, int64_t imm21) {
 
 
 void Assembler::adr(const Register& xd, Label* label) {
-  adr(xd, static_cast<int>(LinkAndGetByteOffsetTo(label)));
+  adr(xd,
+      static_cast<int>(LinkAndGetByteOffsetTo(label, ImmPCRel_width)));
 }
 
 
@@ -498,7 +669,8 @@ void Assembler::adrp(const Register& xd, int64_t imm21) {
 
 void Assembler::adrp(const Register& xd, Label* label) {
   VIXL_ASSERT(AllowPageOffsetDependentCode());
-  adrp(xd, static_cast<int>(LinkAndGetPageOffsetTo(label)));
+  adrp(xd,
+       static_cast<int>(LinkAndGetPageOffsetTo(label, ImmPCRel_width)));
 }
 
 
@@ -2692,8 +2864,6 @@ void Assembler::NEON3DifferentHN(const VRegister& vd,
 
 // clang-format off
 #define NEON_3DIFF_LONG_LIST(V) \
-  V(pmull,  NEON_PMULL,  vn.IsVector() && vn.Is8B())                           \
-  V(pmull2, NEON_PMULL2, vn.IsVector() && vn.Is16B())                          \
   V(saddl,  NEON_SADDL,  vn.IsVector() && vn.IsD())                            \
   V(saddl2, NEON_SADDL2, vn.IsVector() && vn.IsQ())                            \
   V(sabal,  NEON_SABAL,  vn.IsVector() && vn.IsD())                            \
@@ -2742,6 +2912,29 @@ void Assembler::FN(const VRegister& vd,               \
 NEON_3DIFF_LONG_LIST(VIXL_DEFINE_ASM_FUNC)
 #undef VIXL_DEFINE_ASM_FUNC
 
+
+void Assembler::pmull(const VRegister& vd,
+                      const VRegister& vn,
+                      const VRegister& vm) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON));
+  VIXL_ASSERT(AreSameFormat(vn, vm));
+  VIXL_ASSERT((vn.Is8B() && vd.Is8H()) || (vn.Is1D() && vd.Is1Q()));
+  VIXL_ASSERT(CPUHas(CPUFeatures::kPmull1Q) || vd.Is8H());
+  Instr format = vn.Is1D() ? static_cast<Instr>(NEON_1D) : VFormat(vn);
+  Emit(format | NEON_PMULL | Rm(vm) | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::pmull2(const VRegister& vd,
+                       const VRegister& vn,
+                       const VRegister& vm) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON));
+  VIXL_ASSERT(AreSameFormat(vn, vm));
+  VIXL_ASSERT((vn.Is16B() && vd.Is8H()) || (vn.Is2D() && vd.Is1Q()));
+  VIXL_ASSERT(CPUHas(CPUFeatures::kPmull1Q) || vd.Is8H());
+  Emit(VFormat(vn) | NEON_PMULL2 | Rm(vm) | Rn(vn) | Rd(vd));
+}
+
 // clang-format off
 #define NEON_3DIFF_HN_LIST(V)         \
   V(addhn,   NEON_ADDHN,   vd.IsD())  \
@@ -4122,6 +4315,121 @@ void Assembler::udot(const VRegister& vd,
 }
 
 
+void Assembler::aese(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kAES));
+  VIXL_ASSERT(vd.Is16B() && vn.Is16B());
+
+  Emit(AESE | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::aesd(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kAES));
+  VIXL_ASSERT(vd.Is16B() && vn.Is16B());
+
+  Emit(AESD | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::aesmc(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kAES));
+  VIXL_ASSERT(vd.Is16B() && vn.Is16B());
+
+  Emit(AESMC | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::aesimc(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kAES));
+  VIXL_ASSERT(vd.Is16B() && vn.Is16B());
+
+  Emit(AESIMC | Rn(vn) | Rd(vd));
+}
+
+
+// clang-format off
+#define CRYPTO_SHA1_HASH_LIST(V) \
+  V(sha1c, SHA1C)                \
+  V(sha1p, SHA1P)                \
+  V(sha1m, SHA1M)
+// clang-format on
+
+#define VIXL_DEFINE_ASM_FUNC(FN, OP)                             \
+  void Assembler::FN(const VRegister& vd,                        \
+                     const VRegister& vn,                        \
+                     const VRegister& vm) {                      \
+    VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA1)); \
+    VIXL_ASSERT(vd.IsQ() && vn.IsS() && vm.Is4S());              \
+    Emit(OP | Rm(vm) | Rn(vn) | Rd(vd));                         \
+  }
+CRYPTO_SHA1_HASH_LIST(VIXL_DEFINE_ASM_FUNC)
+#undef VIXL_DEFINE_ASM_FUNC
+
+
+void Assembler::sha1h(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA1));
+  VIXL_ASSERT(vd.IsS() && vn.IsS());
+
+  Emit(SHA1H | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::sha1su0(const VRegister& vd,
+                        const VRegister& vn,
+                        const VRegister& vm) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA1));
+  VIXL_ASSERT(vd.Is4S() && vn.Is4S() && vm.Is4S());
+
+  Emit(SHA1SU0 | Rm(vm) | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::sha1su1(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA1));
+  VIXL_ASSERT(vd.Is4S() && vn.Is4S());
+
+  Emit(SHA1SU1 | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::sha256h(const VRegister& vd,
+                        const VRegister& vn,
+                        const VRegister& vm) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA2));
+  VIXL_ASSERT(vd.IsQ() && vn.IsQ() && vm.Is4S());
+
+  Emit(SHA256H | Rm(vm) | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::sha256h2(const VRegister& vd,
+                         const VRegister& vn,
+                         const VRegister& vm) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA2));
+  VIXL_ASSERT(vd.IsQ() && vn.IsQ() && vm.Is4S());
+
+  Emit(SHA256H2 | Rm(vm) | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::sha256su0(const VRegister& vd, const VRegister& vn) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA2));
+  VIXL_ASSERT(vd.Is4S() && vn.Is4S());
+
+  Emit(SHA256SU0 | Rn(vn) | Rd(vd));
+}
+
+
+void Assembler::sha256su1(const VRegister& vd,
+                          const VRegister& vn,
+                          const VRegister& vm) {
+  VIXL_ASSERT(CPUHas(CPUFeatures::kNEON, CPUFeatures::kSHA2));
+  VIXL_ASSERT(vd.Is4S() && vn.Is4S() && vm.Is4S());
+
+  Emit(SHA256SU1 | Rm(vm) | Rn(vn) | Rd(vd));
+}
+
+
 void Assembler::faddp(const VRegister& vd, const VRegister& vn) {
   VIXL_ASSERT(CPUHas(CPUFeatures::kFP, CPUFeatures::kNEON));
   VIXL_ASSERT((vd.Is1S() && vn.Is2S()) || (vd.Is1D() && vn.Is2D()) ||
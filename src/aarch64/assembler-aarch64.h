@@ -42,16 +42,28 @@ namespace aarch64 {
 class LabelTestHelper;  // Forward declaration.
 
 
+// Unresolved links to a label are normally kept in the linking instructions
+// themselves: each instruction's immediate field holds the offset (in
+// instructions) to the previous link, with zero marking the end of the chain.
+// The label only records the most recent link, so no allocation is required
+// however many times it is used. Links that cannot be chained (because the
+// previous link is out of range of the immediate field, or the instruction
+// cannot store an arbitrary offset) are kept in a separate set.
 class Label {
  public:
-  Label() : location_(kUnknownLocation), target_isa_(kUnknown) {}
+  Label()
+      : link_chain_head_(kNoLinkChain),
+        location_(kUnknownLocation),
+        target_isa_(kUnknown) {}
   ~Label() {
     // All links to a label must have been resolved before it is destructed.
     VIXL_ASSERT(!IsLinked());
   }
 
   bool IsBound() const { return location_ >= 0; }
-  bool IsLinked() const { return !links_.empty(); }
+  bool IsLinked() const {
+    return (link_chain_head_ != kNoLinkChain) || !links_.empty();
+  }
 
   ptrdiff_t GetLocation() const { return location_; }
   VIXL_DEPRECATED("GetLocation", ptrdiff_t location() const) {
@@ -138,16 +150,36 @@ class Label {
     kUnknown = -1,
   };
 
-  // Allows iterating over the links of a label. The behaviour is undefined if
-  // the list of links is modified in any way while iterating.
-  class LabelLinksIterator : public LabelLinksIteratorBase {
+  // Allows iterating over the links of a label: first the in-code chain, then
+  // the other links. The current instruction may be patched whilst iterating,
+  // but the behaviour is undefined if the links are modified in any other way.
+  class LabelLinksIterator {
    public:
-    explicit LabelLinksIterator(Label* label)
-        : LabelLinksIteratorBase(&label->links_) {}
+    LabelLinksIterator(Label* label, const CodeBuffer* buffer);
+
+    bool Done() const {
+      return (chain_link_ == kNoLinkChain) && links_it_.Done();
+    }
+    void Advance();
+
+    // The offset of the linked instruction.
+    ptrdiff_t GetCurrentOffset();
+    // The ISA of the linked instruction. For chained links, this is inferred:
+    // C64 `adrp` is never chained, and the encoding of the other chained
+    // instructions does not depend on the source ISA, so the label's own ISA
+    // is used for them.
+    ISA GetCurrentISA();
 
-    // TODO: Remove these and use the STL-like interface instead.
-    using LabelLinksIteratorBase::Advance;
-    using LabelLinksIteratorBase::Current;
+   private:
+    // Move to the chained instruction at `offset`, skipping any branches that
+    // have been redirected to veneers.
+    void MoveToChainLink(ptrdiff_t offset);
+
+    Label* label_;
+    const CodeBuffer* buffer_;
+    ptrdiff_t chain_link_;
+    ptrdiff_t next_chain_link_;
+    LabelLinksIteratorBase links_it_;
   };
 
   void Bind(ptrdiff_t location) {
@@ -159,6 +191,7 @@ class Label {
     VIXL_ASSERT(IsBound());
   }
 
+  // Add a link that is not part of the in-code chain.
   void AddLink(ptrdiff_t source, ISA source_isa) {
     // If a label is bound, the assembler already has the information it needs
     // to write the instruction, so there is no need to add it to links_.
@@ -170,36 +203,28 @@ class Label {
     VIXL_ASSERT(IsLinked());
   }
 
-  void DeleteLink(ptrdiff_t instruction) { links_.erase(instruction); }
+  // Delete a link that is not part of the in-code chain. Return true if the
+  // link was found.
+  bool DeleteLink(ptrdiff_t source, ISA source_isa) {
+    return links_.erase(source + vixl::aarch64::GetInterworkOffset(
+                                     source_isa)) != 0;
+  }
 
-  void ClearAllLinks() { links_.clear(); }
+  void ClearAllLinks() {
+    links_.clear();
+    link_chain_head_ = kNoLinkChain;
+  }
 
-  // TODO: The comment below considers average case complexity for our
-  // usual use-cases. The elements of interest are:
-  // - Branches to a label are emitted in order: branch instructions to a label
-  // are generated at an offset in the code generation buffer greater than any
-  // other branch to that same label already generated. As an example, this can
-  // be broken when an instruction is patched to become a branch. Note that the
-  // code will still work, but the complexity considerations below may locally
-  // not apply any more.
-  // - Veneers are generated in order: for multiple branches of the same type
-  // branching to the same unbound label going out of range, veneers are
-  // generated in growing order of the branch instruction offset from the start
-  // of the buffer.
-  //
-  // When creating a veneer for a branch going out of range, the link for this
-  // branch needs to be removed from this `links_`. Since all branches are
-  // tracked in one underlying InvalSet, the complexity for this deletion is the
-  // same as for finding the element, ie. O(n), where n is the number of links
-  // in the set.
-  // This could be reduced to O(1) by using the same trick as used when tracking
-  // branch information for veneers: split the container to use one set per type
-  // of branch. With that setup, when a veneer is created and the link needs to
-  // be deleted, if the two points above hold, it must be the minimum element of
-  // the set for its type of branch, and that minimum element will be accessible
-  // in O(1).
-
-  // The offsets of the instructions that have linked to this label.
+  // Return the offset between chained links encoded in `link`, in bytes. This
+  // is negative, or zero at the end of the chain. Branches that have been
+  // redirected to a veneer are not part of the chain any more, but they point
+  // forwards to the veneer, which took their place.
+  static ptrdiff_t GetLinkChainDelta(const Instruction* link);
+
+  // The most recent link in the in-code chain.
+  ptrdiff_t link_chain_head_;
+  // Links that are not part of the in-code chain. In typical code, there are
+  // few of these, and they fit in the preallocated space.
   LinksSet links_;
   // The label location.
   ptrdiff_t location_;
@@ -207,6 +232,7 @@ class Label {
   MaybeISA target_isa_;
 
   static const ptrdiff_t kUnknownLocation = -1;
+  static const ptrdiff_t kNoLinkChain = -1;
 
   // It is not safe to copy labels.
   Label(const Label&) = delete;
@@ -474,21 +500,24 @@ class Assembler : public vixl::internal::AssemblerBase {
       PositionIndependentCodeOption pic = PositionIndependentCode)
       : fixed_address_bits_(static_cast<int>(pic)),
         cpu_features_(CPUFeatures::AArch64LegacyBaseline()),
-        isa_map_(ISA::A64) {}
+        isa_map_(ISA::A64),
+        link_labels_(true) {}
   explicit Assembler(
       size_t capacity,
       PositionIndependentCodeOption pic = PositionIndependentCode)
       : AssemblerBase(capacity),
         fixed_address_bits_(static_cast<int>(pic)),
         cpu_features_(CPUFeatures::AArch64LegacyBaseline()),
-        isa_map_(ISA::A64) {}
+        isa_map_(ISA::A64),
+        link_labels_(true) {}
   Assembler(byte* buffer,
             size_t capacity,
             PositionIndependentCodeOption pic = PositionIndependentCode)
       : AssemblerBase(buffer, capacity),
         fixed_address_bits_(static_cast<int>(pic)),
         cpu_features_(CPUFeatures::AArch64LegacyBaseline()),
-        isa_map_(ISA::A64) {}
+        isa_map_(ISA::A64),
+        link_labels_(true) {}
 
   // Upon destruction, the code will assert that one of the following is true:
   //  * The Assembler object has not been used.
@@ -508,6 +537,11 @@ class Assembler : public vixl::internal::AssemblerBase {
   // Bind a label to a specified offset from the start of the buffer.
   void BindToOffset(Label* label, ptrdiff_t offset);
 
+  // Emit a veneer for the (out-of-range) branch at `branch_offset` to the
+  // unbound `label`: patch the branch to point to the current PC, and emit an
+  // unconditional branch to the label in its place.
+  void EmitVeneer(ptrdiff_t branch_offset, Label* label);
+
   // Place a literal at the current PC.
   void place(RawLiteral* literal);
 
@@ -523,6 +557,23 @@ class Assembler : public vixl::internal::AssemblerBase {
   // Conveniently swap between A64 and C64.
   void ExchangeISA() { SetISA(vixl::aarch64::ExchangeISA(GetISA())); }
 
+  // Instructions that refer to unbound labels are normally linked to them, so
+  // that they can be patched when the label is bound. When label linking is
+  // disabled, they are emitted with an offset of zero instead, and the label is
+  // left untouched. This is only useful for code that will be discarded, for
+  // example to measure it.
+  void SetLabelLinking(bool enable) { link_labels_ = enable; }
+  bool IsLabelLinkingEnabled() const { return link_labels_; }
+
+  // In size-only mode, code is measured but not written, as described for
+  // `CodeBuffer::SetSizeOnly()`. Labels and literals are still tracked, so
+  // that every decision that depends on the layout of the code (such as the
+  // placement of pools and veneers) is the same as for real emission, but
+  // nothing is patched, and addresses of code are not available. The mode can
+  // only be changed when the buffer is empty.
+  void SetSizeOnly(bool size_only) { GetBuffer()->SetSizeOnly(size_only); }
+  bool IsSizeOnly() const { return GetBuffer().IsSizeOnly(); }
+
   VIXL_DEPRECATED("GetCursorOffset", ptrdiff_t CursorOffset() const) {
     return GetCursorOffset();
   }
@@ -3690,6 +3741,48 @@ class Assembler : public vixl::internal::AssemblerBase {
              const VRegister& vm,
              int rot);
 
+  // AES single round encryption.
+  void aese(const VRegister& vd, const VRegister& vn);
+
+  // AES single round decryption.
+  void aesd(const VRegister& vd, const VRegister& vn);
+
+  // AES mix columns.
+  void aesmc(const VRegister& vd, const VRegister& vn);
+
+  // AES inverse mix columns.
+  void aesimc(const VRegister& vd, const VRegister& vn);
+
+  // SHA1 hash update (choose).
+  void sha1c(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
+  // SHA1 hash update (parity).
+  void sha1p(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
+  // SHA1 hash update (majority).
+  void sha1m(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
+  // SHA1 fixed rotate.
+  void sha1h(const VRegister& vd, const VRegister& vn);
+
+  // SHA1 schedule update 0.
+  void sha1su0(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
+  // SHA1 schedule update 1.
+  void sha1su1(const VRegister& vd, const VRegister& vn);
+
+  // SHA256 hash update (part 1).
+  void sha256h(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
+  // SHA256 hash update (part 2).
+  void sha256h2(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
+  // SHA256 schedule update 0.
+  void sha256su0(const VRegister& vd, const VRegister& vn);
+
+  // SHA256 schedule update 1.
+  void sha256su1(const VRegister& vd, const VRegister& vn, const VRegister& vm);
+
   // Scalable Vector Extensions.
 
   // Absolute value (predicated).
@@ -7685,14 +7778,17 @@ class Assembler : public vixl::internal::AssemblerBase {
 
   // Link the current (not-yet-emitted) instruction to the specified label, then
   // return an offset to be encoded in the instruction. If the label is not yet
-  // bound, an offset of 0 is returned.
-  ptrdiff_t LinkAndGetByteOffsetTo(Label* label);
-  ptrdiff_t LinkAndGetBranchOffsetTo(Label* label);
-  ptrdiff_t LinkAndGetPageOffsetTo(Label* label);
+  // bound, the returned value links the instruction into the label's in-code
+  // chain, and must be encoded in a signed immediate field of
+  // `chain_field_width` bits. Instructions that cannot hold such a value
+  // should pass a width of 0; they get an offset of 0.
+  ptrdiff_t LinkAndGetByteOffsetTo(Label* label, int chain_field_width);
+  ptrdiff_t LinkAndGetBranchOffsetTo(Label* label, ImmBranchType branch_type);
+  ptrdiff_t LinkAndGetPageOffsetTo(Label* label, int chain_field_width);
 
   // A common implementation for the LinkAndGet<Type>OffsetTo helpers.
   template <int element_shift>
-  ptrdiff_t LinkAndGetOffsetTo(Label* label);
+  ptrdiff_t LinkAndGetOffsetTo(Label* label, int chain_field_width);
 
   // Literal load offset are in words (32-bit).
   ptrdiff_t LinkAndGetWordOffsetTo(RawLiteral* literal);
@@ -7717,6 +7813,8 @@ class Assembler : public vixl::internal::AssemblerBase {
   CPUFeatures cpu_features_;
 
   ISAMap isa_map_;
+
+  bool link_labels_;
 };
 
 
@@ -76,7 +76,7 @@ void Assembler::adr(CRegister cd, int64_t imm21) {
 }
 
 void Assembler::adr(CRegister cd, Label* label) {
-  adr(cd, LinkAndGetByteOffsetTo(label));
+  adr(cd, LinkAndGetByteOffsetTo(label, ImmPCRel_width));
 }
 
 void Assembler::adrdp(CRegister cd, int64_t imm20) {
@@ -98,7 +98,9 @@ void Assembler::adrp(CRegister cd, int64_t imm20) {
 
 void Assembler::adrp(CRegister cd, Label* label) {
   VIXL_ASSERT(AllowPageOffsetDependentCode());
-  adrp(cd, LinkAndGetPageOffsetTo(label));
+  // The encoding of C64 `adrp` differs from A64, so these links are not
+  // chained (and the source ISA is recorded with the link).
+  adrp(cd, LinkAndGetPageOffsetTo(label, 0));
 }
 
 void Assembler::alignd(CRegister cd, CRegister cn, int imm) {
@@ -207,7 +209,8 @@ void Assembler::bx(Label* label) {
   // Link the label. Binding the label won't update the instruction because it
   // only supports an offset of 4, but it will check that the ISA and offset are
   // correct.
-  ptrdiff_t offset = LinkAndGetByteOffsetTo(label);
+  // `bx` has no immediate field, so it cannot be chained.
+  ptrdiff_t offset = LinkAndGetByteOffsetTo(label, 0);
   USE(offset);
   if (label->IsBound()) {
     // This occurs if BindToOffset binds the label ahead of the branch.
@@ -0,0 +1,149 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "branch-relaxation-aarch64.h"
+
+#include "macro-assembler-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+void BranchRelaxation::Generate(const Generator& generator) {
+  VIXL_ASSERT(masm_->branch_relaxation_ == NULL);
+  branches_.clear();
+  passes_ = 0;
+  real_function_start_ = masm_->GetCursorOffset();
+
+  // Measure the function until the set of relaxed branches is stable. Each
+  // pass can only add to it, so this terminates.
+  do {
+    MacroAssembler scratch(masm_->GetPic());
+    scratch.SetCPUFeatures(*masm_->GetCPUFeatures());
+    scratch.SetISA(masm_->GetISA());
+    scratch.SetGenerateSimulatorCode(masm_->GenerateSimulatorCode());
+    scratch.GetLiteralPool()->SetDeduplication(
+        masm_->GetLiteralPool()->IsDeduplicationEnabled());
+    scratch.SetLabelLinking(false);
+    scratch.SetSizeOnly(true);
+    measuring_ = true;
+    RunPass(&scratch, generator);
+    // Emit the literal pool, so that the literals it owns are deleted.
+    scratch.FinalizeCode();
+  } while (RelaxOutOfRangeBranches());
+
+  measuring_ = false;
+  RunPass(masm_, generator);
+}
+
+
+int BranchRelaxation::GetNumberOfRelaxedBranches() const {
+  int count = 0;
+  for (size_t i = 0; i < branches_.size(); i++) {
+    if (branches_[i].relax) count++;
+  }
+  return count;
+}
+
+
+bool BranchRelaxation::RecordBranch(const MacroAssembler* masm,
+                                    const Label* label,
+                                    ImmBranchType type) {
+  size_t index = next_branch_++;
+  if (index == branches_.size()) {
+    // This branch is new. This only happens in the first pass.
+    VIXL_ASSERT(passes_ == 1);
+    Branch branch = {0, 0, false, type, false};
+    branches_.push_back(branch);
+  }
+  Branch* branch = &branches_[index];
+  // The generator must produce the same branches in every pass.
+  VIXL_ASSERT(branch->type == type);
+
+  branch->offset = masm->GetCursorOffset() - function_start_;
+  branch->has_target = label->IsBound();
+  if (label->IsBound()) {
+    if (!measuring_ || (bound_.count(label) != 0)) {
+      branch->target = label->GetLocation() - function_start_;
+    } else {
+      // The label was bound before the function, in the real MacroAssembler.
+      branch->target = label->GetLocation() - real_function_start_;
+    }
+  } else {
+    unresolved_[label].push_back(index);
+  }
+  return branch->relax;
+}
+
+
+void BranchRelaxation::RecordBind(const Label* label) {
+  VIXL_ASSERT(label->IsBound());
+  if (measuring_) bound_.insert(label);
+
+  std::unordered_map<const Label*, std::vector<size_t> >::iterator it =
+      unresolved_.find(label);
+  if (it == unresolved_.end()) return;
+  for (size_t i = 0; i < it->second.size(); i++) {
+    Branch* branch = &branches_[it->second[i]];
+    branch->target = label->GetLocation() - function_start_;
+    branch->has_target = true;
+  }
+  unresolved_.erase(it);
+}
+
+
+void BranchRelaxation::RunPass(MacroAssembler* masm,
+                               const Generator& generator) {
+  passes_++;
+  function_start_ = masm->GetCursorOffset();
+  next_branch_ = 0;
+  unresolved_.clear();
+  bound_.clear();
+
+  masm->branch_relaxation_ = this;
+  generator(masm);
+  masm->branch_relaxation_ = NULL;
+
+  VIXL_ASSERT(next_branch_ == branches_.size());
+}
+
+
+bool BranchRelaxation::RelaxOutOfRangeBranches() {
+  bool changed = false;
+  for (size_t i = 0; i < branches_.size(); i++) {
+    Branch* branch = &branches_[i];
+    // Branches to labels that were not bound by the generator use veneers.
+    if (branch->relax || !branch->has_target) continue;
+    ptrdiff_t offset = (branch->target - branch->offset) / kInstructionSize;
+    if (!Instruction::IsValidImmPCOffset(branch->type, offset)) {
+      branch->relax = true;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+}  // namespace aarch64
+}  // namespace vixl
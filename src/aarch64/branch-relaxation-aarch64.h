@@ -0,0 +1,147 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_BRANCH_RELAXATION_AARCH64_H_
+#define VIXL_AARCH64_BRANCH_RELAXATION_AARCH64_H_
+
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "instructions-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class Label;
+class MacroAssembler;
+
+// Generate a function with its conditional, compare-and-branch and
+// test-and-branch instructions in their short form, relaxing only those that
+// are out of range into an inverted branch around an unconditional `b`.
+//
+// This is an alternative to veneers: a relaxed branch costs one extra
+// instruction in line, instead of a veneer and a second taken branch, and the
+// branches don't need to be tracked by the veneer pool.
+//
+// The function is described by a generator, which is run several times. The
+// first runs only measure the code, using a scratch MacroAssembler in size-only
+// mode, and record the position and target of each branch. Branches that turn
+// out to be out of range are relaxed, and the function is measured again until
+// no more branches need to be relaxed. Finally, the generator is run on the
+// real MacroAssembler.
+//
+// Branches are identified by the order in which they are generated, so the
+// generator must be deterministic. Unbound labels are not linked whilst
+// measuring, so the generator can refer to labels that it doesn't bind, but it
+// must not bind labels that outlive it, and it must not rely on the code that
+// it generates whilst measuring. Branches to labels that are not bound by the
+// generator are not relaxed, and use veneers as usual. Veneers also remain as a
+// fallback if the final layout differs from the measured one, for example
+// because the real MacroAssembler had pending pools.
+//
+// Typical usage:
+//
+//   BranchRelaxation relaxation(&masm);
+//   relaxation.Generate([](MacroAssembler* masm) {
+//     Label loop;
+//     masm->Bind(&loop);
+//     ...
+//     masm->Cbnz(x0, &loop);
+//   });
+class BranchRelaxation {
+ public:
+  typedef std::function<void(MacroAssembler* masm)> Generator;
+
+  explicit BranchRelaxation(MacroAssembler* masm)
+      : masm_(masm),
+        measuring_(false),
+        function_start_(0),
+        real_function_start_(0),
+        next_branch_(0),
+        passes_(0) {}
+
+  // Generate a function at the current position of the MacroAssembler.
+  void Generate(const Generator& generator);
+
+  // Statistics for the last call to `Generate`. The final emission counts as a
+  // pass.
+  int GetNumberOfPasses() const { return passes_; }
+  int GetNumberOfBranches() const { return static_cast<int>(branches_.size()); }
+  int GetNumberOfRelaxedBranches() const;
+
+ private:
+  struct Branch {
+    // Offsets are relative to the start of the function.
+    ptrdiff_t offset;
+    ptrdiff_t target;
+    bool has_target;
+    ImmBranchType type;
+    bool relax;
+  };
+
+  // Record a branch to `label` at the current position of `masm`. Return true
+  // if the branch should be relaxed.
+  bool RecordBranch(const MacroAssembler* masm,
+                    const Label* label,
+                    ImmBranchType type);
+  // Record that `label` has been bound.
+  void RecordBind(const Label* label);
+
+  void RunPass(MacroAssembler* masm, const Generator& generator);
+  // Relax branches that were out of range in the last pass. Return true if any
+  // new branches were relaxed.
+  bool RelaxOutOfRangeBranches();
+
+  MacroAssembler* masm_;
+  bool measuring_;
+
+  // The position of the function in the MacroAssembler used for the current
+  // pass, and in the real MacroAssembler.
+  ptrdiff_t function_start_;
+  ptrdiff_t real_function_start_;
+
+  size_t next_branch_;
+  std::vector<Branch> branches_;
+
+  // Branches to labels that have not been bound yet, in the current pass.
+  std::unordered_map<const Label*, std::vector<size_t> > unresolved_;
+  // When measuring, the labels bound by the generator. Other bound labels are
+  // in the real MacroAssembler.
+  std::unordered_set<const Label*> bound_;
+
+  int passes_;
+
+  friend class MacroAssembler;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_BRANCH_RELAXATION_AARCH64_H_
@@ -259,6 +259,7 @@ SYSTEM_REGISTER_FIELDS_LIST(DECLARE_FIELDS_OFFSETS, NOTHING)
 // ImmPCRel is a compound field (not present in INSTRUCTION_FIELDS_LIST), formed
 // from ImmPCRelLo and ImmPCRelHi.
 const int ImmPCRel_mask = ImmPCRelLo_mask | ImmPCRelHi_mask;
+const int ImmPCRel_width = ImmPCRelLo_width + ImmPCRelHi_width;
 
 // Disable `clang-format` for the `enum`s below. We care about the manual
 // formatting that `clang-format` would destroy.
@@ -1881,19 +1882,36 @@ enum FPFixedPointConvertOp {
 // Crypto - two register SHA.
 enum Crypto2RegSHAOp {
   Crypto2RegSHAFixed = 0x5E280800,
-  Crypto2RegSHAFMask = 0xFF3E0C00
+  Crypto2RegSHAFMask = 0xFF3E0C00,
+  Crypto2RegSHAMask  = 0xFF3FFC00,
+  SHA1H              = Crypto2RegSHAFixed | 0x00000000,
+  SHA1SU1            = Crypto2RegSHAFixed | 0x00001000,
+  SHA256SU0          = Crypto2RegSHAFixed | 0x00002000
 };
 
 // Crypto - three register SHA.
 enum Crypto3RegSHAOp {
   Crypto3RegSHAFixed = 0x5E000000,
-  Crypto3RegSHAFMask = 0xFF208C00
+  Crypto3RegSHAFMask = 0xFF208C00,
+  Crypto3RegSHAMask  = 0xFF20FC00,
+  SHA1C              = Crypto3RegSHAFixed | 0x00000000,
+  SHA1P              = Crypto3RegSHAFixed | 0x00001000,
+  SHA1M              = Crypto3RegSHAFixed | 0x00002000,
+  SHA1SU0            = Crypto3RegSHAFixed | 0x00003000,
+  SHA256H            = Crypto3RegSHAFixed | 0x00004000,
+  SHA256H2           = Crypto3RegSHAFixed | 0x00005000,
+  SHA256SU1          = Crypto3RegSHAFixed | 0x00006000
 };
 
 // Crypto - AES.
 enum CryptoAESOp {
   CryptoAESFixed = 0x4E280800,
-  CryptoAESFMask = 0xFF3E0C00
+  CryptoAESFMask = 0xFF3E0C00,
+  CryptoAESMask  = 0xFF3FFC00,
+  AESE           = CryptoAESFixed | 0x00004000,
+  AESD           = CryptoAESFixed | 0x00005000,
+  AESMC          = CryptoAESFixed | 0x00006000,
+  AESIMC         = CryptoAESFixed | 0x00007000
 };
 
 // Morello instructions.
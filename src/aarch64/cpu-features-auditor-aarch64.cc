@@ -80,6 +80,58 @@ class CPUFeaturesAuditor::RecordInstructionFeaturesScope {
   CPUFeaturesAuditor* auditor_;
 };
 
+void CPUFeaturesAuditor::ValidateAuditCache() {
+  if (available_ == cached_available_) return;
+  cached_available_ = available_;
+  cache_generation_++;
+  if (cache_generation_ == 0) {
+    // The generation has wrapped around, so old entries could look valid.
+    audit_cache_.clear();
+    cache_generation_ = 1;
+  }
+}
+
+CPUFeaturesAuditor::AuditCacheEntry* CPUFeaturesAuditor::GetAuditCacheEntry(
+    const Instruction* instr) {
+  if (audit_cache_.empty()) {
+    AuditCacheEntry invalid = {};
+    audit_cache_.resize(kAuditCacheSize, invalid);
+  }
+  // Multiplicative hashing spreads out encodings that differ only in their
+  // low bits, such as register fields.
+  uint32_t hash = instr->GetInstructionBits() * UINT32_C(0x9e3779b1);
+  return &audit_cache_[hash >> (32 - kAuditCacheSizeLog2)];
+}
+
+// Look the instruction up in the audit cache, and audit it if it is missing.
+#define VIXL_DEFINE_CACHED_VISITOR(A)                                     \
+  void CPUFeaturesAuditor::Visit##A(const Instruction* instr) {           \
+    ValidateAuditCache();                                                 \
+    AuditCacheEntry* entry = GetAuditCacheEntry(instr);                   \
+    Instr encoding = instr->GetInstructionBits();                         \
+    ISA isa = GetISA();                                                   \
+    if ((entry->generation == cache_generation_) &&                       \
+        (entry->encoding == encoding) && (entry->isa == isa)) {           \
+      last_instruction_ = entry->features;                                \
+      last_instruction_is_available_ = entry->is_available;               \
+      if (entry->seen_generation != seen_generation_) {                   \
+        seen_.Combine(entry->features);                                   \
+        entry->seen_generation = seen_generation_;                        \
+      }                                                                   \
+      return;                                                             \
+    }                                                                     \
+    Audit##A(instr);                                                      \
+    last_instruction_is_available_ = available_.Has(last_instruction_);   \
+    entry->generation = cache_generation_;                                \
+    entry->seen_generation = seen_generation_;                            \
+    entry->encoding = encoding;                                           \
+    entry->isa = isa;                                                     \
+    entry->is_available = last_instruction_is_available_;                 \
+    entry->features = last_instruction_;                                  \
+  }
+VISITOR_LIST(VIXL_DEFINE_CACHED_VISITOR)
+#undef VIXL_DEFINE_CACHED_VISITOR
+
 void CPUFeaturesAuditor::LoadStoreHelper(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(LoadStoreMask)) {
@@ -123,27 +175,27 @@ void CPUFeaturesAuditor::LoadStorePairHelper(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitAddSubExtended(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditAddSubExtended(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitAddSubImmediate(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditAddSubImmediate(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitAddSubShifted(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditAddSubShifted(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitAddSubWithCarry(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditAddSubWithCarry(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitRotateRightIntoFlags(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditRotateRightIntoFlags(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(RotateRightIntoFlagsMask)) {
     case RMIF:
@@ -152,7 +204,7 @@ void CPUFeaturesAuditor::VisitRotateRightIntoFlags(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitEvaluateIntoFlags(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditEvaluateIntoFlags(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(EvaluateIntoFlagsMask)) {
     case SETF8:
@@ -162,7 +214,7 @@ void CPUFeaturesAuditor::VisitEvaluateIntoFlags(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitAtomicMemory(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditAtomicMemory(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(AtomicMemoryMask)) {
     case LDAPRB:
@@ -178,54 +230,81 @@ void CPUFeaturesAuditor::VisitAtomicMemory(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitBitfield(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditBitfield(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitCompareBranch(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditCompareBranch(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitConditionalBranch(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditConditionalBranch(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitConditionalCompareImmediate(
+void CPUFeaturesAuditor::AuditConditionalCompareImmediate(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitConditionalCompareRegister(
+void CPUFeaturesAuditor::AuditConditionalCompareRegister(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitConditionalSelect(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditConditionalSelect(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitCrypto2RegSHA(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditCrypto2RegSHA(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
-  USE(instr);
+  switch (instr->Mask(Crypto2RegSHAMask)) {
+    case SHA1H:
+    case SHA1SU1:
+      scope.Record(CPUFeatures::kNEON, CPUFeatures::kSHA1);
+      return;
+    case SHA256SU0:
+      scope.Record(CPUFeatures::kNEON, CPUFeatures::kSHA2);
+      return;
+    default:
+      // Unallocated encodings.
+      return;
+  }
 }
 
-void CPUFeaturesAuditor::VisitCrypto3RegSHA(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditCrypto3RegSHA(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
-  USE(instr);
+  switch (instr->Mask(Crypto3RegSHAMask)) {
+    case SHA1C:
+    case SHA1P:
+    case SHA1M:
+    case SHA1SU0:
+      scope.Record(CPUFeatures::kNEON, CPUFeatures::kSHA1);
+      return;
+    case SHA256H:
+    case SHA256H2:
+    case SHA256SU1:
+      scope.Record(CPUFeatures::kNEON, CPUFeatures::kSHA2);
+      return;
+    default:
+      // Unallocated encodings.
+      return;
+  }
 }
 
-void CPUFeaturesAuditor::VisitCryptoAES(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditCryptoAES(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
+  scope.Record(CPUFeatures::kNEON, CPUFeatures::kAES);
 }
 
-void CPUFeaturesAuditor::VisitDataProcessing1Source(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditDataProcessing1Source(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(DataProcessing1SourceMask)) {
     case PACIA:
@@ -254,7 +333,7 @@ void CPUFeaturesAuditor::VisitDataProcessing1Source(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitDataProcessing2Source(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditDataProcessing2Source(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(DataProcessing2SourceMask)) {
     case CRC32B:
@@ -276,7 +355,7 @@ void CPUFeaturesAuditor::VisitDataProcessing2Source(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitLoadStoreRCpcUnscaledOffset(
+void CPUFeaturesAuditor::AuditLoadStoreRCpcUnscaledOffset(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(LoadStoreRCpcUnscaledOffsetMask)) {
@@ -301,28 +380,28 @@ void CPUFeaturesAuditor::VisitLoadStoreRCpcUnscaledOffset(
   }
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePAC(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStorePAC(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
   scope.Record(CPUFeatures::kPAuth);
 }
 
-void CPUFeaturesAuditor::VisitDataProcessing3Source(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditDataProcessing3Source(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitException(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditException(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitExtract(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditExtract(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitFPCompare(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditFPCompare(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
   scope.Record(CPUFeatures::kFP);
@@ -339,7 +418,7 @@ void CPUFeaturesAuditor::VisitFPCompare(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitFPConditionalCompare(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditFPConditionalCompare(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
   scope.Record(CPUFeatures::kFP);
@@ -354,7 +433,7 @@ void CPUFeaturesAuditor::VisitFPConditionalCompare(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitFPConditionalSelect(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditFPConditionalSelect(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
   scope.Record(CPUFeatures::kFP);
@@ -363,7 +442,7 @@ void CPUFeaturesAuditor::VisitFPConditionalSelect(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitFPDataProcessing1Source(
+void CPUFeaturesAuditor::AuditFPDataProcessing1Source(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
@@ -400,7 +479,7 @@ void CPUFeaturesAuditor::VisitFPDataProcessing1Source(
   }
 }
 
-void CPUFeaturesAuditor::VisitFPDataProcessing2Source(
+void CPUFeaturesAuditor::AuditFPDataProcessing2Source(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
@@ -423,7 +502,7 @@ void CPUFeaturesAuditor::VisitFPDataProcessing2Source(
   }
 }
 
-void CPUFeaturesAuditor::VisitFPDataProcessing3Source(
+void CPUFeaturesAuditor::AuditFPDataProcessing3Source(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
@@ -441,7 +520,7 @@ void CPUFeaturesAuditor::VisitFPDataProcessing3Source(
   }
 }
 
-void CPUFeaturesAuditor::VisitFPFixedPointConvert(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditFPFixedPointConvert(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
   scope.Record(CPUFeatures::kFP);
@@ -462,7 +541,7 @@ void CPUFeaturesAuditor::VisitFPFixedPointConvert(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitFPImmediate(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditFPImmediate(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
   scope.Record(CPUFeatures::kFP);
@@ -471,7 +550,7 @@ void CPUFeaturesAuditor::VisitFPImmediate(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitFPIntegerConvert(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditFPIntegerConvert(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require FP.
   scope.Record(CPUFeatures::kFP);
@@ -519,7 +598,7 @@ void CPUFeaturesAuditor::VisitFPIntegerConvert(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitLoadLiteral(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadLiteral(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(LoadLiteralMask)) {
     case LDR_s_lit:
@@ -535,7 +614,7 @@ void CPUFeaturesAuditor::VisitLoadLiteral(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitLoadStoreExclusive(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStoreExclusive(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(LoadStoreExclusiveMask)) {
     case CAS_w:
@@ -580,52 +659,52 @@ void CPUFeaturesAuditor::VisitLoadStoreExclusive(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePairNonTemporal(
+void CPUFeaturesAuditor::AuditLoadStorePairNonTemporal(
     const Instruction* instr) {
   LoadStorePairHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePairOffset(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStorePairOffset(const Instruction* instr) {
   LoadStorePairHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePairPostIndex(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStorePairPostIndex(const Instruction* instr) {
   LoadStorePairHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePairPreIndex(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStorePairPreIndex(const Instruction* instr) {
   LoadStorePairHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePostIndex(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStorePostIndex(const Instruction* instr) {
   LoadStoreHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStorePreIndex(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLoadStorePreIndex(const Instruction* instr) {
   LoadStoreHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStoreRegisterOffset(
+void CPUFeaturesAuditor::AuditLoadStoreRegisterOffset(
     const Instruction* instr) {
   LoadStoreHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStoreUnscaledOffset(
+void CPUFeaturesAuditor::AuditLoadStoreUnscaledOffset(
     const Instruction* instr) {
   LoadStoreHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLoadStoreUnsignedOffset(
+void CPUFeaturesAuditor::AuditLoadStoreUnsignedOffset(
     const Instruction* instr) {
   LoadStoreHelper(instr);
 }
 
-void CPUFeaturesAuditor::VisitLogicalImmediate(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLogicalImmediate(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitLogicalShifted(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditLogicalShifted(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
@@ -687,7 +766,7 @@ void CPUFeaturesAuditor::VisitLogicalShifted(const Instruction* instr) {
   V(MorelloStorePairExclusive)
 
 #define VIXL_DEFINE_SIMPLE_MORELLO_VISITOR(NAME)                   \
-  void CPUFeaturesAuditor::Visit##NAME(const Instruction* instr) { \
+  void CPUFeaturesAuditor::Audit##NAME(const Instruction* instr) { \
     RecordInstructionFeaturesScope scope(this);                    \
     scope.Record(CPUFeatures::kMorello);                           \
     USE(instr);                                                    \
@@ -696,7 +775,7 @@ VIXL_SIMPLE_MORELLO_VISITOR_LIST(VIXL_DEFINE_SIMPLE_MORELLO_VISITOR)
 #undef VIXL_DEFINE_SIMPLE_MORELLO_VISITOR
 #undef VIXL_SIMPLE_MORELLO_VISITOR_LIST
 
-void CPUFeaturesAuditor::VisitMorelloCompareAndSwap(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditMorelloCompareAndSwap(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   scope.Record(CPUFeatures::kMorello);
   switch (instr->Mask(MorelloCompareAndSwapMask)) {
@@ -712,7 +791,7 @@ void CPUFeaturesAuditor::VisitMorelloCompareAndSwap(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitMorelloLDAPR(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditMorelloLDAPR(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   scope.Record(CPUFeatures::kMorello);
   switch (instr->Mask(MorelloLDAPRMask)) {
@@ -725,7 +804,7 @@ void CPUFeaturesAuditor::VisitMorelloLDAPR(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitMorelloLoadStoreRegisterAltBase(
+void CPUFeaturesAuditor::AuditMorelloLoadStoreRegisterAltBase(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   scope.Record(CPUFeatures::kMorello);
@@ -742,7 +821,7 @@ void CPUFeaturesAuditor::VisitMorelloLoadStoreRegisterAltBase(
   }
 }
 
-void CPUFeaturesAuditor::VisitMorelloLoadStoreUnscaledImmediateAltBase(
+void CPUFeaturesAuditor::AuditMorelloLoadStoreUnscaledImmediateAltBase(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   scope.Record(CPUFeatures::kMorello);
@@ -767,7 +846,7 @@ void CPUFeaturesAuditor::VisitMorelloLoadStoreUnscaledImmediateAltBase(
   }
 }
 
-void CPUFeaturesAuditor::VisitMorelloSwap(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditMorelloSwap(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   scope.Record(CPUFeatures::kMorello);
   switch (instr->Mask(MorelloSwapMask)) {
@@ -783,12 +862,12 @@ void CPUFeaturesAuditor::VisitMorelloSwap(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitMoveWideImmediate(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditMoveWideImmediate(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEON2RegMisc(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEON2RegMisc(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -839,21 +918,24 @@ void CPUFeaturesAuditor::VisitNEON2RegMisc(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEON2RegMiscFP16(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEON2RegMiscFP16(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEONHalf.
   scope.Record(CPUFeatures::kFP, CPUFeatures::kNEON, CPUFeatures::kNEONHalf);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEON3Different(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEON3Different(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
-  USE(instr);
+  if ((instr->Mask(NEON3DifferentMask & ~NEON_Q) == NEON_PMULL) &&
+      (instr->GetNEONSize() == 3)) {
+    scope.Record(CPUFeatures::kPmull1Q);
+  }
 }
 
-void CPUFeaturesAuditor::VisitNEON3Same(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEON3Same(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -873,7 +955,7 @@ void CPUFeaturesAuditor::VisitNEON3Same(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEON3SameExtra(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEON3SameExtra(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -898,14 +980,14 @@ void CPUFeaturesAuditor::VisitNEON3SameExtra(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEON3SameFP16(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEON3SameFP16(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON FP16 support.
   scope.Record(CPUFeatures::kFP, CPUFeatures::kNEON, CPUFeatures::kNEONHalf);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONAcrossLanes(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONAcrossLanes(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -918,7 +1000,7 @@ void CPUFeaturesAuditor::VisitNEONAcrossLanes(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONByIndexedElement(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONByIndexedElement(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -971,21 +1053,21 @@ void CPUFeaturesAuditor::VisitNEONByIndexedElement(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONCopy(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONCopy(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONExtract(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONExtract(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONLoadStoreMultiStruct(
+void CPUFeaturesAuditor::AuditNEONLoadStoreMultiStruct(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
@@ -993,7 +1075,7 @@ void CPUFeaturesAuditor::VisitNEONLoadStoreMultiStruct(
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONLoadStoreMultiStructPostIndex(
+void CPUFeaturesAuditor::AuditNEONLoadStoreMultiStructPostIndex(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
@@ -1001,7 +1083,7 @@ void CPUFeaturesAuditor::VisitNEONLoadStoreMultiStructPostIndex(
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONLoadStoreSingleStruct(
+void CPUFeaturesAuditor::AuditNEONLoadStoreSingleStruct(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
@@ -1009,7 +1091,7 @@ void CPUFeaturesAuditor::VisitNEONLoadStoreSingleStruct(
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONLoadStoreSingleStructPostIndex(
+void CPUFeaturesAuditor::AuditNEONLoadStoreSingleStructPostIndex(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
@@ -1017,7 +1099,7 @@ void CPUFeaturesAuditor::VisitNEONLoadStoreSingleStructPostIndex(
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONModifiedImmediate(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONModifiedImmediate(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -1028,14 +1110,14 @@ void CPUFeaturesAuditor::VisitNEONModifiedImmediate(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONPerm(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONPerm(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONScalar2RegMisc(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalar2RegMisc(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -1069,21 +1151,21 @@ void CPUFeaturesAuditor::VisitNEONScalar2RegMisc(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONScalar2RegMiscFP16(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalar2RegMiscFP16(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEONHalf.
   scope.Record(CPUFeatures::kFP, CPUFeatures::kNEON, CPUFeatures::kNEONHalf);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONScalar3Diff(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalar3Diff(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONScalar3Same(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalar3Same(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -1092,21 +1174,21 @@ void CPUFeaturesAuditor::VisitNEONScalar3Same(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONScalar3SameExtra(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalar3SameExtra(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON and RDM.
   scope.Record(CPUFeatures::kNEON, CPUFeatures::kRDM);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONScalar3SameFP16(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalar3SameFP16(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEONHalf.
   scope.Record(CPUFeatures::kFP, CPUFeatures::kNEON, CPUFeatures::kNEONHalf);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONScalarByIndexedElement(
+void CPUFeaturesAuditor::AuditNEONScalarByIndexedElement(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
@@ -1136,14 +1218,14 @@ void CPUFeaturesAuditor::VisitNEONScalarByIndexedElement(
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONScalarCopy(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalarCopy(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitNEONScalarPairwise(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONScalarPairwise(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -1168,7 +1250,7 @@ void CPUFeaturesAuditor::VisitNEONScalarPairwise(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONScalarShiftImmediate(
+void CPUFeaturesAuditor::AuditNEONScalarShiftImmediate(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
@@ -1190,7 +1272,7 @@ void CPUFeaturesAuditor::VisitNEONScalarShiftImmediate(
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONShiftImmediate(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONShiftImmediate(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
@@ -1211,14 +1293,14 @@ void CPUFeaturesAuditor::VisitNEONShiftImmediate(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitNEONTable(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditNEONTable(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   // All of these instructions require NEON.
   scope.Record(CPUFeatures::kNEON);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitPCRelAddressing(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditPCRelAddressing(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
@@ -1373,7 +1455,7 @@ void CPUFeaturesAuditor::VisitPCRelAddressing(const Instruction* instr) {
   V(SVEVectorSplice_Destructive)
 
 #define VIXL_DEFINE_SIMPLE_SVE_VISITOR(NAME)                       \
-  void CPUFeaturesAuditor::Visit##NAME(const Instruction* instr) { \
+  void CPUFeaturesAuditor::Audit##NAME(const Instruction* instr) { \
     RecordInstructionFeaturesScope scope(this);                    \
     scope.Record(CPUFeatures::kSVE);                               \
     USE(instr);                                                    \
@@ -1382,7 +1464,7 @@ VIXL_SIMPLE_SVE_VISITOR_LIST(VIXL_DEFINE_SIMPLE_SVE_VISITOR)
 #undef VIXL_DEFINE_SIMPLE_SVE_VISITOR
 #undef VIXL_SIMPLE_SVE_VISITOR_LIST
 
-void CPUFeaturesAuditor::VisitSystem(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditSystem(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   if (instr->Mask(SystemHintFMask) == SystemHintFixed) {
     CPUFeatures required;
@@ -1463,22 +1545,22 @@ void CPUFeaturesAuditor::VisitSystem(const Instruction* instr) {
   }
 }
 
-void CPUFeaturesAuditor::VisitTestBranch(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditTestBranch(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitUnallocated(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditUnallocated(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitUnconditionalBranch(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditUnconditionalBranch(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitUnconditionalBranchToRegister(
+void CPUFeaturesAuditor::AuditUnconditionalBranchToRegister(
     const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   switch (instr->Mask(UnconditionalBranchToRegisterMask)) {
@@ -1500,12 +1582,12 @@ void CPUFeaturesAuditor::VisitUnconditionalBranchToRegister(
   }
 }
 
-void CPUFeaturesAuditor::VisitReserved(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditReserved(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
 
-void CPUFeaturesAuditor::VisitUnimplemented(const Instruction* instr) {
+void CPUFeaturesAuditor::AuditUnimplemented(const Instruction* instr) {
   RecordInstructionFeaturesScope scope(this);
   USE(instr);
 }
@@ -28,6 +28,7 @@
 #define VIXL_AARCH64_CPU_FEATURES_AUDITOR_AARCH64_H_
 
 #include <iostream>
+#include <vector>
 
 #include "cpu-features.h"
 #include "decoder-aarch64.h"
@@ -44,6 +45,12 @@ namespace aarch64 {
 // Primarily, this allows the Disassembler and Simulator to share the same CPU
 // features logic. However, it can be used standalone to scan code blocks for
 // CPU features.
+//
+// The features required by an instruction depend only on its encoding, the
+// ISA and the available features, so the result of each audit is cached,
+// together with whether the instruction is available. Instructions that have
+// been seen before, such as those in a simulated loop, cost little more than a
+// table lookup. The cache is flushed whenever the available features change.
 class CPUFeaturesAuditor : public DecoderVisitor {
  public:
   // Construction arguments:
@@ -59,13 +66,21 @@ class CPUFeaturesAuditor : public DecoderVisitor {
   //     features.
   explicit CPUFeaturesAuditor(
       Decoder* decoder, const CPUFeatures& available = CPUFeatures::None())
-      : available_(available), decoder_(decoder) {
+      : last_instruction_is_available_(true),
+        available_(available),
+        decoder_(decoder),
+        cache_generation_(1),
+        seen_generation_(1) {
     if (decoder_ != NULL) decoder_->AppendVisitor(this);
   }
 
   explicit CPUFeaturesAuditor(
       const CPUFeatures& available = CPUFeatures::None())
-      : available_(available), decoder_(NULL) {}
+      : last_instruction_is_available_(true),
+        available_(available),
+        decoder_(NULL),
+        cache_generation_(1),
+        seen_generation_(1) {}
 
   virtual ~CPUFeaturesAuditor() {
     if (decoder_ != NULL) decoder_->RemoveVisitor(this);
@@ -74,6 +89,9 @@ class CPUFeaturesAuditor : public DecoderVisitor {
   void ResetSeenFeatures() {
     seen_ = CPUFeatures::None();
     last_instruction_ = CPUFeatures::None();
+    last_instruction_is_available_ = true;
+    // Cached features are no longer in `seen_`.
+    seen_generation_++;
   }
 
   // Query or set available CPUFeatures.
@@ -91,16 +109,22 @@ class CPUFeaturesAuditor : public DecoderVisitor {
   }
 
   bool InstructionIsAvailable() const {
+    // The cached result is only valid if `available_` has not been modified
+    // since the last instruction was visited.
+    if (available_ == cached_available_) return last_instruction_is_available_;
     return available_.Has(last_instruction_);
   }
 
-  // The common CPUFeatures interface operates on the available_ list.
+  // The common CPUFeatures interface operates on the available_ list. Note
+  // that the returned pointer can be used to modify the available features at
+  // any time, so changes are detected when the next instruction is visited.
   CPUFeatures* GetCPUFeatures() { return &available_; }
   void SetCPUFeatures(const CPUFeatures& available) {
     SetAvailableFeatures(available);
   }
 
-// Declare all Visitor functions.
+// Declare all Visitor functions. Each one looks the instruction up in the
+// cache, and only audits it if it isn't there.
 #define DECLARE(A) \
   virtual void Visit##A(const Instruction* instr) VIXL_OVERRIDE;
   VISITOR_LIST(DECLARE)
@@ -114,14 +138,46 @@ class CPUFeaturesAuditor : public DecoderVisitor {
  private:
   class RecordInstructionFeaturesScope;
 
+  // Work out the features required by an instruction, uncached.
+#define DECLARE(A) void Audit##A(const Instruction* instr);
+  VISITOR_LIST(DECLARE)
+#undef DECLARE
+
   void LoadStoreHelper(const Instruction* instr);
   void LoadStorePairHelper(const Instruction* instr);
 
+  struct AuditCacheEntry {
+    // The entry is valid if `generation` matches `cache_generation_`.
+    uint32_t generation;
+    // The features are already in `seen_` if this matches `seen_generation_`.
+    uint32_t seen_generation;
+    Instr encoding;
+    ISA isa;
+    bool is_available;
+    CPUFeatures features;
+  };
+
+  static const int kAuditCacheSizeLog2 = 10;
+  static const size_t kAuditCacheSize = 1 << kAuditCacheSizeLog2;
+
+  AuditCacheEntry* GetAuditCacheEntry(const Instruction* instr);
+  // Flush the cache if `available_` has changed.
+  void ValidateAuditCache();
+
   CPUFeatures seen_;
   CPUFeatures last_instruction_;
+  bool last_instruction_is_available_;
   CPUFeatures available_;
 
   Decoder* decoder_;
+
+  // The audit cache is allocated on first use, and flushed by incrementing
+  // `cache_generation_`. `cached_available_` holds the available features that
+  // the cached entries were checked against.
+  std::vector<AuditCacheEntry> audit_cache_;
+  CPUFeatures cached_available_;
+  uint32_t cache_generation_;
+  uint32_t seen_generation_;
 };
 
 }  // namespace aarch64
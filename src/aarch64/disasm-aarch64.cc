@@ -2350,17 +2350,88 @@ void Disassembler::VisitException(const Instruction *instr) {
 
 
 void Disassembler::VisitCrypto2RegSHA(const Instruction *instr) {
-  VisitUnimplemented(instr);
+  const char *mnemonic;
+  const char *form = "'Vd.4s, 'Vn.4s";
+
+  switch (instr->Mask(Crypto2RegSHAMask)) {
+    case SHA1H:
+      mnemonic = "sha1h";
+      form = "'Sd, 'Sn";
+      break;
+    case SHA1SU1:
+      mnemonic = "sha1su1";
+      break;
+    case SHA256SU0:
+      mnemonic = "sha256su0";
+      break;
+    default:
+      VisitUnallocated(instr);
+      return;
+  }
+  Format(instr, mnemonic, form);
 }
 
 
 void Disassembler::VisitCrypto3RegSHA(const Instruction *instr) {
-  VisitUnimplemented(instr);
+  const char *mnemonic;
+  const char *form = "'Qd, 'Sn, 'Vm.4s";
+
+  switch (instr->Mask(Crypto3RegSHAMask)) {
+    case SHA1C:
+      mnemonic = "sha1c";
+      break;
+    case SHA1P:
+      mnemonic = "sha1p";
+      break;
+    case SHA1M:
+      mnemonic = "sha1m";
+      break;
+    case SHA1SU0:
+      mnemonic = "sha1su0";
+      form = "'Vd.4s, 'Vn.4s, 'Vm.4s";
+      break;
+    case SHA256H:
+      mnemonic = "sha256h";
+      form = "'Qd, 'Qn, 'Vm.4s";
+      break;
+    case SHA256H2:
+      mnemonic = "sha256h2";
+      form = "'Qd, 'Qn, 'Vm.4s";
+      break;
+    case SHA256SU1:
+      mnemonic = "sha256su1";
+      form = "'Vd.4s, 'Vn.4s, 'Vm.4s";
+      break;
+    default:
+      VisitUnallocated(instr);
+      return;
+  }
+  Format(instr, mnemonic, form);
 }
 
 
 void Disassembler::VisitCryptoAES(const Instruction *instr) {
-  VisitUnimplemented(instr);
+  const char *mnemonic;
+  const char *form = "'Vd.16b, 'Vn.16b";
+
+  switch (instr->Mask(CryptoAESMask)) {
+    case AESE:
+      mnemonic = "aese";
+      break;
+    case AESD:
+      mnemonic = "aesd";
+      break;
+    case AESMC:
+      mnemonic = "aesmc";
+      break;
+    case AESIMC:
+      mnemonic = "aesimc";
+      break;
+    default:
+      VisitUnallocated(instr);
+      return;
+  }
+  Format(instr, mnemonic, form);
 }
 
 
@@ -3029,6 +3100,11 @@ void Disassembler::VisitNEON3Different(const Instruction *instr) {
   switch (instr->Mask(NEON3DifferentMask) & ~NEON_Q) {
     case NEON_PMULL:
       mnemonic = "pmull";
+      if (instr->GetNEONSize() == 3) {
+        // Polynomial multiply of 64-bit elements, producing 128 bits.
+        form = instr->Mask(NEON_Q) ? "'Vd.1q, 'Vn.2d, 'Vm.2d"
+                                   : "'Vd.1q, 'Vn.1d, 'Vm.1d";
+      }
       break;
     case NEON_SABAL:
       mnemonic = "sabal";
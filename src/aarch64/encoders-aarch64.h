@@ -0,0 +1,436 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef VIXL_AARCH64_ENCODERS_AARCH64_H_
+#define VIXL_AARCH64_ENCODERS_AARCH64_H_
+
+#include "../globals-vixl.h"
+
+#include "constants-aarch64.h"
+#include "instructions-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+// Constexpr instruction encoders, for building fixed code sequences at compile
+// time:
+//
+//   using namespace vixl::aarch64::encoding;
+//   constexpr std::array<Instr, 3> kStub = {{
+//       Movz(XReg(16), 0),  // Patched at load time.
+//       Movk(XReg(16), 0, 16),
+//       Br(XReg(16)),
+//   }};
+//
+// The field encoders mirror the Assembler's (`Rd()`, `ImmAddSub()` and so on),
+// and the instruction encoders produce the same encodings as the corresponding
+// Assembler methods. Branch and literal offsets are in instructions, like the
+// Assembler's immediate forms. Invalid operands make the expression
+// non-constant, so they are rejected at compile time. If the encoders are
+// called at run time, invalid operands abort, even in release builds.
+//
+// Registers are described by their codes, wrapped in `WReg`, `XReg` or `CReg`
+// to select the form of the instruction. Code 31 is the stack pointer or the
+// zero register, according to the instruction, as in the architecture.
+//
+// Unlike the Assembler, the encoders don't check the CPU features or the ISA.
+// In particular, the C64 forms of `Adr` and `Adrp` are only meaningful in C64
+// code.
+namespace encoding {
+
+struct WReg {
+  constexpr explicit WReg(unsigned code) : code(code) {}
+  unsigned code;
+};
+
+struct XReg {
+  constexpr explicit XReg(unsigned code) : code(code) {}
+  unsigned code;
+};
+
+struct CReg {
+  constexpr explicit CReg(unsigned code) : code(code) {}
+  unsigned code;
+};
+
+// This is deliberately not constexpr, so that calling it in a constant
+// expression is an error.
+inline Instr InvalidEncoding() {
+  VIXL_ABORT_WITH_MSG("Invalid operand for constexpr encoder.\n");
+  return 0xffffffff;
+}
+
+constexpr Instr Check(bool valid, Instr encoding) {
+  return valid ? encoding : InvalidEncoding();
+}
+
+constexpr bool IsUintN(unsigned n, uint64_t x) {
+  return (n >= 64) || ((x >> n) == 0);
+}
+
+constexpr bool IsIntN(unsigned n, int64_t x) {
+  return (x >= -(INT64_C(1) << (n - 1))) && (x < (INT64_C(1) << (n - 1)));
+}
+
+constexpr Instr UnsignedField(uint64_t imm, int offset, int width) {
+  return Check(IsUintN(width, imm), static_cast<Instr>(imm << offset));
+}
+
+constexpr Instr SignedField(int64_t imm, int offset, int width) {
+  return Check(IsIntN(width, imm),
+               static_cast<Instr>((static_cast<uint64_t>(imm) &
+                                   ((UINT64_C(1) << width) - 1))
+                                  << offset));
+}
+
+// Register fields.
+constexpr Instr Rd(unsigned code) { return UnsignedField(code, Rd_offset, 5); }
+constexpr Instr Rn(unsigned code) { return UnsignedField(code, Rn_offset, 5); }
+constexpr Instr Rm(unsigned code) { return UnsignedField(code, Rm_offset, 5); }
+constexpr Instr Ra(unsigned code) { return UnsignedField(code, Ra_offset, 5); }
+constexpr Instr Rt(unsigned code) { return UnsignedField(code, Rt_offset, 5); }
+constexpr Instr Rt2(unsigned code) {
+  return UnsignedField(code, Rt2_offset, 5);
+}
+
+constexpr Instr SF(XReg) { return SixtyFourBits; }
+constexpr Instr SF(WReg) { return ThirtyTwoBits; }
+
+// Immediate fields.
+constexpr Instr ImmAddSub(uint64_t imm, int shift) {
+  return Check((shift == 0) || (shift == 12),
+               UnsignedField(imm, ImmAddSub_offset, ImmAddSub_width) |
+                   ((shift == 0) ? 0 : (1 << ImmAddSubShift_offset)));
+}
+
+// Encode `imm` for `add` or `sub` instructions, with implicit shift if
+// necessary.
+constexpr Instr ImmAddSub(uint64_t imm) {
+  return IsUintN(12, imm) ? ImmAddSub(imm, 0)
+                          : Check((imm & 0xfff) == 0, ImmAddSub(imm >> 12, 12));
+}
+
+constexpr Instr ImmMoveWide(uint64_t imm) {
+  return UnsignedField(imm, ImmMoveWide_offset, ImmMoveWide_width);
+}
+
+constexpr Instr ShiftMoveWide(int64_t shift) {
+  return UnsignedField(shift, ShiftMoveWide_offset, ShiftMoveWide_width);
+}
+
+constexpr Instr ImmPCRelAddressCommon(uint64_t p_immhi_immlo) {
+  return Check(IsUintN(21, p_immhi_immlo),
+               ((static_cast<Instr>(p_immhi_immlo >> ImmPCRelLo_width)
+                 << ImmPCRelHi_offset) &
+                ImmPCRelHi_mask) |
+                   ((static_cast<Instr>(p_immhi_immlo) << ImmPCRelLo_offset) &
+                    ImmPCRelLo_mask));
+}
+
+constexpr Instr ImmPCRelAddress(int64_t imm21) {
+  return Check(IsIntN(21, imm21),
+               ImmPCRelAddressCommon(static_cast<uint64_t>(imm21) &
+                                     ((UINT64_C(1) << 21) - 1)));
+}
+
+// Used for C64's ADRP, which takes a signed immediate and sets the top bit
+// ("P") of the immediate field.
+constexpr Instr ImmC64RelAddressADRP(int64_t imm20) {
+  return Check(IsIntN(20, imm20),
+               ImmPCRelAddressCommon((UINT64_C(1) << 20) |
+                                     (static_cast<uint64_t>(imm20) &
+                                      ((UINT64_C(1) << 20) - 1))));
+}
+
+constexpr Instr ImmUncondBranch(int64_t imm26) {
+  return SignedField(imm26, ImmUncondBranch_offset, ImmUncondBranch_width);
+}
+
+constexpr Instr ImmCondBranch(int64_t imm19) {
+  return SignedField(imm19, ImmCondBranch_offset, ImmCondBranch_width);
+}
+
+constexpr Instr ImmCmpBranch(int64_t imm19) {
+  return SignedField(imm19, ImmCmpBranch_offset, ImmCmpBranch_width);
+}
+
+constexpr Instr ImmTestBranch(int64_t imm14) {
+  return SignedField(imm14, ImmTestBranch_offset, ImmTestBranch_width);
+}
+
+constexpr Instr ImmTestBranchBit(unsigned bit_pos) {
+  return Check(IsUintN(6, bit_pos),
+               ((bit_pos << (ImmTestBranchBit5_offset - 5)) &
+                ImmTestBranchBit5_mask) |
+                   ((bit_pos << ImmTestBranchBit40_offset) &
+                    ImmTestBranchBit40_mask));
+}
+
+constexpr Instr ImmLLiteral(int64_t imm19) {
+  return SignedField(imm19, ImmLLiteral_offset, ImmLLiteral_width);
+}
+
+// `offset` is in bytes, and must be a multiple of the access size.
+constexpr Instr ImmLSUnsigned(int64_t offset, unsigned size_log2) {
+  return Check((offset >= 0) && ((offset & ((1 << size_log2) - 1)) == 0),
+               UnsignedField(offset >> size_log2,
+                             ImmLSUnsigned_offset,
+                             ImmLSUnsigned_width));
+}
+
+constexpr Instr ImmLSPair(int64_t offset, unsigned size_log2) {
+  return Check((offset & ((1 << size_log2) - 1)) == 0,
+               SignedField(offset / (1 << size_log2),
+                           ImmLSPair_offset,
+                           ImmLSPair_width));
+}
+
+constexpr Instr ImmException(uint64_t imm16) {
+  return UnsignedField(imm16, ImmException_offset, ImmException_width);
+}
+
+// The condition of a conditional branch, in bits 0-3.
+constexpr Instr ConditionalBranchCond(Condition cond) {
+  return Check((cond >= eq) && (cond <= nv), static_cast<Instr>(cond));
+}
+
+// A64 instructions.
+
+constexpr Instr Nop() { return HINT | (NOP << ImmHint_offset); }
+
+constexpr Instr Brk(uint64_t code) { return BRK | ImmException(code); }
+
+// The `B` and `BL` opcodes are hidden by the encoders of the same name.
+constexpr Instr B(int64_t imm26) {
+  return UnconditionalBranchFixed | ImmUncondBranch(imm26);
+}
+constexpr Instr Bl(int64_t imm26) {
+  return UnconditionalBranchFixed | 0x80000000 | ImmUncondBranch(imm26);
+}
+constexpr Instr B(Condition cond, int64_t imm19) {
+  return B_cond | ImmCondBranch(imm19) | ConditionalBranchCond(cond);
+}
+
+template <typename R>
+constexpr Instr Cbz(R rt, int64_t imm19) {
+  return SF(rt) | CBZ | ImmCmpBranch(imm19) | Rt(rt.code);
+}
+
+template <typename R>
+constexpr Instr Cbnz(R rt, int64_t imm19) {
+  return SF(rt) | CBNZ | ImmCmpBranch(imm19) | Rt(rt.code);
+}
+
+template <typename R>
+constexpr Instr Tbz(R rt, unsigned bit_pos, int64_t imm14) {
+  return TBZ | ImmTestBranchBit(bit_pos) | ImmTestBranch(imm14) | Rt(rt.code);
+}
+
+template <typename R>
+constexpr Instr Tbnz(R rt, unsigned bit_pos, int64_t imm14) {
+  return TBNZ | ImmTestBranchBit(bit_pos) | ImmTestBranch(imm14) |
+         Rt(rt.code);
+}
+
+constexpr Instr Br(XReg xn) { return BR | Rn(xn.code); }
+constexpr Instr Blr(XReg xn) { return BLR | Rn(xn.code); }
+constexpr Instr Ret(XReg xn = XReg(kLinkRegCode)) {
+  return RET | Rn(xn.code);
+}
+
+// `rd` and `rn` can be the stack pointer, but not the zero register.
+template <typename R>
+constexpr Instr Add(R rd, R rn, uint64_t imm) {
+  return SF(rd) | AddSubImmediateFixed | ADD | ImmAddSub(imm) | Rd(rd.code) |
+         Rn(rn.code);
+}
+
+template <typename R>
+constexpr Instr Sub(R rd, R rn, uint64_t imm) {
+  return SF(rd) | AddSubImmediateFixed | SUB | ImmAddSub(imm) | Rd(rd.code) |
+         Rn(rn.code);
+}
+
+// `rd` is the zero register when its code is 31.
+template <typename R>
+constexpr Instr Adds(R rd, R rn, uint64_t imm) {
+  return SF(rd) | AddSubImmediateFixed | ADDS | ImmAddSub(imm) | Rd(rd.code) |
+         Rn(rn.code);
+}
+
+template <typename R>
+constexpr Instr Subs(R rd, R rn, uint64_t imm) {
+  return SF(rd) | AddSubImmediateFixed | SUBS | ImmAddSub(imm) | Rd(rd.code) |
+         Rn(rn.code);
+}
+
+// `mov rd, rm`, as an alias of `orr rd, zr, rm`. Neither register can be the
+// stack pointer; use `Add(rd, rn, 0)` for that.
+template <typename R>
+constexpr Instr Mov(R rd, R rm) {
+  return SF(rd) | LogicalShiftedFixed | ORR | Rd(rd.code) |
+         Rn(kZeroRegCode) | Rm(rm.code);
+}
+
+// `shift` is in bits.
+template <typename R>
+constexpr Instr Movz(R rd, uint64_t imm16, int shift = 0) {
+  return SF(rd) | MoveWideImmediateFixed | MOVZ |
+         Check((shift % 16) == 0, ShiftMoveWide(shift / 16)) |
+         ImmMoveWide(imm16) | Rd(rd.code);
+}
+
+template <typename R>
+constexpr Instr Movk(R rd, uint64_t imm16, int shift = 0) {
+  return SF(rd) | MoveWideImmediateFixed | MOVK |
+         Check((shift % 16) == 0, ShiftMoveWide(shift / 16)) |
+         ImmMoveWide(imm16) | Rd(rd.code);
+}
+
+template <typename R>
+constexpr Instr Movn(R rd, uint64_t imm16, int shift = 0) {
+  return SF(rd) | MoveWideImmediateFixed | MOVN |
+         Check((shift % 16) == 0, ShiftMoveWide(shift / 16)) |
+         ImmMoveWide(imm16) | Rd(rd.code);
+}
+
+constexpr Instr Adr(XReg xd, int64_t imm21) {
+  return ADR | ImmPCRelAddress(imm21) | Rd(xd.code);
+}
+
+// `imm21` is in pages.
+constexpr Instr Adrp(XReg xd, int64_t imm21) {
+  return ADRP | ImmPCRelAddress(imm21) | Rd(xd.code);
+}
+
+// Loads and stores with an unsigned, scaled offset in bytes. The base register
+// can be the stack pointer.
+constexpr Instr Ldr(XReg xt, XReg xn, int64_t offset = 0) {
+  return LDR_x_unsigned | ImmLSUnsigned(offset, kXRegSizeInBytesLog2) |
+         Rn(xn.code) | Rt(xt.code);
+}
+constexpr Instr Ldr(WReg wt, XReg xn, int64_t offset = 0) {
+  return LDR_w_unsigned | ImmLSUnsigned(offset, kWRegSizeInBytesLog2) |
+         Rn(xn.code) | Rt(wt.code);
+}
+constexpr Instr Str(XReg xt, XReg xn, int64_t offset = 0) {
+  return STR_x_unsigned | ImmLSUnsigned(offset, kXRegSizeInBytesLog2) |
+         Rn(xn.code) | Rt(xt.code);
+}
+constexpr Instr Str(WReg wt, XReg xn, int64_t offset = 0) {
+  return STR_w_unsigned | ImmLSUnsigned(offset, kWRegSizeInBytesLog2) |
+         Rn(xn.code) | Rt(wt.code);
+}
+
+constexpr Instr LdrLiteral(XReg xt, int64_t imm19) {
+  return LDR_x_lit | ImmLLiteral(imm19) | Rt(xt.code);
+}
+constexpr Instr LdrLiteral(WReg wt, int64_t imm19) {
+  return LDR_w_lit | ImmLLiteral(imm19) | Rt(wt.code);
+}
+
+// Pairs of X registers, with a signed, scaled offset in bytes.
+constexpr Instr LoadStorePairX(Instr offset_op,
+                               Instr pre_op,
+                               Instr post_op,
+                               XReg xt,
+                               XReg xt2,
+                               XReg xn,
+                               int64_t offset,
+                               AddrMode mode) {
+  return ((mode == Offset) ? offset_op
+                           : ((mode == PreIndex) ? pre_op : post_op)) |
+         ImmLSPair(offset, kXRegSizeInBytesLog2) | Rn(xn.code) |
+         Rt2(xt2.code) | Rt(xt.code);
+}
+
+constexpr Instr Ldp(
+    XReg xt, XReg xt2, XReg xn, int64_t offset, AddrMode mode = Offset) {
+  return LoadStorePairX(LDP_x_off,
+                        LDP_x_pre,
+                        LDP_x_post,
+                        xt,
+                        xt2,
+                        xn,
+                        offset,
+                        mode);
+}
+
+constexpr Instr Stp(
+    XReg xt, XReg xt2, XReg xn, int64_t offset, AddrMode mode = Offset) {
+  return LoadStorePairX(STP_x_off,
+                        STP_x_pre,
+                        STP_x_post,
+                        xt,
+                        xt2,
+                        xn,
+                        offset,
+                        mode);
+}
+
+// C64 (Morello) instructions.
+
+constexpr Instr Br(CReg cn) { return BR_c | Rn(cn.code); }
+constexpr Instr Blr(CReg cn) { return BLR_c | Rn(cn.code); }
+constexpr Instr Ret(CReg cn) { return RET_c | Rn(cn.code); }
+
+// `mov cd, cn`, as an alias of `cpy`.
+constexpr Instr Mov(CReg cd, CReg cn) {
+  return CPY_c_c | Rd(cd.code) | Rn(cn.code);
+}
+
+constexpr Instr Add(CReg cd, CReg cn, uint64_t imm) {
+  return ADD_c_cis | ImmAddSub(imm) | Rd(cd.code) | Rn(cn.code);
+}
+
+constexpr Instr Adr(CReg cd, int64_t imm21) {
+  return ADR | ImmPCRelAddress(imm21) | Rd(cd.code);
+}
+
+// `imm20` is in pages.
+constexpr Instr Adrp(CReg cd, int64_t imm20) {
+  return ADRP | ImmC64RelAddressADRP(imm20) | Rd(cd.code);
+}
+
+// The base register is a C register in C64, and an X register in A64.
+template <typename R>
+constexpr Instr Ldr(CReg ct, R rn, int64_t offset = 0) {
+  return LDR_c_rib | ImmLSUnsigned(offset, kCRegSizeInBytesLog2) |
+         Rn(rn.code) | Rt(ct.code);
+}
+
+template <typename R>
+constexpr Instr Str(CReg ct, R rn, int64_t offset = 0) {
+  return STR_c_rib | ImmLSUnsigned(offset, kCRegSizeInBytesLog2) |
+         Rn(rn.code) | Rt(ct.code);
+}
+
+}  // namespace encoding
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_ENCODERS_AARCH64_H_
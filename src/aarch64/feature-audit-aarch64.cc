@@ -0,0 +1,224 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "cpu-features-auditor-aarch64.h"
+#include "decoder-aarch64.h"
+#include "macro-assembler-aarch64.h"
+
+#include "feature-audit-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+const Instruction* FeatureAudit::Function::GetFirstUse(
+    CPUFeatures::Feature feature) const {
+  for (const FirstUse& use : first_uses) {
+    if (use.first == feature) return use.second;
+  }
+  return NULL;
+}
+
+
+void FeatureAudit::AddFunction(const std::string& name,
+                               const Instruction* start,
+                               const Instruction* end,
+                               ISA isa) {
+  ISAMap map(isa);
+  AddFunction(name, start, end, &map);
+}
+
+
+void FeatureAudit::AddFunction(const std::string& name,
+                               const Instruction* start,
+                               const Instruction* end,
+                               const ISAMap* isa_map) {
+  VIXL_CHECK(start <= end);
+  VIXL_CHECK(((end - start) % kInstructionSize) == 0);
+  Function function;
+  function.name = name;
+  function.start = start;
+  function.end = end;
+  functions_.push_back(function);
+  int index = GetNumberOfFunctions() - 1;
+
+  // Split the function at each change of ISA. The map is only used here, so
+  // that the audit itself doesn't share it between threads.
+  ISA isa = isa_map->GetISAAt(0);
+  const Instruction* segment_start = start;
+  for (const std::pair<const ptrdiff_t, ISA>& block : *isa_map) {
+    if (block.first <= 0) continue;
+    const Instruction* block_start = start + block.first;
+    if (block_start >= end) break;
+    AddSegment(index, segment_start, block_start, isa);
+    segment_start = block_start;
+    isa = block.second;
+  }
+  AddSegment(index, segment_start, end, isa);
+}
+
+
+void FeatureAudit::AddFunctions(
+    const MacroAssembler& masm,
+    const std::vector<std::pair<std::string, const Label*>>& labels) {
+  const Instruction* base =
+      masm.GetBuffer().GetStartAddress<const Instruction*>();
+  ptrdiff_t size = masm.GetSizeOfCodeGenerated();
+
+  std::vector<std::pair<ptrdiff_t, const std::string*>> starts;
+  for (const std::pair<std::string, const Label*>& label : labels) {
+    VIXL_CHECK(label.second->IsBound());
+    starts.push_back(std::make_pair(label.second->GetLocation(), &label.first));
+  }
+  std::stable_sort(starts.begin(), starts.end());
+
+  for (size_t i = 0; i < starts.size(); i++) {
+    ptrdiff_t start = starts[i].first;
+    ptrdiff_t end = (i + 1 < starts.size()) ? starts[i + 1].first : size;
+    ISAMap map = masm.GetISAMap()->GetPart(start, end);
+    AddFunction(*starts[i].second, base + start, base + end, &map);
+  }
+}
+
+
+void FeatureAudit::AddSegment(int function,
+                              const Instruction* start,
+                              const Instruction* end,
+                              ISA isa) {
+  // Data, such as literal pools, isn't audited.
+  if ((start == end) || (isa == ISA::Data)) return;
+  Segment segment = {function, start, end, isa};
+  pending_.push_back(segment);
+}
+
+
+void FeatureAudit::AuditChunk(Chunk* chunk,
+                              Decoder* decoder,
+                              const CPUFeaturesAuditor& auditor) {
+  for (const Instruction* instr = chunk->segment.start;
+       instr < chunk->segment.end;
+       instr = instr->GetNextInstruction()) {
+    decoder->Decode(instr, chunk->segment.isa);
+    const CPUFeatures& features = auditor.GetInstructionFeatures();
+    // Most instructions only use features that have already been seen, so
+    // only look at the individual features when that isn't the case.
+    if (chunk->features.Has(features)) continue;
+    for (CPUFeatures::const_iterator it = features.begin();
+         it != features.end();
+         ++it) {
+      if (!chunk->features.Has(*it)) {
+        chunk->first_uses.push_back(std::make_pair(*it, instr));
+      }
+    }
+    chunk->features.Combine(features);
+  }
+}
+
+
+void FeatureAudit::Run(int number_of_threads) {
+  // Split the pending segments into chunks, in code order.
+  std::vector<Chunk> chunks;
+  for (const Segment& segment : pending_) {
+    const Instruction* start = segment.start;
+    while (start < segment.end) {
+      size_t remaining = (segment.end - start) / kInstructionSize;
+      const Instruction* end =
+          start + (std::min(remaining, chunk_size_) * kInstructionSize);
+      Chunk chunk;
+      chunk.segment = segment;
+      chunk.segment.start = start;
+      chunk.segment.end = end;
+      chunks.push_back(chunk);
+      start = end;
+    }
+  }
+  pending_.clear();
+
+  if (number_of_threads <= 0) {
+    number_of_threads =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  number_of_threads =
+      std::min(number_of_threads, static_cast<int>(chunks.size()));
+
+  // Each thread takes the next chunk as soon as it is free. Decoders are
+  // expensive to construct, so each thread keeps its own for every chunk.
+  std::atomic<size_t> next_chunk(0);
+  auto worker = [this, &chunks, &next_chunk]() {
+    Decoder decoder;
+    CPUFeaturesAuditor auditor(&decoder, baseline_);
+    for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+      AuditChunk(&chunks[i], &decoder, auditor);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < number_of_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  if (number_of_threads > 0) worker();
+  for (std::thread& thread : threads) thread.join();
+
+  // Merge the chunks into their functions. Chunks are in code order, so the
+  // first use of each feature comes from the first chunk that uses it.
+  for (const Chunk& chunk : chunks) {
+    Function* function = &functions_[chunk.segment.function];
+    for (const FirstUse& use : chunk.first_uses) {
+      if (!function->features.Has(use.first)) {
+        function->first_uses.push_back(use);
+      }
+    }
+    function->features.Combine(chunk.features);
+  }
+}
+
+
+CPUFeatures FeatureAudit::GetRequiredFeatures() const {
+  CPUFeatures features;
+  for (const Function& function : functions_) {
+    features.Combine(function.features);
+  }
+  return features;
+}
+
+
+void FeatureAudit::PrintReport(std::ostream& os) const {
+  for (const Function& function : functions_) {
+    os << function.name << ": {";
+    if (!function.features.HasNoFeatures()) os << " " << function.features;
+    os << " }\n";
+    for (const FirstUse& use : function.first_uses) {
+      if (baseline_.Has(use.first)) continue;
+      os << "  " << use.first << " is not in the baseline; first used at +0x"
+         << std::hex << (use.second - function.start) << std::dec << "\n";
+    }
+  }
+}
+
+}  // namespace aarch64
+}  // namespace vixl
@@ -0,0 +1,180 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_FEATURE_AUDIT_AARCH64_H_
+#define VIXL_AARCH64_FEATURE_AUDIT_AARCH64_H_
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../cpu-features.h"
+#include "../globals-vixl.h"
+
+#include "instructions-aarch64.h"
+#include "isa-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class CPUFeaturesAuditor;
+class Decoder;
+class Label;
+class MacroAssembler;
+
+// Find the CPU features that each function in a body of code requires, for
+// example to check that it only uses features available on the oldest core
+// that it will run on. Functions are audited in parallel, using one Decoder
+// and CPUFeaturesAuditor per thread, and large functions are split into chunks
+// so that the work is balanced between threads.
+//
+// Typical usage:
+//
+//   FeatureAudit audit(CPUFeatures::AArch64LegacyBaseline());
+//   audit.AddFunction("foo", foo_start, foo_end);
+//   audit.AddFunction("bar", bar_start, bar_end, &bar_isa_map);
+//   audit.Run();
+//   if (!audit.IsCompatible()) audit.PrintReport(std::cout);
+//
+// The baseline is used as the auditor's hint for instructions that can be
+// provided by more than one feature (see CPUFeaturesAuditor), so it should be
+// the set of features of the target core.
+class FeatureAudit {
+ public:
+  typedef std::pair<CPUFeatures::Feature, const Instruction*> FirstUse;
+
+  struct Function {
+    std::string name;
+    const Instruction* start;
+    const Instruction* end;
+
+    // The minimal set of features needed to run the function: the union of
+    // the features required by each of its instructions.
+    CPUFeatures features;
+    // The first instruction that requires each feature in `features`, in the
+    // order in which they appear in the code.
+    std::vector<FirstUse> first_uses;
+
+    // Return the first instruction that requires `feature`, or NULL if no
+    // instruction does.
+    const Instruction* GetFirstUse(CPUFeatures::Feature feature) const;
+  };
+
+  explicit FeatureAudit(const CPUFeatures& baseline = CPUFeatures::None())
+      : baseline_(baseline), chunk_size_(kDefaultChunkSize) {}
+
+  // Add a function covering [start, end). If an ISA map is given, it describes
+  // the code from `start`, and data regions are skipped. Otherwise, the whole
+  // function is decoded as `isa`.
+  void AddFunction(const std::string& name,
+                   const Instruction* start,
+                   const Instruction* end,
+                   ISA isa = ISA::A64);
+  void AddFunction(const std::string& name,
+                   const Instruction* start,
+                   const Instruction* end,
+                   const ISAMap* isa_map);
+
+  // Add the code generated by `masm`, split into one function at each of the
+  // given labels. Each function ends where the next one starts, or at the end
+  // of the code. The MacroAssembler must have been finalised, and every label
+  // must be bound.
+  void AddFunctions(
+      const MacroAssembler& masm,
+      const std::vector<std::pair<std::string, const Label*>>& labels);
+
+  // Audit every function. If `number_of_threads` is zero, one thread is used
+  // for each available core. This can be called again after adding functions.
+  void Run(int number_of_threads = 0);
+
+  const CPUFeatures& GetBaseline() const { return baseline_; }
+
+  int GetNumberOfFunctions() const {
+    return static_cast<int>(functions_.size());
+  }
+  const Function& GetFunction(int index) const {
+    VIXL_ASSERT((index >= 0) && (index < GetNumberOfFunctions()));
+    return functions_[index];
+  }
+
+  // The union of the features required by every function.
+  CPUFeatures GetRequiredFeatures() const;
+
+  // Return true if every function only requires features in the baseline.
+  bool IsCompatible() const {
+    return baseline_.Has(GetRequiredFeatures());
+  }
+
+  // Print the features required by each function. For features that are not
+  // in the baseline, the offset of the first instruction that uses them is
+  // also printed.
+  void PrintReport(std::ostream& os) const;
+
+  // The maximum number of instructions audited as one piece of work. This only
+  // affects performance.
+  void SetChunkSize(size_t instructions) {
+    VIXL_ASSERT(instructions > 0);
+    chunk_size_ = instructions;
+  }
+
+  static const size_t kDefaultChunkSize = 4 * 1024;
+
+ private:
+  // A part of a function, decoded as a single ISA.
+  struct Segment {
+    int function;
+    const Instruction* start;
+    const Instruction* end;
+    ISA isa;
+  };
+
+  // The result of auditing part of a segment.
+  struct Chunk {
+    Segment segment;
+    CPUFeatures features;
+    std::vector<FirstUse> first_uses;
+  };
+
+  void AddSegment(int function,
+                  const Instruction* start,
+                  const Instruction* end,
+                  ISA isa);
+  static void AuditChunk(Chunk* chunk,
+                         Decoder* decoder,
+                         const CPUFeaturesAuditor& auditor);
+
+  CPUFeatures baseline_;
+  size_t chunk_size_;
+  std::vector<Function> functions_;
+  // Segments that have not been audited yet, in code order.
+  std::vector<Segment> pending_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_FEATURE_AUDIT_AARCH64_H_
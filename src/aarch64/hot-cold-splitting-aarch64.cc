@@ -0,0 +1,174 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+
+#include "hot-cold-splitting-aarch64.h"
+
+#include "macro-assembler-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+ExecutionProfiler::ExecutionProfiler(const Instruction* start,
+                                     const Instruction* end)
+    : start_(start) {
+  VIXL_ASSERT(end >= start);
+  VIXL_ASSERT(((end - start) % kInstructionSize) == 0);
+  counts_.resize((end - start) / kInstructionSize, 0);
+}
+
+
+uint64_t ExecutionProfiler::GetExecutionCount(ptrdiff_t offset) const {
+  VIXL_ASSERT((offset % kInstructionSize) == 0);
+  VIXL_ASSERT((offset >= 0) &&
+              (static_cast<size_t>(offset / kInstructionSize) <
+               counts_.size()));
+  return counts_[offset / kInstructionSize];
+}
+
+
+void ExecutionProfiler::Reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+}
+
+
+int HotColdSplitter::AddBlock(const Generator& generator, bool falls_through) {
+  Block block = {generator, false, falls_through, 0, 0};
+  blocks_.push_back(block);
+  return static_cast<int>(blocks_.size()) - 1;
+}
+
+
+void HotColdSplitter::SetGenerator(int block, const Generator& generator) {
+  VIXL_ASSERT((block >= 0) && (block < GetNumberOfBlocks()));
+  blocks_[block].generator = generator;
+}
+
+
+void HotColdSplitter::SetFallsThrough(int block, bool falls_through) {
+  VIXL_ASSERT((block >= 0) && (block < GetNumberOfBlocks()));
+  blocks_[block].falls_through = falls_through;
+}
+
+
+void HotColdSplitter::SetCold(int block, bool is_cold) {
+  VIXL_ASSERT((block >= 0) && (block < GetNumberOfBlocks()));
+  // The entry block must stay at the start of the function.
+  VIXL_ASSERT((block != 0) || !is_cold);
+  blocks_[block].is_cold = is_cold;
+}
+
+
+bool HotColdSplitter::IsCold(int block) const {
+  VIXL_ASSERT((block >= 0) && (block < GetNumberOfBlocks()));
+  return blocks_[block].is_cold;
+}
+
+
+int HotColdSplitter::GetNumberOfColdBlocks() const {
+  int count = 0;
+  for (size_t i = 0; i < blocks_.size(); i++) {
+    if (blocks_[i].is_cold) count++;
+  }
+  return count;
+}
+
+
+int HotColdSplitter::ClassifyFromProfile(const ExecutionProfiler& profiler,
+                                         uint64_t threshold) {
+  VIXL_ASSERT(labels_count_ == blocks_.size());
+  // Blocks are only entered at their start, so the count of their first
+  // instruction is the number of times that they were entered.
+  for (size_t i = 1; i < blocks_.size(); i++) {
+    Block* block = &blocks_[i];
+    if (block->size == 0) continue;
+    block->is_cold = profiler.GetExecutionCount(block->offset) <= threshold;
+  }
+  return GetNumberOfColdBlocks();
+}
+
+
+Label* HotColdSplitter::GetLabel(int block) {
+  VIXL_ASSERT((block >= 0) && (static_cast<size_t>(block) < labels_count_));
+  return &labels_[block];
+}
+
+
+ptrdiff_t HotColdSplitter::GetBlockOffset(int block) const {
+  VIXL_ASSERT((block >= 0) && (static_cast<size_t>(block) < labels_count_));
+  return blocks_[block].offset;
+}
+
+
+void HotColdSplitter::Generate(MacroAssembler* masm) {
+  // Labels from a previous call are bound, so they can be discarded.
+  labels_count_ = blocks_.size();
+  labels_.reset(new Label[labels_count_]);
+  added_branches_ = 0;
+  function_start_ = masm->GetCursorOffset();
+
+  // Control that falls through the last block leaves the function; `end` is
+  // bound after the cold region, which is where it would have gone.
+  Label end;
+  for (size_t i = 0; i < blocks_.size(); i++) {
+    if (!blocks_[i].is_cold) EmitBlock(masm, static_cast<int>(i), &end);
+  }
+  cold_start_ = masm->GetCursorOffset() - function_start_;
+  for (size_t i = 0; i < blocks_.size(); i++) {
+    if (blocks_[i].is_cold) EmitBlock(masm, static_cast<int>(i), &end);
+  }
+  masm->Bind(&end);
+}
+
+
+void HotColdSplitter::EmitBlock(MacroAssembler* masm, int index, Label* end) {
+  Block* block = &blocks_[index];
+  masm->Bind(&labels_[index]);
+  block->offset = masm->GetCursorOffset() - function_start_;
+  if (block->generator) block->generator(masm);
+  block->size = masm->GetCursorOffset() - function_start_ - block->offset;
+  if (!block->falls_through) return;
+
+  // Find the block that control falls through to, and whether it follows this
+  // one in the new layout. Blocks in each region keep their original order.
+  size_t next = index + 1;
+  bool is_adjacent;
+  if (next < blocks_.size()) {
+    is_adjacent = (blocks_[next].is_cold == block->is_cold);
+  } else {
+    // The end of the function follows the last cold block, or the last hot
+    // block if there are no cold blocks.
+    is_adjacent = block->is_cold || (GetNumberOfColdBlocks() == 0);
+  }
+  if (!is_adjacent) {
+    masm->B((next < blocks_.size()) ? &labels_[next] : end);
+    added_branches_++;
+  }
+}
+
+}  // namespace aarch64
+}  // namespace vixl
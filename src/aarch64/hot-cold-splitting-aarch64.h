@@ -0,0 +1,203 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_HOT_COLD_SPLITTING_AARCH64_H_
+#define VIXL_AARCH64_HOT_COLD_SPLITTING_AARCH64_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "decoder-aarch64.h"
+#include "instructions-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class Label;
+class MacroAssembler;
+
+// Count how many times each instruction in a region of code is executed. This
+// is a decoder visitor, so it can be attached to the decoder used by the
+// Simulator:
+//
+//   ExecutionProfiler profiler(start, end);
+//   Decoder decoder;
+//   Simulator simulator(&decoder);
+//   decoder.AppendVisitor(&profiler);
+//   simulator.RunFrom(start);
+//
+// Instructions outside the region are ignored.
+class ExecutionProfiler : public DecoderVisitor {
+ public:
+  ExecutionProfiler(const Instruction* start, const Instruction* end);
+
+  // Return the number of times that the instruction at `offset` from the start
+  // of the region was executed.
+  uint64_t GetExecutionCount(ptrdiff_t offset) const;
+
+  void Reset();
+
+  virtual void VisitData(const Instruction* instr) VIXL_OVERRIDE {
+    USE(instr);
+  }
+
+#define DECLARE(A)                                                \
+  virtual void Visit##A(const Instruction* instr) VIXL_OVERRIDE { \
+    Count(instr);                                                 \
+  }
+  VISITOR_LIST(DECLARE)
+#undef DECLARE
+
+ private:
+  void Count(const Instruction* instr) {
+    uintptr_t offset = reinterpret_cast<uintptr_t>(instr) -
+                       reinterpret_cast<uintptr_t>(start_);
+    // Instructions before `start_` wrap around to large offsets.
+    if (offset < (counts_.size() * kInstructionSize)) {
+      counts_[offset / kInstructionSize]++;
+    }
+  }
+
+  const Instruction* start_;
+  std::vector<uint64_t> counts_;
+};
+
+
+// Generate a function with its rarely executed blocks, such as slow paths and
+// error handling, moved out of line into a cold region after the rest of the
+// function. This keeps the hot path dense in the instruction cache.
+//
+// The function is described as a sequence of blocks, each with a generator.
+// Blocks are laid out in order, except that cold blocks are deferred to the
+// cold region. Each block has a label, bound to its start, which other blocks
+// can branch to. If control can fall through the end of a block, and the
+// next block is not next in the new layout, a branch to it is added.
+// Branches between the hot and cold regions are ordinary label branches, and
+// use veneers if they are out of range. The splitter can also be used inside a
+// BranchRelaxation generator, to relax these branches instead.
+//
+// Blocks can be marked as cold explicitly, or classified from the execution
+// counts of a previous version of the function, for example one run in the
+// Simulator with an `ExecutionProfiler`. The first block is the entry point of
+// the function, so it can never be cold.
+//
+// Typical usage:
+//
+//   HotColdSplitter splitter;
+//   int entry = splitter.AddBlock();
+//   int slow = splitter.AddBlock();
+//   splitter.SetGenerator(entry, [&](MacroAssembler* masm) {
+//     masm->Cbz(x0, splitter.GetLabel(slow));
+//     ...
+//     masm->Ret();
+//   });
+//   splitter.SetGenerator(slow, ...);
+//   splitter.SetCold(slow, true);
+//   splitter.Generate(&masm);
+//
+// Because generators can run more than once, they must be deterministic, and
+// should refer to blocks through `GetLabel()` rather than through labels that
+// they don't own.
+class HotColdSplitter {
+ public:
+  typedef std::function<void(MacroAssembler* masm)> Generator;
+
+  HotColdSplitter()
+      : labels_count_(0),
+        function_start_(0),
+        cold_start_(0),
+        added_branches_(0) {}
+
+  // Add a hot block at the end of the function, and return its index. If
+  // `falls_through` is false, control never reaches the end of the block (for
+  // example because it ends with `ret` or an unconditional branch).
+  int AddBlock(const Generator& generator = Generator(),
+               bool falls_through = true);
+
+  // Set the generator of a block. This allows blocks to be added before the
+  // code that refers to them is known.
+  void SetGenerator(int block, const Generator& generator);
+  void SetFallsThrough(int block, bool falls_through);
+
+  void SetCold(int block, bool is_cold);
+  bool IsCold(int block) const;
+
+  // Mark blocks as cold if they were entered at most `threshold` times, and
+  // hot otherwise, according to `profiler`. The profiler must cover exactly
+  // the code produced by the last call to `Generate()`, which is usually
+  // generated with every block hot. Blocks that produced no code, and the
+  // entry block, are not changed. Return the number of cold blocks.
+  int ClassifyFromProfile(const ExecutionProfiler& profiler,
+                          uint64_t threshold = 0);
+
+  // Generate the function at the current position of `masm`. This can be
+  // called more than once; each call rebinds the blocks' labels.
+  void Generate(MacroAssembler* masm);
+
+  // The label of a block, for the current or last call to `Generate()`. Labels
+  // are only available once `Generate()` has been called.
+  Label* GetLabel(int block);
+
+  int GetNumberOfBlocks() const { return static_cast<int>(blocks_.size()); }
+  int GetNumberOfColdBlocks() const;
+
+  // Layout information for the last call to `Generate()`. Offsets are relative
+  // to the start of the function.
+  ptrdiff_t GetBlockOffset(int block) const;
+  ptrdiff_t GetColdRegionOffset() const { return cold_start_; }
+  ptrdiff_t GetFunctionStart() const { return function_start_; }
+  // The number of branches added to keep blocks connected.
+  int GetNumberOfAddedBranches() const { return added_branches_; }
+
+ private:
+  struct Block {
+    Generator generator;
+    bool is_cold;
+    bool falls_through;
+    // Relative to `function_start_`.
+    ptrdiff_t offset;
+    ptrdiff_t size;
+  };
+
+  void EmitBlock(MacroAssembler* masm, int block, Label* end);
+
+  std::vector<Block> blocks_;
+  // One label per block, recreated by each call to `Generate()`.
+  std::unique_ptr<Label[]> labels_;
+  size_t labels_count_;
+
+  ptrdiff_t function_start_;
+  ptrdiff_t cold_start_;
+  int added_branches_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_HOT_COLD_SPLITTING_AARCH64_H_
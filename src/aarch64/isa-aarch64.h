@@ -147,6 +147,15 @@ class ISAMap {
     cursor_ = isas_.end();
   }
 
+  ISA GetDefaultISA() const { return default_isa_; }
+
+  // Iterate over the recorded blocks, in order of their starting offsets. Each
+  // element is a `std::pair<ptrdiff_t, ISA>`. Code before the first block (if
+  // any) uses `GetDefaultISA()`.
+  typedef std::map<ptrdiff_t, ISA>::const_iterator const_iterator;
+  const_iterator begin() const { return isas_.begin(); }
+  const_iterator end() const { return isas_.end(); }
+
  private:
   bool CursorContains(ptrdiff_t at) const {
     if (isas_.empty()) return false;
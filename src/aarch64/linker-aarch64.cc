@@ -0,0 +1,292 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "linker-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+const int Linker::kTrampolineSize;
+const int64_t Linker::kMaxCallDistance;
+
+
+void LinkUnit::Bind(LinkSymbol symbol) {
+  VIXL_ASSERT(symbol.IsValid());
+  Definition definition = {symbol.GetIndex(), masm_.GetCursorOffset()};
+  definitions_.push_back(definition);
+}
+
+
+void LinkUnit::EmitReference(LinkSymbol symbol, bool link) {
+  VIXL_ASSERT(symbol.IsValid());
+  // The scope may emit pools, so only record the offset once it is open.
+  ExactAssemblyScope scope(&masm_, kInstructionSize);
+  Reference reference = {symbol.GetIndex(), masm_.GetCursorOffset()};
+  references_.push_back(reference);
+  // The branch is patched by the Linker.
+  if (link) {
+    masm_.bl(static_cast<int64_t>(0));
+  } else {
+    masm_.b(static_cast<int64_t>(0));
+  }
+}
+
+
+void LinkUnit::Generate() {
+  if (generator_) generator_(this);
+  masm_.FinalizeCode();
+}
+
+
+LinkSymbol Linker::AddSymbol(const char* name) {
+  VIXL_ASSERT(name != NULL);
+  symbol_names_.push_back(name);
+  return LinkSymbol(static_cast<int>(symbol_names_.size()) - 1);
+}
+
+
+const char* Linker::GetSymbolName(LinkSymbol symbol) const {
+  VIXL_ASSERT(symbol.IsValid());
+  return symbol_names_[symbol.GetIndex()].c_str();
+}
+
+
+LinkUnit* Linker::AddUnit(const LinkUnit::Generator& generator) {
+  units_.emplace_back(new LinkUnit(GetNumberOfUnits(), generator));
+  return units_.back().get();
+}
+
+
+void Linker::GenerateInParallel(int number_of_threads) {
+  if (number_of_threads <= 0) {
+    number_of_threads =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  number_of_threads = std::min(number_of_threads, GetNumberOfUnits());
+
+  // Units can take very different amounts of time to generate, so rather than
+  // dividing them up in advance, each thread takes the next unit as soon as it
+  // is free.
+  std::atomic<size_t> next_unit(0);
+  auto worker = [this, &next_unit]() {
+    for (size_t i = next_unit++; i < units_.size(); i = next_unit++) {
+      units_[i]->Generate();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < number_of_threads; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) thread.join();
+}
+
+
+ptrdiff_t Linker::ComputeLayout(ptrdiff_t start) {
+  ptrdiff_t offset = start;
+  for (const std::unique_ptr<LinkUnit>& unit : units_) {
+    offset = AlignUp(offset, unit_alignment_);
+    unit->linked_offset_ = offset;
+    offset += unit->masm_.GetSizeOfCodeGenerated();
+    if (!unit->trampolines_.empty()) {
+      // Align the islands so that the trampolines' offsets are naturally
+      // aligned.
+      offset = AlignUp(offset, kXRegSizeInBytes);
+      unit->island_offset_ = offset;
+      offset += unit->trampolines_.size() * kTrampolineSize;
+    }
+  }
+  return offset;
+}
+
+
+ptrdiff_t Linker::GetTargetOffset(int symbol) const {
+  const Definition& definition = definitions_[symbol];
+  return units_[definition.unit]->linked_offset_ + definition.offset;
+}
+
+
+bool Linker::IsInRange(ptrdiff_t from, ptrdiff_t to) const {
+  int64_t distance = to - from;
+  return (distance >= -max_call_distance_) &&
+         (distance < max_call_distance_) &&
+         Instruction::IsValidImmPCOffset(UncondBranchType,
+                                         distance / kInstructionSize);
+}
+
+
+bool Linker::AddTrampolines() {
+  bool added = false;
+  for (const std::unique_ptr<LinkUnit>& unit : units_) {
+    std::vector<int>* trampolines = &unit->trampolines_;
+    for (const LinkUnit::Reference& reference : unit->references_) {
+      if (std::find(trampolines->begin(),
+                    trampolines->end(),
+                    reference.symbol) != trampolines->end()) {
+        continue;
+      }
+      if (!IsInRange(unit->linked_offset_ + reference.offset,
+                     GetTargetOffset(reference.symbol))) {
+        trampolines->push_back(reference.symbol);
+        trampolines_++;
+        added = true;
+      }
+    }
+  }
+  return added;
+}
+
+
+void Linker::EmitPadding(Assembler* output, ptrdiff_t to) {
+  ptrdiff_t padding = to - output->GetCursorOffset();
+  VIXL_ASSERT(padding >= 0);
+  output->GetBuffer()->EmitZeroedBytes(static_cast<int>(padding));
+}
+
+
+void Linker::EmitUnit(Assembler* output, const LinkUnit* unit) {
+  const CodeBuffer& buffer = unit->masm_.GetBuffer();
+  const byte* code = buffer.GetStartAddress<const byte*>();
+  ptrdiff_t size = buffer.GetSizeInBytes();
+  const ISAMap* isa_map = unit->masm_.GetISAMap();
+
+  // Copy the code one ISA block at a time, so that the output's ISAMap
+  // describes it in the same way as the unit's.
+  output->SetISA(isa_map->GetISAAt(0));
+  ptrdiff_t copied = 0;
+  for (ISAMap::const_iterator it = isa_map->begin(); it != isa_map->end();
+       ++it) {
+    if (it->first <= 0) continue;
+    if (it->first >= size) break;
+    output->GetBuffer()->EmitData(code + copied, it->first - copied);
+    output->SetISA(it->second);
+    copied = it->first;
+  }
+  output->GetBuffer()->EmitData(code + copied, size - copied);
+}
+
+
+void Linker::EmitTrampoline(Assembler* output, ptrdiff_t target) {
+  ptrdiff_t start = output->GetCursorOffset();
+  output->SetISA(ISA::A64);
+  // The offset is four instructions ahead.
+  output->ldr(x16, 4);
+  output->adr(x17, -static_cast<int>(kInstructionSize));
+  output->add(x16, x16, x17);
+  output->br(x16);
+  output->SetISA(ISA::Data);
+  output->dc64(target - start);
+  VIXL_ASSERT((output->GetCursorOffset() - start) == kTrampolineSize);
+}
+
+
+void Linker::Link(Assembler* output) {
+  // Resolve the symbols.
+  Definition undefined = {-1, 0};
+  definitions_.assign(symbol_names_.size(), undefined);
+  for (const std::unique_ptr<LinkUnit>& unit : units_) {
+    VIXL_CHECK(!unit->masm_.GetBuffer()->IsDirty());
+    for (const LinkUnit::Definition& definition : unit->definitions_) {
+      // Each symbol must be defined once.
+      VIXL_CHECK(definitions_[definition.symbol].unit == -1);
+      Definition resolved = {unit->GetIndex(), definition.offset};
+      definitions_[definition.symbol] = resolved;
+    }
+    unit->trampolines_.clear();
+  }
+  for (const std::unique_ptr<LinkUnit>& unit : units_) {
+    for (const LinkUnit::Reference& reference : unit->references_) {
+      // Every referenced symbol must be defined.
+      VIXL_CHECK(definitions_[reference.symbol].unit != -1);
+    }
+  }
+
+  // Lay out the units, and add trampolines until every reference is in range.
+  // Trampolines are never removed, so this terminates.
+  trampolines_ = 0;
+  ptrdiff_t start = output->GetCursorOffset();
+  ptrdiff_t end;
+  do {
+    end = ComputeLayout(start);
+  } while (AddTrampolines());
+  linked_size_ = end - start;
+
+  ISA original_isa = output->GetISA();
+  {
+    CodeBufferCheckScope scope(output,
+                               linked_size_,
+                               CodeBufferCheckScope::kReserveBufferSpace,
+                               CodeBufferCheckScope::kExactSize);
+    for (const std::unique_ptr<LinkUnit>& unit : units_) {
+      EmitPadding(output, unit->linked_offset_);
+      EmitUnit(output, unit.get());
+      if (!unit->trampolines_.empty()) {
+        EmitPadding(output, unit->island_offset_);
+        for (int symbol : unit->trampolines_) {
+          EmitTrampoline(output, GetTargetOffset(symbol));
+        }
+      }
+    }
+    output->SetISA(original_isa);
+  }
+
+  // Patch the branches, now that the code has been copied.
+  CodeBuffer* buffer = output->GetBuffer();
+  for (const std::unique_ptr<LinkUnit>& unit : units_) {
+    const std::vector<int>& trampolines = unit->trampolines_;
+    for (const LinkUnit::Reference& reference : unit->references_) {
+      ptrdiff_t target = GetTargetOffset(reference.symbol);
+      std::vector<int>::const_iterator trampoline =
+          std::find(trampolines.begin(), trampolines.end(), reference.symbol);
+      if (trampoline != trampolines.end()) {
+        target = unit->island_offset_ +
+                 ((trampoline - trampolines.begin()) * kTrampolineSize);
+      }
+      VIXL_ASSERT(IsInRange(unit->linked_offset_ + reference.offset, target));
+      Instruction* branch = buffer->GetOffsetAddress<Instruction*>(
+          unit->linked_offset_ + reference.offset);
+      branch->SetImmPCOffsetTarget(buffer->GetOffsetAddress<Instruction*>(
+                                       target),
+                                   ISA::A64,
+                                   ISA::A64);
+    }
+  }
+}
+
+
+ptrdiff_t Linker::GetSymbolOffset(LinkSymbol symbol) const {
+  VIXL_ASSERT(symbol.IsValid());
+  VIXL_ASSERT(static_cast<size_t>(symbol.GetIndex()) < definitions_.size());
+  return GetTargetOffset(symbol.GetIndex());
+}
+
+}  // namespace aarch64
+}  // namespace vixl
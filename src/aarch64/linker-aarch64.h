@@ -0,0 +1,261 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef VIXL_AARCH64_LINKER_AARCH64_H_
+#define VIXL_AARCH64_LINKER_AARCH64_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "macro-assembler-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class Linker;
+
+// A symbol that can be referred to from any unit of a Linker, like a label
+// that is shared between MacroAssemblers. Symbols are created by a Linker, and
+// are only meaningful to that Linker.
+class LinkSymbol {
+ public:
+  LinkSymbol() : index_(-1) {}
+
+  int GetIndex() const { return index_; }
+  bool IsValid() const { return index_ >= 0; }
+
+ private:
+  explicit LinkSymbol(int index) : index_(index) {}
+
+  int index_;
+
+  friend class Linker;
+};
+
+
+// A unit of code, usually a single function, generated into its own
+// MacroAssembler. Units are created by a Linker. Code is generated into the
+// unit's MacroAssembler as usual, except that branches to symbols defined by
+// other units use `B()` and `Bl()`, which are resolved by `Linker::Link()`.
+//
+// Different units can be generated concurrently, but each unit must only be
+// used by one thread at a time.
+class LinkUnit {
+ public:
+  typedef std::function<void(LinkUnit* unit)> Generator;
+
+  MacroAssembler* GetMacroAssembler() { return &masm_; }
+  const MacroAssembler* GetMacroAssembler() const { return &masm_; }
+
+  // Define `symbol` at the current position. Each symbol must be defined
+  // exactly once, by one of the units.
+  void Bind(LinkSymbol symbol);
+
+  // Branch, or branch with link, to `symbol`. The symbol can be defined by any
+  // unit, including this one.
+  void B(LinkSymbol symbol) { EmitReference(symbol, false); }
+  void Bl(LinkSymbol symbol) { EmitReference(symbol, true); }
+
+  int GetIndex() const { return index_; }
+
+  // The offset of the unit in the linked code, once `Linker::Link()` has been
+  // called.
+  ptrdiff_t GetLinkedOffset() const { return linked_offset_; }
+
+ private:
+  LinkUnit(int index, const Generator& generator)
+      : index_(index),
+        generator_(generator),
+        linked_offset_(-1),
+        island_offset_(-1) {}
+
+  struct Definition {
+    int symbol;
+    ptrdiff_t offset;
+  };
+
+  struct Reference {
+    int symbol;
+    // Relative to the start of the unit.
+    ptrdiff_t offset;
+  };
+
+  void EmitReference(LinkSymbol symbol, bool link);
+
+  // Run the generator, if any, and finalise the code.
+  void Generate();
+
+  int index_;
+  Generator generator_;
+  MacroAssembler masm_;
+  std::vector<Definition> definitions_;
+  std::vector<Reference> references_;
+
+  // Layout information, computed by `Linker::Link()`.
+  ptrdiff_t linked_offset_;
+  ptrdiff_t island_offset_;
+  // The symbols that this unit calls through trampolines, in the order of the
+  // trampolines in the unit's island.
+  std::vector<int> trampolines_;
+
+  friend class Linker;
+};
+
+
+// Generate the functions of a module independently, possibly on several
+// threads, and link them into a single buffer.
+//
+// Each function is generated into its own LinkUnit, which has its own
+// MacroAssembler. Calls between functions refer to LinkSymbols rather than
+// labels. Once every unit has been generated, `Link()` copies the units into
+// one Assembler, merges their ISAMaps, and resolves the calls.
+//
+// A call whose target is out of range of `b` or `bl` (+/-128MB) goes through a
+// trampoline instead. Trampolines are placed in an island immediately after
+// the calling unit, so they are always in range of their callers, and they can
+// reach any offset. Like the veneers emitted by a system linker, trampolines
+// use ip0 (x16) and ip1 (x17) as scratch registers, so these registers must
+// not be live across a call to a symbol. Trampolines are A64 code, so calls
+// that might need one must be made from A64 code.
+//
+// Typical usage:
+//
+//   Linker linker;
+//   LinkSymbol callee = linker.AddSymbol("callee");
+//   linker.AddUnit([=](LinkUnit* unit) {
+//     MacroAssembler* masm = unit->GetMacroAssembler();
+//     ...
+//     unit->Bl(callee);
+//     ...
+//   });
+//   linker.AddUnit([=](LinkUnit* unit) {
+//     unit->Bind(callee);
+//     ...
+//   });
+//   linker.GenerateInParallel();
+//
+//   MacroAssembler masm;
+//   linker.Link(&masm);
+//   masm.FinalizeCode();
+//
+// Symbols and units must be added before generation starts.
+class Linker {
+ public:
+  Linker()
+      : unit_alignment_(kInstructionSize),
+        max_call_distance_(kMaxCallDistance),
+        linked_size_(0),
+        trampolines_(0) {}
+
+  // Add a symbol. The name is only used to describe the symbol, for example
+  // when writing an object file.
+  LinkSymbol AddSymbol(const char* name);
+  const char* GetSymbolName(LinkSymbol symbol) const;
+
+  // Add a unit, and return it. The unit is owned by the Linker.
+  LinkUnit* AddUnit(
+      const LinkUnit::Generator& generator = LinkUnit::Generator());
+  LinkUnit* GetUnit(int index) { return units_[index].get(); }
+  int GetNumberOfUnits() const { return static_cast<int>(units_.size()); }
+
+  // Run the generator of each unit, and finalise the unit's code, on up to
+  // `number_of_threads` threads (including the calling thread). By default,
+  // one thread is used for each hardware thread.
+  //
+  // Units without generators can be generated directly instead, in which case
+  // they must be finalised before `Link()` is called.
+  void GenerateInParallel(int number_of_threads = 0);
+
+  // Align the start of each unit to `alignment` bytes in the linked code. The
+  // padding between units is zero-filled.
+  void SetUnitAlignment(size_t alignment) {
+    VIXL_ASSERT(IsPowerOf2(alignment) && (alignment >= kInstructionSize));
+    unit_alignment_ = alignment;
+  }
+
+  // Limit the distance that calls can reach directly. This is mostly useful to
+  // exercise trampolines without generating 128MB of code.
+  void SetMaxCallDistance(int64_t distance) {
+    VIXL_ASSERT((distance > 0) && (distance <= kMaxCallDistance));
+    max_call_distance_ = distance;
+  }
+
+  // Copy every unit into `output`, at its current position, and resolve the
+  // references between them. The units must have been generated and
+  // finalised. Pending pools in `output` are not emitted, so `output` should
+  // usually be a fresh Assembler.
+  void Link(Assembler* output);
+
+  // Information about the last call to `Link()`. Offsets are relative to the
+  // start of the buffer of the output Assembler.
+  ptrdiff_t GetSymbolOffset(LinkSymbol symbol) const;
+  size_t GetLinkedSize() const { return linked_size_; }
+  int GetNumberOfTrampolines() const { return trampolines_; }
+
+  // `ldr x16, <offset>; adr x17, <trampoline>; add x16, x16, x17; br x16`,
+  // followed by the 64-bit offset from the trampoline to its target.
+  static const int kTrampolineSize = 4 * kInstructionSize + kXRegSizeInBytes;
+  static const int64_t kMaxCallDistance = INT64_C(128) * 1024 * 1024;
+
+ private:
+  struct Definition {
+    int unit;
+    ptrdiff_t offset;
+  };
+
+  // Place the units and their islands from `start`, and return the offset of
+  // the end of the linked code.
+  ptrdiff_t ComputeLayout(ptrdiff_t start);
+  // Add trampolines for the references that are out of range in the current
+  // layout. Return true if any were added.
+  bool AddTrampolines();
+  ptrdiff_t GetTargetOffset(int symbol) const;
+  bool IsInRange(ptrdiff_t from, ptrdiff_t to) const;
+
+  void EmitUnit(Assembler* output, const LinkUnit* unit);
+  void EmitTrampoline(Assembler* output, ptrdiff_t target);
+  void EmitPadding(Assembler* output, ptrdiff_t to);
+
+  std::vector<std::string> symbol_names_;
+  std::vector<Definition> definitions_;
+  std::vector<std::unique_ptr<LinkUnit> > units_;
+
+  size_t unit_alignment_;
+  int64_t max_call_distance_;
+
+  size_t linked_size_;
+  int trampolines_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_LINKER_AARCH64_H_
@@ -30,6 +30,18 @@
 
 #include "simulator-aarch64.h"
 
+// Use the host's AES and carry-less multiply instructions, where the compiler
+// makes them available, for the equivalent simulated instructions.
+#if defined(__x86_64__) && defined(__AES__)
+#include <wmmintrin.h>
+#define VIXL_SIMULATOR_HOST_AES
+#endif
+#if defined(__x86_64__) && defined(__PCLMUL__) && defined(__SSE4_1__)
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#define VIXL_SIMULATOR_HOST_PCLMUL
+#endif
+
 namespace vixl {
 namespace aarch64 {
 
@@ -1157,6 +1169,355 @@ LogicVRegister Simulator::pmull2(VectorFormat vform,
 }
 
 
+LogicVRegister Simulator::pmull64(LogicVRegister dst,
+                                  const LogicVRegister& src1,
+                                  const LogicVRegister& src2,
+                                  int index) {
+  uint64_t op1 = src1.Uint(kFormat2D, index);
+  uint64_t op2 = src2.Uint(kFormat2D, index);
+  uint64_t lo;
+  uint64_t hi;
+#ifdef VIXL_SIMULATOR_HOST_PCLMUL
+  __m128i product = _mm_clmulepi64_si128(_mm_cvtsi64_si128(op1),
+                                         _mm_cvtsi64_si128(op2),
+                                         0x00);
+  lo = static_cast<uint64_t>(_mm_cvtsi128_si64(product));
+  hi = static_cast<uint64_t>(_mm_extract_epi64(product, 1));
+#else
+  lo = 0;
+  hi = 0;
+  for (int i = 0; i < 64; i++) {
+    if ((op1 >> i) & 1) {
+      lo ^= op2 << i;
+      if (i > 0) hi ^= op2 >> (64 - i);
+    }
+  }
+#endif
+  dst.SetUint(kFormat2D, 0, lo);
+  dst.SetUint(kFormat2D, 1, hi);
+  return dst;
+}
+
+
+#ifndef VIXL_SIMULATOR_HOST_AES
+// The AES S-box, and its inverse.
+static const uint8_t kAESSBox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
+    0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0, 0xb7, 0xfd, 0x93, 0x26,
+    0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2,
+    0xeb, 0x27, 0xb2, 0x75, 0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84, 0x53, 0xd1, 0x00, 0xed,
+    0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f,
+    0x50, 0x3c, 0x9f, 0xa8, 0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2, 0xcd, 0x0c, 0x13, 0xec,
+    0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14,
+    0xde, 0x5e, 0x0b, 0xdb, 0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79, 0xe7, 0xc8, 0x37, 0x6d,
+    0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f,
+    0x4b, 0xbd, 0x8b, 0x8a, 0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e, 0xe1, 0xf8, 0x98, 0x11,
+    0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f,
+    0xb0, 0x54, 0xbb, 0x16};
+
+static const uint8_t kAESInverseSBox[256] = {
+    0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e,
+    0x81, 0xf3, 0xd7, 0xfb, 0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87,
+    0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb, 0x54, 0x7b, 0x94, 0x32,
+    0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+    0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49,
+    0x6d, 0x8b, 0xd1, 0x25, 0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16,
+    0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92, 0x6c, 0x70, 0x48, 0x50,
+    0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+    0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05,
+    0xb8, 0xb3, 0x45, 0x06, 0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02,
+    0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b, 0x3a, 0x91, 0x11, 0x41,
+    0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+    0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8,
+    0x1c, 0x75, 0xdf, 0x6e, 0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89,
+    0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b, 0xfc, 0x56, 0x3e, 0x4b,
+    0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+    0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59,
+    0x27, 0x80, 0xec, 0x5f, 0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d,
+    0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef, 0xa0, 0xe0, 0x3b, 0x4d,
+    0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+    0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63,
+    0x55, 0x21, 0x0c, 0x7d};
+
+// Multiply by x in GF(2^8), modulo the AES polynomial.
+static uint8_t AESXTime(uint8_t value) {
+  return static_cast<uint8_t>((value << 1) ^ ((value & 0x80) ? 0x1b : 0));
+}
+
+static uint8_t AESMultiply(uint8_t value, int factor) {
+  uint8_t result = 0;
+  for (; factor != 0; factor >>= 1) {
+    if (factor & 1) result ^= value;
+    value = AESXTime(value);
+  }
+  return result;
+}
+#endif
+
+
+LogicVRegister Simulator::aes(LogicVRegister srcdst,
+                              const LogicVRegister& src,
+                              bool decrypt) {
+#ifdef VIXL_SIMULATOR_HOST_AES
+  // AESE and AESD add the round key before the substitution, but the host
+  // instructions add it at the end, so add it here and use a zero key.
+  __m128i state =
+      _mm_set_epi64x(srcdst.Uint(kFormat2D, 1) ^ src.Uint(kFormat2D, 1),
+                     srcdst.Uint(kFormat2D, 0) ^ src.Uint(kFormat2D, 0));
+  __m128i zero = _mm_setzero_si128();
+  state = decrypt ? _mm_aesdeclast_si128(state, zero)
+                  : _mm_aesenclast_si128(state, zero);
+  srcdst.SetUint(kFormat2D, 0, _mm_cvtsi128_si64(state));
+  srcdst.SetUint(kFormat2D,
+                 1,
+                 _mm_cvtsi128_si64(_mm_unpackhi_epi64(state, state)));
+#else
+  // The state is stored in column-major order, so byte `(4 * c) + r` is in
+  // row r and column c.
+  uint8_t state[kQRegSizeInBytes];
+  for (unsigned i = 0; i < kQRegSizeInBytes; i++) {
+    state[i] = static_cast<uint8_t>(srcdst.Uint(kFormat16B, i) ^
+                                    src.Uint(kFormat16B, i));
+  }
+  const uint8_t* sbox = decrypt ? kAESInverseSBox : kAESSBox;
+  for (int c = 0; c < 4; c++) {
+    for (int r = 0; r < 4; r++) {
+      // ShiftRows rotates row r left by r columns, and InvShiftRows rotates
+      // it right.
+      int from = decrypt ? ((c + 4 - r) % 4) : ((c + r) % 4);
+      srcdst.SetUint(kFormat16B, (4 * c) + r, sbox[state[(4 * from) + r]]);
+    }
+  }
+#endif
+  return srcdst;
+}
+
+
+LogicVRegister Simulator::aesmix(LogicVRegister dst,
+                                 const LogicVRegister& src,
+                                 bool inverse) {
+#ifdef VIXL_SIMULATOR_HOST_AES
+  __m128i state =
+      _mm_set_epi64x(src.Uint(kFormat2D, 1), src.Uint(kFormat2D, 0));
+  if (inverse) {
+    state = _mm_aesimc_si128(state);
+  } else {
+    // There is no host instruction for MixColumns alone, but a full
+    // encryption round (with a zero key) applied after undoing its ShiftRows
+    // and SubBytes steps leaves only MixColumns.
+    __m128i zero = _mm_setzero_si128();
+    state = _mm_aesenc_si128(_mm_aesdeclast_si128(state, zero), zero);
+  }
+  dst.SetUint(kFormat2D, 0, _mm_cvtsi128_si64(state));
+  dst.SetUint(kFormat2D,
+              1,
+              _mm_cvtsi128_si64(_mm_unpackhi_epi64(state, state)));
+#else
+  // Each column is multiplied by a fixed polynomial, with coefficients
+  // {2, 3, 1, 1} for MixColumns, and {14, 11, 13, 9} for InvMixColumns.
+  static const int kMix[4] = {2, 3, 1, 1};
+  static const int kInverseMix[4] = {14, 11, 13, 9};
+  const int* coefficients = inverse ? kInverseMix : kMix;
+  uint8_t state[kQRegSizeInBytes];
+  for (unsigned i = 0; i < kQRegSizeInBytes; i++) {
+    state[i] = static_cast<uint8_t>(src.Uint(kFormat16B, i));
+  }
+  for (int c = 0; c < 4; c++) {
+    for (int r = 0; r < 4; r++) {
+      uint8_t result = 0;
+      for (int i = 0; i < 4; i++) {
+        result ^= AESMultiply(state[(4 * c) + ((r + i) % 4)], coefficients[i]);
+      }
+      dst.SetUint(kFormat16B, (4 * c) + r, result);
+    }
+  }
+#endif
+  return dst;
+}
+
+
+// Read a 32-bit element from a Q register.
+static uint32_t ReadWord(const LogicVRegister& reg, int index) {
+  return static_cast<uint32_t>(reg.Uint(kFormat4S, index));
+}
+
+static uint32_t SHAChoose(uint32_t x, uint32_t y, uint32_t z) {
+  return ((y ^ z) & x) ^ z;
+}
+
+static uint32_t SHAMajority(uint32_t x, uint32_t y, uint32_t z) {
+  return (x & y) | ((x | y) & z);
+}
+
+static uint32_t SHAParity(uint32_t x, uint32_t y, uint32_t z) {
+  return x ^ y ^ z;
+}
+
+static uint32_t RotateRight32(uint32_t value, int amount) {
+  return static_cast<uint32_t>(RotateRight(value, amount, kWRegSize));
+}
+
+static uint32_t RotateLeft32(uint32_t value, int amount) {
+  return RotateRight32(value, kWRegSize - amount);
+}
+
+
+LogicVRegister Simulator::sha1(LogicVRegister srcdst,
+                               const LogicVRegister& src1,
+                               const LogicVRegister& src2,
+                               Instr op) {
+  // x holds the hash state {a, b, c, d}, and y holds e.
+  uint32_t x[4];
+  for (int i = 0; i < 4; i++) x[i] = ReadWord(srcdst, i);
+  uint32_t y = ReadWord(src1, 0);
+  for (int e = 0; e < 4; e++) {
+    uint32_t f;
+    switch (op) {
+      case SHA1C:
+        f = SHAChoose(x[1], x[2], x[3]);
+        break;
+      case SHA1P:
+        f = SHAParity(x[1], x[2], x[3]);
+        break;
+      case SHA1M:
+        f = SHAMajority(x[1], x[2], x[3]);
+        break;
+      default:
+        VIXL_UNREACHABLE();
+        f = 0;
+    }
+    y += RotateLeft32(x[0], 5) + f + ReadWord(src2, e);
+    x[1] = RotateLeft32(x[1], 30);
+    // Rotate {y, x} by one word.
+    uint32_t t = x[3];
+    x[3] = x[2];
+    x[2] = x[1];
+    x[1] = x[0];
+    x[0] = y;
+    y = t;
+  }
+  for (int i = 0; i < 4; i++) srcdst.SetUint(kFormat4S, i, x[i]);
+  return srcdst;
+}
+
+
+LogicVRegister Simulator::sha1h(LogicVRegister dst, const LogicVRegister& src) {
+  uint32_t result = RotateLeft32(ReadWord(src, 0), 30);
+  dst.ClearForWrite(kFormatS);
+  dst.SetUint(kFormatS, 0, result);
+  return dst;
+}
+
+
+LogicVRegister Simulator::sha1su0(LogicVRegister srcdst,
+                                  const LogicVRegister& src1,
+                                  const LogicVRegister& src2) {
+  uint64_t lo = srcdst.Uint(kFormat2D, 1) ^ srcdst.Uint(kFormat2D, 0) ^
+                src2.Uint(kFormat2D, 0);
+  uint64_t hi = src1.Uint(kFormat2D, 0) ^ srcdst.Uint(kFormat2D, 1) ^
+                src2.Uint(kFormat2D, 1);
+  srcdst.SetUint(kFormat2D, 0, lo);
+  srcdst.SetUint(kFormat2D, 1, hi);
+  return srcdst;
+}
+
+
+LogicVRegister Simulator::sha1su1(LogicVRegister srcdst,
+                                  const LogicVRegister& src) {
+  uint32_t t[4];
+  for (int i = 0; i < 4; i++) {
+    uint32_t shifted = (i < 3) ? ReadWord(src, i + 1) : 0;
+    t[i] = ReadWord(srcdst, i) ^ shifted;
+  }
+  for (int i = 0; i < 4; i++) {
+    uint32_t result = RotateLeft32(t[i], 1);
+    if (i == 3) result ^= RotateLeft32(t[0], 2);
+    srcdst.SetUint(kFormat4S, i, result);
+  }
+  return srcdst;
+}
+
+
+LogicVRegister Simulator::sha256h(LogicVRegister srcdst,
+                                  const LogicVRegister& src1,
+                                  const LogicVRegister& src2,
+                                  bool part1) {
+  // x holds {a, b, c, d} and y holds {e, f, g, h}. For SHA256H, these are
+  // the destination and first source respectively, and for SHA256H2 they are
+  // the other way around.
+  uint32_t x[4];
+  uint32_t y[4];
+  for (int i = 0; i < 4; i++) {
+    x[i] = part1 ? ReadWord(srcdst, i) : ReadWord(src1, i);
+    y[i] = part1 ? ReadWord(src1, i) : ReadWord(srcdst, i);
+  }
+  for (int e = 0; e < 4; e++) {
+    uint32_t sigma0 = RotateRight32(x[0], 2) ^ RotateRight32(x[0], 13) ^
+                      RotateRight32(x[0], 22);
+    uint32_t sigma1 = RotateRight32(y[0], 6) ^ RotateRight32(y[0], 11) ^
+                      RotateRight32(y[0], 25);
+    uint32_t t =
+        y[3] + sigma1 + SHAChoose(y[0], y[1], y[2]) + ReadWord(src2, e);
+    x[3] += t;
+    y[3] = t + sigma0 + SHAMajority(x[0], x[1], x[2]);
+    // Rotate {y, x} by one word.
+    uint32_t top = y[3];
+    y[3] = y[2];
+    y[2] = y[1];
+    y[1] = y[0];
+    y[0] = x[3];
+    x[3] = x[2];
+    x[2] = x[1];
+    x[1] = x[0];
+    x[0] = top;
+  }
+  for (int i = 0; i < 4; i++) {
+    srcdst.SetUint(kFormat4S, i, part1 ? x[i] : y[i]);
+  }
+  return srcdst;
+}
+
+
+LogicVRegister Simulator::sha256su0(LogicVRegister srcdst,
+                                    const LogicVRegister& src) {
+  uint32_t result[4];
+  for (int i = 0; i < 4; i++) {
+    uint32_t t = (i < 3) ? ReadWord(srcdst, i + 1) : ReadWord(src, 0);
+    t = RotateRight32(t, 7) ^ RotateRight32(t, 18) ^ (t >> 3);
+    result[i] = t + ReadWord(srcdst, i);
+  }
+  for (int i = 0; i < 4; i++) srcdst.SetUint(kFormat4S, i, result[i]);
+  return srcdst;
+}
+
+
+LogicVRegister Simulator::sha256su1(LogicVRegister srcdst,
+                                    const LogicVRegister& src1,
+                                    const LogicVRegister& src2) {
+  uint32_t result[4];
+  for (int i = 0; i < 4; i++) {
+    // The first two elements depend on the top half of the second source,
+    // and the last two on the first two results.
+    uint32_t t1 = (i < 2) ? ReadWord(src2, i + 2) : result[i - 2];
+    t1 = RotateRight32(t1, 17) ^ RotateRight32(t1, 19) ^ (t1 >> 10);
+    uint32_t t0 = (i < 3) ? ReadWord(src1, i + 1) : ReadWord(src2, 0);
+    result[i] = t1 + ReadWord(srcdst, i) + t0;
+  }
+  for (int i = 0; i < 4; i++) srcdst.SetUint(kFormat4S, i, result[i]);
+  return srcdst;
+}
+
+
 LogicVRegister Simulator::sub(VectorFormat vform,
                               LogicVRegister dst,
                               const LogicVRegister& src1,
@@ -4352,7 +4713,14 @@ T Simulator::FPMulx(T op1, T op2) {
 
 template <typename T>
 T Simulator::FPMulAdd(T a, T op1, T op2) {
-  T result = FPProcessNaNs3(a, op1, op2);
+  // If the fused result is neither a NaN nor zero, the host result is exact,
+  // and none of the special cases below apply.
+  T result = FusedMultiplyAdd(op1, op2, a);
+  if (!IsNaN(result) && (result != T(0.0))) {
+    return result;
+  }
+
+  result = FPProcessNaNs3(a, op1, op2);
 
   T sign_a = copysign(1.0, a);
   T sign_prod = copysign(1.0, op1) * copysign(1.0, op2);
@@ -4797,7 +5165,7 @@ uint64_t Simulator::FPToUInt64(double value, FPRounding rmode) {
 }
 
 
-#define DEFINE_NEON_FP_VECTOR_OP(FN, OP, PROCNAN)                \
+#define DEFINE_NEON_FP_VECTOR_OP(FN, OP, PROCNAN, HOSTOP)        \
   template <typename T>                                          \
   LogicVRegister Simulator::FN(VectorFormat vform,               \
                                LogicVRegister dst,               \
@@ -4808,11 +5176,11 @@ uint64_t Simulator::FPToUInt64(double value, FPRounding rmode) {
       T op1 = src1.Float<T>(i);                                  \
       T op2 = src2.Float<T>(i);                                  \
       T result;                                                  \
-      if (PROCNAN) {                                             \
+      if (!IsNaN(op1) && !IsNaN(op2)) {                          \
+        result = HOSTOP(op1, op2);                               \
+        if (IsNaN(result)) result = OP(op1, op2);                \
+      } else if (PROCNAN) {                                      \
         result = FPProcessNaNs(op1, op2);                        \
-        if (!IsNaN(result)) {                                    \
-          result = OP(op1, op2);                                 \
-        }                                                        \
       } else {                                                   \
         result = OP(op1, op2);                                   \
       }                                                          \
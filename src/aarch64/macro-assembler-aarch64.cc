@@ -28,6 +28,8 @@
 
 #include "macro-assembler-aarch64.h"
 
+#include "branch-relaxation-aarch64.h"
+
 namespace vixl {
 namespace aarch64 {
 
@@ -50,7 +52,9 @@ LiteralPool::LiteralPool(MacroAssembler* masm)
     : Pool(masm),
       size_(0),
       first_use_(-1),
-      recommended_checkpoint_(kNoCheckpointRequired) {}
+      recommended_checkpoint_(kNoCheckpointRequired),
+      deduplicate_(false),
+      deduplicated_size_(0) {}
 
 
 LiteralPool::~LiteralPool() VIXL_NEGATIVE_TESTING_ALLOW_EXCEPTION {
@@ -73,6 +77,7 @@ void LiteralPool::Reset() {
     }
   }
   entries_.clear();
+  shared_entries_.clear();
   size_ = 0;
   first_use_ = -1;
   Pool::Reset();
@@ -179,6 +184,35 @@ void LiteralPool::AddEntry(RawLiteral* literal) {
   VIXL_ASSERT(masm_->GetCursorOffset() >= first_use_);
   entries_.push_back(literal);
   size_ += literal->GetSize();
+
+  if (deduplicate_ &&
+      (literal->deletion_policy_ == RawLiteral::kDeletedOnPlacementByPool)) {
+    SharedEntryKey key = {literal->size_, literal->high64_, literal->low64_};
+    // If an identical entry exists, it was created explicitly (bypassing
+    // `FindSharedEntry()`), so it is fine to leave it alone.
+    shared_entries_.insert(std::make_pair(key, literal));
+  }
+}
+
+
+void LiteralPool::SetDeduplication(bool enable) {
+  deduplicate_ = enable;
+  if (!enable) shared_entries_.clear();
+}
+
+
+RawLiteral* LiteralPool::FindSharedEntry(size_t size,
+                                         uint64_t high64,
+                                         uint64_t low64) {
+  if (!deduplicate_) return NULL;
+  SharedEntryKey key = {size, high64, low64};
+  auto it = shared_entries_.find(key);
+  if (it == shared_entries_.end()) return NULL;
+  RawLiteral* literal = it->second;
+  VIXL_ASSERT(literal->IsUsed());
+  VIXL_ASSERT(literal->GetSize() == size);
+  deduplicated_size_ += size;
+  return literal;
 }
 
 
@@ -228,9 +262,17 @@ void VeneerPool::DeleteUnresolvedBranchInfoForLabel(Label* label) {
   }
 
   if (label->IsLinked()) {
-    Label::LabelLinksIterator links_it(label);
+    Label::LabelLinksIterator links_it(label, masm_->GetBuffer());
     for (; !links_it.Done(); links_it.Advance()) {
-      ptrdiff_t link_offset = *links_it.Current();
+      ptrdiff_t link_offset = links_it.GetCurrentOffset();
+      if (masm_->IsSizeOnly()) {
+        // There is no code to read the branch type from, but branches are
+        // tracked by offset, so any type that uses veneers will do. Links that
+        // don't use veneers are not tracked, and are ignored.
+        BranchInfo branch_info(link_offset, label, CondBranchType);
+        unresolved_branches_.erase(branch_info);
+        continue;
+      }
       Instruction* link = masm_->GetInstructionAt(link_offset);
 
       // ADR instructions are not handled.
@@ -245,6 +287,81 @@ void VeneerPool::DeleteUnresolvedBranchInfoForLabel(Label* label) {
 }
 
 
+void VeneerPool::BranchInfoSet::insert(BranchInfo branch_info) {
+  ImmBranchType type = branch_info.branch_type_;
+  VIXL_ASSERT(IsValidBranchType(type));
+  VIXL_ASSERT(!IsLive(branch_info));
+  size_t index = GetLiveIndex(branch_info.pc_offset_);
+  if (index >= live_branches_.size()) {
+    // Grow geometrically, to keep insertion amortised O(1).
+    live_branches_.resize(std::max(2 * live_branches_.size(), index + 1));
+  }
+  live_branches_[index] = true;
+  size_++;
+  std::vector<BranchInfo>* heap = &heaps_[BranchIndexFromType(type)];
+  heap->push_back(branch_info);
+  std::push_heap(heap->begin(), heap->end(), IsLaterLimit());
+}
+
+
+void VeneerPool::BranchInfoSet::erase(BranchInfo branch_info) {
+  if (!IsValidBranchType(branch_info.branch_type_)) return;
+  if (!IsLive(branch_info)) return;
+  live_branches_[GetLiveIndex(branch_info.pc_offset_)] = false;
+  size_--;
+  // Leave the heap entry in place; it is now stale.
+  stale_count_++;
+  if (IsEmpty()) {
+    Reset();
+  } else if ((stale_count_ >= kReclaimFrom) && (stale_count_ > GetSize())) {
+    PurgeStaleEntries();
+  }
+}
+
+
+const VeneerPool::BranchInfo* VeneerPool::BranchInfoSet::GetFirst(int index) {
+  std::vector<BranchInfo>* heap = &heaps_[index];
+  while (!heap->empty()) {
+    if (IsLive(heap->front())) return &heap->front();
+    PopHeap(index);
+    stale_count_--;
+  }
+  return NULL;
+}
+
+
+void VeneerPool::BranchInfoSet::EraseFirst(int index) {
+  VIXL_ASSERT(!heaps_[index].empty());
+  VIXL_ASSERT(IsLive(heaps_[index].front()));
+  live_branches_[GetLiveIndex(heaps_[index].front().pc_offset_)] = false;
+  size_--;
+  PopHeap(index);
+}
+
+
+void VeneerPool::BranchInfoSet::PopHeap(int index) {
+  std::vector<BranchInfo>* heap = &heaps_[index];
+  std::pop_heap(heap->begin(), heap->end(), IsLaterLimit());
+  heap->pop_back();
+}
+
+
+void VeneerPool::BranchInfoSet::PurgeStaleEntries() {
+  for (int i = 0; i < kNumberOfTrackedBranchTypes; i++) {
+    std::vector<BranchInfo>* heap = &heaps_[i];
+    std::vector<BranchInfo>::iterator live_end =
+        std::remove_if(heap->begin(),
+                       heap->end(),
+                       [this](const BranchInfo& branch_info) {
+                         return !IsLive(branch_info);
+                       });
+    heap->erase(live_end, heap->end());
+    std::make_heap(heap->begin(), heap->end(), IsLaterLimit());
+  }
+  stale_count_ = 0;
+}
+
+
 bool VeneerPool::ShouldEmitVeneer(int64_t first_unreacheable_pc,
                                   size_t amount) {
   ptrdiff_t offset =
@@ -285,38 +402,26 @@ void VeneerPool::Emit(EmitOption option, size_t amount) {
   // range.
   static const size_t kVeneerEmissionMargin = 1 * KBytes;
 
-  for (BranchInfoSetIterator it(&unresolved_branches_); !it.Done();) {
-    BranchInfo* branch_info = it.Current();
-    if (ShouldEmitVeneer(branch_info->first_unreacheable_pc_,
-                         amount + kVeneerEmissionMargin)) {
+  for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
+    const BranchInfo* first;
+    while ((first = unresolved_branches_.GetFirst(i)) != NULL) {
+      if (!ShouldEmitVeneer(first->first_unreacheable_pc_,
+                            amount + kVeneerEmissionMargin)) {
+        // The other branches of this type have later limits.
+        break;
+      }
       CodeBufferCheckScope scope(masm_,
                                  kVeneerCodeSize,
                                  CodeBufferCheckScope::kCheck,
                                  CodeBufferCheckScope::kExactSize);
-      ptrdiff_t branch_pos = branch_info->pc_offset_;
-      Instruction* branch = masm_->GetInstructionAt(branch_pos);
-      Label* label = branch_info->label_;
+      ptrdiff_t branch_pos = first->pc_offset_;
+      Label* label = first->label_;
+      unresolved_branches_.EraseFirst(i);
 
       // Patch the branch to point to the current position, and emit a branch
-      // to the label.
-      Instruction* veneer = masm_->GetCursorAddress<Instruction*>();
-      // The source/target ISA makes a difference for `bx #4` and variants of
-      // `adr`. None of those are handled by the veneer pool, so we just pretend
-      // that we are branching from A64 to A64.
-      VIXL_ASSERT(!branch->IsPCRelAddressing());
-      VIXL_ASSERT(!branch->IsMorelloBX());
-      branch->SetImmPCOffsetTarget(veneer, ISA::A64, ISA::A64);
-      {
-        ExactAssemblyScopeWithoutPoolsCheck guard(masm_, kInstructionSize);
-        masm_->b(label);
-      }
-
-      // Update the label. The branch patched does not point to it any longer.
-      label->DeleteLink(branch_pos);
-
-      it.DeleteCurrentAndAdvance();
-    } else {
-      it.AdvanceToNextType();
+      // to the label. The veneer replaces the branch in the label's links.
+      ExactAssemblyScopeWithoutPoolsCheck guard(masm_, kInstructionSize);
+      masm_->EmitVeneer(branch_pos, label);
     }
   }
 
@@ -340,7 +445,8 @@ MacroAssembler::MacroAssembler(PositionIndependentCodeOption pic)
       literal_pool_(this),
       veneer_pool_(this),
       recommended_checkpoint_(Pool::kNoCheckpointRequired),
-      fp_nan_propagation_(NoFPMacroNaNPropagationSelected) {
+      fp_nan_propagation_(NoFPMacroNaNPropagationSelected),
+      branch_relaxation_(NULL) {
   checkpoint_ = GetNextCheckPoint();
 #ifndef VIXL_DEBUG
   USE(allow_macro_instructions_);
@@ -363,7 +469,8 @@ MacroAssembler::MacroAssembler(size_t capacity,
       literal_pool_(this),
       veneer_pool_(this),
       recommended_checkpoint_(Pool::kNoCheckpointRequired),
-      fp_nan_propagation_(NoFPMacroNaNPropagationSelected) {
+      fp_nan_propagation_(NoFPMacroNaNPropagationSelected),
+      branch_relaxation_(NULL) {
   checkpoint_ = GetNextCheckPoint();
 }
 
@@ -384,7 +491,8 @@ MacroAssembler::MacroAssembler(byte* buffer,
       literal_pool_(this),
       veneer_pool_(this),
       recommended_checkpoint_(Pool::kNoCheckpointRequired),
-      fp_nan_propagation_(NoFPMacroNaNPropagationSelected) {
+      fp_nan_propagation_(NoFPMacroNaNPropagationSelected),
+      branch_relaxation_(NULL) {
   checkpoint_ = GetNextCheckPoint();
 }
 
@@ -429,6 +537,236 @@ void MacroAssembler::CheckEmitPoolsFor(size_t amount) {
 }
 
 
+// Return a four-bit mask of the halfwords of `value` that aren't zero.
+static unsigned GetNonZeroHalfwords(uint64_t value) {
+  // Set the top bit of each halfword that isn't zero, without carrying into
+  // the next halfword.
+  const uint64_t kLowBits = UINT64_C(0x7fff7fff7fff7fff);
+  uint64_t top_bits = (((value & kLowBits) + kLowBits) | value) & ~kLowBits;
+  // Gather bits 15, 31, 47 and 63 into bits 60 to 63. The partial products
+  // don't overlap, so there are no carries.
+  return static_cast<unsigned>((top_bits * UINT64_C(0x0000200040008001)) >>
+                               60);
+}
+
+
+ImmediateMaterialiser::Sequence ImmediateMaterialiser::GetMoveWideSequence(
+    uint64_t imm, unsigned reg_size) {
+  VIXL_ASSERT((reg_size % 16) == 0);
+  VIXL_ASSERT((imm & ~GetUintMask(reg_size)) == 0);
+  // Imm is represented by [imm3, imm2, imm1, imm0], where each imm is 16 bits.
+  // If the number of 0xffff halfwords is greater than the number of 0x0000
+  // halfwords, it's more efficient to start with move-inverted. This is used
+  // for every long immediate, so avoid branches.
+  unsigned halfwords_mask = (1U << (reg_size / 16)) - 1;
+  unsigned clear_mask = ~GetNonZeroHalfwords(imm) & halfwords_mask;
+  unsigned set_mask =
+      ~GetNonZeroHalfwords(~imm & GetUintMask(reg_size)) & halfwords_mask;
+  bool invert_move = CountHalfwords(set_mask) > CountHalfwords(clear_mask);
+  unsigned ignored_mask = invert_move ? set_mask : clear_mask;
+  unsigned used_mask = ~ignored_mask & halfwords_mask;
+  // If every halfword is ignored, `imm` is 0 or ~0, and a single move-wide
+  // instruction for the lowest halfword is enough.
+  used_mask |= (used_mask == 0);
+
+  // Use movn/movz for the first non-ignored halfword, and movk for subsequent
+  // halfwords.
+  int first = CountTrailingZeros(used_mask);
+  uint64_t first_mask = UINT64_C(0xffff) << (16 * first);
+  Sequence sequence;
+  sequence.shift = 16 * first;
+  if (invert_move) {
+    sequence.initial = (imm | ~first_mask) & GetUintMask(reg_size);
+    sequence.op = kMovn;
+  } else {
+    sequence.initial = imm & first_mask;
+    sequence.op = kMovz;
+  }
+  sequence.movk_mask = used_mask & (used_mask - 1);
+  return sequence;
+}
+
+
+// Return true if the low `width` bits of `value` hold a single run of set bits,
+// possibly wrapping around, but are neither all clear nor all set. This is the
+// pattern of a logical immediate with `width`-bit elements.
+static bool IsRotatedRun(uint64_t value, unsigned width) {
+  uint64_t mask = GetUintMask(width);
+  value &= mask;
+  if ((value == 0) || (value == mask)) return false;
+  // Invert wrapping runs, so that the run doesn't include bit 0.
+  if ((value & 1) != 0) value = ~value & mask;
+  // Adding the lowest set bit clears the whole run if it is contiguous.
+  return ((value + (value & -value)) & value) == 0;
+}
+
+
+// Return the halfwords of `imm` that are 0x0000, 0xffff or a 16-bit run,
+// as a bit mask.
+static unsigned GetSimpleHalfwords(uint64_t imm) {
+  unsigned mask = 0;
+  for (int i = 0; i < 4; i++) {
+    uint64_t halfword = (imm >> (16 * i)) & 0xffff;
+    // This is IsRotatedRun(halfword, 16), but also accepts 0x0000 and 0xffff,
+    // and avoids branches, since it is used for every long immediate.
+    uint64_t run = halfword ^ (-(halfword & 1) & 0xffff);
+    bool is_simple = ((run + (run & -run)) & run) == 0;
+    mask |= static_cast<unsigned>(is_simple) << i;
+  }
+  return mask;
+}
+
+
+// Return true if at least `count` halfwords of `imm` have the same value.
+static bool HasRepeatedHalfwords(uint64_t imm, int count) {
+  uint64_t h0 = imm & 0xffff;
+  uint64_t h1 = (imm >> 16) & 0xffff;
+  uint64_t h2 = (imm >> 32) & 0xffff;
+  uint64_t h3 = imm >> 48;
+  int pairs = (h0 == h1) + (h0 == h2) + (h0 == h3) + (h1 == h2) + (h1 == h3) +
+              (h2 == h3);
+  // `count` equal halfwords make count * (count - 1) / 2 pairs. Two pairs of
+  // equal halfwords make only two, so aren't mistaken for three equal ones.
+  return pairs >= ((count * (count - 1)) / 2);
+}
+
+
+bool ImmediateMaterialiser::CanImprove(uint64_t imm,
+                                       unsigned reg_size,
+                                       const Sequence& sequence) {
+  // A shorter sequence can only exist if this one has at least two `movk`s,
+  // which isn't possible for W registers.
+  int movk_count = CountHalfwords(sequence.movk_mask);
+  if ((reg_size != kXRegSize) || (movk_count < 2)) return false;
+  // Logical immediates with elements of 32 or 64 bits can only match simple
+  // halfwords. Smaller elements make all halfwords the same.
+  int needed = 4 - movk_count + 1;
+  return (CountHalfwords(GetSimpleHalfwords(imm)) >= needed) ||
+         HasRepeatedHalfwords(imm, needed);
+}
+
+
+void ImmediateMaterialiser::Search(uint64_t imm,
+                                   unsigned reg_size,
+                                   Sequence* sequence) {
+  if (!CanImprove(imm, reg_size, *sequence)) return;
+  int best_movk_count = sequence->GetLength() - 1;
+  // The number of halfwords that a better initial value must get right.
+  int needed = 4 - best_movk_count + 1;
+
+  // Candidate initial values are logical immediates that match `imm` in at
+  // least `needed` halfwords. The halfwords of elements of 32 or 64 bits are
+  // each 0x0000, 0xffff or a 16-bit run, so only these ("simple") halfwords of
+  // `imm` can be matched. Other halfwords can be replaced with 0x0000 or
+  // 0xffff, since they are corrected with `movk` anyway. Smaller elements
+  // make all halfwords the same.
+  uint64_t halfwords[4];
+  for (int i = 0; i < 4; i++) {
+    halfwords[i] = (imm >> (16 * i)) & 0xffff;
+  }
+  unsigned simple_mask = GetSimpleHalfwords(imm);
+
+  uint64_t candidates[4 + 16 + 32];
+  int count = 0;
+
+  // Elements of up to 16 bits.
+  for (int i = 0; i < 4; i++) {
+    int matches = 0;
+    for (int j = 0; j < 4; j++) {
+      if (halfwords[j] == halfwords[i]) matches++;
+    }
+    uint64_t candidate = halfwords[i] * UINT64_C(0x0001000100010001);
+    if ((matches >= needed) && Assembler::IsImmLogical(candidate, kXRegSize)) {
+      candidates[count++] = candidate;
+    }
+  }
+
+  if (CountHalfwords(simple_mask) >= needed) {
+    // 32-bit elements.
+    const uint64_t kLowHalfwords[] = {halfwords[0], halfwords[2], 0, 0xffff};
+    const uint64_t kHighHalfwords[] = {halfwords[1], halfwords[3], 0, 0xffff};
+    for (int lo = 0; lo < 4; lo++) {
+      for (int hi = 0; hi < 4; hi++) {
+        uint64_t element = kLowHalfwords[lo] | (kHighHalfwords[hi] << 16);
+        if (IsRotatedRun(element, 32)) {
+          candidates[count++] = element * UINT64_C(0x0000000100000001);
+        }
+      }
+    }
+
+    // 64-bit elements.
+    for (unsigned replace = 1; replace < 16; replace++) {
+      int replace_count = CountHalfwords(replace);
+      if (replace_count >= best_movk_count) continue;
+      if ((~replace & 0xf & ~simple_mask) != 0) continue;
+      // Try each combination of 0x0000 and 0xffff in the replaced halfwords.
+      for (unsigned fill = 0; fill < (1U << replace_count); fill++) {
+        uint64_t candidate = imm;
+        int fill_bit = 0;
+        for (int i = 0; i < 4; i++) {
+          if ((replace & (1 << i)) == 0) continue;
+          uint64_t mask = UINT64_C(0xffff) << (16 * i);
+          candidate &= ~mask;
+          if ((fill & (1 << fill_bit++)) != 0) candidate |= mask;
+        }
+        if (IsRotatedRun(candidate, 64)) {
+          VIXL_ASSERT(count < static_cast<int>(ArrayLength(candidates)));
+          candidates[count++] = candidate;
+        }
+      }
+    }
+  }
+
+  for (int c = 0; c < count; c++) {
+    VIXL_ASSERT(Assembler::IsImmLogical(candidates[c], kXRegSize));
+    uint64_t difference = candidates[c] ^ imm;
+    unsigned movk_mask = 0;
+    for (int i = 0; i < 4; i++) {
+      if (((difference >> (16 * i)) & 0xffff) != 0) movk_mask |= 1 << i;
+    }
+    int movk_count = CountHalfwords(movk_mask);
+    if (movk_count < best_movk_count) {
+      sequence->initial = candidates[c];
+      sequence->movk_mask = movk_mask;
+      sequence->op = kOrr;
+      best_movk_count = movk_count;
+    }
+  }
+  if (sequence->op == kOrr) {
+    bool is_logical = Assembler::IsImmLogical(sequence->initial,
+                                              kXRegSize,
+                                              &sequence->n,
+                                              &sequence->imm_s,
+                                              &sequence->imm_r);
+    VIXL_ASSERT(is_logical);
+    USE(is_logical);
+  }
+}
+
+
+void ImmediateMaterialiser::Improve(uint64_t imm,
+                                    unsigned reg_size,
+                                    Sequence* sequence) {
+  // Most immediates can be ruled out quickly, without using the cache.
+  if (!CanImprove(imm, reg_size, *sequence)) return;
+
+  if (cache_.empty()) {
+    CacheEntry unused = {0, 0, {0, 0, kMovz, 0, 0, 0, 0}};
+    cache_.resize(1 << kCacheSizeLog2, unused);
+  }
+  // Fibonacci hashing.
+  uint64_t hash = (imm ^ reg_size) * UINT64_C(0x9e3779b97f4a7c15);
+  CacheEntry* entry = &cache_[hash >> (64 - kCacheSizeLog2)];
+  if ((entry->imm != imm) || (entry->reg_size != reg_size)) {
+    Search(imm, reg_size, sequence);
+    entry->imm = imm;
+    entry->reg_size = reg_size;
+    entry->sequence = *sequence;
+  }
+  *sequence = entry->sequence;
+}
+
+
 int MacroAssembler::MoveImmediateHelper(MacroAssembler* masm,
                                         const Register& rd,
                                         uint64_t imm) {
@@ -450,76 +788,78 @@ int MacroAssembler::MoveImmediateHelper(MacroAssembler* masm,
   //  5. 64-bit orr immediate.
   // Move-keep may then be used to modify each of the 16-bit half words.
   //
-  // The code below supports all five initial value generators, and
-  // applying move-keep operations to move-zero and move-inverted initial
-  // values.
-
-  // Try to move the immediate in one instruction, and if that fails, switch to
-  // using multiple instructions.
-  if (OneInstrMoveImmediateHelper(masm, rd, imm)) {
-    return 1;
-  } else {
-    int instruction_count = 0;
-    unsigned reg_size = rd.GetSizeInBits();
-
-    // Generic immediate case. Imm will be represented by
-    //   [imm3, imm2, imm1, imm0], where each imm is 16 bits.
-    // A move-zero or move-inverted is generated for the first non-zero or
-    // non-0xffff immX, and a move-keep for subsequent non-zero immX.
-
-    uint64_t ignored_halfword = 0;
-    bool invert_move = false;
-    // If the number of 0xffff halfwords is greater than the number of 0x0000
-    // halfwords, it's more efficient to use move-inverted.
-    if (CountClearHalfWords(~imm, reg_size) >
-        CountClearHalfWords(imm, reg_size)) {
-      ignored_halfword = 0xffff;
-      invert_move = true;
-    }
-
-    // Mov instructions can't move values into the stack pointer, so set up a
-    // temporary register, if needed.
-    UseScratchRegisterScope temps;
-    Register temp;
-    if (emit_code) {
-      temps.Open(masm);
-      temp = rd.IsSP() ? temps.AcquireSameSizeAs(rd) : rd;
-    }
-
-    // Iterate through the halfwords. Use movn/movz for the first non-ignored
-    // halfword, and movk for subsequent halfwords.
-    VIXL_ASSERT((reg_size % 16) == 0);
-    bool first_mov_done = false;
-    for (unsigned i = 0; i < (reg_size / 16); i++) {
-      uint64_t imm16 = (imm >> (16 * i)) & 0xffff;
-      if (imm16 != ignored_halfword) {
-        if (!first_mov_done) {
-          if (invert_move) {
-            if (emit_code) masm->movn(temp, ~imm16 & 0xffff, 16 * i);
-            instruction_count++;
-          } else {
-            if (emit_code) masm->movz(temp, imm16, 16 * i);
-            instruction_count++;
-          }
-          first_mov_done = true;
-        } else {
-          // Construct a wider constant.
-          if (emit_code) masm->movk(temp, imm16, 16 * i);
-          instruction_count++;
-        }
-      }
+  // ImmediateMaterialiser finds the initial value that needs the fewest
+  // move-keep operations.
+
+  // The move-wide sequence is cheap to find, and tells us whether a single
+  // `movz` or `movn` is enough. This is equivalent to trying
+  // OneInstrMoveImmediateHelper first, but avoids classifying the immediate
+  // twice.
+  unsigned reg_size = rd.GetSizeInBits();
+  imm &= GetUintMask(reg_size);
+  ImmediateMaterialiser::Sequence sequence =
+      ImmediateMaterialiser::GetMoveWideSequence(imm, reg_size);
+  // Move-wide instructions can't write to the stack pointer, and `orr` can't
+  // write to the zero register.
+  if (((sequence.movk_mask != 0) || rd.IsSP()) && !rd.IsZero()) {
+    if (IsImmLogical(imm,
+                     reg_size,
+                     &sequence.n,
+                     &sequence.imm_s,
+                     &sequence.imm_r)) {
+      sequence.initial = imm;
+      sequence.movk_mask = 0;
+      sequence.op = ImmediateMaterialiser::kOrr;
+    } else if (emit_code) {
+      masm->immediate_materialiser_.Improve(imm, reg_size, &sequence);
+    } else {
+      ImmediateMaterialiser::Search(imm, reg_size, &sequence);
     }
+  }
+  int instruction_count = sequence.GetLength();
 
-    VIXL_ASSERT(first_mov_done);
+  // Mov instructions can't move values into the stack pointer, so set up a
+  // temporary register, if needed.
+  bool use_temp = rd.IsSP() && ((sequence.movk_mask != 0) ||
+                                 (sequence.op != ImmediateMaterialiser::kOrr));
+  if (use_temp) instruction_count++;
+  if (!emit_code) return instruction_count;
 
-    // Move the temporary if the original destination register was the stack
-    // pointer.
-    if (rd.IsSP()) {
-      if (emit_code) masm->mov(rd, temp);
-      instruction_count++;
-    }
-    return instruction_count;
+  UseScratchRegisterScope temps;
+  Register temp = rd;
+  if (use_temp) {
+    temps.Open(masm);
+    temp = temps.AcquireSameSizeAs(rd);
   }
+  switch (sequence.op) {
+    case ImmediateMaterialiser::kMovz:
+      masm->movz(temp,
+                 (sequence.initial >> sequence.shift) & 0xffff,
+                 sequence.shift);
+      break;
+    case ImmediateMaterialiser::kMovn:
+      masm->movn(temp,
+                 (~sequence.initial >> sequence.shift) & 0xffff,
+                 sequence.shift);
+      break;
+    case ImmediateMaterialiser::kOrr:
+      masm->LogicalImmediate(temp,
+                             AppropriateZeroRegFor(temp),
+                             sequence.n,
+                             sequence.imm_s,
+                             sequence.imm_r,
+                             ORR);
+      break;
+  }
+  for (unsigned mask = sequence.movk_mask; mask != 0; mask &= mask - 1) {
+    int shift = 16 * CountTrailingZeros(mask);
+    masm->movk(temp, (imm >> shift) & 0xffff, shift);
+  }
+
+  // Move the temporary if the original destination register was the stack
+  // pointer.
+  if (use_temp) masm->mov(rd, temp);
+  return instruction_count;
 }
 
 
@@ -613,13 +953,14 @@ void MacroAssembler::B(Label* label, Condition cond) {
   VIXL_ASSERT((cond != al) && (cond != nv));
   EmissionCheckScope guard(this, 2 * kInstructionSize);
 
-  if (label->IsBound() && LabelIsOutOfRange(label, CondBranchType)) {
+  if (ShouldRelaxBranch(label, CondBranchType) ||
+      (label->IsBound() && LabelIsOutOfRange(label, CondBranchType))) {
     Label done;
     b(&done, InvertCondition(cond));
     b(label);
     bind(&done);
   } else {
-    if (!label->IsBound()) {
+    if (!label->IsBound() && IsLabelLinkingEnabled()) {
       veneer_pool_.RegisterUnresolvedBranch(GetCursorOffset(),
                                             label,
                                             CondBranchType);
@@ -639,13 +980,14 @@ void MacroAssembler::Cbnz(const Register& rt, Label* label) {
   VIXL_ASSERT(!rt.IsZero());
   EmissionCheckScope guard(this, 2 * kInstructionSize);
 
-  if (label->IsBound() && LabelIsOutOfRange(label, CondBranchType)) {
+  if (ShouldRelaxBranch(label, CompareBranchType) ||
+      (label->IsBound() && LabelIsOutOfRange(label, CondBranchType))) {
     Label done;
     cbz(rt, &done);
     b(label);
     bind(&done);
   } else {
-    if (!label->IsBound()) {
+    if (!label->IsBound() && IsLabelLinkingEnabled()) {
       veneer_pool_.RegisterUnresolvedBranch(GetCursorOffset(),
                                             label,
                                             CompareBranchType);
@@ -665,13 +1007,14 @@ void MacroAssembler::Cbz(const Register& rt, Label* label) {
   VIXL_ASSERT(!rt.IsZero());
   EmissionCheckScope guard(this, 2 * kInstructionSize);
 
-  if (label->IsBound() && LabelIsOutOfRange(label, CondBranchType)) {
+  if (ShouldRelaxBranch(label, CompareBranchType) ||
+      (label->IsBound() && LabelIsOutOfRange(label, CondBranchType))) {
     Label done;
     cbnz(rt, &done);
     b(label);
     bind(&done);
   } else {
-    if (!label->IsBound()) {
+    if (!label->IsBound() && IsLabelLinkingEnabled()) {
       veneer_pool_.RegisterUnresolvedBranch(GetCursorOffset(),
                                             label,
                                             CompareBranchType);
@@ -690,13 +1033,14 @@ void MacroAssembler::Tbnz(const Register& rt, unsigned bit_pos, Label* label) {
   VIXL_ASSERT(!rt.IsZero());
   EmissionCheckScope guard(this, 2 * kInstructionSize);
 
-  if (label->IsBound() && LabelIsOutOfRange(label, TestBranchType)) {
+  if (ShouldRelaxBranch(label, TestBranchType) ||
+      (label->IsBound() && LabelIsOutOfRange(label, TestBranchType))) {
     Label done;
     tbz(rt, bit_pos, &done);
     b(label);
     bind(&done);
   } else {
-    if (!label->IsBound()) {
+    if (!label->IsBound() && IsLabelLinkingEnabled()) {
       veneer_pool_.RegisterUnresolvedBranch(GetCursorOffset(),
                                             label,
                                             TestBranchType);
@@ -715,13 +1059,14 @@ void MacroAssembler::Tbz(const Register& rt, unsigned bit_pos, Label* label) {
   VIXL_ASSERT(!rt.IsZero());
   EmissionCheckScope guard(this, 2 * kInstructionSize);
 
-  if (label->IsBound() && LabelIsOutOfRange(label, TestBranchType)) {
+  if (ShouldRelaxBranch(label, TestBranchType) ||
+      (label->IsBound() && LabelIsOutOfRange(label, TestBranchType))) {
     Label done;
     tbnz(rt, bit_pos, &done);
     b(label);
     bind(&done);
   } else {
-    if (!label->IsBound()) {
+    if (!label->IsBound() && IsLabelLinkingEnabled()) {
       veneer_pool_.RegisterUnresolvedBranch(GetCursorOffset(),
                                             label,
                                             TestBranchType);
@@ -748,6 +1093,52 @@ void MacroAssembler::Bind(Label* label, BranchTargetIdentifier id) {
       bti(id);
     }
   }
+  if (branch_relaxation_ != NULL) branch_relaxation_->RecordBind(label);
+}
+
+
+void MacroAssembler::Bind(Label* label,
+                          LabelAlignmentHint hint,
+                          BranchTargetIdentifier id) {
+  VIXL_ASSERT(allow_macro_instructions_);
+  VIXL_ASSERT(hint < kNumberOfLabelAlignmentHints);
+  const LabelAlignmentPolicy& policy = label_alignment_[hint];
+  if (policy.alignment <= static_cast<int>(kInstructionSize)) {
+    Bind(label, id);
+    return;
+  }
+
+  // Emit pools now if they would otherwise be emitted in the padding, or in
+  // the aligned block, and block them until the label is bound.
+  size_t size = policy.max_padding + policy.alignment;
+  CheckEmitPoolsFor(size);
+  EmissionCheckScope guard(this, size);
+  size_t padding = GetBuffer()->GetAlignmentPadding(policy.alignment);
+  if ((padding > 0) && (padding <= static_cast<size_t>(policy.max_padding))) {
+    ExactAssemblyScope scope(this, padding);
+    for (size_t i = 0; i < padding; i += kInstructionSize) {
+      nop();
+    }
+  }
+  Bind(label, id);
+}
+
+
+void MacroAssembler::SetLabelAlignment(LabelAlignmentHint hint,
+                                       int alignment,
+                                       int max_padding) {
+  VIXL_ASSERT((hint > kNoAlignmentHint) &&
+              (hint < kNumberOfLabelAlignmentHints));
+  VIXL_ASSERT(IsPowerOf2(alignment));
+  VIXL_ASSERT((alignment >= static_cast<int>(kInstructionSize)) &&
+              (alignment <= 64));
+  int max_useful_padding = alignment - static_cast<int>(kInstructionSize);
+  if ((max_padding < 0) || (max_padding > max_useful_padding)) {
+    max_padding = max_useful_padding;
+  }
+  VIXL_ASSERT(IsAligned(max_padding, kInstructionSize));
+  label_alignment_[hint].alignment = alignment;
+  label_alignment_[hint].max_padding = max_padding;
 }
 
 // Bind a label to a specified offset from the start of the buffer.
@@ -755,6 +1146,14 @@ void MacroAssembler::BindToOffset(Label* label, ptrdiff_t offset) {
   VIXL_ASSERT(allow_macro_instructions_);
   veneer_pool_.DeleteUnresolvedBranchInfoForLabel(label);
   Assembler::BindToOffset(label, offset);
+  if (branch_relaxation_ != NULL) branch_relaxation_->RecordBind(label);
+}
+
+
+bool MacroAssembler::ShouldRelaxBranch(Label* label,
+                                       ImmBranchType branch_type) {
+  if (branch_relaxation_ == NULL) return false;
+  return branch_relaxation_->RecordBranch(this, label, branch_type);
 }
 
 
@@ -1541,10 +1940,7 @@ void MacroAssembler::Fmov(VRegister vd, double imm) {
       if (rawbits == 0) {
         fmov(vd, xzr);
       } else {
-        ldr(vd,
-            new Literal<double>(imm,
-                                &literal_pool_,
-                                RawLiteral::kDeletedOnPlacementByPool));
+        ldr(vd, CreatePoolLiteral(imm));
       }
     } else {
       // TODO: consider NEON support for load literal.
@@ -1578,10 +1974,7 @@ void MacroAssembler::Fmov(VRegister vd, float imm) {
       if (rawbits == 0) {
         fmov(vd, wzr);
       } else {
-        ldr(vd,
-            new Literal<float>(imm,
-                               &literal_pool_,
-                               RawLiteral::kDeletedOnPlacementByPool));
+        ldr(vd, CreatePoolLiteral(imm));
       }
     } else {
       // TODO: consider NEON support for load literal.
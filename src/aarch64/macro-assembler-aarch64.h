@@ -29,6 +29,8 @@
 
 #include <algorithm>
 #include <limits>
+#include <unordered_map>
+#include <vector>
 
 #include "../code-generation-scopes-vixl.h"
 #include "../globals-vixl.h"
@@ -49,6 +51,7 @@ namespace vixl {
 namespace aarch64 {
 
 // Forward declaration
+class BranchRelaxation;
 class MacroAssembler;
 class UseScratchRegisterScope;
 
@@ -126,6 +129,25 @@ class LiteralPool : public Pool {
     deleted_on_destruction_.push_back(literal);
   }
 
+  // Literal deduplication. When enabled, the MacroAssembler shares a single
+  // pool entry between all the literals it creates implicitly (for example in
+  // `Ldr(rt, imm)` or `Fmov(vd, imm)`) that have the same size and value, as
+  // long as they are emitted in the same pool. Literals created explicitly by
+  // the user are never shared, since they may be updated after placement.
+  // Deduplication is disabled by default.
+  void SetDeduplication(bool enable);
+  bool IsDeduplicationEnabled() const { return deduplicate_; }
+
+  // Return a pending pool-owned entry with the specified size and value, or
+  // NULL if there isn't one (or if deduplication is disabled). The size of a
+  // returned entry is counted in `GetDeduplicatedSize()`, so the caller is
+  // expected to use it.
+  RawLiteral* FindSharedEntry(size_t size, uint64_t high64, uint64_t low64);
+
+  // The total number of literal bytes that deduplication has saved, since the
+  // pool was created.
+  size_t GetDeduplicatedSize() const { return deduplicated_size_; }
+
   // Recommended not exact since the pool can be blocked for short periods.
   static const ptrdiff_t kRecommendedLiteralPoolRange = 128 * KBytes;
 
@@ -141,6 +163,32 @@ class LiteralPool : public Pool {
   ptrdiff_t recommended_checkpoint_;
 
   std::vector<RawLiteral*> deleted_on_destruction_;
+
+  struct SharedEntryKey {
+    size_t size;
+    uint64_t high64;
+    uint64_t low64;
+
+    bool operator==(const SharedEntryKey& other) const {
+      return (size == other.size) && (high64 == other.high64) &&
+             (low64 == other.low64);
+    }
+  };
+
+  struct SharedEntryKeyHash {
+    size_t operator()(const SharedEntryKey& key) const {
+      uint64_t hash = key.low64 * UINT64_C(0x9e3779b97f4a7c15);
+      hash ^= (hash >> 32) ^ key.high64 ^ key.size;
+      return static_cast<size_t>(hash * UINT64_C(0xbf58476d1ce4e5b9));
+    }
+  };
+
+  // The pool-owned entries of `entries_` that may be shared. Only populated
+  // when deduplication is enabled.
+  std::unordered_map<SharedEntryKey, RawLiteral*, SharedEntryKeyHash>
+      shared_entries_;
+  bool deduplicate_;
+  size_t deduplicated_size_;
 };
 
 
@@ -185,41 +233,6 @@ class VeneerPool : public Pool {
           pc_offset_ + Instruction::GetImmBranchForwardRange(branch_type_);
     }
 
-    static bool IsValidComparison(const BranchInfo& branch_1,
-                                  const BranchInfo& branch_2) {
-      // BranchInfo are always compared against against other objects with
-      // the same branch type.
-      if (branch_1.branch_type_ != branch_2.branch_type_) {
-        return false;
-      }
-      // Since we should never have two branch infos with the same offsets, it
-      // first looks like we should check that offsets are different. However
-      // the operators may also be used to *search* for a branch info in the
-      // set.
-      bool same_offsets = (branch_1.pc_offset_ == branch_2.pc_offset_);
-      return (!same_offsets || ((branch_1.label_ == branch_2.label_) &&
-                                (branch_1.first_unreacheable_pc_ ==
-                                 branch_2.first_unreacheable_pc_)));
-    }
-
-    // We must provide comparison operators to work with InvalSet.
-    bool operator==(const BranchInfo& other) const {
-      VIXL_ASSERT(IsValidComparison(*this, other));
-      return pc_offset_ == other.pc_offset_;
-    }
-    bool operator<(const BranchInfo& other) const {
-      VIXL_ASSERT(IsValidComparison(*this, other));
-      return pc_offset_ < other.pc_offset_;
-    }
-    bool operator<=(const BranchInfo& other) const {
-      VIXL_ASSERT(IsValidComparison(*this, other));
-      return pc_offset_ <= other.pc_offset_;
-    }
-    bool operator>(const BranchInfo& other) const {
-      VIXL_ASSERT(IsValidComparison(*this, other));
-      return pc_offset_ > other.pc_offset_;
-    }
-
     // First instruction position that is not reachable by the branch using a
     // positive branch offset.
     ptrdiff_t first_unreacheable_pc_;
@@ -277,86 +290,39 @@ class VeneerPool : public Pool {
     return GetOtherPoolsMaxSize();
   }
 
-  static const int kNPreallocatedInfos = 4;
   static const ptrdiff_t kInvalidOffset = PTRDIFF_MAX;
+  // Stale entries are purged from the branch heaps once there are at least
+  // this many of them, and more than there are live entries.
   static const size_t kReclaimFrom = 128;
-  static const size_t kReclaimFactor = 16;
 
  private:
-  typedef InvalSet<BranchInfo,
-                   kNPreallocatedInfos,
-                   ptrdiff_t,
-                   kInvalidOffset,
-                   kReclaimFrom,
-                   kReclaimFactor>
-      BranchInfoTypedSetBase;
-  typedef InvalSetIterator<BranchInfoTypedSetBase> BranchInfoTypedSetIterBase;
-
-  class BranchInfoTypedSet : public BranchInfoTypedSetBase {
-   public:
-    BranchInfoTypedSet() : BranchInfoTypedSetBase() {}
-
-    ptrdiff_t GetFirstLimit() {
-      if (empty()) {
-        return kInvalidOffset;
-      }
-      return GetMinElementKey();
-    }
-    VIXL_DEPRECATED("GetFirstLimit", ptrdiff_t FirstLimit()) {
-      return GetFirstLimit();
-    }
-  };
-
-  class BranchInfoTypedSetIterator : public BranchInfoTypedSetIterBase {
-   public:
-    BranchInfoTypedSetIterator() : BranchInfoTypedSetIterBase(NULL) {}
-    explicit BranchInfoTypedSetIterator(BranchInfoTypedSet* typed_set)
-        : BranchInfoTypedSetIterBase(typed_set) {}
-
-    // TODO: Remove these and use the STL-like interface instead.
-    using BranchInfoTypedSetIterBase::Advance;
-    using BranchInfoTypedSetIterBase::Current;
-  };
-
+  // The set of unresolved branches.
+  //
+  // Branches are kept in one binary min-heap per branch type, ordered by
+  // `first_unreacheable_pc_`, so that the branch that is the closest to going
+  // out of range is always at the top. Erasing a branch only removes it from
+  // `live_branches_`; the heap entry becomes stale and is discarded when it
+  // reaches the top (or when stale entries are purged). This makes insertion,
+  // deletion and finding the first limit O(log(n)) (amortised), which matters
+  // for very large functions with many pending forward branches.
   class BranchInfoSet {
    public:
-    void insert(BranchInfo branch_info) {
-      ImmBranchType type = branch_info.branch_type_;
-      VIXL_ASSERT(IsValidBranchType(type));
-      typed_set_[BranchIndexFromType(type)].insert(branch_info);
-    }
+    BranchInfoSet() : size_(0), stale_count_(0) {}
 
-    void erase(BranchInfo branch_info) {
-      if (IsValidBranchType(branch_info.branch_type_)) {
-        int index =
-            BranchInfoSet::BranchIndexFromType(branch_info.branch_type_);
-        typed_set_[index].erase(branch_info);
-      }
-    }
+    void insert(BranchInfo branch_info);
+    void erase(BranchInfo branch_info);
 
-    size_t GetSize() const {
-      size_t res = 0;
-      for (int i = 0; i < kNumberOfTrackedBranchTypes; i++) {
-        res += typed_set_[i].size();
-      }
-      return res;
-    }
+    size_t GetSize() const { return size_; }
     VIXL_DEPRECATED("GetSize", size_t size() const) { return GetSize(); }
 
-    bool IsEmpty() const {
-      for (int i = 0; i < kNumberOfTrackedBranchTypes; i++) {
-        if (!typed_set_[i].empty()) {
-          return false;
-        }
-      }
-      return true;
-    }
+    bool IsEmpty() const { return size_ == 0; }
     VIXL_DEPRECATED("IsEmpty", bool empty() const) { return IsEmpty(); }
 
     ptrdiff_t GetFirstLimit() {
       ptrdiff_t res = kInvalidOffset;
       for (int i = 0; i < kNumberOfTrackedBranchTypes; i++) {
-        res = std::min(res, typed_set_[i].GetFirstLimit());
+        const BranchInfo* first = GetFirst(i);
+        if (first != NULL) res = std::min(res, first->first_unreacheable_pc_);
       }
       return res;
     }
@@ -364,10 +330,19 @@ class VeneerPool : public Pool {
       return GetFirstLimit();
     }
 
+    // Return the live branch of the specified type with the lowest limit, or
+    // NULL if there are no branches of that type.
+    const BranchInfo* GetFirst(int index);
+    // Remove the branch returned by `GetFirst(index)`.
+    void EraseFirst(int index);
+
     void Reset() {
       for (int i = 0; i < kNumberOfTrackedBranchTypes; i++) {
-        typed_set_[i].clear();
+        heaps_[i].clear();
       }
+      live_branches_.clear();
+      size_ = 0;
+      stale_count_ = 0;
     }
 
     static ImmBranchType BranchTypeFromIndex(int index) {
@@ -402,75 +377,41 @@ class VeneerPool : public Pool {
              (branch_type != UncondBranchType);
     }
 
-   private:
     static const int kNumberOfTrackedBranchTypes = 3;
-    BranchInfoTypedSet typed_set_[kNumberOfTrackedBranchTypes];
 
-    friend class VeneerPool;
-    friend class BranchInfoSetIterator;
-  };
-
-  class BranchInfoSetIterator {
-   public:
-    explicit BranchInfoSetIterator(BranchInfoSet* set) : set_(set) {
-      for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
-        new (&sub_iterator_[i])
-            BranchInfoTypedSetIterator(&(set_->typed_set_[i]));
+   private:
+    // Order heap entries so that the lowest limit is at the top.
+    struct IsLaterLimit {
+      bool operator()(const BranchInfo& a, const BranchInfo& b) const {
+        return a.first_unreacheable_pc_ > b.first_unreacheable_pc_;
       }
-    }
+    };
 
-    VeneerPool::BranchInfo* Current() {
-      for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
-        if (!sub_iterator_[i].Done()) {
-          return sub_iterator_[i].Current();
-        }
-      }
-      VIXL_UNREACHABLE();
-      return NULL;
+    static size_t GetLiveIndex(ptrdiff_t pc_offset) {
+      VIXL_ASSERT(pc_offset >= 0);
+      VIXL_ASSERT(IsAligned(pc_offset, kInstructionSize));
+      return static_cast<size_t>(pc_offset) / kInstructionSize;
     }
 
-    void Advance() {
-      VIXL_ASSERT(!Done());
-      for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
-        if (!sub_iterator_[i].Done()) {
-          sub_iterator_[i].Advance();
-          return;
-        }
-      }
-      VIXL_UNREACHABLE();
+    bool IsLive(ptrdiff_t pc_offset) const {
+      size_t index = GetLiveIndex(pc_offset);
+      return (index < live_branches_.size()) && live_branches_[index];
     }
-
-    bool Done() const {
-      for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
-        if (!sub_iterator_[i].Done()) return false;
-      }
-      return true;
+    bool IsLive(const BranchInfo& branch_info) const {
+      return IsLive(branch_info.pc_offset_);
     }
 
-    void AdvanceToNextType() {
-      VIXL_ASSERT(!Done());
-      for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
-        if (!sub_iterator_[i].Done()) {
-          sub_iterator_[i].Finish();
-          return;
-        }
-      }
-      VIXL_UNREACHABLE();
-    }
-
-    void DeleteCurrentAndAdvance() {
-      for (int i = 0; i < BranchInfoSet::kNumberOfTrackedBranchTypes; i++) {
-        if (!sub_iterator_[i].Done()) {
-          sub_iterator_[i].DeleteCurrentAndAdvance();
-          return;
-        }
-      }
-    }
-
-   private:
-    BranchInfoSet* set_;
-    BranchInfoTypedSetIterator
-        sub_iterator_[BranchInfoSet::kNumberOfTrackedBranchTypes];
+    void PopHeap(int index);
+    void PurgeStaleEntries();
+
+    std::vector<BranchInfo> heaps_[kNumberOfTrackedBranchTypes];
+    // One flag per instruction in the buffer, set for the branches that are
+    // still unresolved. Each of these is present in exactly one of the heaps.
+    std::vector<bool> live_branches_;
+    // The number of unresolved branches.
+    size_t size_;
+    // The number of heap entries that are not live.
+    size_t stale_count_;
   };
 
   ptrdiff_t GetNextCheckPoint() {
@@ -656,6 +597,91 @@ enum FPMacroNaNPropagationOption {
   FastNaNPropagation
 };
 
+// Hints for `MacroAssembler::Bind()`, describing how a label is used, so that
+// it can be aligned according to the policy set with
+// `MacroAssembler::SetLabelAlignment()`.
+enum LabelAlignmentHint {
+  kNoAlignmentHint,
+  // The first instruction of a loop, usually the target of its back edge.
+  kLoopHeaderHint,
+  // Any other frequently executed branch target.
+  kHotBranchTargetHint,
+  kNumberOfLabelAlignmentHints
+};
+
+// Find short sequences of instructions to materialise immediates.
+//
+// Each sequence has an initial `movz`, `movn` or `orr` (immediate), followed
+// by a `movk` for each halfword that the initial value gets wrong. The initial
+// value can be any logical immediate, so for example 0x5555123455555555 needs
+// only an `orr` and a `movk`.
+//
+// Most immediates can quickly be shown to have no better sequence than the
+// one that uses only move-wide instructions. The others need a search, so
+// their results are cached.
+class ImmediateMaterialiser {
+ public:
+  // The instruction used to write the initial value.
+  enum InitialOp { kMovz, kMovn, kOrr };
+
+  // Return the number of set bits in a four-bit halfword mask, without calling
+  // into the compiler runtime on hosts without a population count instruction.
+  static int CountHalfwords(unsigned mask) {
+    VIXL_ASSERT(mask < 16);
+    return (UINT64_C(0x4332322132212110) >> (4 * mask)) & 0xf;
+  }
+
+  struct Sequence {
+    // The value written by the first instruction.
+    uint64_t initial;
+    // The halfwords to be inserted with `movk`, as a bit mask.
+    unsigned movk_mask;
+    InitialOp op;
+    // The encoding of `initial`: the position of its only significant
+    // halfword for `movz` and `movn`, or the logical immediate fields for
+    // `orr`. Keeping these avoids encoding the value again.
+    unsigned shift;
+    unsigned n;
+    unsigned imm_s;
+    unsigned imm_r;
+
+    int GetLength() const { return 1 + CountHalfwords(movk_mask); }
+  };
+
+  ImmediateMaterialiser() {}
+
+  // Find a sequence that only uses move-wide instructions: a `movz` or `movn`
+  // for the first halfword that isn't 0x0000 (or 0xffff), and a `movk` for
+  // each of the others. This is optimal for sequences of up to two
+  // instructions.
+  static Sequence GetMoveWideSequence(uint64_t imm, unsigned reg_size);
+
+  // Replace `sequence`, the move-wide sequence for `imm`, with a shortest
+  // sequence. `imm` must not be a logical immediate.
+  void Improve(uint64_t imm, unsigned reg_size, Sequence* sequence);
+
+  // As above, without using the cache.
+  static void Search(uint64_t imm, unsigned reg_size, Sequence* sequence);
+
+ private:
+  // Return false if there is certainly no shorter sequence than `sequence`.
+  static bool CanImprove(uint64_t imm,
+                         unsigned reg_size,
+                         const Sequence& sequence);
+
+  struct CacheEntry {
+    uint64_t imm;
+    // Zero for unused entries.
+    unsigned reg_size;
+    Sequence sequence;
+  };
+
+  // The cache is direct-mapped, and allocated on first use.
+  static const int kCacheSizeLog2 = 8;
+  std::vector<CacheEntry> cache_;
+};
+
+
 class MacroAssembler : public Assembler, public MacroAssemblerInterface {
  public:
   explicit MacroAssembler(
@@ -1156,6 +1182,12 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     bfxil(rd, rn, lsb, width);
   }
   void Bind(Label* label, BranchTargetIdentifier id = EmitBTI_none);
+  // Bind a label, aligning it first according to the policy for `hint`. The
+  // padding is emitted before the label, so it is executed by code that falls
+  // through to the label, but not by branches to it.
+  void Bind(Label* label,
+            LabelAlignmentHint hint,
+            BranchTargetIdentifier id = EmitBTI_none);
   // Bind a label to a specified offset from the start of the buffer.
   void BindToOffset(Label* label, ptrdiff_t offset);
   void Bl(Label* label) {
@@ -1945,13 +1977,9 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     SingleEmissionCheckScope guard(this);
     RawLiteral* literal;
     if (vt.IsD()) {
-      literal = new Literal<double>(imm,
-                                    &literal_pool_,
-                                    RawLiteral::kDeletedOnPlacementByPool);
+      literal = CreatePoolLiteral(imm);
     } else {
-      literal = new Literal<float>(static_cast<float>(imm),
-                                   &literal_pool_,
-                                   RawLiteral::kDeletedOnPlacementByPool);
+      literal = CreatePoolLiteral(static_cast<float>(imm));
     }
     ldr(vt, literal);
   }
@@ -1960,13 +1988,9 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     SingleEmissionCheckScope guard(this);
     RawLiteral* literal;
     if (vt.IsS()) {
-      literal = new Literal<float>(imm,
-                                   &literal_pool_,
-                                   RawLiteral::kDeletedOnPlacementByPool);
+      literal = CreatePoolLiteral(imm);
     } else {
-      literal = new Literal<double>(static_cast<double>(imm),
-                                    &literal_pool_,
-                                    RawLiteral::kDeletedOnPlacementByPool);
+      literal = CreatePoolLiteral(static_cast<double>(imm));
     }
     ldr(vt, literal);
   }
@@ -1974,11 +1998,7 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     VIXL_ASSERT(allow_macro_instructions_);
     VIXL_ASSERT(vt.IsQ());
     SingleEmissionCheckScope guard(this);
-    ldr(vt,
-        new Literal<uint64_t>(high64,
-                              low64,
-                              &literal_pool_,
-                              RawLiteral::kDeletedOnPlacementByPool));
+    ldr(vt, CreatePoolLiteral(high64, low64));
   }
   void Ldr(const Register& rt, uint64_t imm) {
     VIXL_ASSERT(allow_macro_instructions_);
@@ -1986,15 +2006,11 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     SingleEmissionCheckScope guard(this);
     RawLiteral* literal;
     if (rt.Is64Bits()) {
-      literal = new Literal<uint64_t>(imm,
-                                      &literal_pool_,
-                                      RawLiteral::kDeletedOnPlacementByPool);
+      literal = CreatePoolLiteral(imm);
     } else {
       VIXL_ASSERT(rt.Is32Bits());
       VIXL_ASSERT(IsUint32(imm) || IsInt32(imm));
-      literal = new Literal<uint32_t>(static_cast<uint32_t>(imm),
-                                      &literal_pool_,
-                                      RawLiteral::kDeletedOnPlacementByPool);
+      literal = CreatePoolLiteral(static_cast<uint32_t>(imm));
     }
     ldr(rt, literal);
   }
@@ -2002,10 +2018,7 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     VIXL_ASSERT(allow_macro_instructions_);
     VIXL_ASSERT(!rt.IsZero());
     SingleEmissionCheckScope guard(this);
-    ldrsw(rt,
-          new Literal<uint32_t>(imm,
-                                &literal_pool_,
-                                RawLiteral::kDeletedOnPlacementByPool));
+    ldrsw(rt, CreatePoolLiteral(imm));
   }
   void Ldr(const CPURegister& rt, RawLiteral* literal) {
     VIXL_ASSERT(allow_macro_instructions_);
@@ -2844,6 +2857,13 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
   V(saddl2, Saddl2)              \
   V(saddw, Saddw)                \
   V(saddw2, Saddw2)              \
+  V(sha1c, Sha1c)                \
+  V(sha1m, Sha1m)                \
+  V(sha1p, Sha1p)                \
+  V(sha1su0, Sha1su0)            \
+  V(sha256h, Sha256h)            \
+  V(sha256h2, Sha256h2)          \
+  V(sha256su1, Sha256su1)        \
   V(shadd, Shadd)                \
   V(shsub, Shsub)                \
   V(smax, Smax)                  \
@@ -2936,6 +2956,10 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
   V(abs, Abs)                    \
   V(addp, Addp)                  \
   V(addv, Addv)                  \
+  V(aesd, Aesd)                  \
+  V(aese, Aese)                  \
+  V(aesimc, Aesimc)              \
+  V(aesmc, Aesmc)                \
   V(cls, Cls)                    \
   V(clz, Clz)                    \
   V(cnt, Cnt)                    \
@@ -2984,6 +3008,9 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
   V(sadalp, Sadalp)              \
   V(saddlp, Saddlp)              \
   V(saddlv, Saddlv)              \
+  V(sha1h, Sha1h)                \
+  V(sha1su1, Sha1su1)            \
+  V(sha256su0, Sha256su0)        \
   V(smaxv, Smaxv)                \
   V(sminv, Sminv)                \
   V(sqabs, Sqabs)                \
@@ -7065,6 +7092,27 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
     return IsLiteralPoolBlocked() && IsVeneerPoolBlocked();
   }
 
+  // Align labels bound with `hint` to `alignment` bytes, which must be a power
+  // of two no larger than 64, by padding with `nop` instructions. If more than
+  // `max_padding` bytes would be needed, the label is not aligned at all. By
+  // default, labels are not aligned, and a negative `max_padding` allows any
+  // padding.
+  //
+  // Pools that would be due within the padding or the aligned block that
+  // follows it are emitted before the padding, so that they don't separate the
+  // label from its padding, or displace the start of the block.
+  void SetLabelAlignment(LabelAlignmentHint hint,
+                         int alignment,
+                         int max_padding = -1);
+  int GetLabelAlignment(LabelAlignmentHint hint) const {
+    VIXL_ASSERT(hint < kNumberOfLabelAlignmentHints);
+    return label_alignment_[hint].alignment;
+  }
+  int GetMaxLabelPadding(LabelAlignmentHint hint) const {
+    VIXL_ASSERT(hint < kNumberOfLabelAlignmentHints);
+    return label_alignment_[hint].max_padding;
+  }
+
   void SetGenerateSimulatorCode(bool value) {
     generate_simulator_code_ = value;
   }
@@ -7390,6 +7438,30 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
                  const CPURegister& dst2,
                  const CPURegister& dst3);
 
+  // Create a literal to be placed (and deleted) by the literal pool, or reuse
+  // an identical pending one if literal deduplication is enabled.
+  template <typename T>
+  RawLiteral* CreatePoolLiteral(T value) {
+    VIXL_STATIC_ASSERT(sizeof(value) <= kXRegSizeInBytes);
+    uint64_t low64 = 0;
+    memcpy(&low64, &value, sizeof(value));
+    RawLiteral* literal =
+        literal_pool_.FindSharedEntry(sizeof(value), 0, low64);
+    if (literal != NULL) return literal;
+    return new Literal<T>(value,
+                          &literal_pool_,
+                          RawLiteral::kDeletedOnPlacementByPool);
+  }
+  RawLiteral* CreatePoolLiteral(uint64_t high64, uint64_t low64) {
+    RawLiteral* literal =
+        literal_pool_.FindSharedEntry(kQRegSizeInBytes, high64, low64);
+    if (literal != NULL) return literal;
+    return new Literal<uint64_t>(high64,
+                                 low64,
+                                 &literal_pool_,
+                                 RawLiteral::kDeletedOnPlacementByPool);
+  }
+
   void Movi16bitHelper(const VRegister& vd, uint64_t imm);
   void Movi32bitHelper(const VRegister& vd, uint64_t imm);
   void Movi64bitHelper(const VRegister& vd, uint64_t imm);
@@ -7414,6 +7486,10 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
       const MemOperand& mem,
       UseScratchRegisterScope* scratch_scope);
 
+  // Return true if the branch to `label` should be emitted as an inverted
+  // branch around an unconditional `b`, as chosen by BranchRelaxation.
+  bool ShouldRelaxBranch(Label* label, ImmBranchType branch_type);
+
   bool LabelIsOutOfRange(Label* label, ImmBranchType branch_type) {
     return !Instruction::IsValidImmPCOffset(branch_type,
                                             label->GetLocation() -
@@ -7621,13 +7697,26 @@ class MacroAssembler : public Assembler, public MacroAssemblerInterface {
   LiteralPool literal_pool_;
   VeneerPool veneer_pool_;
 
+  ImmediateMaterialiser immediate_materialiser_;
+
   ptrdiff_t checkpoint_;
   ptrdiff_t recommended_checkpoint_;
 
   FPMacroNaNPropagationOption fp_nan_propagation_;
 
+  struct LabelAlignmentPolicy {
+    LabelAlignmentPolicy() : alignment(kInstructionSize), max_padding(0) {}
+    int alignment;
+    int max_padding;
+  };
+  LabelAlignmentPolicy label_alignment_[kNumberOfLabelAlignmentHints];
+
+  // The active BranchRelaxation, if any.
+  BranchRelaxation* branch_relaxation_;
+
   friend class Pool;
   friend class LiteralPool;
+  friend class BranchRelaxation;
 };
 
 
@@ -7694,6 +7783,69 @@ class BlockPoolsScope {
   MacroAssembler* masm_;
 };
 
+
+// Emit a sequence of already-encoded instructions with as little overhead as
+// possible. Opening the scope reserves space for up to `count` instructions
+// and blocks the pools, like an ExactAssemblyScope with kMaximumSize. After
+// that, `Emit()` only stores the instruction: unlike the Assembler, it doesn't
+// check the ISA, the CPU features or the space left in the buffer, except in
+// debug builds, where the space is checked.
+//
+// The buffer's cursor is only moved when the scope is closed, so neither the
+// Assembler nor the MacroAssembler can be used whilst the scope is open.
+//
+//   {
+//     InstructionStreamScope stream(&masm, count);
+//     for (size_t i = 0; i < count; i++) stream.Emit(encodings[i]);
+//   }
+class InstructionStreamScope : public ExactAssemblyScope {
+ public:
+  InstructionStreamScope(MacroAssembler* masm, size_t count)
+      : ExactAssemblyScope(masm, count * kInstructionSize, kMaximumSize),
+        buffer_(masm->GetBuffer()),
+        start_(NULL),
+        size_(0),
+        limit_(count * kInstructionSize) {
+    // Size-only buffers have no storage, so only the size is recorded.
+    if (!buffer_->IsSizeOnly()) {
+      start_ = buffer_->GetOffsetAddress<byte*>(buffer_->GetCursorOffset());
+    }
+  }
+
+  virtual ~InstructionStreamScope() { Close(); }
+
+  void Emit(Instr instruction) {
+    VIXL_ASSERT((size_ + kInstructionSize) <= limit_);
+    if (start_ != NULL) {
+      memcpy(start_ + size_, &instruction, sizeof(instruction));
+    }
+    size_ += kInstructionSize;
+  }
+
+  void Emit(const Instr* instructions, size_t count) {
+    size_t size = count * kInstructionSize;
+    VIXL_ASSERT((size_ + size) <= limit_);
+    if (start_ != NULL) memcpy(start_ + size_, instructions, size);
+    size_ += size;
+  }
+
+  size_t GetSizeOfCodeEmitted() const { return size_; }
+
+  void Close() {
+    if (buffer_ != NULL) {
+      buffer_->Advance(size_);
+      buffer_ = NULL;
+    }
+    ExactAssemblyScope::Close();
+  }
+
+ private:
+  CodeBuffer* buffer_;
+  byte* start_;
+  size_t size_;
+  size_t limit_;
+};
+
 MovprfxHelperScope::MovprfxHelperScope(MacroAssembler* masm,
                                        const ZRegister& dst,
                                        const ZRegister& src)
@@ -8015,32 +8167,6 @@ void MacroAssembler::CallRuntimeHelper(R (*function)(P...),
 #endif  // #ifdef VIXL_HAS_MACROASSEMBLER_RUNTIME_CALL_SUPPORT
 
 }  // namespace aarch64
-
-// Required InvalSet template specialisations.
-// TODO: These template specialisations should not live in this file.  Move
-// VeneerPool out of the aarch64 namespace in order to share its implementation
-// later.
-template <>
-inline ptrdiff_t InvalSet<aarch64::VeneerPool::BranchInfo,
-                          aarch64::VeneerPool::kNPreallocatedInfos,
-                          ptrdiff_t,
-                          aarch64::VeneerPool::kInvalidOffset,
-                          aarch64::VeneerPool::kReclaimFrom,
-                          aarch64::VeneerPool::kReclaimFactor>::
-    GetKey(const aarch64::VeneerPool::BranchInfo& branch_info) {
-  return branch_info.first_unreacheable_pc_;
-}
-template <>
-inline void InvalSet<aarch64::VeneerPool::BranchInfo,
-                     aarch64::VeneerPool::kNPreallocatedInfos,
-                     ptrdiff_t,
-                     aarch64::VeneerPool::kInvalidOffset,
-                     aarch64::VeneerPool::kReclaimFrom,
-                     aarch64::VeneerPool::kReclaimFactor>::
-    SetKey(aarch64::VeneerPool::BranchInfo* branch_info, ptrdiff_t key) {
-  branch_info->first_unreacheable_pc_ = key;
-}
-
 }  // namespace vixl
 
 #endif  // VIXL_AARCH64_MACRO_ASSEMBLER_AARCH64_H_
@@ -0,0 +1,580 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+extern "C" {
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+}
+
+#include <cstring>
+
+#include "object-writer-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+// The subset of ELF64 definitions that we need. These follow the System V gABI
+// and are defined here (rather than taken from <elf.h>) so that the writer
+// works on hosts without ELF headers.
+namespace elf {
+
+const uint8_t kClass64 = 2;
+const uint8_t kData2LSB = 1;
+const uint8_t kVersionCurrent = 1;
+const uint16_t kTypeRelocatable = 1;
+const uint16_t kMachineAArch64 = 183;
+
+const uint32_t kSectionProgBits = 1;
+const uint32_t kSectionSymTab = 2;
+const uint32_t kSectionStrTab = 3;
+const uint32_t kSectionRela = 4;
+
+const uint64_t kSectionFlagAlloc = 0x2;
+const uint64_t kSectionFlagExecInstr = 0x4;
+const uint64_t kSectionFlagInfoLink = 0x40;
+
+const uint8_t kBindLocal = 0;
+const uint8_t kBindGlobal = 1;
+const uint8_t kSymbolNoType = 0;
+const uint8_t kSymbolObject = 1;
+const uint8_t kSymbolFunc = 2;
+const uint16_t kSectionIndexUndefined = 0;
+
+struct Header {
+  uint8_t ident[16];
+  uint16_t type;
+  uint16_t machine;
+  uint32_t version;
+  uint64_t entry;
+  uint64_t phoff;
+  uint64_t shoff;
+  uint32_t flags;
+  uint16_t ehsize;
+  uint16_t phentsize;
+  uint16_t phnum;
+  uint16_t shentsize;
+  uint16_t shnum;
+  uint16_t shstrndx;
+};
+
+struct SectionHeader {
+  uint32_t name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t addr;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint32_t info;
+  uint64_t addralign;
+  uint64_t entsize;
+};
+
+struct Sym {
+  uint32_t name;
+  uint8_t info;
+  uint8_t other;
+  uint16_t shndx;
+  uint64_t value;
+  uint64_t size;
+};
+
+struct Rela {
+  uint64_t offset;
+  uint64_t info;
+  int64_t addend;
+};
+
+VIXL_STATIC_ASSERT(sizeof(Header) == 64);
+VIXL_STATIC_ASSERT(sizeof(SectionHeader) == 64);
+VIXL_STATIC_ASSERT(sizeof(Sym) == 24);
+VIXL_STATIC_ASSERT(sizeof(Rela) == 24);
+
+// Section indices, in the order in which they are written.
+enum SectionIndex {
+  kNullSection,
+  kTextSection,
+  kRelaTextSection,
+  kSymTabSection,
+  kStrTabSection,
+  kShStrTabSection,
+  kNumberOfSections
+};
+
+// A simple ELF string table builder.
+class StringTable {
+ public:
+  StringTable() : data_(1, '\0') {}
+
+  uint32_t Add(const std::string& string) {
+    if (string.empty()) return 0;
+    uint32_t index = static_cast<uint32_t>(data_.size());
+    data_.insert(data_.end(), string.begin(), string.end());
+    data_.push_back('\0');
+    return index;
+  }
+
+  const std::vector<char>& GetData() const { return data_; }
+
+ private:
+  std::vector<char> data_;
+};
+
+template <typename T>
+void Append(std::vector<byte>* out, const T& value) {
+  const byte* raw = reinterpret_cast<const byte*>(&value);
+  out->insert(out->end(), raw, raw + sizeof(value));
+}
+
+void AppendData(std::vector<byte>* out, const void* data, size_t size) {
+  const byte* raw = reinterpret_cast<const byte*>(data);
+  out->insert(out->end(), raw, raw + size);
+}
+
+void AlignTo(std::vector<byte>* out, size_t alignment) {
+  while ((out->size() % alignment) != 0) out->push_back(0);
+}
+
+}  // namespace elf
+
+
+ElfObjectWriter::ElfObjectWriter(const Assembler* assembler)
+    : code_(assembler->GetBuffer().GetStartAddress<const byte*>()),
+      size_(assembler->GetSizeOfCodeGenerated()),
+      isa_map_(assembler->GetISAMap()) {
+  AddMappingSymbols();
+}
+
+
+ElfObjectWriter::ElfObjectWriter(const byte* code,
+                                 size_t size,
+                                 const ISAMap* isa_map)
+    : code_(code), size_(size), isa_map_(isa_map) {
+  AddMappingSymbols();
+}
+
+
+static const char* GetMappingSymbolName(ISA isa) {
+  switch (isa) {
+    case ISA::A64:
+      return "$x";
+    case ISA::C64:
+      return "$c";
+    case ISA::Data:
+      return "$d";
+  }
+  VIXL_UNREACHABLE();
+  return "$d";
+}
+
+
+void ElfObjectWriter::AddMappingSymbols() {
+  VIXL_ASSERT(symbols_.empty());
+  if (size_ == 0) return;
+
+  // Emit a mapping symbol at the start of the section, then one at every
+  // change of ISA. Adjacent blocks with the same ISA don't need a new symbol.
+  ISA current = isa_map_->GetISAAt(0);
+  Symbol start = {GetMappingSymbolName(current), 0, 0, elf::kSymbolNoType,
+                  false, false};
+  symbols_.push_back(start);
+  for (ISAMap::const_iterator it = isa_map_->begin(); it != isa_map_->end();
+       ++it) {
+    if (it->first <= 0) continue;
+    if (static_cast<size_t>(it->first) >= size_) break;
+    if (it->second == current) continue;
+    current = it->second;
+    Symbol mapping = {GetMappingSymbolName(current),
+                      static_cast<uint64_t>(it->first),
+                      0,
+                      elf::kSymbolNoType,
+                      false,
+                      false};
+    symbols_.push_back(mapping);
+  }
+}
+
+
+void ElfObjectWriter::AddSymbol(const char* name,
+                                const Label* label,
+                                size_t size,
+                                SymbolBinding binding) {
+  VIXL_ASSERT(label->IsBound());
+  ISA isa = label->GetISA();
+  uint64_t value = label->GetLocation() + GetInterworkOffset(isa);
+  uint8_t type = (isa == ISA::Data) ? elf::kSymbolObject : elf::kSymbolFunc;
+  Symbol symbol = {name, value, size, type, binding == kGlobalSymbol, false};
+  symbols_.push_back(symbol);
+}
+
+
+void ElfObjectWriter::AddSymbol(const char* name,
+                                ptrdiff_t offset,
+                                size_t size,
+                                SymbolBinding binding) {
+  VIXL_ASSERT((offset >= 0) && (static_cast<size_t>(offset) <= size_));
+  ISA isa = isa_map_->GetISAAt(offset);
+  uint64_t value = offset + GetInterworkOffset(isa);
+  uint8_t type = (isa == ISA::Data) ? elf::kSymbolObject : elf::kSymbolFunc;
+  Symbol symbol = {name, value, size, type, binding == kGlobalSymbol, false};
+  symbols_.push_back(symbol);
+}
+
+
+size_t ElfObjectWriter::FindOrAddUndefinedSymbol(const char* name) {
+  for (size_t i = 0; i < symbols_.size(); i++) {
+    if (symbols_[i].is_undefined && (symbols_[i].name == name)) return i;
+  }
+  Symbol symbol = {name, 0, 0, elf::kSymbolNoType, true, true};
+  symbols_.push_back(symbol);
+  return symbols_.size() - 1;
+}
+
+
+void ElfObjectWriter::AddExternalReference(const char* name,
+                                           ptrdiff_t offset,
+                                           ElfRelocationType type,
+                                           int64_t addend) {
+  VIXL_ASSERT((offset >= 0) && (static_cast<size_t>(offset) < size_));
+  Relocation relocation = {static_cast<uint64_t>(offset),
+                           FindOrAddUndefinedSymbol(name),
+                           static_cast<uint32_t>(type),
+                           addend};
+  relocations_.push_back(relocation);
+}
+
+
+void ElfObjectWriter::Write(std::vector<byte>* out) const {
+  out->clear();
+
+  // The ELF specification requires local symbols to precede global ones. Build
+  // the symbol table first, remembering where each of our symbols ends up so
+  // that relocations can refer to them.
+  elf::StringTable strtab;
+  std::vector<elf::Sym> syms;
+  std::vector<uint32_t> sym_index(symbols_.size(), 0);
+  elf::Sym null_sym = {0, 0, 0, 0, 0, 0};
+  syms.push_back(null_sym);
+  uint32_t first_global = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    bool want_global = (pass == 1);
+    if (want_global) first_global = static_cast<uint32_t>(syms.size());
+    for (size_t i = 0; i < symbols_.size(); i++) {
+      const Symbol& symbol = symbols_[i];
+      if (symbol.is_global != want_global) continue;
+      uint8_t bind = symbol.is_global ? elf::kBindGlobal : elf::kBindLocal;
+      elf::Sym sym;
+      sym.name = strtab.Add(symbol.name);
+      sym.info = static_cast<uint8_t>((bind << 4) | symbol.type);
+      sym.other = 0;
+      sym.shndx = symbol.is_undefined ? elf::kSectionIndexUndefined
+                                      : static_cast<uint16_t>(
+                                            elf::kTextSection);
+      sym.value = symbol.value;
+      sym.size = symbol.size;
+      sym_index[i] = static_cast<uint32_t>(syms.size());
+      syms.push_back(sym);
+    }
+  }
+
+  std::vector<elf::Rela> relas;
+  for (size_t i = 0; i < relocations_.size(); i++) {
+    const Relocation& relocation = relocations_[i];
+    elf::Rela rela;
+    rela.offset = relocation.offset;
+    rela.info = (static_cast<uint64_t>(sym_index[relocation.symbol]) << 32) |
+                relocation.type;
+    rela.addend = relocation.addend;
+    relas.push_back(rela);
+  }
+
+  elf::StringTable shstrtab;
+  uint32_t text_name = shstrtab.Add(".text");
+  uint32_t rela_text_name = shstrtab.Add(".rela.text");
+  uint32_t symtab_name = shstrtab.Add(".symtab");
+  uint32_t strtab_name = shstrtab.Add(".strtab");
+  uint32_t shstrtab_name = shstrtab.Add(".shstrtab");
+
+  // Lay out the file: header, section contents, then section headers.
+  elf::Header header;
+  memset(&header, 0, sizeof(header));
+  elf::Append(out, header);
+
+  elf::SectionHeader sections[elf::kNumberOfSections];
+  memset(sections, 0, sizeof(sections));
+
+  elf::AlignTo(out, 16);
+  sections[elf::kTextSection].name = text_name;
+  sections[elf::kTextSection].type = elf::kSectionProgBits;
+  sections[elf::kTextSection].flags =
+      elf::kSectionFlagAlloc | elf::kSectionFlagExecInstr;
+  sections[elf::kTextSection].offset = out->size();
+  sections[elf::kTextSection].size = size_;
+  sections[elf::kTextSection].addralign = 16;
+  elf::AppendData(out, code_, size_);
+
+  elf::AlignTo(out, 8);
+  sections[elf::kRelaTextSection].name = rela_text_name;
+  sections[elf::kRelaTextSection].type = elf::kSectionRela;
+  sections[elf::kRelaTextSection].flags = elf::kSectionFlagInfoLink;
+  sections[elf::kRelaTextSection].offset = out->size();
+  sections[elf::kRelaTextSection].size = relas.size() * sizeof(elf::Rela);
+  sections[elf::kRelaTextSection].link = elf::kSymTabSection;
+  sections[elf::kRelaTextSection].info = elf::kTextSection;
+  sections[elf::kRelaTextSection].addralign = 8;
+  sections[elf::kRelaTextSection].entsize = sizeof(elf::Rela);
+  for (size_t i = 0; i < relas.size(); i++) elf::Append(out, relas[i]);
+
+  elf::AlignTo(out, 8);
+  sections[elf::kSymTabSection].name = symtab_name;
+  sections[elf::kSymTabSection].type = elf::kSectionSymTab;
+  sections[elf::kSymTabSection].offset = out->size();
+  sections[elf::kSymTabSection].size = syms.size() * sizeof(elf::Sym);
+  sections[elf::kSymTabSection].link = elf::kStrTabSection;
+  sections[elf::kSymTabSection].info = first_global;
+  sections[elf::kSymTabSection].addralign = 8;
+  sections[elf::kSymTabSection].entsize = sizeof(elf::Sym);
+  for (size_t i = 0; i < syms.size(); i++) elf::Append(out, syms[i]);
+
+  sections[elf::kStrTabSection].name = strtab_name;
+  sections[elf::kStrTabSection].type = elf::kSectionStrTab;
+  sections[elf::kStrTabSection].offset = out->size();
+  sections[elf::kStrTabSection].size = strtab.GetData().size();
+  sections[elf::kStrTabSection].addralign = 1;
+  elf::AppendData(out, strtab.GetData().data(), strtab.GetData().size());
+
+  sections[elf::kShStrTabSection].name = shstrtab_name;
+  sections[elf::kShStrTabSection].type = elf::kSectionStrTab;
+  sections[elf::kShStrTabSection].offset = out->size();
+  sections[elf::kShStrTabSection].size = shstrtab.GetData().size();
+  sections[elf::kShStrTabSection].addralign = 1;
+  elf::AppendData(out, shstrtab.GetData().data(), shstrtab.GetData().size());
+
+  elf::AlignTo(out, 8);
+  uint64_t shoff = out->size();
+  for (int i = 0; i < elf::kNumberOfSections; i++) {
+    elf::Append(out, sections[i]);
+  }
+
+  // Now that the layout is known, fill in the header.
+  header.ident[0] = 0x7f;
+  header.ident[1] = 'E';
+  header.ident[2] = 'L';
+  header.ident[3] = 'F';
+  header.ident[4] = elf::kClass64;
+  header.ident[5] = elf::kData2LSB;
+  header.ident[6] = elf::kVersionCurrent;
+  header.type = elf::kTypeRelocatable;
+  header.machine = elf::kMachineAArch64;
+  header.version = elf::kVersionCurrent;
+  header.shoff = shoff;
+  header.ehsize = sizeof(elf::Header);
+  header.shentsize = sizeof(elf::SectionHeader);
+  header.shnum = elf::kNumberOfSections;
+  header.shstrndx = elf::kShStrTabSection;
+  memcpy(out->data(), &header, sizeof(header));
+}
+
+
+bool ElfObjectWriter::WriteTo(FILE* file) const {
+  std::vector<byte> data;
+  Write(&data);
+  return fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
+
+bool ElfObjectWriter::WriteTo(const char* filename) const {
+  FILE* file = fopen(filename, "wb");
+  if (file == NULL) return false;
+  bool ok = WriteTo(file);
+  return (fclose(file) == 0) && ok;
+}
+
+
+namespace jitdump {
+
+const uint32_t kMagic = 0x4A695444;  // "JiTD"
+const uint32_t kVersion = 1;
+
+enum RecordType { kCodeLoad = 0, kCodeClose = 3 };
+
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t total_size;
+  uint32_t elf_mach;
+  uint32_t pad1;
+  uint32_t pid;
+  uint64_t timestamp;
+  uint64_t flags;
+};
+
+struct RecordHeader {
+  uint32_t id;
+  uint32_t total_size;
+  uint64_t timestamp;
+};
+
+struct CodeLoad {
+  RecordHeader header;
+  uint32_t pid;
+  uint32_t tid;
+  uint64_t vma;
+  uint64_t code_addr;
+  uint64_t code_size;
+  uint64_t code_index;
+  // Followed by the null-terminated name, then the code.
+};
+
+VIXL_STATIC_ASSERT(sizeof(FileHeader) == 40);
+VIXL_STATIC_ASSERT(sizeof(RecordHeader) == 16);
+VIXL_STATIC_ASSERT(sizeof(CodeLoad) == 56);
+
+}  // namespace jitdump
+
+
+uint64_t PerfJitDumpWriter::GetTimestamp() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) return 0;
+  return (static_cast<uint64_t>(ts.tv_sec) * 1000000000) + ts.tv_nsec;
+}
+
+
+bool PerfJitDumpWriter::Open(const char* directory) {
+  VIXL_ASSERT(!IsOpen());
+  char filename[4096];
+  snprintf(filename,
+           sizeof(filename),
+           "%s/jit-%d.dump",
+           directory,
+           static_cast<int>(getpid()));
+  file_ = fopen(filename, "w+b");
+  if (file_ == NULL) return false;
+  owns_file_ = true;
+  if (!WriteHeader() || !MarkForPerf()) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+
+bool PerfJitDumpWriter::Open(FILE* file) {
+  VIXL_ASSERT(!IsOpen());
+  file_ = file;
+  owns_file_ = false;
+  if (!WriteHeader()) {
+    file_ = NULL;
+    return false;
+  }
+  return true;
+}
+
+
+bool PerfJitDumpWriter::WriteHeader() {
+  jitdump::FileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = jitdump::kMagic;
+  header.version = jitdump::kVersion;
+  header.total_size = sizeof(header);
+  header.elf_mach = elf::kMachineAArch64;
+  header.pid = static_cast<uint32_t>(getpid());
+  header.timestamp = GetTimestamp();
+  return fwrite(&header, sizeof(header), 1, file_) == 1;
+}
+
+
+bool PerfJitDumpWriter::MarkForPerf() {
+  // perf discovers jitdump files by looking for executable mappings of them in
+  // the profiled process.
+  long page_size = sysconf(_SC_PAGESIZE);  // NOLINT(runtime/int)
+  if (page_size <= 0) return false;
+  if (fflush(file_) != 0) return false;
+  mapping_ = mmap(NULL,
+                  page_size,
+                  PROT_READ | PROT_EXEC,
+                  MAP_PRIVATE,
+                  fileno(file_),
+                  0);
+  if (mapping_ == MAP_FAILED) {
+    mapping_ = NULL;
+    return false;
+  }
+  return true;
+}
+
+
+bool PerfJitDumpWriter::AddCodeLoad(const char* name,
+                                    const void* address,
+                                    size_t size) {
+  VIXL_ASSERT(IsOpen());
+  size_t name_size = strlen(name) + 1;
+  jitdump::CodeLoad record;
+  record.header.id = jitdump::kCodeLoad;
+  record.header.total_size =
+      static_cast<uint32_t>(sizeof(record) + name_size + size);
+  record.header.timestamp = GetTimestamp();
+  record.pid = static_cast<uint32_t>(getpid());
+#ifdef SYS_gettid
+  record.tid = static_cast<uint32_t>(syscall(SYS_gettid));
+#else
+  record.tid = record.pid;
+#endif
+  record.vma = reinterpret_cast<uintptr_t>(address);
+  record.code_addr = record.vma;
+  record.code_size = size;
+  record.code_index = code_index_++;
+
+  bool ok = fwrite(&record, sizeof(record), 1, file_) == 1;
+  ok = ok && (fwrite(name, 1, name_size, file_) == name_size);
+  ok = ok && (fwrite(address, 1, size, file_) == size);
+  return ok;
+}
+
+
+void PerfJitDumpWriter::Close() {
+  if (!IsOpen()) return;
+  jitdump::RecordHeader record;
+  record.id = jitdump::kCodeClose;
+  record.total_size = sizeof(record);
+  record.timestamp = GetTimestamp();
+  fwrite(&record, sizeof(record), 1, file_);
+  fflush(file_);
+
+  if (mapping_ != NULL) {
+    long page_size = sysconf(_SC_PAGESIZE);  // NOLINT(runtime/int)
+    munmap(mapping_, page_size);
+    mapping_ = NULL;
+  }
+  if (owns_file_) fclose(file_);
+  file_ = NULL;
+  owns_file_ = false;
+}
+
+}  // namespace aarch64
+}  // namespace vixl
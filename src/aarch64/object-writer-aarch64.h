@@ -0,0 +1,211 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_OBJECT_WRITER_AARCH64_H_
+#define VIXL_AARCH64_OBJECT_WRITER_AARCH64_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "assembler-aarch64.h"
+#include "isa-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+// Relocation types supported by ElfObjectWriter. The values match the AArch64
+// ELF ABI ("ELF for the Arm 64-bit Architecture").
+enum ElfRelocationType {
+  kRelocAbs64 = 257,           // R_AARCH64_ABS64
+  kRelocAbs32 = 258,           // R_AARCH64_ABS32
+  kRelocPrel32 = 261,          // R_AARCH64_PREL32
+  kRelocAdrPrelPgHi21 = 275,   // R_AARCH64_ADR_PREL_PG_HI21
+  kRelocAddAbsLo12Nc = 277,    // R_AARCH64_ADD_ABS_LO12_NC
+  kRelocJump26 = 282,          // R_AARCH64_JUMP26
+  kRelocCall26 = 283,          // R_AARCH64_CALL26
+  kRelocLdst64AbsLo12Nc = 286  // R_AARCH64_LDST64_ABS_LO12_NC
+};
+
+// Produce an ELF64 relocatable object (`.o`) from finalised code.
+//
+// The object has a single `.text` section holding the whole buffer. Mapping
+// symbols (`$x` for A64, `$c` for C64 and `$d` for data) are generated from the
+// ISAMap so that disassemblers and profilers decode each region correctly.
+// Other symbols are added explicitly, usually from bound labels, and external
+// references are recorded as RELA relocations against undefined symbols.
+//
+// Typical usage:
+//
+//   MacroAssembler masm;
+//   Label entry;
+//   masm.Bind(&entry);
+//   ...
+//   {
+//     // Placeholder, to be resolved by the linker.
+//     ExactAssemblyScope scope(&masm, kInstructionSize);
+//     call_site = masm.GetCursorOffset();
+//     masm.bl(static_cast<int64_t>(0));
+//   }
+//   ...
+//   masm.FinalizeCode();
+//
+//   ElfObjectWriter writer(&masm);
+//   writer.AddSymbol("my_stub", &entry, masm.GetSizeOfCodeGenerated());
+//   writer.AddExternalReference("memcpy", call_site, kRelocCall26);
+//   writer.WriteTo(file);
+//
+// Only little-endian hosts are supported, consistent with the rest of VIXL.
+class ElfObjectWriter {
+ public:
+  enum SymbolBinding { kLocalSymbol, kGlobalSymbol };
+
+  // The code must have been finalised, and must not be modified while the
+  // writer is in use.
+  explicit ElfObjectWriter(const Assembler* assembler);
+  ElfObjectWriter(const byte* code, size_t size, const ISAMap* isa_map);
+
+  // Add a symbol at a bound label. The symbol type (function or object) is
+  // derived from the label's ISA, and C64 function symbols have their bottom
+  // bit set, as required by the Morello ELF ABI.
+  void AddSymbol(const char* name,
+                 const Label* label,
+                 size_t size = 0,
+                 SymbolBinding binding = kGlobalSymbol);
+  // Add a symbol at an arbitrary offset. The ISA is taken from the ISAMap.
+  void AddSymbol(const char* name,
+                 ptrdiff_t offset,
+                 size_t size = 0,
+                 SymbolBinding binding = kGlobalSymbol);
+
+  // Record a reference from the instruction (or data) at `offset` to the
+  // undefined symbol `name`. Several references may share the same symbol.
+  void AddExternalReference(const char* name,
+                            ptrdiff_t offset,
+                            ElfRelocationType type,
+                            int64_t addend = 0);
+
+  // Serialise the object.
+  void Write(std::vector<byte>* out) const;
+  // Write the object to a file. Returns false on I/O errors.
+  bool WriteTo(FILE* file) const;
+  bool WriteTo(const char* filename) const;
+
+  int GetNumberOfSymbols() const { return static_cast<int>(symbols_.size()); }
+  int GetNumberOfRelocations() const {
+    return static_cast<int>(relocations_.size());
+  }
+
+ private:
+  struct Symbol {
+    std::string name;
+    uint64_t value;
+    uint64_t size;
+    uint8_t type;  // STT_*
+    bool is_global;
+    bool is_undefined;
+  };
+
+  struct Relocation {
+    uint64_t offset;
+    size_t symbol;  // Index into symbols_.
+    uint32_t type;
+    int64_t addend;
+  };
+
+  size_t FindOrAddUndefinedSymbol(const char* name);
+  void AddMappingSymbols();
+
+  const byte* code_;
+  size_t size_;
+  const ISAMap* isa_map_;
+
+  std::vector<Symbol> symbols_;
+  std::vector<Relocation> relocations_;
+};
+
+
+// Write a JIT dump file, as consumed by `perf inject --jit`.
+//
+// The file format is described in the Linux sources, in
+// `tools/perf/Documentation/jitdump-specification.txt`. For perf to find the
+// file, it must be named `jit-<pid>.dump` and must be mapped (with PROT_EXEC)
+// by the process whilst it is being profiled; `Open(directory)` does this.
+// Samples are attributed using CLOCK_MONOTONIC timestamps, so record with
+// `perf record -k mono`.
+//
+// Typical usage:
+//
+//   PerfJitDumpWriter jitdump;
+//   jitdump.Open();  // Writes /tmp/jit-<pid>.dump by default.
+//   ...
+//   masm.FinalizeCode();
+//   masm.GetBuffer()->SetExecutable();
+//   jitdump.AddCodeLoad("my_function",
+//                       masm.GetBuffer()->GetStartAddress<const void*>(),
+//                       masm.GetSizeOfCodeGenerated());
+class PerfJitDumpWriter {
+ public:
+  PerfJitDumpWriter()
+      : file_(NULL), owns_file_(false), mapping_(NULL), code_index_(0) {}
+  ~PerfJitDumpWriter() { Close(); }
+
+  // Open a dump file in `directory`, and write the header. Returns false on
+  // error.
+  bool Open(const char* directory = "/tmp");
+  // Write the header to an already-open file. The writer does not take
+  // ownership of the file, and does not map it for perf.
+  bool Open(FILE* file);
+
+  // Record that `size` bytes of code at `address` are now executable, and
+  // have the name `name`. The code is copied into the dump file, so it may be
+  // unmapped or modified after this call. ISA transitions are not recorded;
+  // C64 code is reported as if it were A64.
+  bool AddCodeLoad(const char* name, const void* address, size_t size);
+
+  // Write the end-of-file record, and close the file if it was opened by the
+  // writer.
+  void Close();
+
+  bool IsOpen() const { return file_ != NULL; }
+
+ private:
+  bool WriteHeader();
+  bool MarkForPerf();
+  static uint64_t GetTimestamp();
+
+  FILE* file_;
+  bool owns_file_;
+  void* mapping_;
+  uint64_t code_index_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_OBJECT_WRITER_AARCH64_H_
@@ -0,0 +1,441 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "peephole-aarch64.h"
+
+#include "macro-assembler-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+static const Instr kNopInstruction = HINT | (NOP << ImmHint_offset);
+
+void CodeRegion::AddBranchTarget(const Label* label) {
+  VIXL_ASSERT(label->IsBound());
+  AddBranchTarget(label->GetLocation());
+}
+
+
+Instruction* CodeRegion::GetInstructionAt(ptrdiff_t offset) const {
+  return masm_->GetBuffer()->GetOffsetAddress<Instruction*>(offset);
+}
+
+
+void CodeRegion::Scan(ptrdiff_t start, ptrdiff_t end) {
+  VIXL_ASSERT(IsAligned(start, kInstructionSize));
+  VIXL_ASSERT(IsAligned(end, kInstructionSize));
+  VIXL_ASSERT((0 <= start) && (start <= end));
+  VIXL_ASSERT(end <= masm_->GetCursorOffset());
+
+  start_ = start;
+  end_ = end;
+  size_t count = (end_ - start_) / kInstructionSize;
+  is_target_.assign(count, false);
+  is_code_.assign(count, false);
+
+  // Scan the whole buffer, since branches from outside the region can target
+  // instructions inside it.
+  const ISAMap* isa_map = masm_->GetISAMap();
+  ptrdiff_t buffer_end = AlignDown(masm_->GetCursorOffset(), kInstructionSize);
+  ptrdiff_t offset = 0;
+  while (offset < buffer_end) {
+    if (isa_map->GetISAAt(offset) == ISA::Data) {
+      offset += kInstructionSize;
+      continue;
+    }
+    if ((start_ <= offset) && (offset < end_)) {
+      is_code_[(offset - start_) / kInstructionSize] = true;
+    }
+
+    const Instruction* instr = GetInstructionAt(offset);
+    if (instr->IsImmBranch() ||
+        (instr->IsPCRelAddressing() && (instr->Mask(PCRelAddressingMask) == ADR))) {
+      ptrdiff_t target = instr->GetImmPCOffsetTarget() -
+                         masm_->GetBuffer()->GetStartAddress<Instruction*>();
+      MarkBranchTarget(AlignDown(target, kInstructionSize));
+    }
+
+    // Skip the arguments of simulator pseudo-instructions.
+    offset += kInstructionSize;
+    if (masm_->GenerateSimulatorCode() &&
+        (instr->Mask(ExceptionMask) == HLT)) {
+      switch (instr->GetImmException()) {
+        case kPrintfOpcode:
+          offset += kPrintfLength - kInstructionSize;
+          break;
+        case kTraceOpcode:
+          offset += kTraceLength - kInstructionSize;
+          break;
+        case kLogOpcode:
+          offset += kLogLength - kInstructionSize;
+          break;
+        case kRuntimeCallOpcode:
+          offset += AlignUp(kRuntimeCallLength, kInstructionSize) -
+                    kInstructionSize;
+          break;
+        case kSetCPUFeaturesOpcode:
+        case kEnableCPUFeaturesOpcode:
+        case kDisableCPUFeaturesOpcode:
+          // The list of features ends with kNone, and is padded to the next
+          // instruction.
+          while (*masm_->GetBuffer()
+                      ->GetOffsetAddress<const ConfigureCPUFeaturesElementType*>(
+                          offset++) != CPUFeatures::kNone) {
+          }
+          offset = AlignUp(offset, kInstructionSize);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < extra_targets_.size(); i++) {
+    MarkBranchTarget(AlignDown(extra_targets_[i], kInstructionSize));
+  }
+}
+
+
+void CodeRegion::MarkBranchTarget(ptrdiff_t offset) {
+  if ((start_ <= offset) && (offset < end_)) {
+    is_target_[(offset - start_) / kInstructionSize] = true;
+  }
+}
+
+
+PeepholeOptimiser::PeepholeOptimiser(MacroAssembler* masm)
+    : masm_(masm), block_local_registers_(0), region_(masm) {
+  decoder_.AppendVisitor(this);
+}
+
+
+int PeepholeOptimiser::Optimise() {
+  return Optimise(0, AlignDown(masm_->GetCursorOffset(), kInstructionSize));
+}
+
+
+int PeepholeOptimiser::Optimise(ptrdiff_t start, ptrdiff_t end) {
+  region_.Scan(start, end);
+
+  int count = 0;
+  for (ptrdiff_t offset = start; offset < end; offset += kInstructionSize) {
+    if (!IsCode(offset)) continue;
+    // Apply patterns until none match, so that sequences such as three
+    // consecutive `add`s are fully combined.
+    int nops;
+    do {
+      nops = OptimiseAt(offset);
+      count += nops;
+    } while (nops > 0);
+  }
+  return count;
+}
+
+
+PeepholeOptimiser::InstructionInfo PeepholeOptimiser::Analyse(
+    ptrdiff_t offset) {
+  VIXL_ASSERT(IsCode(offset));
+  InstructionInfo none = {kOther, false, false, 0, 0, 0, 0, 0};
+  info_ = none;
+  ISA isa = masm_->GetISAMap()->GetISAAt(offset);
+  decoder_.Decode(GetInstructionAt(offset), isa);
+  if ((isa != ISA::A64) && (info_.kind != kBlockEnd) && (info_.kind != kNop)) {
+    // The register operands of C64 instructions may be capabilities, so don't
+    // try to optimise them.
+    info_.kind = kOther;
+  }
+  return info_;
+}
+
+
+ptrdiff_t PeepholeOptimiser::GetNextInBlock(ptrdiff_t offset) const {
+  for (offset += kInstructionSize; offset < region_.GetEnd();
+       offset += kInstructionSize) {
+    if (!IsCode(offset) || IsBranchTarget(offset)) return -1;
+    if (GetInstructionAt(offset)->GetInstructionBits() != kNopInstruction) {
+      return offset;
+    }
+  }
+  return -1;
+}
+
+
+// Return true if `instr` might read register `code`. This is conservative: any
+// register field that refers to `code` counts, as does the first register of a
+// pair that includes `code`.
+static bool MayReadRegister(const Instruction* instr, int code) {
+  int fields[] = {static_cast<int>(instr->GetRd()),
+                  static_cast<int>(instr->GetRn()),
+                  static_cast<int>(instr->GetRm()),
+                  static_cast<int>(instr->GetRa())};
+  for (size_t i = 0; i < ArrayLength(fields); i++) {
+    if ((fields[i] == code) || (fields[i] + 1 == code)) return true;
+  }
+  return false;
+}
+
+
+bool PeepholeOptimiser::IsDeadAfter(int code, ptrdiff_t offset) {
+  VIXL_ASSERT((code >= 0) && (code < static_cast<int>(kZeroRegCode)));
+  for (ptrdiff_t next = GetNextInBlock(offset); next >= 0;
+       next = GetNextInBlock(next)) {
+    InstructionInfo info = Analyse(next);
+    switch (info.kind) {
+      case kAddSubRegister:
+      case kLogicalRegister:
+        if (info.rm == code) return false;
+        VIXL_FALLTHROUGH();
+      case kAddSubImmediate:
+        if (info.rn == code) return false;
+        VIXL_FALLTHROUGH();
+      case kMoveImmediate:
+        if (info.rd == code) return true;
+        break;
+      case kNop:
+        break;
+      case kOther:
+      case kBlockEnd:
+        if (MayReadRegister(GetInstructionAt(next), code)) return false;
+        break;
+    }
+    if (info.kind == kBlockEnd) break;
+  }
+  // The end of the block was reached without `code` being read or written.
+  return (block_local_registers_ & (UINT64_C(1) << code)) != 0;
+}
+
+
+int PeepholeOptimiser::OptimiseAt(ptrdiff_t offset) {
+  InstructionInfo info = Analyse(offset);
+  switch (info.kind) {
+    case kLogicalRegister:
+      // mov xd, xd
+      if (info.is_64_bit && (info.op == ORR) && (info.rn == kZeroRegCode) &&
+          (info.rm == info.rd)) {
+        SetNop(offset);
+        return 1;
+      }
+      return 0;
+    case kAddSubImmediate:
+      // add xd, xd, #0
+      if (info.is_64_bit && !info.sets_flags && (info.imm == 0) &&
+          (info.rn == info.rd)) {
+        SetNop(offset);
+        return 1;
+      }
+      return CombineAddSubImmediate(offset, info);
+    case kMoveImmediate:
+      return FoldMoveImmediate(offset, info);
+    case kOther:
+    case kNop:
+    case kBlockEnd:
+    case kAddSubRegister:
+      return 0;
+  }
+  VIXL_UNREACHABLE();
+  return 0;
+}
+
+
+int PeepholeOptimiser::CombineAddSubImmediate(ptrdiff_t offset,
+                                              const InstructionInfo& first) {
+  if (first.sets_flags) return 0;
+  ptrdiff_t next = GetNextInBlock(offset);
+  if (next < 0) return 0;
+  InstructionInfo second = Analyse(next);
+  if ((second.kind != kAddSubImmediate) || second.sets_flags ||
+      (second.is_64_bit != first.is_64_bit) || (second.rn != first.rd) ||
+      (second.rd != first.rd)) {
+    return 0;
+  }
+
+  int64_t total = (first.op == SUB) ? -static_cast<int64_t>(first.imm)
+                                    : static_cast<int64_t>(first.imm);
+  total += (second.op == SUB) ? -static_cast<int64_t>(second.imm)
+                              : static_cast<int64_t>(second.imm);
+  Instr op = (total < 0) ? SUB : ADD;
+  uint64_t imm = static_cast<uint64_t>((total < 0) ? -total : total);
+  if (!Assembler::IsImmAddSub(imm)) return 0;
+
+  Instr sf = first.is_64_bit ? static_cast<Instr>(SixtyFourBits) : 0;
+  GetInstructionAt(offset)->SetInstructionBits(
+      AddSubImmediateFixed | sf | op | Assembler::ImmAddSub(imm) |
+      (first.rn << Rn_offset) | (first.rd << Rd_offset));
+  SetNop(next);
+  return 1;
+}
+
+
+int PeepholeOptimiser::FoldMoveImmediate(ptrdiff_t offset,
+                                         const InstructionInfo& move) {
+  int code = move.rd;
+  // Register 31 is the stack pointer for `orr` (immediate), and the zero
+  // register for `movz` and `movn`.
+  if (code == static_cast<int>(kZeroRegCode)) return 0;
+
+  ptrdiff_t next = GetNextInBlock(offset);
+  if (next < 0) return 0;
+  InstructionInfo use = Analyse(next);
+  if ((use.kind != kAddSubRegister) && (use.kind != kLogicalRegister)) return 0;
+  if ((use.rm != code) || (use.rn == code)) return 0;
+  // In the immediate forms, register 31 means the stack pointer rather than
+  // the zero register, except as the destination of flag-setting forms.
+  if (use.rn == kZeroRegCode) return 0;
+  if ((use.rd == kZeroRegCode) && !use.sets_flags) return 0;
+  if ((use.rd != code) && !IsDeadAfter(code, next)) return 0;
+
+  unsigned reg_size = use.is_64_bit ? kXRegSize : kWRegSize;
+  uint64_t value = use.is_64_bit ? move.imm : (move.imm & kWRegMask);
+  Instr sf = use.is_64_bit ? static_cast<Instr>(SixtyFourBits) : 0;
+  Instr registers = (use.rn << Rn_offset) | (use.rd << Rd_offset);
+  Instr bits;
+  if (use.kind == kAddSubRegister) {
+    Instr op = use.op;
+    if (!Assembler::IsImmAddSub(value)) {
+      // Try the opposite operation, unless the flags would differ.
+      if (use.sets_flags) return 0;
+      value = -value;
+      if (!use.is_64_bit) value &= kWRegMask;
+      if (!Assembler::IsImmAddSub(value)) return 0;
+      op = (op == ADD) ? SUB : ADD;
+    }
+    bits = AddSubImmediateFixed | sf | op | Assembler::ImmAddSub(value);
+    if (use.sets_flags) bits |= AddSubSetFlagsBit;
+  } else {
+    unsigned n, imm_s, imm_r;
+    if (!Assembler::IsImmLogical(value, reg_size, &n, &imm_s, &imm_r)) {
+      return 0;
+    }
+    bits = LogicalImmediateFixed | sf | use.op |
+           Assembler::BitN(n, reg_size) |
+           Assembler::ImmSetBits(imm_s, reg_size) |
+           Assembler::ImmRotate(imm_r, reg_size);
+  }
+  GetInstructionAt(next)->SetInstructionBits(bits | registers);
+  SetNop(offset);
+  return 1;
+}
+
+
+void PeepholeOptimiser::SetNop(ptrdiff_t offset) {
+  GetInstructionAt(offset)->SetInstructionBits(kNopInstruction);
+}
+
+
+void PeepholeOptimiser::VisitAddSubImmediate(const Instruction* instr) {
+  info_.kind = kAddSubImmediate;
+  info_.is_64_bit = instr->GetSixtyFourBits() != 0;
+  info_.sets_flags = instr->GetFlagsUpdate() != 0;
+  info_.op = instr->Mask(AddSubOpMask) & ~AddSubSetFlagsBit;
+  info_.rd = instr->GetRd();
+  info_.rn = instr->GetRn();
+  info_.imm = static_cast<uint64_t>(instr->GetImmAddSub())
+              << (12 * instr->GetImmAddSubShift());
+}
+
+
+void PeepholeOptimiser::VisitAddSubShifted(const Instruction* instr) {
+  if ((instr->GetShiftDP() != LSL) || (instr->GetImmDPShift() != 0)) return;
+  info_.kind = kAddSubRegister;
+  info_.is_64_bit = instr->GetSixtyFourBits() != 0;
+  info_.sets_flags = instr->GetFlagsUpdate() != 0;
+  info_.op = instr->Mask(AddSubOpMask) & ~AddSubSetFlagsBit;
+  info_.rd = instr->GetRd();
+  info_.rn = instr->GetRn();
+  info_.rm = instr->GetRm();
+}
+
+
+void PeepholeOptimiser::VisitLogicalImmediate(const Instruction* instr) {
+  // Only `mov` (`orr` from the zero register) is of interest.
+  if ((instr->Mask(LogicalOpMask & ~NOT) != ORR) ||
+      (instr->GetRn() != kZeroRegCode)) {
+    return;
+  }
+  info_.kind = kMoveImmediate;
+  info_.rd = instr->GetRd();
+  info_.imm = instr->GetImmLogical();
+}
+
+
+void PeepholeOptimiser::VisitLogicalShifted(const Instruction* instr) {
+  if ((instr->Mask(NOT) != 0) || (instr->GetShiftDP() != LSL) ||
+      (instr->GetImmDPShift() != 0)) {
+    return;
+  }
+  info_.kind = kLogicalRegister;
+  info_.is_64_bit = instr->GetSixtyFourBits() != 0;
+  info_.op = instr->Mask(LogicalOpMask);
+  info_.sets_flags = info_.op == ANDS;
+  info_.rd = instr->GetRd();
+  info_.rn = instr->GetRn();
+  info_.rm = instr->GetRm();
+}
+
+
+void PeepholeOptimiser::VisitMoveWideImmediate(const Instruction* instr) {
+  uint64_t imm = static_cast<uint64_t>(instr->GetImmMoveWide())
+                 << (16 * instr->GetShiftMoveWide());
+  switch (instr->Mask(MoveWideImmediateMask)) {
+    case MOVZ_w:
+    case MOVZ_x:
+      break;
+    case MOVN_w:
+      imm = ~imm & kWRegMask;
+      break;
+    case MOVN_x:
+      imm = ~imm;
+      break;
+    default:
+      // `movk` depends on the previous value.
+      return;
+  }
+  info_.kind = kMoveImmediate;
+  info_.rd = instr->GetRd();
+  info_.imm = imm;
+}
+
+
+void PeepholeOptimiser::VisitSystem(const Instruction* instr) {
+  if (instr->GetInstructionBits() == kNopInstruction) {
+    info_.kind = kNop;
+  } else if (instr->IsBti()) {
+    // BTI marks a branch target.
+    info_.kind = kBlockEnd;
+  }
+}
+
+
+#define DEFINE_BLOCK_END_VISITOR(A)                            \
+  void PeepholeOptimiser::Visit##A(const Instruction* instr) { \
+    USE(instr);                                                \
+    info_.kind = kBlockEnd;                                    \
+  }
+VIXL_PEEPHOLE_BLOCK_END_VISITOR_LIST(DEFINE_BLOCK_END_VISITOR)
+#undef DEFINE_BLOCK_END_VISITOR
+
+}  // namespace aarch64
+}  // namespace vixl
@@ -0,0 +1,251 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_PEEPHOLE_AARCH64_H_
+#define VIXL_AARCH64_PEEPHOLE_AARCH64_H_
+
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "decoder-aarch64.h"
+#include "operands-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class Label;
+class MacroAssembler;
+
+// Instructions that can change control flow, or that hold data for the
+// simulator, and so end a basic block.
+#define VIXL_PEEPHOLE_BLOCK_END_VISITOR_LIST(V) \
+  V(CompareBranch)                              \
+  V(ConditionalBranch)                          \
+  V(Exception)                                  \
+  V(MorelloBranch)                              \
+  V(MorelloBranchBx)                            \
+  V(MorelloBranchRestricted)                    \
+  V(MorelloBranchSealedDirect)                  \
+  V(MorelloBranchSealedIndirect)                \
+  V(MorelloBranchToSealed)                      \
+  V(MorelloLoadPairAndBranch)                   \
+  V(Reserved)                                   \
+  V(TestBranch)                                 \
+  V(Unallocated)                                \
+  V(UnconditionalBranch)                        \
+  V(UnconditionalBranchToRegister)              \
+  V(Unimplemented)
+
+// The layout of a region of finished code: which words hold instructions
+// (rather than literal pool data or the payloads of simulator
+// pseudo-instructions), and which instructions may be reached from somewhere
+// other than the preceding instruction.
+//
+// Targets of immediate branches and `adr` anywhere in the buffer are found
+// automatically; others must be added with `AddBranchTarget`.
+class CodeRegion {
+ public:
+  explicit CodeRegion(MacroAssembler* masm)
+      : masm_(masm), start_(0), end_(0) {}
+
+  void AddBranchTarget(ptrdiff_t offset) { extra_targets_.push_back(offset); }
+  void AddBranchTarget(const Label* label);
+
+  // Scan the buffer to find the layout of the code between `start` and `end`
+  // (offsets into the buffer).
+  void Scan(ptrdiff_t start, ptrdiff_t end);
+
+  ptrdiff_t GetStart() const { return start_; }
+  ptrdiff_t GetEnd() const { return end_; }
+
+  bool IsBranchTarget(ptrdiff_t offset) const {
+    return is_target_[(offset - start_) / kInstructionSize];
+  }
+  bool IsCode(ptrdiff_t offset) const {
+    return is_code_[(offset - start_) / kInstructionSize];
+  }
+
+  Instruction* GetInstructionAt(ptrdiff_t offset) const;
+
+ private:
+  void MarkBranchTarget(ptrdiff_t offset);
+
+  MacroAssembler* masm_;
+  std::vector<ptrdiff_t> extra_targets_;
+
+  ptrdiff_t start_;
+  ptrdiff_t end_;
+  std::vector<bool> is_target_;
+  std::vector<bool> is_code_;
+};
+
+
+// Remove redundant instructions from finished code, in place.
+//
+// MacroAssembler expansions are emitted one at a time, so consecutive macros
+// often leave sequences that could be simplified. The optimiser recognises a
+// few such sequences using the Decoder, and rewrites them without moving any
+// code. Instructions that are no longer needed become `nop`s, so label
+// locations, pools, literal references and the ISAMap all remain valid.
+//
+// The following sequences are optimised:
+//  - `mov xd, xd` and `add xd, xd, #0` (but not the W forms, which clear the
+//    top half of the register).
+//  - A non-flag-setting `add` or `sub` (immediate) followed by another that
+//    updates the same register: `add x0, x1, #1; add x0, x0, #2` becomes
+//    `add x0, x1, #3`.
+//  - A single-instruction immediate move into a register that is then used in
+//    place of an immediate, and is dead afterwards: `mov x16, #42;
+//    add x0, x1, x16` becomes `add x0, x1, #42`. This is the typical output of
+//    macros that use a scratch register.
+//
+// Sequences are never optimised across a branch target. Targets of immediate
+// branches and `adr` anywhere in the buffer are found automatically; other
+// targets, such as the entry points of functions or code reached through
+// computed branches, must be added with `AddBranchTarget`.
+//
+// Registers are only considered dead if they are overwritten before being read
+// in the same basic block. Registers that are known never to be live across a
+// branch or branch target, such as the scratch registers of code that never
+// keeps values in them across branches, can be passed to
+// `SetBlockLocalRegisters` to allow more optimisations.
+//
+// Data must be marked as such in the ISAMap (as the literal pool does), and
+// simulator pseudo-instructions are recognised, so that their payloads are
+// not mistaken for instructions. The code must not have been made executable
+// yet (or must have been made writable again).
+//
+// Typical usage:
+//
+//   masm.FinalizeCode();
+//   PeepholeOptimiser peephole(&masm);
+//   peephole.AddBranchTarget(&entry);
+//   peephole.Optimise();
+class PeepholeOptimiser : public DecoderVisitorWithDefaults {
+ public:
+  explicit PeepholeOptimiser(MacroAssembler* masm);
+
+  // Declare that the code at `offset` (or `label`) may be reached from
+  // somewhere other than the preceding instruction.
+  void AddBranchTarget(ptrdiff_t offset) { region_.AddBranchTarget(offset); }
+  void AddBranchTarget(const Label* label) { region_.AddBranchTarget(label); }
+
+  // Declare registers that are dead at every branch and branch target.
+  void SetBlockLocalRegisters(const CPURegList& registers) {
+    VIXL_ASSERT(registers.GetType() == CPURegister::kRegister);
+    block_local_registers_ = registers.GetList();
+  }
+
+  // Optimise the code between `start` and `end` (offsets into the buffer), or
+  // the whole buffer. Return the number of instructions that were replaced
+  // with `nop`.
+  int Optimise(ptrdiff_t start, ptrdiff_t end);
+  int Optimise();
+
+  // Decoder visitors, used to classify instructions.
+  virtual void VisitAddSubImmediate(const Instruction* instr) VIXL_OVERRIDE;
+  virtual void VisitAddSubShifted(const Instruction* instr) VIXL_OVERRIDE;
+  virtual void VisitLogicalImmediate(const Instruction* instr) VIXL_OVERRIDE;
+  virtual void VisitLogicalShifted(const Instruction* instr) VIXL_OVERRIDE;
+  virtual void VisitMoveWideImmediate(const Instruction* instr) VIXL_OVERRIDE;
+  virtual void VisitSystem(const Instruction* instr) VIXL_OVERRIDE;
+
+#define DECLARE(A) virtual void Visit##A(const Instruction* instr) VIXL_OVERRIDE;
+  VIXL_PEEPHOLE_BLOCK_END_VISITOR_LIST(DECLARE)
+#undef DECLARE
+
+ private:
+  enum InstructionKind {
+    kOther,
+    kNop,
+    // Control flow, or anything that might be.
+    kBlockEnd,
+    // `add`, `sub`, `adds` or `subs` with an immediate.
+    kAddSubImmediate,
+    // As above, with an unshifted register as the second operand.
+    kAddSubRegister,
+    // `and`, `orr`, `eor` or `ands` with an unshifted register.
+    kLogicalRegister,
+    // `movz`, `movn` or `orr` (immediate) from the zero register.
+    kMoveImmediate
+  };
+
+  struct InstructionInfo {
+    InstructionKind kind;
+    bool is_64_bit;
+    bool sets_flags;
+    // For add/sub and logical instructions, the operation, masked with
+    // `AddSubOpMask` or `LogicalOpMask`.
+    Instr op;
+    int rd;
+    int rn;
+    int rm;
+    // The immediate operand. For `kMoveImmediate`, this is the value written to
+    // the whole X register.
+    uint64_t imm;
+  };
+
+  Instruction* GetInstructionAt(ptrdiff_t offset) const {
+    return region_.GetInstructionAt(offset);
+  }
+  InstructionInfo Analyse(ptrdiff_t offset);
+
+  bool IsBranchTarget(ptrdiff_t offset) const {
+    return region_.IsBranchTarget(offset);
+  }
+  bool IsCode(ptrdiff_t offset) const { return region_.IsCode(offset); }
+
+  // Return the offset of the next instruction that isn't a `nop`, if it is in
+  // the same basic block as the instruction at `offset`, or -1.
+  ptrdiff_t GetNextInBlock(ptrdiff_t offset) const;
+  // Return true if register `code` is dead after the instruction at `offset`.
+  bool IsDeadAfter(int code, ptrdiff_t offset);
+
+  // Try to optimise the sequence starting at `offset`. Each function returns
+  // the number of instructions that were replaced with `nop`.
+  int OptimiseAt(ptrdiff_t offset);
+  int CombineAddSubImmediate(ptrdiff_t offset, const InstructionInfo& first);
+  int FoldMoveImmediate(ptrdiff_t offset, const InstructionInfo& move);
+
+  void SetNop(ptrdiff_t offset);
+
+  MacroAssembler* masm_;
+  Decoder decoder_;
+
+  // The instruction being analysed.
+  InstructionInfo info_;
+
+  RegList block_local_registers_;
+
+  // The region being optimised.
+  CodeRegion region_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_PEEPHOLE_AARCH64_H_
@@ -109,21 +109,99 @@ static uint64_t BigShuffle(uint64_t in_data) {
   return out_data;
 }
 
+// The shuffles are linear (over XOR), so they can be applied to a whole
+// 64-bit value by looking up each byte in a table of its contribution to the
+// result. Adjacent shuffles are combined into a single table, and nibble
+// substitution is done a byte at a time.
+class PACTables {
+ public:
+  PACTables() {
+    for (int i = 0; i < 8; i++) {
+      for (uint64_t value = 0; value < 256; value++) {
+        uint64_t in_data = value << (8 * i);
+        first_shuffle_[i][value] = ShuffleNibbles(BigShuffle(in_data));
+        second_shuffle_[i][value] = BigShuffle(ShuffleNibbles(in_data));
+        third_shuffle_[i][value] = BigShuffle(in_data);
+      }
+    }
+    for (uint64_t value = 0; value < 256; value++) {
+      substitute_[value] = static_cast<uint8_t>(SubstituteNibbles(value));
+    }
+  }
+
+  static const PACTables& Get() {
+    static const PACTables tables;
+    return tables;
+  }
+
+  // ShuffleNibbles(BigShuffle(in_data))
+  uint64_t FirstShuffle(uint64_t in_data) const {
+    return Apply(first_shuffle_, in_data);
+  }
+
+  // BigShuffle(ShuffleNibbles(in_data))
+  uint64_t SecondShuffle(uint64_t in_data) const {
+    return Apply(second_shuffle_, in_data);
+  }
+
+  // BigShuffle(in_data)
+  uint64_t ThirdShuffle(uint64_t in_data) const {
+    return Apply(third_shuffle_, in_data);
+  }
+
+  // SubstituteNibbles(in_data)
+  uint64_t Substitute(uint64_t in_data) const {
+    uint64_t out_data = 0;
+    for (int i = 0; i < 8; i++) {
+      uint64_t byte = (in_data >> (8 * i)) & 0xff;
+      out_data |= static_cast<uint64_t>(substitute_[byte]) << (8 * i);
+    }
+    return out_data;
+  }
+
+ private:
+  static uint64_t Apply(const uint64_t (&table)[8][256], uint64_t in_data) {
+    uint64_t out_data = 0;
+    for (int i = 0; i < 8; i++) {
+      out_data ^= table[i][(in_data >> (8 * i)) & 0xff];
+    }
+    return out_data;
+  }
+
+  uint64_t first_shuffle_[8][256];
+  uint64_t second_shuffle_[8][256];
+  uint64_t third_shuffle_[8][256];
+  uint8_t substitute_[256];
+};
+
 // A simple, non-standard hash function invented for simulating. It mixes
 // reasonably well, however it is unlikely to be cryptographically secure and
 // may have a higher collision chance than other hashing algorithms.
 uint64_t Simulator::ComputePAC(uint64_t data, uint64_t context, PACKey key) {
+  uint64_t hash = (data ^ (context * UINT64_C(0x9e3779b97f4a7c15)) ^ key.low) *
+                  UINT64_C(0x9e3779b97f4a7c15);
+  PACCacheEntry* entry = &pac_cache_[hash >> (64 - kPACCacheSizeLog2)];
+  if (entry->valid && (entry->data == data) && (entry->context == context) &&
+      (entry->key_high == key.high) && (entry->key_low == key.low)) {
+    return entry->pac;
+  }
+
+  const PACTables& tables = PACTables::Get();
   uint64_t working_value = data ^ key.high;
-  working_value = BigShuffle(working_value);
-  working_value = ShuffleNibbles(working_value);
+  working_value = tables.FirstShuffle(working_value);
   working_value ^= key.low;
-  working_value = ShuffleNibbles(working_value);
-  working_value = BigShuffle(working_value);
+  working_value = tables.SecondShuffle(working_value);
   working_value ^= context;
-  working_value = SubstituteNibbles(working_value);
-  working_value = BigShuffle(working_value);
-  working_value = SubstituteNibbles(working_value);
+  working_value = tables.Substitute(working_value);
+  working_value = tables.ThirdShuffle(working_value);
+  working_value = tables.Substitute(working_value);
 
+  entry->data = data;
+  entry->context = context;
+  entry->key_high = key.high;
+  entry->key_low = key.low;
+  entry->pac = working_value;
+  entry->valid = true;
   return working_value;
 }
 
@@ -0,0 +1,864 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "register-allocator-aarch64.h"
+
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+#include "macro-assembler-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+// Registers that are never allocated:
+//  - x16 and x17 (and v31), the MacroAssembler's scratch registers, so that
+//    emitters can use macros that need them.
+//  - x18, the platform register.
+//  - x29 and x30, the frame pointer and link register.
+static const RegList kAllocatableX =
+    CPURegList(CPURegister::kRegister, kXRegSize, 0, 15).GetList() |
+    CPURegList(CPURegister::kRegister, kXRegSize, 19, 28).GetList();
+static const RegList kAllocatableV =
+    CPURegList(CPURegister::kVRegister, kQRegSize, 0, 30).GetList();
+
+// Registers used to reload spilled values, when anything is spilled. These
+// limit the number of spilled operands of each operation.
+static const RegList kTempsX =
+    CPURegList(CPURegister::kRegister, kXRegSize, 13, 15).GetList();
+static const RegList kTempsV =
+    CPURegList(CPURegister::kVRegister, kQRegSize, 28, 30).GetList();
+
+static const RegList kCalleeSavedX =
+    CPURegList(CPURegister::kRegister, kXRegSize, 19, 28).GetList();
+
+// Each operation has two positions: uses are read at the first, and results
+// are written at the second.
+static int GetInputPosition(int op) { return 2 * op; }
+static int GetOutputPosition(int op) { return (2 * op) + 1; }
+// Parameters are written before the first operation.
+static const int kEntryPosition = -1;
+
+
+int RegisterAllocator::Allocation::GetCode(
+    VirtualRegister reg, VirtualRegister::RegisterClass cls) const {
+  USE(cls);
+  VIXL_ASSERT(reg.GetClass() == cls);
+  VIXL_ASSERT(reg.GetIndex() < static_cast<int>(codes_.size()));
+  int code = codes_[reg.GetIndex()];
+  VIXL_ASSERT(code >= 0);
+  return code;
+}
+
+
+RegisterAllocator::RegisterAllocator(MacroAssembler* masm)
+    : masm_(masm),
+      used_callee_saved_(0),
+      needs_frame_(false),
+      frame_size_(0),
+      spilled_count_(0),
+      coalesced_count_(0) {}
+
+
+VirtualRegister RegisterAllocator::NewRegister(
+    VirtualRegister::RegisterClass cls) {
+  VIXL_ASSERT(cls != VirtualRegister::kInvalid);
+  classes_.push_back(cls);
+  return VirtualRegister(static_cast<int>(classes_.size()) - 1, cls);
+}
+
+
+RegisterAllocator::Operation* RegisterAllocator::AddOperation(
+    OperationKind kind) {
+  Operation op;
+  op.kind = kind;
+  op.label = NULL;
+  op.falls_through = true;
+  operations_.push_back(op);
+  return &operations_.back();
+}
+
+
+void RegisterAllocator::AddOperands(
+    std::vector<int>* list, std::initializer_list<VirtualRegister> regs) {
+  for (std::initializer_list<VirtualRegister>::const_iterator it = regs.begin();
+       it != regs.end();
+       ++it) {
+    VIXL_ASSERT(it->IsValid());
+    VIXL_ASSERT(it->GetIndex() < static_cast<int>(classes_.size()));
+    if (std::find(list->begin(), list->end(), it->GetIndex()) == list->end()) {
+      list->push_back(it->GetIndex());
+    }
+  }
+}
+
+
+void RegisterAllocator::Emit(std::initializer_list<VirtualRegister> defs,
+                             std::initializer_list<VirtualRegister> uses,
+                             const Emitter& emitter) {
+  Operation* op = AddOperation(kInstruction);
+  AddOperands(&op->defs, defs);
+  AddOperands(&op->uses, uses);
+  op->emitter = emitter;
+}
+
+
+void RegisterAllocator::Mov(VirtualRegister dst, VirtualRegister src) {
+  VIXL_ASSERT(dst.GetClass() == src.GetClass());
+  Operation* op = AddOperation(kCopy);
+  AddOperands(&op->defs, {dst});
+  AddOperands(&op->uses, {src});
+}
+
+
+void RegisterAllocator::Bind(Label* label) {
+  Operation* op = AddOperation(kBind);
+  op->label = label;
+}
+
+
+void RegisterAllocator::B(Label* label) {
+  Operation* op = AddOperation(kBranch);
+  op->label = label;
+  op->falls_through = false;
+  op->emitter = [label](MacroAssembler* masm, const Allocation& allocation) {
+    USE(allocation);
+    masm->B(label);
+  };
+}
+
+
+void RegisterAllocator::B(Label* label, Condition cond) {
+  Branch(label, {}, [label, cond](MacroAssembler* masm,
+                                  const Allocation& allocation) {
+    USE(allocation);
+    masm->B(label, cond);
+  });
+}
+
+
+void RegisterAllocator::Branch(Label* label,
+                               std::initializer_list<VirtualRegister> uses,
+                               const Emitter& emitter) {
+  Operation* op = AddOperation(kBranch);
+  AddOperands(&op->uses, uses);
+  op->label = label;
+  op->emitter = emitter;
+}
+
+
+void RegisterAllocator::Call(Label* target,
+                             std::initializer_list<VirtualRegister> arguments,
+                             VirtualRegister result) {
+  Operation* op = AddOperation(kCall);
+  op->label = target;
+  // Arguments are kept in order, and may be repeated.
+  for (std::initializer_list<VirtualRegister>::const_iterator it =
+           arguments.begin();
+       it != arguments.end();
+       ++it) {
+    VIXL_ASSERT((it->GetClass() == VirtualRegister::kX) ||
+                (it->GetClass() == VirtualRegister::kV));
+    op->uses.push_back(it->GetIndex());
+  }
+  if (result.IsValid()) {
+    VIXL_ASSERT(result.GetClass() != VirtualRegister::kZ);
+    op->defs.push_back(result.GetIndex());
+  }
+}
+
+
+void RegisterAllocator::Return() {
+  Operation* op = AddOperation(kReturn);
+  op->falls_through = false;
+}
+
+
+void RegisterAllocator::Return(VirtualRegister value) {
+  VIXL_ASSERT(value.GetClass() != VirtualRegister::kZ);
+  Operation* op = AddOperation(kReturn);
+  op->falls_through = false;
+  op->uses.push_back(value.GetIndex());
+}
+
+
+void RegisterAllocator::AddHint(int vreg, int code, int other_vreg) {
+  Interval* interval = &intervals_[vreg];
+  if ((interval->hint_code < 0) && (interval->hint_vreg < 0)) {
+    interval->hint_code = code;
+    interval->hint_vreg = other_vreg;
+  }
+}
+
+
+void RegisterAllocator::BuildIntervals() {
+  int vreg_count = static_cast<int>(classes_.size());
+  int op_count = static_cast<int>(operations_.size());
+
+  // Split the operations into basic blocks. Each block is described by the
+  // index of its first operation; the last block ends with the function.
+  std::vector<int> block_starts;
+  std::unordered_map<const Label*, int> label_blocks;
+  for (int i = 0; i < op_count; i++) {
+    const Operation& op = operations_[i];
+    bool starts_block = (i == 0) || (op.kind == kBind) ||
+                        (operations_[i - 1].kind == kBranch) ||
+                        (operations_[i - 1].kind == kReturn);
+    if (starts_block) block_starts.push_back(i);
+    if (op.kind == kBind) {
+      VIXL_ASSERT(label_blocks.count(op.label) == 0);
+      label_blocks[op.label] = static_cast<int>(block_starts.size()) - 1;
+    }
+  }
+  int block_count = static_cast<int>(block_starts.size());
+  block_starts.push_back(op_count);
+
+  // Compute the registers that each block reads before writing them, and
+  // those that it writes.
+  std::vector<std::vector<bool> > gen(block_count,
+                                      std::vector<bool>(vreg_count, false));
+  std::vector<std::vector<bool> > kill(block_count,
+                                       std::vector<bool>(vreg_count, false));
+  std::vector<std::vector<int> > successors(block_count);
+  for (int b = 0; b < block_count; b++) {
+    for (int i = block_starts[b]; i < block_starts[b + 1]; i++) {
+      const Operation& op = operations_[i];
+      for (size_t u = 0; u < op.uses.size(); u++) {
+        if (!kill[b][op.uses[u]]) gen[b][op.uses[u]] = true;
+      }
+      for (size_t d = 0; d < op.defs.size(); d++) {
+        kill[b][op.defs[d]] = true;
+      }
+    }
+    const Operation& last = operations_[block_starts[b + 1] - 1];
+    if (last.kind == kBranch) {
+      VIXL_ASSERT(label_blocks.count(last.label) != 0);
+      successors[b].push_back(label_blocks[last.label]);
+    }
+    if (last.falls_through && (b + 1 < block_count)) {
+      successors[b].push_back(b + 1);
+    }
+  }
+
+  // Iterate to a fixed point, visiting blocks backwards since liveness flows
+  // backwards.
+  std::vector<std::vector<bool> > live_in(block_count,
+                                          std::vector<bool>(vreg_count, false));
+  std::vector<std::vector<bool> > live_out(block_count,
+                                           std::vector<bool>(vreg_count,
+                                                             false));
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int b = block_count - 1; b >= 0; b--) {
+      for (size_t s = 0; s < successors[b].size(); s++) {
+        const std::vector<bool>& in = live_in[successors[b][s]];
+        for (int v = 0; v < vreg_count; v++) {
+          if (in[v]) live_out[b][v] = true;
+        }
+      }
+      for (int v = 0; v < vreg_count; v++) {
+        bool in = gen[b][v] || (live_out[b][v] && !kill[b][v]);
+        if (in && !live_in[b][v]) {
+          live_in[b][v] = true;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Each register has a single interval, from the first position where it is
+  // live to the last.
+  intervals_.clear();
+  for (int v = 0; v < vreg_count; v++) {
+    Interval interval = {v, INT_MAX, INT_MIN, false, -1, -1};
+    intervals_.push_back(interval);
+  }
+  for (int b = 0; b < block_count; b++) {
+    int first = block_starts[b];
+    int end = block_starts[b + 1];
+    for (int v = 0; v < vreg_count; v++) {
+      Interval* interval = &intervals_[v];
+      if (live_in[b][v]) {
+        interval->start = std::min(interval->start, GetInputPosition(first));
+      }
+      if (live_out[b][v]) {
+        interval->end = std::max(interval->end, GetInputPosition(end));
+      }
+    }
+    for (int i = first; i < end; i++) {
+      const Operation& op = operations_[i];
+      // Copies, calls and returns consume their inputs before writing any
+      // results. Other operations might write a result before reading all of
+      // their inputs.
+      bool consumes_inputs =
+          (op.kind == kCopy) || (op.kind == kCall) || (op.kind == kReturn);
+      int use_position =
+          consumes_inputs ? GetInputPosition(i) : GetOutputPosition(i);
+      for (size_t u = 0; u < op.uses.size(); u++) {
+        Interval* interval = &intervals_[op.uses[u]];
+        interval->start = std::min(interval->start, GetInputPosition(i));
+        interval->end = std::max(interval->end, use_position);
+      }
+      for (size_t d = 0; d < op.defs.size(); d++) {
+        Interval* interval = &intervals_[op.defs[d]];
+        interval->start = std::min(interval->start, GetOutputPosition(i));
+        interval->end = std::max(interval->end, GetOutputPosition(i));
+      }
+    }
+  }
+  for (size_t p = 0; p < parameters_.size(); p++) {
+    Interval* interval = &intervals_[parameters_[p].reg.GetIndex()];
+    interval->start = kEntryPosition;
+    interval->end = std::max(interval->end, kEntryPosition);
+  }
+
+  // Find the registers that are live across calls, and the hints.
+  for (size_t p = 0; p < parameters_.size(); p++) {
+    const GenericOperand& location = parameters_[p].location;
+    if (location.IsCPURegister()) {
+      AddHint(parameters_[p].reg.GetIndex(),
+              location.GetCPURegister().GetCode(),
+              -1);
+    }
+  }
+  call_positions_.clear();
+  for (int i = 0; i < op_count; i++) {
+    const Operation& op = operations_[i];
+    if (op.kind == kCopy) {
+      AddHint(op.defs[0], -1, op.uses[0]);
+      AddHint(op.uses[0], -1, op.defs[0]);
+    } else if (op.kind == kCall) {
+      call_positions_.push_back(i);
+      ABI abi;
+      for (size_t u = 0; u < op.uses.size(); u++) {
+        bool is_x = (classes_[op.uses[u]] == VirtualRegister::kX);
+        GenericOperand location =
+            is_x ? abi.GetNextParameterGenericOperand<int64_t>()
+                 : abi.GetNextParameterGenericOperand<double>();
+        VIXL_ASSERT(location.IsCPURegister());
+        AddHint(op.uses[u], location.GetCPURegister().GetCode(), -1);
+      }
+      if (!op.defs.empty()) AddHint(op.defs[0], 0, -1);
+    } else if ((op.kind == kReturn) && !op.uses.empty()) {
+      AddHint(op.uses[0], 0, -1);
+    }
+  }
+  for (int v = 0; v < vreg_count; v++) {
+    Interval* interval = &intervals_[v];
+    for (size_t c = 0; c < call_positions_.size(); c++) {
+      int call = call_positions_[c];
+      if ((interval->start < GetInputPosition(call)) &&
+          (interval->end > GetOutputPosition(call))) {
+        interval->crosses_call = true;
+        break;
+      }
+    }
+  }
+}
+
+
+RegList RegisterAllocator::GetAllocatableRegisters(Bank bank,
+                                                   bool reserve_temps) const {
+  RegList allocatable = (bank == kGeneralBank) ? kAllocatableX : kAllocatableV;
+  if (reserve_temps) allocatable &= ~GetTemps(bank);
+  return allocatable;
+}
+
+
+RegList RegisterAllocator::GetTemps(Bank bank) const {
+  return (bank == kGeneralBank) ? kTempsX : kTempsV;
+}
+
+
+int RegisterAllocator::AllocateRegisters(bool reserve_temps) {
+  int vreg_count = static_cast<int>(classes_.size());
+  codes_.assign(vreg_count, -1);
+
+  // Registers that are never used have no interval.
+  std::vector<int> order;
+  for (int v = 0; v < vreg_count; v++) {
+    if (intervals_[v].start <= intervals_[v].end) order.push_back(v);
+  }
+  std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+    return intervals_[a].start < intervals_[b].start;
+  });
+
+  RegList free[kNumberOfBanks] = {
+      GetAllocatableRegisters(kGeneralBank, reserve_temps),
+      GetAllocatableRegisters(kVectorBank, reserve_temps)};
+  std::vector<int> active;
+  int spilled = 0;
+
+  for (size_t o = 0; o < order.size(); o++) {
+    const Interval& current = intervals_[order[o]];
+    int vreg = current.vreg;
+    Bank bank = GetBank(vreg);
+    bool is_z = (classes_[vreg] == VirtualRegister::kZ);
+
+    // Release the registers of intervals that have ended.
+    for (size_t a = 0; a < active.size();) {
+      const Interval& other = intervals_[active[a]];
+      if (other.end < current.start) {
+        free[GetBank(other.vreg)] |= UINT64_C(1) << codes_[other.vreg];
+        active.erase(active.begin() + a);
+      } else {
+        a++;
+      }
+    }
+
+    // Only X registers can be preserved across calls.
+    RegList allowed = GetAllocatableRegisters(bank, reserve_temps);
+    if (current.crosses_call) {
+      if (is_z) {
+        VIXL_ABORT_WITH_MSG("Z registers cannot be live across calls.\n");
+      }
+      allowed &= (bank == kGeneralBank) ? kCalleeSavedX : 0;
+    }
+
+    int code = -1;
+    RegList available = free[bank] & allowed;
+    if (available != 0) {
+      int hint = current.hint_code;
+      if ((hint < 0) && (current.hint_vreg >= 0)) {
+        hint = codes_[current.hint_vreg];
+      }
+      if ((hint >= 0) && ((available & (UINT64_C(1) << hint)) != 0)) {
+        code = hint;
+      } else {
+        code = CountTrailingZeros(available);
+      }
+    } else {
+      // Spill whichever of the active intervals (that could give up a
+      // suitable register) and the current one ends last. Z registers are
+      // never spilled.
+      int victim = -1;
+      for (size_t a = 0; a < active.size(); a++) {
+        const Interval& other = intervals_[active[a]];
+        if (GetBank(other.vreg) != bank) continue;
+        if (classes_[other.vreg] == VirtualRegister::kZ) continue;
+        if ((allowed & (UINT64_C(1) << codes_[other.vreg])) == 0) continue;
+        if ((victim < 0) || (other.end > intervals_[active[victim]].end)) {
+          victim = static_cast<int>(a);
+        }
+      }
+      bool spill_victim =
+          (victim >= 0) &&
+          (is_z || (intervals_[active[victim]].end > current.end));
+      if (spill_victim) {
+        int other = active[victim];
+        code = codes_[other];
+        codes_[other] = -1;
+        active.erase(active.begin() + victim);
+        spilled++;
+      } else if (is_z) {
+        VIXL_ABORT_WITH_MSG("Too many Z registers are live at once.\n");
+      } else {
+        spilled++;
+        continue;
+      }
+    }
+
+    codes_[vreg] = code;
+    free[bank] &= ~(UINT64_C(1) << code);
+    active.push_back(vreg);
+  }
+  return spilled;
+}
+
+
+void RegisterAllocator::Generate() {
+  VIXL_ASSERT(!operations_.empty());
+  BuildIntervals();
+  // Try not to reserve registers for reloading spilled values, since they are
+  // only needed if something is spilled.
+  spilled_count_ = AllocateRegisters(false);
+  if (spilled_count_ > 0) spilled_count_ = AllocateRegisters(true);
+
+  // Lay out the frame: saved callee-saved registers first, then spill slots.
+  used_callee_saved_ = 0;
+  for (size_t v = 0; v < codes_.size(); v++) {
+    if ((GetBank(static_cast<int>(v)) == kGeneralBank) && (codes_[v] >= 0)) {
+      used_callee_saved_ |= (UINT64_C(1) << codes_[v]) & kCalleeSavedX;
+    }
+  }
+  int offset = CountSetBits(used_callee_saved_) * kXRegSizeInBytes;
+  slots_.assign(codes_.size(), -1);
+  for (size_t v = 0; v < codes_.size(); v++) {
+    if ((codes_[v] >= 0) || (intervals_[v].start > intervals_[v].end)) {
+      continue;
+    }
+    int size = (GetBank(static_cast<int>(v)) == kGeneralBank)
+                   ? kXRegSizeInBytes
+                   : kQRegSizeInBytes;
+    offset = AlignUp(offset, size);
+    slots_[v] = offset;
+    offset += size;
+  }
+  frame_size_ = AlignUp(offset, 16);
+  needs_frame_ = (frame_size_ > 0) || !call_positions_.empty();
+  coalesced_count_ = 0;
+
+  allocation_codes_ = codes_;
+  EmitPrologue();
+  for (size_t i = 0; i < operations_.size(); i++) {
+    EmitOperation(operations_[i]);
+  }
+}
+
+
+CPURegister RegisterAllocator::GetAssignedRegister(VirtualRegister reg) const {
+  VIXL_ASSERT(reg.GetIndex() < static_cast<int>(codes_.size()));
+  int code = codes_[reg.GetIndex()];
+  if (code < 0) return NoCPUReg;
+  return GetRegister(reg.GetIndex(), code);
+}
+
+
+CPURegister RegisterAllocator::GetRegister(int vreg, int code) const {
+  switch (classes_[vreg]) {
+    case VirtualRegister::kX:
+      return XRegister(code);
+    case VirtualRegister::kV:
+      return QRegister(code);
+    case VirtualRegister::kZ:
+      return ZRegister(code);
+    case VirtualRegister::kInvalid:
+      break;
+  }
+  VIXL_UNREACHABLE();
+  return NoCPUReg;
+}
+
+
+MemOperand RegisterAllocator::GetSlot(int vreg) const {
+  VIXL_ASSERT(slots_[vreg] >= 0);
+  return MemOperand(sp, slots_[vreg]);
+}
+
+
+void RegisterAllocator::EmitPrologue() {
+  if (needs_frame_) {
+    masm_->Stp(x29, x30, MemOperand(sp, -16, PreIndex));
+    masm_->Mov(x29, sp);
+    if (frame_size_ > 0) masm_->Sub(sp, sp, frame_size_);
+    CPURegList saved(CPURegister::kRegister, kXRegSize, used_callee_saved_);
+    int offset = 0;
+    while (!saved.IsEmpty()) {
+      CPURegister first = saved.PopLowestIndex();
+      CPURegister second = saved.PopLowestIndex();
+      if (second.IsValid()) {
+        masm_->Stp(first, second, MemOperand(sp, offset));
+        offset += 2 * kXRegSizeInBytes;
+      } else {
+        masm_->Str(first, MemOperand(sp, offset));
+        offset += kXRegSizeInBytes;
+      }
+    }
+  }
+
+  // Move the parameters from where the caller put them.
+  std::vector<Move> moves;
+  for (size_t p = 0; p < parameters_.size(); p++) {
+    int vreg = parameters_[p].reg.GetIndex();
+    if (intervals_[vreg].end <= kEntryPosition) continue;
+    const GenericOperand& location = parameters_[p].location;
+    Move move;
+    move.cls = classes_[vreg];
+    move.dst_code = codes_[vreg];
+    if (move.dst_code < 0) move.dst_mem = GetSlot(vreg);
+    if (location.IsCPURegister()) {
+      move.src_code = location.GetCPURegister().GetCode();
+    } else {
+      // Stack parameters are above the frame record, if there is one.
+      int64_t offset = location.GetMemOperand().GetOffset();
+      move.src_code = -1;
+      move.src_mem = needs_frame_ ? MemOperand(x29, 16 + offset)
+                                  : MemOperand(sp, offset);
+    }
+    moves.push_back(move);
+  }
+  EmitParallelMove(&moves);
+}
+
+
+void RegisterAllocator::EmitEpilogue() {
+  if (!needs_frame_) return;
+  CPURegList saved(CPURegister::kRegister, kXRegSize, used_callee_saved_);
+  int offset = 0;
+  while (!saved.IsEmpty()) {
+    CPURegister first = saved.PopLowestIndex();
+    CPURegister second = saved.PopLowestIndex();
+    if (second.IsValid()) {
+      masm_->Ldp(first, second, MemOperand(sp, offset));
+      offset += 2 * kXRegSizeInBytes;
+    } else {
+      masm_->Ldr(first, MemOperand(sp, offset));
+      offset += kXRegSizeInBytes;
+    }
+  }
+  if (frame_size_ > 0) masm_->Mov(sp, x29);
+  masm_->Ldp(x29, x30, MemOperand(sp, 16, PostIndex));
+}
+
+
+void RegisterAllocator::EmitOperation(const Operation& op) {
+  switch (op.kind) {
+    case kInstruction:
+    case kBranch: {
+      // Reload spilled operands into temporary registers.
+      RegList temps[kNumberOfBanks] = {GetTemps(kGeneralBank),
+                                       GetTemps(kVectorBank)};
+      std::vector<int> reloaded;
+      for (int pass = 0; pass < 2; pass++) {
+        const std::vector<int>& list = (pass == 0) ? op.uses : op.defs;
+        for (size_t i = 0; i < list.size(); i++) {
+          int vreg = list[i];
+          if (allocation_codes_[vreg] >= 0) continue;
+          Bank bank = GetBank(vreg);
+          if (temps[bank] == 0) {
+            VIXL_ABORT_WITH_MSG("Too many spilled operands.\n");
+          }
+          int code = CountTrailingZeros(temps[bank]);
+          temps[bank] &= ~(UINT64_C(1) << code);
+          allocation_codes_[vreg] = code;
+          reloaded.push_back(vreg);
+          if (pass == 0) masm_->Ldr(GetRegister(vreg, code), GetSlot(vreg));
+        }
+      }
+
+      Allocation allocation;
+      allocation.codes_.swap(allocation_codes_);
+      op.emitter(masm_, allocation);
+      allocation_codes_.swap(allocation.codes_);
+
+      for (size_t i = 0; i < reloaded.size(); i++) {
+        int vreg = reloaded[i];
+        if (std::find(op.defs.begin(), op.defs.end(), vreg) != op.defs.end()) {
+          masm_->Str(GetRegister(vreg, allocation_codes_[vreg]),
+                     GetSlot(vreg));
+        }
+        allocation_codes_[vreg] = -1;
+      }
+      break;
+    }
+    case kCopy: {
+      int dst = op.defs[0];
+      int src = op.uses[0];
+      if ((codes_[dst] >= 0) && (codes_[dst] == codes_[src])) {
+        coalesced_count_++;
+        break;
+      }
+      Move move;
+      move.cls = classes_[dst];
+      move.dst_code = codes_[dst];
+      if (move.dst_code < 0) move.dst_mem = GetSlot(dst);
+      move.src_code = codes_[src];
+      if (move.src_code < 0) move.src_mem = GetSlot(src);
+      EmitMove(move);
+      break;
+    }
+    case kBind:
+      masm_->Bind(op.label);
+      break;
+    case kCall: {
+      ABI abi;
+      std::vector<Move> moves;
+      for (size_t u = 0; u < op.uses.size(); u++) {
+        int vreg = op.uses[u];
+        Move move;
+        move.cls = classes_[vreg];
+        GenericOperand location =
+            (move.cls == VirtualRegister::kX)
+                ? abi.GetNextParameterGenericOperand<int64_t>()
+                : abi.GetNextParameterGenericOperand<double>();
+        if (!location.IsCPURegister()) {
+          VIXL_ABORT_WITH_MSG("Too many call arguments.\n");
+        }
+        move.dst_code = location.GetCPURegister().GetCode();
+        move.src_code = codes_[vreg];
+        if (move.src_code < 0) move.src_mem = GetSlot(vreg);
+        if (move.dst_code == move.src_code) {
+          coalesced_count_++;
+        } else {
+          moves.push_back(move);
+        }
+      }
+      EmitParallelMove(&moves);
+      masm_->Bl(op.label);
+      if (!op.defs.empty()) {
+        int vreg = op.defs[0];
+        Move move;
+        move.cls = classes_[vreg];
+        move.src_code = 0;
+        move.dst_code = codes_[vreg];
+        if (move.dst_code < 0) move.dst_mem = GetSlot(vreg);
+        if (move.dst_code == 0) {
+          coalesced_count_++;
+        } else {
+          EmitMove(move);
+        }
+      }
+      break;
+    }
+    case kReturn:
+      if (!op.uses.empty()) {
+        int vreg = op.uses[0];
+        Move move;
+        move.cls = classes_[vreg];
+        move.dst_code = 0;
+        move.src_code = codes_[vreg];
+        if (move.src_code < 0) move.src_mem = GetSlot(vreg);
+        if (move.src_code == 0) {
+          coalesced_count_++;
+        } else {
+          EmitMove(move);
+        }
+      }
+      EmitEpilogue();
+      masm_->Ret();
+      break;
+  }
+}
+
+
+void RegisterAllocator::EmitMove(const Move& move) {
+  // Z registers are never spilled.
+  VIXL_ASSERT((move.cls != VirtualRegister::kZ) ||
+              ((move.dst_code >= 0) && (move.src_code >= 0)));
+  bool is_x = (move.cls == VirtualRegister::kX);
+  if ((move.dst_code >= 0) && (move.src_code >= 0)) {
+    if (move.dst_code == move.src_code) return;
+    switch (move.cls) {
+      case VirtualRegister::kX:
+        masm_->Mov(XRegister(move.dst_code), XRegister(move.src_code));
+        break;
+      case VirtualRegister::kV:
+        masm_->Mov(VRegister(move.dst_code, kFormat16B),
+                   VRegister(move.src_code, kFormat16B));
+        break;
+      case VirtualRegister::kZ:
+        masm_->Mov(ZRegister(move.dst_code, kFormatVnD),
+                   ZRegister(move.src_code, kFormatVnD));
+        break;
+      case VirtualRegister::kInvalid:
+        VIXL_UNREACHABLE();
+        break;
+    }
+  } else if (move.dst_code >= 0) {
+    masm_->Ldr(is_x ? CPURegister(XRegister(move.dst_code))
+                    : CPURegister(QRegister(move.dst_code)),
+               move.src_mem);
+  } else if (move.src_code >= 0) {
+    masm_->Str(is_x ? CPURegister(XRegister(move.src_code))
+                    : CPURegister(QRegister(move.src_code)),
+               move.dst_mem);
+  } else {
+    UseScratchRegisterScope temps(masm_);
+    CPURegister temp = is_x ? CPURegister(temps.AcquireX())
+                            : CPURegister(temps.AcquireVRegisterOfSize(
+                                  kQRegSize));
+    masm_->Ldr(temp, move.src_mem);
+    masm_->Str(temp, move.dst_mem);
+  }
+}
+
+
+void RegisterAllocator::EmitParallelMove(std::vector<Move>* moves) {
+  // Stores only read registers, so do them before any register is
+  // overwritten. Loads only write registers, so do them after every register
+  // has been read.
+  std::vector<Move> loads;
+  std::vector<Move> pending;
+  for (size_t m = 0; m < moves->size(); m++) {
+    const Move& move = (*moves)[m];
+    if (move.dst_code < 0) {
+      EmitMove(move);
+    } else if (move.src_code < 0) {
+      loads.push_back(move);
+    } else if (move.dst_code != move.src_code) {
+      pending.push_back(move);
+    }
+  }
+
+  // Emit register moves whose destination isn't needed by another move. If
+  // there are none, the remaining moves form cycles, so break one by copying
+  // a source to a scratch register. That cycle is then resolved before
+  // another needs breaking, so one scratch register per bank is enough.
+  UseScratchRegisterScope temps(masm_);
+  CPURegister scratch[kNumberOfBanks] = {NoCPUReg, NoCPUReg};
+  while (!pending.empty()) {
+    bool progress = false;
+    for (size_t m = 0; m < pending.size();) {
+      const Move& move = pending[m];
+      bool blocked = false;
+      for (size_t other = 0; other < pending.size(); other++) {
+        if ((other != m) && (pending[other].src_code == move.dst_code) &&
+            (GetBankOfClass(pending[other].cls) ==
+             GetBankOfClass(move.cls))) {
+          blocked = true;
+          break;
+        }
+      }
+      if (blocked) {
+        m++;
+      } else {
+        EmitMove(move);
+        pending.erase(pending.begin() + m);
+        progress = true;
+      }
+    }
+    if (!progress) {
+      const Move& move = pending[0];
+      Bank bank = GetBankOfClass(move.cls);
+      if (!scratch[bank].IsValid()) {
+        scratch[bank] = (bank == kGeneralBank)
+                            ? CPURegister(temps.AcquireX())
+                            : CPURegister(temps.AcquireVRegisterOfSize(
+                                  kQRegSize));
+      }
+      int blocking_code = move.dst_code;
+      Move save = move;
+      save.dst_code = scratch[bank].GetCode();
+      save.src_code = blocking_code;
+      EmitMove(save);
+      for (size_t other = 0; other < pending.size(); other++) {
+        if ((pending[other].src_code == blocking_code) &&
+            (GetBankOfClass(pending[other].cls) == bank)) {
+          pending[other].src_code = scratch[bank].GetCode();
+        }
+      }
+    }
+  }
+
+  for (size_t m = 0; m < loads.size(); m++) {
+    EmitMove(loads[m]);
+  }
+}
+
+}  // namespace aarch64
+}  // namespace vixl
@@ -0,0 +1,340 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_REGISTER_ALLOCATOR_AARCH64_H_
+#define VIXL_AARCH64_REGISTER_ALLOCATOR_AARCH64_H_
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "abi-aarch64.h"
+#include "operands-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class Label;
+class MacroAssembler;
+
+// A register that has not been assigned a physical register yet. Virtual
+// registers are created by a RegisterAllocator, and are only meaningful to
+// that allocator.
+class VirtualRegister {
+ public:
+  enum RegisterClass {
+    kInvalid,
+    // A 64-bit general-purpose register, also usable as a W register.
+    kX,
+    // A 128-bit FP or NEON register, also usable in any narrower form.
+    kV,
+    // An SVE vector register.
+    kZ
+  };
+
+  VirtualRegister() : index_(-1), class_(kInvalid) {}
+
+  int GetIndex() const { return index_; }
+  RegisterClass GetClass() const { return class_; }
+  bool IsValid() const { return class_ != kInvalid; }
+
+ private:
+  VirtualRegister(int index, RegisterClass cls) : index_(index), class_(cls) {}
+
+  int index_;
+  RegisterClass class_;
+
+  friend class RegisterAllocator;
+};
+
+
+// Generate a function whose values are held in virtual registers, using a
+// linear-scan register allocator to assign physical registers.
+//
+// The body of the function is recorded as a sequence of operations, each of
+// which declares the virtual registers that it defines and uses. Most
+// operations are emitted by a callback, which is given the physical register
+// assigned to each of its operands, and can use any MacroAssembler
+// functionality (including its scratch registers). Copies, control flow,
+// calls and returns are recorded separately, because the allocator has to
+// understand them.
+//
+// `Generate` computes the liveness of each virtual register over the control
+// flow graph, and allocates registers in a single pass over the live
+// intervals, in order of their start (Poletto and Sarkar, "Linear scan
+// register allocation", 1999). Parameters, call arguments and results, return
+// values and copies give hints, so that a value that flows through them can
+// stay in the same register, and the copy disappears. Values that are live
+// across a call use callee-saved registers, which are saved in the prologue.
+// When registers run out, the interval that ends last is spilled to a stack
+// slot, and reloaded into a reserved register around each operation that uses
+// it.
+//
+// Parameters and return values follow the ABI class. Calls are made to labels
+// bound elsewhere in the same MacroAssembler, with at most eight X and eight V
+// arguments; V arguments and results are passed as doubles. V registers are
+// never live across calls in callee-saved registers, because only their
+// bottom 64 bits are preserved. Z registers must not be live across calls, and
+// are never spilled.
+//
+// Typical usage:
+//
+//   RegisterAllocator ra(&masm);
+//   VirtualRegister n = ra.AddParameter<int64_t>();
+//   VirtualRegister sum = ra.NewX();
+//   typedef RegisterAllocator::Allocation Allocation;
+//   ra.Emit({sum}, {}, [=](MacroAssembler* masm, const Allocation& a) {
+//     masm->Mov(a.X(sum), 0);
+//   });
+//   Label loop;
+//   ra.Bind(&loop);
+//   ra.Emit({sum, n}, {sum, n}, [=](MacroAssembler* m, const Allocation& a) {
+//     m->Add(a.X(sum), a.X(sum), a.X(n));
+//     m->Subs(a.X(n), a.X(n), 1);
+//   });
+//   ra.B(&loop, ne);
+//   ra.Return(sum);
+//   ra.Generate();
+class RegisterAllocator {
+ public:
+  // The physical registers assigned to virtual registers, as seen by an
+  // operation. Spilled registers have been reloaded into reserved registers.
+  class Allocation {
+   public:
+    Register X(VirtualRegister reg) const {
+      return XRegister(GetCode(reg, VirtualRegister::kX));
+    }
+    Register W(VirtualRegister reg) const {
+      return WRegister(GetCode(reg, VirtualRegister::kX));
+    }
+    VRegister Q(VirtualRegister reg) const {
+      return QRegister(GetCode(reg, VirtualRegister::kV));
+    }
+    VRegister D(VirtualRegister reg) const {
+      return DRegister(GetCode(reg, VirtualRegister::kV));
+    }
+    VRegister S(VirtualRegister reg) const {
+      return SRegister(GetCode(reg, VirtualRegister::kV));
+    }
+    VRegister V(VirtualRegister reg, VectorFormat format) const {
+      return VRegister(GetCode(reg, VirtualRegister::kV), format);
+    }
+    ZRegister Z(VirtualRegister reg) const {
+      return ZRegister(GetCode(reg, VirtualRegister::kZ));
+    }
+
+   private:
+    int GetCode(VirtualRegister reg, VirtualRegister::RegisterClass cls) const;
+
+    std::vector<int> codes_;
+
+    friend class RegisterAllocator;
+  };
+
+  typedef std::function<void(MacroAssembler* masm,
+                             const Allocation& allocation)>
+      Emitter;
+
+  explicit RegisterAllocator(MacroAssembler* masm);
+
+  // Create virtual registers.
+  VirtualRegister NewX() { return NewRegister(VirtualRegister::kX); }
+  VirtualRegister NewV() { return NewRegister(VirtualRegister::kV); }
+  VirtualRegister NewZ() { return NewRegister(VirtualRegister::kZ); }
+
+  // Add a parameter of type `T`, after those already added. Integral and
+  // pointer parameters are held in X registers, and floating-point parameters
+  // in V registers.
+  template <typename T>
+  VirtualRegister AddParameter() {
+    GenericOperand location = abi_.GetNextParameterGenericOperand<T>();
+    VirtualRegister reg = NewRegister(std::is_floating_point<T>::value
+                                          ? VirtualRegister::kV
+                                          : VirtualRegister::kX);
+    parameters_.push_back(Parameter(reg, location));
+    return reg;
+  }
+
+  // Record an operation that writes `defs` and reads `uses`. The emitter must
+  // not branch out of the operation, and must leave `sp` unchanged. Registers
+  // in `defs` are never assigned the same physical register as other operands
+  // of the operation.
+  void Emit(std::initializer_list<VirtualRegister> defs,
+            std::initializer_list<VirtualRegister> uses,
+            const Emitter& emitter);
+
+  // Copy `src` to `dst`. No code is generated if both are assigned the same
+  // register.
+  void Mov(VirtualRegister dst, VirtualRegister src);
+
+  // Control flow. Labels must be bound with `Bind`, and branches to them must
+  // be recorded with `B` or `Branch`.
+  void Bind(Label* label);
+  void B(Label* label);
+  void B(Label* label, Condition cond);
+  // Record a conditional branch that reads `uses`. The emitter must either
+  // branch to `label`, or fall through.
+  void Branch(Label* label,
+              std::initializer_list<VirtualRegister> uses,
+              const Emitter& emitter);
+
+  // Call the function at `target`, which must follow the ABI. `result` may be
+  // invalid if the function doesn't return a value.
+  void Call(Label* target,
+            std::initializer_list<VirtualRegister> arguments,
+            VirtualRegister result = VirtualRegister());
+
+  // Return from the function, optionally with a value.
+  void Return();
+  void Return(VirtualRegister value);
+
+  // Allocate registers, and generate the function at the current position of
+  // the MacroAssembler.
+  void Generate();
+
+  // Statistics for the generated function.
+  int GetNumberOfSpilledRegisters() const { return spilled_count_; }
+  int GetNumberOfCoalescedMoves() const { return coalesced_count_; }
+  // The stack space used for saved registers and spill slots, not including
+  // the frame record.
+  int GetFrameSize() const { return frame_size_; }
+  // The physical register assigned to `reg`, or NoCPUReg if it was spilled.
+  CPURegister GetAssignedRegister(VirtualRegister reg) const;
+
+ private:
+  enum OperationKind {
+    kInstruction,
+    kCopy,
+    kBind,
+    kBranch,
+    kReturn,
+    kCall
+  };
+
+  struct Operation {
+    OperationKind kind;
+    std::vector<int> defs;
+    std::vector<int> uses;
+    Emitter emitter;
+    Label* label;
+    // For branches: false if the branch is unconditional.
+    bool falls_through;
+  };
+
+  struct Parameter {
+    Parameter(VirtualRegister reg_, const GenericOperand& location_)
+        : reg(reg_), location(location_) {}
+    VirtualRegister reg;
+    GenericOperand location;
+  };
+
+  struct Interval {
+    int vreg;
+    int start;
+    int end;
+    // Whether the interval is live across a call.
+    bool crosses_call;
+    // A physical register, or another virtual register, that this interval
+    // should share a register with, or -1.
+    int hint_code;
+    int hint_vreg;
+  };
+
+  // The physical registers of a bank (X, or V and Z together).
+  enum Bank { kGeneralBank, kVectorBank, kNumberOfBanks };
+
+  VirtualRegister NewRegister(VirtualRegister::RegisterClass cls);
+  Operation* AddOperation(OperationKind kind);
+  void AddOperands(std::vector<int>* list,
+                   std::initializer_list<VirtualRegister> regs);
+
+  static Bank GetBankOfClass(VirtualRegister::RegisterClass cls) {
+    return (cls == VirtualRegister::kX) ? kGeneralBank : kVectorBank;
+  }
+  Bank GetBank(int vreg) const { return GetBankOfClass(classes_[vreg]); }
+
+  // Analysis.
+  void BuildIntervals();
+  void AddHint(int vreg, int code, int other_vreg);
+  // Assign registers. If `reserve_temps` is false, registers that would be
+  // used to reload spilled values are also allocated. Return the number of
+  // spilled intervals.
+  int AllocateRegisters(bool reserve_temps);
+  RegList GetAllocatableRegisters(Bank bank, bool reserve_temps) const;
+  RegList GetTemps(Bank bank) const;
+  void Spill(int vreg);
+
+  // Emission.
+  void EmitPrologue();
+  void EmitEpilogue();
+  void EmitOperation(const Operation& op);
+  void EmitReturnValue(const Operation& op);
+  MemOperand GetSlot(int vreg) const;
+  CPURegister GetRegister(int vreg, int code) const;
+  // Move values between registers and stack slots, as if all moves happened
+  // at once.
+  struct Move {
+    VirtualRegister::RegisterClass cls;
+    // A physical register code, or -1 for a memory location.
+    int dst_code;
+    int src_code;
+    MemOperand dst_mem;
+    MemOperand src_mem;
+  };
+  void EmitParallelMove(std::vector<Move>* moves);
+  void EmitMove(const Move& move);
+
+  MacroAssembler* masm_;
+  ABI abi_;
+
+  std::vector<VirtualRegister::RegisterClass> classes_;
+  std::vector<Parameter> parameters_;
+  std::vector<Operation> operations_;
+
+  // Results of the analysis.
+  std::vector<Interval> intervals_;
+  std::vector<int> call_positions_;
+
+  // Results of allocation. A code of -1 means that the register was spilled.
+  std::vector<int> codes_;
+  std::vector<int> slots_;
+  RegList used_callee_saved_;
+  // The codes passed to emitters, with spilled registers replaced by
+  // temporary registers during each operation.
+  std::vector<int> allocation_codes_;
+  bool needs_frame_;
+  int frame_size_;
+
+  int spilled_count_;
+  int coalesced_count_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_REGISTER_ALLOCATOR_AARCH64_H_
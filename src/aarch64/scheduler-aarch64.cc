@@ -0,0 +1,1233 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "scheduler-aarch64.h"
+
+#include "macro-assembler-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+// Out-of-order cores hide much of the latency that these tables describe, but
+// they still benefit from independent work being available early, so they are
+// modelled as if they issued in order, with their dispatch width.
+
+// clang-format off
+const SchedulingModel kCortexA55SchedulingModel = {
+  "Cortex-A55",
+  2,
+  // None, Integer, Multiply, Load, Store, FP
+  {0, 2, 1, 1, 1, 2},
+  {
+    {1, SchedulingModel::kIntegerUnit, 1},    // kIntegerALU
+    {2, SchedulingModel::kIntegerUnit, 1},    // kIntegerShiftedALU
+    {3, SchedulingModel::kMultiplyUnit, 1},   // kIntegerMultiply
+    {12, SchedulingModel::kMultiplyUnit, 12}, // kIntegerDivide
+    {3, SchedulingModel::kLoadUnit, 1},       // kLoad
+    {1, SchedulingModel::kStoreUnit, 1},      // kStore
+    {4, SchedulingModel::kFPUnit, 1},         // kFPALU
+    {4, SchedulingModel::kFPUnit, 1},         // kFPMultiply
+    {4, SchedulingModel::kFPUnit, 1},         // kFPMultiplyAccumulate
+    {22, SchedulingModel::kFPUnit, 19},       // kFPDivide
+    {4, SchedulingModel::kFPUnit, 1},         // kFPConvert
+    {2, SchedulingModel::kFPUnit, 1},         // kNEONALU
+    {4, SchedulingModel::kFPUnit, 1},         // kNEONMultiply
+    {1, SchedulingModel::kNoUnit, 1}          // kNop
+  }
+};
+
+const SchedulingModel kCortexA76SchedulingModel = {
+  "Cortex-A76",
+  4,
+  // None, Integer, Multiply, Load, Store, FP
+  {0, 3, 1, 2, 1, 2},
+  {
+    {1, SchedulingModel::kIntegerUnit, 1},    // kIntegerALU
+    {2, SchedulingModel::kIntegerUnit, 1},    // kIntegerShiftedALU
+    {2, SchedulingModel::kMultiplyUnit, 1},   // kIntegerMultiply
+    {12, SchedulingModel::kMultiplyUnit, 12}, // kIntegerDivide
+    {4, SchedulingModel::kLoadUnit, 1},       // kLoad
+    {1, SchedulingModel::kStoreUnit, 1},      // kStore
+    {2, SchedulingModel::kFPUnit, 1},         // kFPALU
+    {3, SchedulingModel::kFPUnit, 1},         // kFPMultiply
+    {4, SchedulingModel::kFPUnit, 1},         // kFPMultiplyAccumulate
+    {10, SchedulingModel::kFPUnit, 7},        // kFPDivide
+    {3, SchedulingModel::kFPUnit, 1},         // kFPConvert
+    {2, SchedulingModel::kFPUnit, 1},         // kNEONALU
+    {4, SchedulingModel::kFPUnit, 1},         // kNEONMultiply
+    {1, SchedulingModel::kNoUnit, 1}          // kNop
+  }
+};
+
+const SchedulingModel kNeoverseN1SchedulingModel = {
+  "Neoverse-N1",
+  4,
+  // None, Integer, Multiply, Load, Store, FP
+  {0, 3, 1, 2, 1, 2},
+  {
+    {1, SchedulingModel::kIntegerUnit, 1},    // kIntegerALU
+    {2, SchedulingModel::kIntegerUnit, 1},    // kIntegerShiftedALU
+    {2, SchedulingModel::kMultiplyUnit, 1},   // kIntegerMultiply
+    {12, SchedulingModel::kMultiplyUnit, 12}, // kIntegerDivide
+    {4, SchedulingModel::kLoadUnit, 1},       // kLoad
+    {1, SchedulingModel::kStoreUnit, 1},      // kStore
+    {2, SchedulingModel::kFPUnit, 1},         // kFPALU
+    {3, SchedulingModel::kFPUnit, 1},         // kFPMultiply
+    {4, SchedulingModel::kFPUnit, 1},         // kFPMultiplyAccumulate
+    {15, SchedulingModel::kFPUnit, 13},       // kFPDivide
+    {3, SchedulingModel::kFPUnit, 1},         // kFPConvert
+    {2, SchedulingModel::kFPUnit, 1},         // kNEONALU
+    {4, SchedulingModel::kFPUnit, 1},         // kNEONMultiply
+    {1, SchedulingModel::kNoUnit, 1}          // kNop
+  }
+};
+// clang-format on
+
+
+InstructionScheduler::InstructionScheduler(MacroAssembler* masm,
+                                           const SchedulingModel& model)
+    : masm_(masm), model_(model), region_(masm) {
+  decoder_.AppendVisitor(this);
+}
+
+
+int InstructionScheduler::Schedule() {
+  return Schedule(0, AlignDown(masm_->GetCursorOffset(), kInstructionSize));
+}
+
+
+int InstructionScheduler::Schedule(ptrdiff_t start, ptrdiff_t end) {
+  region_.Scan(start, end);
+
+  int saved = 0;
+  ptrdiff_t offset = start;
+  while (offset < end) {
+    infos_.clear();
+    ptrdiff_t block_end = offset;
+    while ((block_end < end) && region_.IsCode(block_end) &&
+           ((block_end == offset) || !region_.IsBranchTarget(block_end)) &&
+           AddInstruction(block_end)) {
+      block_end += kInstructionSize;
+    }
+    if (infos_.size() > 1) saved += ScheduleBlock(offset);
+    // Skip the instruction that ended the block.
+    offset = std::max(block_end, offset + kInstructionSize);
+  }
+  return saved;
+}
+
+
+int InstructionScheduler::EstimateCycles(ptrdiff_t offset, int count) {
+  infos_.clear();
+  for (int i = 0; i < count; i++) {
+    bool schedulable = AddInstruction(offset + (i * kInstructionSize));
+    USE(schedulable);
+    VIXL_ASSERT(schedulable);
+  }
+  BuildGraph();
+  std::vector<int> order;
+  for (int i = 0; i < count; i++) order.push_back(i);
+  return Issue(&order);
+}
+
+
+bool InstructionScheduler::AddInstruction(ptrdiff_t offset) {
+  info_.schedulable = false;
+  info_.is_pc_relative = false;
+  info_.instruction_class = SchedulingModel::kIntegerALU;
+  info_.read_count = 0;
+  info_.write_count = 0;
+  info_.access = kNoAccess;
+  info_.base = -1;
+  info_.offset = 0;
+  info_.size = 0;
+  // The register operands of C64 instructions may be capabilities, and SVE
+  // and Morello instructions aren't analysed, so only A64 code is scheduled.
+  if (masm_->GetISAMap()->GetISAAt(offset) != ISA::A64) return false;
+  decoder_.Decode(region_.GetInstructionAt(offset), ISA::A64);
+  if (!info_.schedulable) return false;
+  infos_.push_back(info_);
+  return true;
+}
+
+
+void InstructionScheduler::AddEdge(int from, int to, int latency) {
+  VIXL_ASSERT(from < to);
+  Edge edge = {to, latency};
+  nodes_[from].successors.push_back(edge);
+  nodes_[to].predecessors++;
+}
+
+
+// Return true if two accesses might overlap.
+static bool MayAlias(int base_a,
+                     int writer_a,
+                     int64_t offset_a,
+                     int64_t size_a,
+                     int base_b,
+                     int writer_b,
+                     int64_t offset_b,
+                     int64_t size_b) {
+  if ((base_a < 0) || (base_a != base_b) || (writer_a != writer_b)) {
+    return true;
+  }
+  return (offset_a < (offset_b + size_b)) && (offset_b < (offset_a + size_a));
+}
+
+
+void InstructionScheduler::BuildGraph() {
+  int count = static_cast<int>(infos_.size());
+  Node empty = {SchedulingModel::kIntegerALU, std::vector<Edge>(), 0, 0};
+  nodes_.assign(count, empty);
+
+  int last_writer[kNumberOfResources];
+  std::vector<int> readers[kNumberOfResources];
+  for (int r = 0; r < kNumberOfResources; r++) last_writer[r] = -1;
+  std::vector<MemoryAccess> accesses;
+
+  for (int i = 0; i < count; i++) {
+    const InstructionInfo& info = infos_[i];
+    nodes_[i].instruction_class = info.instruction_class;
+
+    if (info.access != kNoAccess) {
+      MemoryAccess access = {i,
+                             info.access,
+                             info.base,
+                             (info.base < 0) ? -1 : last_writer[info.base],
+                             info.offset,
+                             info.size};
+      for (size_t j = 0; j < accesses.size(); j++) {
+        const MemoryAccess& other = accesses[j];
+        if ((other.kind == kLoadAccess) && (access.kind == kLoadAccess)) {
+          continue;
+        }
+        if (MayAlias(other.base,
+                     other.base_writer,
+                     other.offset,
+                     other.size,
+                     access.base,
+                     access.base_writer,
+                     access.offset,
+                     access.size)) {
+          // A load from memory that was just stored to has to wait for the
+          // store, at least.
+          AddEdge(other.node, i, (other.kind == kStoreAccess) ? 1 : 0);
+        }
+      }
+      accesses.push_back(access);
+    }
+
+    for (int j = 0; j < info.read_count; j++) {
+      int r = info.reads[j];
+      int writer = last_writer[r];
+      if (writer >= 0) AddEdge(writer, i, GetLatency(writer));
+      readers[r].push_back(i);
+    }
+    for (int j = 0; j < info.write_count; j++) {
+      int r = info.writes[j];
+      if (last_writer[r] >= 0) AddEdge(last_writer[r], i, 0);
+      for (size_t k = 0; k < readers[r].size(); k++) {
+        if (readers[r][k] != i) AddEdge(readers[r][k], i, 0);
+      }
+      readers[r].clear();
+    }
+    for (int j = 0; j < info.write_count; j++) {
+      last_writer[info.writes[j]] = i;
+    }
+  }
+
+  // Prioritise nodes by the length of the longest path from them to the end
+  // of the block.
+  for (int i = count - 1; i >= 0; i--) {
+    int height = GetLatency(i);
+    for (size_t j = 0; j < nodes_[i].successors.size(); j++) {
+      const Edge& edge = nodes_[i].successors[j];
+      height = std::max(height, edge.latency + nodes_[edge.to].height);
+    }
+    nodes_[i].height = height;
+  }
+}
+
+
+int InstructionScheduler::Issue(std::vector<int>* order) {
+  int count = static_cast<int>(nodes_.size());
+  bool in_order = !order->empty();
+  VIXL_ASSERT(!in_order || (order->size() == nodes_.size()));
+
+  std::vector<int> earliest(count, 0);
+  std::vector<int> remaining(count);
+  std::vector<int> ready;
+  for (int i = 0; i < count; i++) {
+    remaining[i] = nodes_[i].predecessors;
+    if (remaining[i] == 0) ready.push_back(i);
+  }
+  // The cycle at which each instance of each unit is next free.
+  std::vector<int> units[SchedulingModel::kNumberOfExecutionUnits];
+  for (int u = 0; u < SchedulingModel::kNumberOfExecutionUnits; u++) {
+    units[u].assign(model_.units[u], 0);
+  }
+
+  int issued = 0;
+  int finish = 0;
+  int cycle = 0;
+  while (issued < count) {
+    for (int slot = 0; slot < model_.issue_width; slot++) {
+      // Find the next node to issue, and a unit for it.
+      int node = -1;
+      int* unit_free = NULL;
+      if (in_order) {
+        int next = (*order)[issued];
+        VIXL_ASSERT(remaining[next] == 0);
+        if (earliest[next] <= cycle) node = next;
+      } else {
+        // Pick the ready node with the longest path to the end of the block,
+        // and then the earliest in program order.
+        for (size_t i = 0; i < ready.size(); i++) {
+          int candidate = ready[i];
+          if (earliest[candidate] > cycle) continue;
+          if ((node >= 0) &&
+              ((nodes_[candidate].height < nodes_[node].height) ||
+               ((nodes_[candidate].height == nodes_[node].height) &&
+                (candidate > node)))) {
+            continue;
+          }
+          // Check that a unit is available.
+          const SchedulingModel::InstructionTiming& timing =
+              model_.timing[nodes_[candidate].instruction_class];
+          if (timing.unit != SchedulingModel::kNoUnit) {
+            std::vector<int>& instances = units[timing.unit];
+            VIXL_ASSERT(!instances.empty());
+            if (*std::min_element(instances.begin(), instances.end()) >
+                cycle) {
+              continue;
+            }
+          }
+          node = candidate;
+        }
+      }
+      if (node < 0) break;
+
+      const SchedulingModel::InstructionTiming& timing =
+          model_.timing[nodes_[node].instruction_class];
+      if (timing.unit != SchedulingModel::kNoUnit) {
+        std::vector<int>& instances = units[timing.unit];
+        VIXL_ASSERT(!instances.empty());
+        unit_free = &*std::min_element(instances.begin(), instances.end());
+        // In-order issue stalls until the unit is free.
+        if (*unit_free > cycle) break;
+        *unit_free = cycle + timing.occupancy;
+      }
+
+      // Issue the node.
+      if (!in_order) {
+        order->push_back(node);
+        ready.erase(std::find(ready.begin(), ready.end(), node));
+      }
+      issued++;
+      finish = std::max(finish, cycle + timing.latency);
+      for (size_t i = 0; i < nodes_[node].successors.size(); i++) {
+        const Edge& edge = nodes_[node].successors[i];
+        earliest[edge.to] = std::max(earliest[edge.to], cycle + edge.latency);
+        if (--remaining[edge.to] == 0) ready.push_back(edge.to);
+      }
+      if (issued == count) break;
+    }
+    cycle++;
+  }
+  return std::max(finish, cycle);
+}
+
+
+int InstructionScheduler::ScheduleBlock(ptrdiff_t offset) {
+  BuildGraph();
+  int count = static_cast<int>(infos_.size());
+  std::vector<int> original;
+  for (int i = 0; i < count; i++) original.push_back(i);
+  int before = Issue(&original);
+  std::vector<int> order;
+  int after = Issue(&order);
+  if (after >= before) return 0;
+
+  // Record the instructions, and the targets of those that are PC-relative,
+  // then check that the targets are still in range from the new locations.
+  std::vector<Instr> bits(count);
+  std::vector<const Instruction*> targets(count, NULL);
+  std::vector<bool> is_literal(count, false);
+  for (int i = 0; i < count; i++) {
+    const Instruction* instr =
+        region_.GetInstructionAt(offset + (i * kInstructionSize));
+    bits[i] = instr->GetInstructionBits();
+    if (!infos_[i].is_pc_relative) continue;
+    is_literal[i] = instr->IsLoadLiteral();
+    targets[i] = is_literal[i] ? instr->GetLiteralAddress<const Instruction*>()
+                               : instr->GetImmPCOffsetTarget();
+  }
+  for (int i = 0; i < count; i++) {
+    int node = order[i];
+    if (targets[node] == NULL) continue;
+    const Instruction* instr =
+        region_.GetInstructionAt(offset + (i * kInstructionSize));
+    int64_t pc_offset = targets[node] - instr;
+    bool in_range = is_literal[node]
+                        ? IsInt19(pc_offset >> kLiteralEntrySizeLog2)
+                        : IsInt21(pc_offset);
+    if (!in_range) return 0;
+  }
+
+  for (int i = 0; i < count; i++) {
+    int node = order[i];
+    Instruction* instr =
+        region_.GetInstructionAt(offset + (i * kInstructionSize));
+    instr->SetInstructionBits(bits[node]);
+    if (targets[node] == NULL) continue;
+    int64_t pc_offset = targets[node] - instr;
+    if (is_literal[node]) {
+      instr->SetInstructionBits(
+          instr->Mask(~ImmLLiteral_mask) |
+          Assembler::ImmLLiteral(pc_offset >> kLiteralEntrySizeLog2));
+    } else {
+      instr->SetInstructionBits(instr->Mask(~ImmPCRel_mask) |
+                                Assembler::ImmPCRelAddress(pc_offset));
+    }
+  }
+  return before - after;
+}
+
+
+void InstructionScheduler::ReadX(unsigned code, Reg31Mode mode) {
+  if ((code == kZeroRegCode) && (mode == Reg31IsZeroRegister)) return;
+  Read(kFirstXResource + code);
+}
+
+
+void InstructionScheduler::WriteX(unsigned code, Reg31Mode mode) {
+  if ((code == kZeroRegCode) && (mode == Reg31IsZeroRegister)) return;
+  Write(kFirstXResource + code);
+}
+
+
+void InstructionScheduler::SetAccess(MemoryAccessKind access,
+                                     int base,
+                                     int64_t offset,
+                                     int64_t size) {
+  info_.access = access;
+  info_.base = base;
+  info_.offset = offset;
+  info_.size = size;
+}
+
+
+void InstructionScheduler::VisitAddSubExtended(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerShiftedALU);
+  bool sets_flags = instr->GetFlagsUpdate() != 0;
+  WriteX(instr->GetRd(),
+         sets_flags ? Reg31IsZeroRegister : Reg31IsStackPointer);
+  ReadX(instr->GetRn(), Reg31IsStackPointer);
+  ReadX(instr->GetRm());
+  if (sets_flags) WriteFlags();
+}
+
+
+void InstructionScheduler::VisitAddSubImmediate(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  bool sets_flags = instr->GetFlagsUpdate() != 0;
+  WriteX(instr->GetRd(),
+         sets_flags ? Reg31IsZeroRegister : Reg31IsStackPointer);
+  ReadX(instr->GetRn(), Reg31IsStackPointer);
+  if (sets_flags) WriteFlags();
+}
+
+
+void InstructionScheduler::VisitAddSubShifted(const Instruction* instr) {
+  SetClass((instr->GetImmDPShift() == 0)
+               ? SchedulingModel::kIntegerALU
+               : SchedulingModel::kIntegerShiftedALU);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+  if (instr->GetFlagsUpdate() != 0) WriteFlags();
+}
+
+
+void InstructionScheduler::VisitAddSubWithCarry(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+  ReadFlags();
+  if (instr->GetFlagsUpdate() != 0) WriteFlags();
+}
+
+
+void InstructionScheduler::VisitBitfield(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerShiftedALU);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  // `bfm` keeps some of the bits of the destination.
+  if ((instr->Mask(BitfieldMask) == BFM_w) ||
+      (instr->Mask(BitfieldMask) == BFM_x)) {
+    ReadX(instr->GetRd());
+  }
+}
+
+
+void InstructionScheduler::VisitConditionalCompareImmediate(
+    const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  ReadX(instr->GetRn());
+  ReadFlags();
+  WriteFlags();
+}
+
+
+void InstructionScheduler::VisitConditionalCompareRegister(
+    const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+  ReadFlags();
+  WriteFlags();
+}
+
+
+void InstructionScheduler::VisitConditionalSelect(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+  ReadFlags();
+}
+
+
+void InstructionScheduler::VisitDataProcessing1Source(
+    const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  WriteX(instr->GetRd());
+  if (instr->ExtractBit(16) != 0) {
+    // Pointer authentication instructions update the pointer in place, and
+    // can use the stack pointer as a modifier.
+    ReadX(instr->GetRd());
+    ReadX(instr->GetRn(), Reg31IsStackPointer);
+  } else {
+    ReadX(instr->GetRn());
+  }
+}
+
+
+void InstructionScheduler::VisitDataProcessing2Source(
+    const Instruction* instr) {
+  switch (instr->Mask(DataProcessing2SourceMask)) {
+    case UDIV_w:
+    case UDIV_x:
+    case SDIV_w:
+    case SDIV_x:
+      SetClass(SchedulingModel::kIntegerDivide);
+      break;
+    default:
+      SetClass(SchedulingModel::kIntegerALU);
+      break;
+  }
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  // `pacga` can use the stack pointer as a modifier.
+  ReadX(instr->GetRm(),
+        (instr->Mask(DataProcessing2SourceMask) == PACGA)
+            ? Reg31IsStackPointer
+            : Reg31IsZeroRegister);
+}
+
+
+void InstructionScheduler::VisitDataProcessing3Source(
+    const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerMultiply);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+  ReadX(instr->GetRa());
+}
+
+
+void InstructionScheduler::VisitExtract(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerShiftedALU);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+}
+
+
+void InstructionScheduler::VisitFPCompare(const Instruction* instr) {
+  SetClass(SchedulingModel::kFPALU);
+  ReadV(instr->GetRn());
+  ReadV(instr->GetRm());
+  WriteFlags();
+}
+
+
+void InstructionScheduler::VisitFPConditionalCompare(
+    const Instruction* instr) {
+  SetClass(SchedulingModel::kFPALU);
+  ReadV(instr->GetRn());
+  ReadV(instr->GetRm());
+  ReadFlags();
+  WriteFlags();
+}
+
+
+void InstructionScheduler::VisitFPConditionalSelect(const Instruction* instr) {
+  SetClass(SchedulingModel::kFPALU);
+  WriteV(instr->GetRd());
+  ReadV(instr->GetRn());
+  ReadV(instr->GetRm());
+  ReadFlags();
+}
+
+
+void InstructionScheduler::VisitFPDataProcessing1Source(
+    const Instruction* instr) {
+  switch (instr->Mask(FPDataProcessing1SourceMask & ~FP16)) {
+    case FMOV_s:
+    case FABS_s:
+    case FNEG_s:
+      SetClass(SchedulingModel::kFPALU);
+      break;
+    case FSQRT_s:
+      SetClass(SchedulingModel::kFPDivide);
+      break;
+    default:
+      // Precision conversions and rounding.
+      SetClass(SchedulingModel::kFPConvert);
+      break;
+  }
+  WriteV(instr->GetRd());
+  ReadV(instr->GetRn());
+}
+
+
+void InstructionScheduler::VisitFPDataProcessing2Source(
+    const Instruction* instr) {
+  switch (instr->Mask(FPDataProcessing2SourceMask & ~FP16)) {
+    case FMUL:
+    case FNMUL:
+      SetClass(SchedulingModel::kFPMultiply);
+      break;
+    case FDIV:
+      SetClass(SchedulingModel::kFPDivide);
+      break;
+    default:
+      SetClass(SchedulingModel::kFPALU);
+      break;
+  }
+  WriteV(instr->GetRd());
+  ReadV(instr->GetRn());
+  ReadV(instr->GetRm());
+}
+
+
+void InstructionScheduler::VisitFPDataProcessing3Source(
+    const Instruction* instr) {
+  SetClass(SchedulingModel::kFPMultiplyAccumulate);
+  WriteV(instr->GetRd());
+  ReadV(instr->GetRn());
+  ReadV(instr->GetRm());
+  ReadV(instr->GetRa());
+}
+
+
+// For conversions between FP and integer registers, return true if the source
+// is an integer register. Both FPIntegerConvert and FPFixedPointConvert encode
+// this in bits 16 to 18.
+static bool IsIntegerToFP(const Instruction* instr) {
+  switch (instr->ExtractBits(18, 16)) {
+    case 2:  // scvtf
+    case 3:  // ucvtf
+    case 7:  // fmov from a general-purpose register
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+void InstructionScheduler::VisitFPFixedPointConvert(const Instruction* instr) {
+  SetClass(SchedulingModel::kFPConvert);
+  if (IsIntegerToFP(instr)) {
+    WriteV(instr->GetRd());
+    ReadX(instr->GetRn());
+  } else {
+    WriteX(instr->GetRd());
+    ReadV(instr->GetRn());
+  }
+}
+
+
+void InstructionScheduler::VisitFPImmediate(const Instruction* instr) {
+  SetClass(SchedulingModel::kFPALU);
+  WriteV(instr->GetRd());
+}
+
+
+void InstructionScheduler::VisitFPIntegerConvert(const Instruction* instr) {
+  SetClass(SchedulingModel::kFPConvert);
+  if (IsIntegerToFP(instr)) {
+    WriteV(instr->GetRd());
+    ReadX(instr->GetRn());
+    // `fmov v0.d[1], x0` keeps the bottom half of the destination.
+    ReadV(instr->GetRd());
+  } else {
+    WriteX(instr->GetRd());
+    ReadV(instr->GetRn());
+  }
+}
+
+
+void InstructionScheduler::VisitLoadLiteral(const Instruction* instr) {
+  SetClass(SchedulingModel::kLoad);
+  info_.is_pc_relative = true;
+  // Literals are never written, so there are no memory dependencies.
+  if (instr->Mask(LoadLiteralMask) == PRFM_lit) return;
+  if (instr->Mask(LoadStoreVMask) != 0) {
+    WriteV(instr->GetRt());
+  } else {
+    WriteX(instr->GetRt());
+  }
+}
+
+
+void InstructionScheduler::VisitLoadStore(const Instruction* instr,
+                                          AddrMode mode) {
+  bool is_prefetch = instr->Mask(LoadStoreMask) == PRFM;
+  bool is_load = is_prefetch || instr->IsLoad();
+  SetClass(is_load ? SchedulingModel::kLoad : SchedulingModel::kStore);
+
+  unsigned rt = instr->GetRt();
+  bool is_vector = instr->Mask(LoadStoreVMask) != 0;
+  if (is_prefetch) {
+    // Prefetches don't write a register.
+  } else if (is_load) {
+    is_vector ? WriteV(rt) : WriteX(rt);
+  } else {
+    is_vector ? ReadV(rt) : ReadX(rt);
+  }
+
+  unsigned rn = instr->GetRn();
+  ReadX(rn, Reg31IsStackPointer);
+  if (mode != Offset) WriteX(rn, Reg31IsStackPointer);
+
+  int64_t offset;
+  if (instr->Mask(LoadStoreUnsignedOffsetFMask) ==
+      LoadStoreUnsignedOffsetFixed) {
+    offset = instr->GetImmLSUnsigned() << instr->GetSizeLS();
+  } else {
+    offset = (mode == PostIndex) ? 0 : instr->GetImmLS();
+  }
+  SetAccess(is_load ? kLoadAccess : kStoreAccess,
+            rn,
+            offset,
+            INT64_C(1) << instr->GetSizeLS());
+}
+
+
+void InstructionScheduler::VisitLoadStorePair(const Instruction* instr,
+                                              AddrMode mode) {
+  bool is_load = instr->IsLoad();
+  SetClass(is_load ? SchedulingModel::kLoad : SchedulingModel::kStore);
+
+  unsigned rt = instr->GetRt();
+  unsigned rt2 = instr->GetRt2();
+  bool is_vector = instr->Mask(LoadStoreVMask) != 0;
+  if (is_load) {
+    is_vector ? WriteV(rt) : WriteX(rt);
+    is_vector ? WriteV(rt2) : WriteX(rt2);
+  } else {
+    is_vector ? ReadV(rt) : ReadX(rt);
+    is_vector ? ReadV(rt2) : ReadX(rt2);
+  }
+
+  unsigned rn = instr->GetRn();
+  ReadX(rn, Reg31IsStackPointer);
+  if (mode != Offset) WriteX(rn, Reg31IsStackPointer);
+
+  unsigned size = instr->GetSizeLSPair();
+  int64_t offset =
+      (mode == PostIndex) ? 0 : (instr->GetImmLSPair() * (INT64_C(1) << size));
+  SetAccess(is_load ? kLoadAccess : kStoreAccess,
+            rn,
+            offset,
+            INT64_C(2) << size);
+}
+
+
+void InstructionScheduler::VisitLoadStorePairNonTemporal(
+    const Instruction* instr) {
+  VisitLoadStorePair(instr, Offset);
+}
+
+
+void InstructionScheduler::VisitLoadStorePairOffset(const Instruction* instr) {
+  VisitLoadStorePair(instr, Offset);
+}
+
+
+void InstructionScheduler::VisitLoadStorePairPostIndex(
+    const Instruction* instr) {
+  VisitLoadStorePair(instr, PostIndex);
+}
+
+
+void InstructionScheduler::VisitLoadStorePairPreIndex(
+    const Instruction* instr) {
+  VisitLoadStorePair(instr, PreIndex);
+}
+
+
+void InstructionScheduler::VisitLoadStorePostIndex(const Instruction* instr) {
+  VisitLoadStore(instr, PostIndex);
+}
+
+
+void InstructionScheduler::VisitLoadStorePreIndex(const Instruction* instr) {
+  VisitLoadStore(instr, PreIndex);
+}
+
+
+void InstructionScheduler::VisitLoadStoreRegisterOffset(
+    const Instruction* instr) {
+  VisitLoadStore(instr, Offset);
+  ReadX(instr->GetRm());
+  // The address isn't known.
+  info_.base = -1;
+}
+
+
+void InstructionScheduler::VisitLoadStoreUnscaledOffset(
+    const Instruction* instr) {
+  VisitLoadStore(instr, Offset);
+}
+
+
+void InstructionScheduler::VisitLoadStoreUnsignedOffset(
+    const Instruction* instr) {
+  VisitLoadStore(instr, Offset);
+}
+
+
+void InstructionScheduler::VisitLogicalImmediate(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  bool sets_flags = instr->Mask(LogicalOpMask & ~NOT) == ANDS;
+  WriteX(instr->GetRd(),
+         sets_flags ? Reg31IsZeroRegister : Reg31IsStackPointer);
+  ReadX(instr->GetRn());
+  if (sets_flags) WriteFlags();
+}
+
+
+void InstructionScheduler::VisitLogicalShifted(const Instruction* instr) {
+  SetClass((instr->GetImmDPShift() == 0)
+               ? SchedulingModel::kIntegerALU
+               : SchedulingModel::kIntegerShiftedALU);
+  WriteX(instr->GetRd());
+  ReadX(instr->GetRn());
+  ReadX(instr->GetRm());
+  if (instr->Mask(LogicalOpMask & ~NOT) == ANDS) WriteFlags();
+}
+
+
+void InstructionScheduler::VisitMoveWideImmediate(const Instruction* instr) {
+  SetClass(SchedulingModel::kIntegerALU);
+  WriteX(instr->GetRd());
+  if ((instr->Mask(MoveWideImmediateMask) == MOVK_w) ||
+      (instr->Mask(MoveWideImmediateMask) == MOVK_x)) {
+    ReadX(instr->GetRd());
+  }
+}
+
+
+void InstructionScheduler::VisitNEON(
+    const Instruction* instr,
+    SchedulingModel::InstructionClass instruction_class,
+    int sources,
+    bool reads_destination) {
+  SetClass(instruction_class);
+  WriteV(instr->GetRd());
+  if (reads_destination) ReadV(instr->GetRd());
+  if (sources >= 1) ReadV(instr->GetRn());
+  if (sources >= 2) ReadV(instr->GetRm());
+}
+
+
+// Return true for narrowing and accumulating instructions, which keep part of
+// the destination. Both NEON2RegMisc and NEONScalar2RegMisc encode the
+// operation in bits 12 to 16.
+static bool NEON2RegMiscReadsDestination(const Instruction* instr) {
+  switch (instr->ExtractBits(16, 12)) {
+    case 0x06:  // sadalp, uadalp
+    case 0x12:  // xtn, sqxtun
+    case 0x14:  // sqxtn, uqxtn
+    case 0x16:  // fcvtn, fcvtxn
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+// As above, for NEONShiftImmediate and NEONScalarShiftImmediate, which encode
+// the operation in bits 11 to 15.
+static bool NEONShiftImmediateReadsDestination(const Instruction* instr) {
+  int opcode = instr->ExtractBits(15, 11);
+  switch (opcode) {
+    case 0x02:  // ssra, usra
+    case 0x06:  // srsra, ursra
+    case 0x08:  // sri
+      return true;
+    case 0x0a:  // shl, sli
+      return instr->ExtractBit(29) != 0;
+    default:
+      // Narrowing shifts.
+      return (opcode & 0x1c) == 0x10;
+  }
+}
+
+
+void InstructionScheduler::VisitNEON2RegMisc(const Instruction* instr) {
+  VisitNEON(instr,
+            (instr->Mask(NEON2RegMiscFPMask) == NEON_FSQRT)
+                ? SchedulingModel::kFPDivide
+                : SchedulingModel::kNEONALU,
+            1,
+            NEON2RegMiscReadsDestination(instr));
+}
+
+
+void InstructionScheduler::VisitNEON2RegMiscFP16(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 1, false);
+}
+
+
+void InstructionScheduler::VisitNEON3Different(const Instruction* instr) {
+  // Most of these are long multiplies. Many accumulate, or keep the bottom
+  // half of the destination.
+  VisitNEON(instr, SchedulingModel::kNEONMultiply, 2, true);
+}
+
+
+void InstructionScheduler::VisitNEON3Same(const Instruction* instr) {
+  SchedulingModel::InstructionClass instruction_class =
+      SchedulingModel::kNEONALU;
+  bool reads_destination = false;
+  switch (instr->Mask(NEON3SameMask)) {
+    case NEON_MLA:
+    case NEON_MLS:
+      reads_destination = true;
+      VIXL_FALLTHROUGH();
+    case NEON_MUL:
+    case NEON_PMUL:
+    case NEON_SQDMULH:
+    case NEON_SQRDMULH:
+      instruction_class = SchedulingModel::kNEONMultiply;
+      break;
+  }
+  switch (instr->Mask(NEON3SameFPMask)) {
+    case NEON_FMLA:
+    case NEON_FMLS:
+      reads_destination = true;
+      VIXL_FALLTHROUGH();
+    case NEON_FMUL:
+    case NEON_FMULX:
+      instruction_class = SchedulingModel::kNEONMultiply;
+      break;
+    case NEON_FDIV:
+      instruction_class = SchedulingModel::kFPDivide;
+      break;
+  }
+  switch (instr->Mask(NEON3SameLogicalMask)) {
+    case NEON_BIF:
+    case NEON_BIT:
+    case NEON_BSL:
+      reads_destination = true;
+      break;
+  }
+  switch (instr->Mask(NEON3SameFHMMask)) {
+    case NEON_FMLAL:
+    case NEON_FMLAL2:
+    case NEON_FMLSL:
+    case NEON_FMLSL2:
+      instruction_class = SchedulingModel::kNEONMultiply;
+      reads_destination = true;
+      break;
+  }
+  VisitNEON(instr, instruction_class, 2, reads_destination);
+}
+
+
+void InstructionScheduler::VisitNEON3SameExtra(const Instruction* instr) {
+  // Dot products and complex multiplies accumulate.
+  VisitNEON(instr, SchedulingModel::kNEONMultiply, 2, true);
+}
+
+
+void InstructionScheduler::VisitNEON3SameFP16(const Instruction* instr) {
+  // This includes `fmla`.
+  VisitNEON(instr, SchedulingModel::kNEONALU, 2, true);
+}
+
+
+void InstructionScheduler::VisitNEONAcrossLanes(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 1, false);
+}
+
+
+void InstructionScheduler::VisitNEONByIndexedElement(
+    const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONMultiply, 2, true);
+  // For H-sized elements, bit 20 is part of the index rather than the
+  // register number.
+  ReadV(instr->GetRm() & 0xf);
+}
+
+
+void InstructionScheduler::VisitNEONCopy(const Instruction* instr) {
+  SetClass(SchedulingModel::kNEONALU);
+  if (instr->Mask(NEONCopyInsElementMask) == NEON_INS_ELEMENT) {
+    WriteV(instr->GetRd());
+    ReadV(instr->GetRd());
+    ReadV(instr->GetRn());
+  } else if (instr->Mask(NEONCopyInsGeneralMask) == NEON_INS_GENERAL) {
+    WriteV(instr->GetRd());
+    ReadV(instr->GetRd());
+    ReadX(instr->GetRn());
+  } else if ((instr->Mask(NEONCopyUmovMask) == NEON_UMOV) ||
+             (instr->Mask(NEONCopySmovMask) == NEON_SMOV)) {
+    WriteX(instr->GetRd());
+    ReadV(instr->GetRn());
+  } else if (instr->Mask(NEONCopyDupElementMask) == NEON_DUP_ELEMENT) {
+    WriteV(instr->GetRd());
+    ReadV(instr->GetRn());
+  } else {
+    VIXL_ASSERT(instr->Mask(NEONCopyDupGeneralMask) == NEON_DUP_GENERAL);
+    WriteV(instr->GetRd());
+    ReadX(instr->GetRn());
+  }
+}
+
+
+void InstructionScheduler::VisitNEONExtract(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 2, false);
+}
+
+
+void InstructionScheduler::VisitNEONLoadStore(const Instruction* instr,
+                                              bool post_index) {
+  // Multiple and single structure accesses use the same bit for loads.
+  VIXL_STATIC_ASSERT(static_cast<Instr>(NEONLoadStoreMultiL) ==
+                     static_cast<Instr>(NEONLoadStoreSingleL));
+  bool is_load = instr->Mask(NEONLoadStoreMultiL) != 0;
+  SetClass(is_load ? SchedulingModel::kLoad : SchedulingModel::kStore);
+
+  int count;
+  int64_t size;
+  bool is_multiple = instr->ExtractBit(24) == 0;
+  if (is_multiple) {
+    switch (instr->ExtractBits(15, 12)) {
+      case 0x7:  // ld1/st1, one register
+        count = 1;
+        break;
+      case 0x8:  // ld2/st2
+      case 0xa:  // ld1/st1, two registers
+        count = 2;
+        break;
+      case 0x4:  // ld3/st3
+      case 0x6:  // ld1/st1, three registers
+        count = 3;
+        break;
+      default:
+        count = 4;
+        break;
+    }
+    size = count * ((instr->GetNEONQ() != 0) ? kQRegSizeInBytes
+                                             : kDRegSizeInBytes);
+  } else {
+    // Single structures, including `ld1r` to `ld4r`. At most one D-sized
+    // element is accessed for each register.
+    count = ((instr->ExtractBit(13) << 1) | instr->ExtractBit(21)) + 1;
+    size = count * kDRegSizeInBytes;
+  }
+
+  for (int i = 0; i < count; i++) {
+    unsigned rt = instr->GetRt() + i;
+    if (is_load) {
+      WriteV(rt);
+      // Single-structure loads keep the other lanes.
+      ReadV(rt);
+    } else {
+      ReadV(rt);
+    }
+  }
+
+  unsigned rn = instr->GetRn();
+  ReadX(rn, Reg31IsStackPointer);
+  if (post_index) {
+    WriteX(rn, Reg31IsStackPointer);
+    // Register 31 means that the offset is the size of the access.
+    ReadX(instr->GetRm());
+  }
+  SetAccess(is_load ? kLoadAccess : kStoreAccess, rn, 0, size);
+}
+
+
+void InstructionScheduler::VisitNEONLoadStoreMultiStruct(
+    const Instruction* instr) {
+  VisitNEONLoadStore(instr, false);
+}
+
+
+void InstructionScheduler::VisitNEONLoadStoreMultiStructPostIndex(
+    const Instruction* instr) {
+  VisitNEONLoadStore(instr, true);
+}
+
+
+void InstructionScheduler::VisitNEONLoadStoreSingleStruct(
+    const Instruction* instr) {
+  VisitNEONLoadStore(instr, false);
+}
+
+
+void InstructionScheduler::VisitNEONLoadStoreSingleStructPostIndex(
+    const Instruction* instr) {
+  VisitNEONLoadStore(instr, true);
+}
+
+
+void InstructionScheduler::VisitNEONModifiedImmediate(
+    const Instruction* instr) {
+  // `orr` and `bic` read the destination.
+  VisitNEON(instr, SchedulingModel::kNEONALU, 0, true);
+}
+
+
+void InstructionScheduler::VisitNEONPerm(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 2, false);
+}
+
+
+void InstructionScheduler::VisitNEONScalar2RegMisc(const Instruction* instr) {
+  VisitNEON(instr,
+            SchedulingModel::kNEONALU,
+            1,
+            NEON2RegMiscReadsDestination(instr));
+}
+
+
+void InstructionScheduler::VisitNEONScalar2RegMiscFP16(
+    const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 1, false);
+}
+
+
+void InstructionScheduler::VisitNEONScalar3Diff(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONMultiply, 2, true);
+}
+
+
+void InstructionScheduler::VisitNEONScalar3Same(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 2, false);
+}
+
+
+void InstructionScheduler::VisitNEONScalar3SameExtra(
+    const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONMultiply, 2, true);
+}
+
+
+void InstructionScheduler::VisitNEONScalar3SameFP16(
+    const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 2, false);
+}
+
+
+void InstructionScheduler::VisitNEONScalarByIndexedElement(
+    const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONMultiply, 2, true);
+  ReadV(instr->GetRm() & 0xf);
+}
+
+
+void InstructionScheduler::VisitNEONScalarCopy(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 1, false);
+}
+
+
+void InstructionScheduler::VisitNEONScalarPairwise(const Instruction* instr) {
+  VisitNEON(instr, SchedulingModel::kNEONALU, 1, false);
+}
+
+
+void InstructionScheduler::VisitNEONScalarShiftImmediate(
+    const Instruction* instr) {
+  VisitNEON(instr,
+            SchedulingModel::kNEONALU,
+            1,
+            NEONShiftImmediateReadsDestination(instr));
+}
+
+
+void InstructionScheduler::VisitNEONShiftImmediate(const Instruction* instr) {
+  VisitNEON(instr,
+            SchedulingModel::kNEONALU,
+            1,
+            NEONShiftImmediateReadsDestination(instr));
+}
+
+
+void InstructionScheduler::VisitNEONTable(const Instruction* instr) {
+  // `tbx` keeps the destination lanes for out-of-range indices.
+  bool is_tbx = instr->Mask(NEONTableExt) != 0;
+  VisitNEON(instr, SchedulingModel::kNEONALU, 0, is_tbx);
+  ReadV(instr->GetRm());
+  int count = instr->ExtractBits(14, 13) + 1;
+  for (int i = 0; i < count; i++) ReadV(instr->GetRn() + i);
+}
+
+
+void InstructionScheduler::VisitPCRelAddressing(const Instruction* instr) {
+  // `adrp` depends on the page of the instruction, so it isn't moved.
+  if (instr->Mask(PCRelAddressingMask) != ADR) return;
+  SetClass(SchedulingModel::kIntegerALU);
+  info_.is_pc_relative = true;
+  WriteX(instr->GetRd());
+}
+
+
+void InstructionScheduler::VisitSystem(const Instruction* instr) {
+  if ((instr->Mask(SystemHintMask) == HINT) && (instr->GetImmHint() == NOP)) {
+    SetClass(SchedulingModel::kNop);
+  }
+}
+
+}  // namespace aarch64
+}  // namespace vixl
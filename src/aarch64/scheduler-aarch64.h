@@ -0,0 +1,362 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef VIXL_AARCH64_SCHEDULER_AARCH64_H_
+#define VIXL_AARCH64_SCHEDULER_AARCH64_H_
+
+#include <vector>
+
+#include "../globals-vixl.h"
+
+#include "decoder-aarch64.h"
+#include "peephole-aarch64.h"
+
+namespace vixl {
+namespace aarch64 {
+
+class Label;
+class MacroAssembler;
+
+// Instructions that the scheduler understands. Anything else ends a block.
+#define VIXL_SCHEDULER_VISITOR_LIST(V)  \
+  V(AddSubExtended)                     \
+  V(AddSubImmediate)                    \
+  V(AddSubShifted)                      \
+  V(AddSubWithCarry)                    \
+  V(Bitfield)                           \
+  V(ConditionalCompareImmediate)        \
+  V(ConditionalCompareRegister)         \
+  V(ConditionalSelect)                  \
+  V(DataProcessing1Source)              \
+  V(DataProcessing2Source)              \
+  V(DataProcessing3Source)              \
+  V(Extract)                            \
+  V(FPCompare)                          \
+  V(FPConditionalCompare)               \
+  V(FPConditionalSelect)                \
+  V(FPDataProcessing1Source)            \
+  V(FPDataProcessing2Source)            \
+  V(FPDataProcessing3Source)            \
+  V(FPFixedPointConvert)                \
+  V(FPImmediate)                        \
+  V(FPIntegerConvert)                   \
+  V(LoadLiteral)                        \
+  V(LoadStorePairNonTemporal)           \
+  V(LoadStorePairOffset)                \
+  V(LoadStorePairPostIndex)             \
+  V(LoadStorePairPreIndex)              \
+  V(LoadStorePostIndex)                 \
+  V(LoadStorePreIndex)                  \
+  V(LoadStoreRegisterOffset)            \
+  V(LoadStoreUnscaledOffset)            \
+  V(LoadStoreUnsignedOffset)            \
+  V(LogicalImmediate)                   \
+  V(LogicalShifted)                     \
+  V(MoveWideImmediate)                  \
+  V(NEON2RegMisc)                       \
+  V(NEON2RegMiscFP16)                   \
+  V(NEON3Different)                     \
+  V(NEON3Same)                          \
+  V(NEON3SameExtra)                     \
+  V(NEON3SameFP16)                      \
+  V(NEONAcrossLanes)                    \
+  V(NEONByIndexedElement)               \
+  V(NEONCopy)                           \
+  V(NEONExtract)                        \
+  V(NEONLoadStoreMultiStruct)           \
+  V(NEONLoadStoreMultiStructPostIndex)  \
+  V(NEONLoadStoreSingleStruct)          \
+  V(NEONLoadStoreSingleStructPostIndex) \
+  V(NEONModifiedImmediate)              \
+  V(NEONPerm)                           \
+  V(NEONScalar2RegMisc)                 \
+  V(NEONScalar2RegMiscFP16)             \
+  V(NEONScalar3Diff)                    \
+  V(NEONScalar3Same)                    \
+  V(NEONScalar3SameExtra)               \
+  V(NEONScalar3SameFP16)                \
+  V(NEONScalarByIndexedElement)         \
+  V(NEONScalarCopy)                     \
+  V(NEONScalarPairwise)                 \
+  V(NEONScalarShiftImmediate)           \
+  V(NEONShiftImmediate)                 \
+  V(NEONTable)                          \
+  V(PCRelAddressing)                    \
+  V(System)
+
+// The timing of each class of instruction on a particular core, as used by
+// the InstructionScheduler. The tables are approximations taken from the
+// cores' software optimisation guides; new cores can be described by
+// filling in a SchedulingModel of their own.
+struct SchedulingModel {
+  enum InstructionClass {
+    // Simple integer operations, such as `add`, `mov` and `csel`.
+    kIntegerALU,
+    // Integer operations with a shifted or extended operand, and bitfield
+    // operations.
+    kIntegerShiftedALU,
+    kIntegerMultiply,
+    kIntegerDivide,
+    kLoad,
+    kStore,
+    // Scalar FP operations other than those below, such as `fadd`, `fcmp`
+    // and `fmov`.
+    kFPALU,
+    kFPMultiply,
+    kFPMultiplyAccumulate,
+    // FP division and square root.
+    kFPDivide,
+    // Conversions between FP precisions, and to and from integers.
+    kFPConvert,
+    kNEONALU,
+    kNEONMultiply,
+    kNop,
+    kNumberOfInstructionClasses
+  };
+
+  enum ExecutionUnit {
+    // Only an issue slot is needed.
+    kNoUnit,
+    kIntegerUnit,
+    // The integer multiply and divide pipeline.
+    kMultiplyUnit,
+    kLoadUnit,
+    kStoreUnit,
+    // The FP and NEON pipelines.
+    kFPUnit,
+    kNumberOfExecutionUnits
+  };
+
+  struct InstructionTiming {
+    // The number of cycles before a dependent instruction can issue.
+    int latency;
+    ExecutionUnit unit;
+    // The number of cycles for which the unit can't accept another
+    // instruction. This is 1 for fully-pipelined instructions.
+    int occupancy;
+  };
+
+  const char* name;
+  // The number of instructions that can issue in each cycle.
+  int issue_width;
+  // The number of units of each kind. `kNoUnit` is ignored.
+  int units[kNumberOfExecutionUnits];
+  InstructionTiming timing[kNumberOfInstructionClasses];
+};
+
+extern const SchedulingModel kCortexA55SchedulingModel;
+extern const SchedulingModel kCortexA76SchedulingModel;
+extern const SchedulingModel kNeoverseN1SchedulingModel;
+
+
+// Reorder the instructions of finished code to avoid stalls, in place.
+//
+// MacroAssembler code is emitted in program order, so a value is often used
+// immediately after the instruction that produces it. In-order cores, such as
+// Cortex-A55, stall until the value is ready. The scheduler uses the Decoder
+// to find the registers, flags and memory that each instruction reads and
+// writes, and then reorders each basic block with a list scheduler, using the
+// latencies and execution units described by a SchedulingModel. A block is
+// only rewritten if the model predicts that the new order issues in fewer
+// cycles than the original.
+//
+// Blocks end at branches, at branch targets and at anything that the
+// scheduler doesn't understand (such as system instructions, exclusive and
+// acquire-release accesses, SVE and Morello instructions, and anything in C64
+// code), so these are never moved. Branch targets are found as they are by
+// the PeepholeOptimiser; entry points and targets of computed branches must
+// be added with `AddBranchTarget`. Literal loads and `adr` are re-encoded when
+// they move.
+//
+// Memory accesses are only reordered when they are both loads, or when they
+// use the same, unmodified base register with immediate offsets that don't
+// overlap. Some NEON instructions are conservatively assumed to read their
+// destination register.
+//
+// Like the PeepholeOptimiser, the scheduler runs after `FinalizeCode()` (so
+// that the pools have been placed), but before the code is made executable.
+//
+// Typical usage:
+//
+//   masm.FinalizeCode();
+//   InstructionScheduler scheduler(&masm, kCortexA55SchedulingModel);
+//   scheduler.AddBranchTarget(&entry);
+//   scheduler.Schedule();
+class InstructionScheduler : public DecoderVisitorWithDefaults {
+ public:
+  InstructionScheduler(MacroAssembler* masm, const SchedulingModel& model);
+
+  // Declare that the code at `offset` (or `label`) may be reached from
+  // somewhere other than the preceding instruction.
+  void AddBranchTarget(ptrdiff_t offset) { region_.AddBranchTarget(offset); }
+  void AddBranchTarget(const Label* label) { region_.AddBranchTarget(label); }
+
+  // Schedule the code between `start` and `end` (offsets into the buffer), or
+  // the whole buffer. Return the number of cycles saved, according to the
+  // model.
+  int Schedule(ptrdiff_t start, ptrdiff_t end);
+  int Schedule();
+
+  // Estimate the number of cycles needed to issue the block of `count`
+  // instructions at `offset`, and to produce all of their results, assuming
+  // that they issue in order. This is mostly useful for testing.
+  int EstimateCycles(ptrdiff_t offset, int count);
+
+  // Decoder visitors, used to find the dependencies of each instruction.
+#define DECLARE(A) virtual void Visit##A(const Instruction* instr) VIXL_OVERRIDE;
+  VIXL_SCHEDULER_VISITOR_LIST(DECLARE)
+#undef DECLARE
+
+ private:
+  // Resources that instructions read and write, other than memory. Register
+  // 31 is the stack pointer; the zero register is not tracked.
+  enum Resource {
+    kFirstXResource = 0,
+    kFirstVResource = kFirstXResource + kNumberOfRegisters,
+    kFlagsResource = kFirstVResource + kNumberOfVRegisters,
+    kNumberOfResources
+  };
+
+  enum MemoryAccessKind { kNoAccess, kLoadAccess, kStoreAccess };
+
+  // The most resources that an instruction can read (`st4` with a register
+  // post-index), or write (`ld4` with a post-index).
+  static const int kMaxReads = 6;
+  static const int kMaxWrites = 5;
+
+  struct InstructionInfo {
+    bool schedulable;
+    // True for literal loads and `adr`, which must be re-encoded when they
+    // move.
+    bool is_pc_relative;
+    SchedulingModel::InstructionClass instruction_class;
+    int read_count;
+    int write_count;
+    int reads[kMaxReads];
+    int writes[kMaxWrites];
+    MemoryAccessKind access;
+    // The base register of the access, or -1 if the address isn't known.
+    int base;
+    int64_t offset;
+    int64_t size;
+  };
+
+  struct Edge {
+    int to;
+    int latency;
+  };
+
+  struct Node {
+    SchedulingModel::InstructionClass instruction_class;
+    std::vector<Edge> successors;
+    int predecessors;
+    // The length of the longest path from this node to the end of the block.
+    int height;
+  };
+
+  struct MemoryAccess {
+    int node;
+    MemoryAccessKind kind;
+    int base;
+    // The node that last wrote the base register before the access, or -1.
+    int base_writer;
+    int64_t offset;
+    int64_t size;
+  };
+
+  // Analyse the instruction at `offset`, and add it to `infos_` if it can be
+  // scheduled.
+  bool AddInstruction(ptrdiff_t offset);
+
+  // Build the dependency graph for the instructions in `infos_`.
+  void BuildGraph();
+  void AddEdge(int from, int to, int latency);
+  int GetLatency(int node) const {
+    return model_.timing[nodes_[node].instruction_class].latency;
+  }
+
+  // Issue the nodes, either in the order given by `order`, or (if `order` is
+  // empty) in the order chosen by the list scheduler, which is then stored in
+  // `order`. Return the number of cycles taken.
+  int Issue(std::vector<int>* order);
+
+  // Schedule the block described by `infos_`, which starts at `offset`, and
+  // return the number of cycles saved.
+  int ScheduleBlock(ptrdiff_t offset);
+
+  // Helpers for the visitors.
+  void SetClass(SchedulingModel::InstructionClass instruction_class) {
+    info_.schedulable = true;
+    info_.instruction_class = instruction_class;
+  }
+  void ReadX(unsigned code, Reg31Mode mode = Reg31IsZeroRegister);
+  void WriteX(unsigned code, Reg31Mode mode = Reg31IsZeroRegister);
+  void Read(int resource) {
+    VIXL_ASSERT(info_.read_count < kMaxReads);
+    info_.reads[info_.read_count++] = resource;
+  }
+  void Write(int resource) {
+    VIXL_ASSERT(info_.write_count < kMaxWrites);
+    info_.writes[info_.write_count++] = resource;
+  }
+  // V register numbers wrap around in register lists.
+  void ReadV(unsigned code) {
+    Read(kFirstVResource + (code % kNumberOfVRegisters));
+  }
+  void WriteV(unsigned code) {
+    Write(kFirstVResource + (code % kNumberOfVRegisters));
+  }
+  void ReadFlags() { Read(kFlagsResource); }
+  void WriteFlags() { Write(kFlagsResource); }
+  void SetAccess(MemoryAccessKind access,
+                 int base,
+                 int64_t offset,
+                 int64_t size);
+  void VisitLoadStore(const Instruction* instr, AddrMode mode);
+  void VisitLoadStorePair(const Instruction* instr, AddrMode mode);
+  void VisitNEONLoadStore(const Instruction* instr, bool post_index);
+  void VisitNEON(const Instruction* instr,
+                 SchedulingModel::InstructionClass instruction_class,
+                 int sources,
+                 bool reads_destination);
+
+  MacroAssembler* masm_;
+  const SchedulingModel& model_;
+  Decoder decoder_;
+  CodeRegion region_;
+
+  // The instruction being analysed.
+  InstructionInfo info_;
+
+  // The block being scheduled.
+  std::vector<InstructionInfo> infos_;
+  std::vector<Node> nodes_;
+};
+
+}  // namespace aarch64
+}  // namespace vixl
+
+#endif  // VIXL_AARCH64_SCHEDULER_AARCH64_H_
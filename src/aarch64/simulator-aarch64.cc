@@ -35,6 +35,13 @@
 
 #include "simulator-aarch64.h"
 
+// Use the host's CRC32 instruction, where the compiler makes it available,
+// for the simulated CRC32C instructions.
+#if defined(__x86_64__) && defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define VIXL_SIMULATOR_HOST_CRC32C
+#endif
+
 namespace vixl {
 namespace aarch64 {
 
@@ -67,6 +74,106 @@ SimSystemRegister SimSystemRegister::DefaultValueFor(SystemRegister id) {
 }
 
 
+static const char kReplayLogMagic[4] = {'V', 'R', 'L', '1'};
+
+
+static void WriteULEB128(std::vector<uint8_t>* data, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0) byte |= 0x80;
+    data->push_back(byte);
+  } while (value != 0);
+}
+
+
+// Return false if the end of the input is reached first, or if the value
+// doesn't fit in 64 bits.
+template <typename F>
+static bool ReadULEB128(F next_byte, uint64_t* value) {
+  *value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    int byte = next_byte();
+    if (byte < 0) return false;
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+
+void SimReplayLog::RecordRawValue(EntryType type, uint64_t raw) {
+  data_.push_back(type);
+  WriteULEB128(&data_, raw);
+}
+
+
+uint64_t SimReplayLog::ReplayRawValue(EntryType type) {
+  VIXL_CHECK(bytes_read_ < data_.size());
+  if (data_[bytes_read_++] != type) {
+    VIXL_ABORT_WITH_MSG("The simulation diverged from the replay log.\n");
+  }
+  uint64_t raw;
+  bool valid = ReadULEB128(
+      [this]() -> int {
+        return (bytes_read_ < data_.size()) ? data_[bytes_read_++] : -1;
+      },
+      &raw);
+  VIXL_CHECK(valid);
+  return raw;
+}
+
+
+bool SimReplayLog::WriteTo(FILE* file) const {
+  std::vector<uint8_t> header;
+  WriteULEB128(&header, bits_.size());
+  WriteULEB128(&header, data_.size());
+  std::vector<uint8_t> bits((bits_.size() + kBitsPerByte - 1) / kBitsPerByte,
+                            0);
+  for (size_t i = 0; i < bits_.size(); i++) {
+    if (bits_[i]) bits[i / kBitsPerByte] |= 1 << (i % kBitsPerByte);
+  }
+  return (fwrite(kReplayLogMagic, sizeof(kReplayLogMagic), 1, file) == 1) &&
+         (fwrite(header.data(), 1, header.size(), file) == header.size()) &&
+         (fwrite(bits.data(), 1, bits.size(), file) == bits.size()) &&
+         (fwrite(data_.data(), 1, data_.size(), file) == data_.size());
+}
+
+
+bool SimReplayLog::ReadFrom(FILE* file) {
+  Clear();
+  char magic[sizeof(kReplayLogMagic)];
+  if ((fread(magic, sizeof(magic), 1, file) != 1) ||
+      (memcmp(magic, kReplayLogMagic, sizeof(magic)) != 0)) {
+    return false;
+  }
+  auto next_byte = [file]() -> int {
+    int byte = fgetc(file);
+    return (byte == EOF) ? -1 : byte;
+  };
+  uint64_t bit_count;
+  uint64_t data_size;
+  if (!ReadULEB128(next_byte, &bit_count) ||
+      !ReadULEB128(next_byte, &data_size)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < bit_count; i += kBitsPerByte) {
+    int byte = next_byte();
+    if (byte < 0) return false;
+    for (uint64_t bit = i; (bit < bit_count) && (bit < (i + kBitsPerByte));
+         bit++) {
+      bits_.push_back(((byte >> (bit - i)) & 1) != 0);
+    }
+  }
+  for (uint64_t i = 0; i < data_size; i++) {
+    int byte = next_byte();
+    if (byte < 0) return false;
+    data_.push_back(static_cast<uint8_t>(byte));
+  }
+  return true;
+}
+
+
 Simulator::Simulator(Decoder* decoder, FILE* stream)
     : movprfx_(NULL), cpu_features_auditor_(decoder, CPUFeatures::All()) {
   // Ensure that shift operations act as the simulator expects.
@@ -120,6 +227,13 @@ Simulator::Simulator(Decoder* decoder, FILE* stream)
 
   guard_pages_ = false;
 
+  replay_mode_ = kReplayDisabled;
+  replay_log_ = NULL;
+
+  for (size_t i = 0; i < ArrayLength(pac_cache_); i++) {
+    pac_cache_[i].valid = false;
+  }
+
   // Initialize the common state of RNDR and RNDRRS.
   uint16_t seed[3] = {11, 22, 33};
   VIXL_STATIC_ASSERT(sizeof(seed) == sizeof(rand_state_));
@@ -133,6 +247,7 @@ Simulator::Simulator(Decoder* decoder, FILE* stream)
 void Simulator::ResetSystemRegisters() {
   // Reset the system registers.
   nzcv_ = SimSystemRegister::DefaultValueFor(NZCV);
+  lazy_nzcv_.Clear();
   fpcr_ = SimSystemRegister::DefaultValueFor(FPCR);
   ResetFFR();
 }
@@ -247,6 +362,92 @@ void Simulator::RunFrom(const Instruction* first) {
 }
 
 
+void Simulator::MaybeClearLocalMonitor() {
+  // Clearing a monitor which isn't marked has no effect, so only decisions
+  // made when it is marked need to be recorded.
+  if (!local_monitor_.IsMarked()) {
+    if (replay_mode_ != kReplay) local_monitor_.MaybeClear();
+    return;
+  }
+  switch (replay_mode_) {
+    case kReplay:
+      if (replay_log_->ReplayBit()) local_monitor_.Clear();
+      break;
+    case kRecord:
+      local_monitor_.MaybeClear();
+      replay_log_->RecordBit(!local_monitor_.IsMarked());
+      break;
+    case kReplayDisabled:
+      local_monitor_.MaybeClear();
+      break;
+  }
+}
+
+
+bool Simulator::IsGlobalMonitorExclusive(uint64_t address, size_t size) {
+  if (replay_mode_ == kReplay) return replay_log_->ReplayBit();
+  bool is_exclusive = global_monitor_.IsExclusive(address, size);
+  if (replay_mode_ == kRecord) replay_log_->RecordBit(is_exclusive);
+  return is_exclusive;
+}
+
+
+Simulator::RunStatus Simulator::RunFor(uint64_t instruction_budget) {
+  LogAllWrittenRegisters();
+
+  for (uint64_t i = 0; i < instruction_budget; i++) {
+    if (pc_ == kEndOfSimAddress) return kEndOfSimulationReached;
+    ExecuteInstruction();
+  }
+  return (pc_ == kEndOfSimAddress) ? kEndOfSimulationReached
+                                   : kInstructionBudgetExhausted;
+}
+
+
+void Simulator::SaveContext(SimContext* context) {
+  for (unsigned i = 0; i < kNumberOfRegisters; i++) {
+    context->registers_[i] = registers_[i];
+  }
+  for (unsigned i = 0; i < kNumberOfVRegisters; i++) {
+    context->vregisters_[i] = vregisters_[i];
+  }
+  for (unsigned i = 0; i < kNumberOfPRegisters; i++) {
+    context->pregisters_[i] = pregisters_[i];
+  }
+  context->ffr_register_ = ffr_register_;
+  context->nzcv_ = ReadNzcv();
+  context->fpcr_ = fpcr_;
+  context->pc_ = pc_;
+  context->movprfx_ = movprfx_;
+  context->btype_ = btype_;
+}
+
+
+void Simulator::RestoreContext(const SimContext& context) {
+  VIXL_ASSERT(context.vregisters_[0].GetSizeInBytes() ==
+              GetVectorLengthInBytes());
+  for (unsigned i = 0; i < kNumberOfRegisters; i++) {
+    registers_[i] = context.registers_[i];
+  }
+  for (unsigned i = 0; i < kNumberOfVRegisters; i++) {
+    vregisters_[i] = context.vregisters_[i];
+  }
+  for (unsigned i = 0; i < kNumberOfPRegisters; i++) {
+    pregisters_[i] = context.pregisters_[i];
+  }
+  ffr_register_ = context.ffr_register_;
+  nzcv_ = context.nzcv_;
+  lazy_nzcv_.Clear();
+  fpcr_ = context.fpcr_;
+  pc_ = context.pc_;
+  pc_modified_ = false;
+  movprfx_ = context.movprfx_;
+  btype_ = context.btype_;
+  next_btype_ = DefaultBType;
+  local_monitor_.Clear();
+}
+
+
 // clang-format off
 const char* Simulator::xreg_names[] = {"x0",  "x1",  "x2",  "x3",  "x4",  "x5",
                                        "x6",  "x7",  "x8",  "x9",  "x10", "x11",
@@ -459,37 +660,31 @@ uint64_t Simulator::AddWithCarry(unsigned reg_size,
   VIXL_ASSERT((carry_in == 0) || (carry_in == 1));
   VIXL_ASSERT((reg_size == kXRegSize) || (reg_size == kWRegSize));
 
-  uint64_t max_uint = (reg_size == kWRegSize) ? kWMaxUInt : kXMaxUInt;
   uint64_t reg_mask = (reg_size == kWRegSize) ? kWRegMask : kXRegMask;
-  uint64_t sign_mask = (reg_size == kWRegSize) ? kWSignMask : kXSignMask;
 
   left &= reg_mask;
   right &= reg_mask;
   uint64_t result = (left + right + carry_in) & reg_mask;
 
   if (set_flags) {
-    ReadNzcv().SetN(CalcNFlag(result, reg_size));
-    ReadNzcv().SetZ(CalcZFlag(result));
-
-    // Compute the C flag by comparing the result to the max unsigned integer.
-    uint64_t max_uint_2op = max_uint - carry_in;
-    bool C = (left > max_uint_2op) || ((max_uint_2op - left) < right);
-    ReadNzcv().SetC(C ? 1 : 0);
-
-    // Overflow iff the sign bit is the same for the two inputs and different
-    // for the result.
-    uint64_t left_sign = left & sign_mask;
-    uint64_t right_sign = right & sign_mask;
-    uint64_t result_sign = result & sign_mask;
-    bool V = (left_sign == right_sign) && (left_sign != result_sign);
-    ReadNzcv().SetV(V ? 1 : 0);
-
+    // The flags are computed when they are read; see SimLazyNzcv.
+    lazy_nzcv_.SetFromAddWithCarry(reg_size, left, right, carry_in, result);
     LogSystemRegister(NZCV);
   }
   return result;
 }
 
 
+void Simulator::MaterializeNzcv() {
+  VIXL_ASSERT(lazy_nzcv_.IsPending());
+  nzcv_.SetN(lazy_nzcv_.GetN() ? 1 : 0);
+  nzcv_.SetZ(lazy_nzcv_.GetZ() ? 1 : 0);
+  nzcv_.SetC(lazy_nzcv_.GetC() ? 1 : 0);
+  nzcv_.SetV(lazy_nzcv_.GetV() ? 1 : 0);
+  lazy_nzcv_.Clear();
+}
+
+
 int64_t Simulator::ShiftOperand(unsigned reg_size,
                                 uint64_t uvalue,
                                 Shift shift_type,
@@ -1928,10 +2123,7 @@ void Simulator::LogicalHelper(const Instruction* instr, int64_t op2) {
   }
 
   if (update_flags) {
-    ReadNzcv().SetN(CalcNFlag(result, reg_size));
-    ReadNzcv().SetZ(CalcZFlag(result));
-    ReadNzcv().SetC(0);
-    ReadNzcv().SetV(0);
+    lazy_nzcv_.SetFromLogical(reg_size, result & GetUintMask(reg_size));
     LogSystemRegister(NZCV);
   }
 
@@ -2281,7 +2473,7 @@ void Simulator::LoadStoreHelper(const Instruction* instr,
     VIXL_ASSERT(op == PRFM);
   }
 
-  local_monitor_.MaybeClear();
+  MaybeClearLocalMonitor();
 }
 
 
@@ -2418,7 +2610,7 @@ void Simulator::LoadStorePairHelper(const Instruction* instr,
     }
   }
 
-  local_monitor_.MaybeClear();
+  MaybeClearLocalMonitor();
 }
 
 
@@ -2739,14 +2931,14 @@ void Simulator::VisitLoadStoreExclusive(const Instruction* instr) {
         bool do_store = true;
         if (is_exclusive) {
           do_store = local_monitor_.IsExclusive(address, access_size) &&
-                     global_monitor_.IsExclusive(address, access_size);
+                     IsGlobalMonitorExclusive(address, access_size);
           WriteWRegister(rs, do_store ? 0 : 1);
 
           //  - All exclusive stores explicitly clear the local monitor.
           local_monitor_.Clear();
         } else {
           //  - Any other store can clear the local monitor as a side effect.
-          local_monitor_.MaybeClear();
+          MaybeClearLocalMonitor();
         }
 
         if (do_store) {
@@ -3063,7 +3255,7 @@ void Simulator::VisitLoadLiteral(const Instruction* instr) {
       VIXL_UNREACHABLE();
   }
 
-  local_monitor_.MaybeClear();
+  MaybeClearLocalMonitor();
 }
 
 
@@ -3250,34 +3442,80 @@ void Simulator::VisitDataProcessing1Source(const Instruction* instr) {
 }
 
 
-uint32_t Simulator::Poly32Mod2(unsigned n, uint64_t data, uint32_t poly) {
-  VIXL_ASSERT((n > 32) && (n <= 64));
-  for (unsigned i = (n - 1); i >= 32; i--) {
-    if (((data >> i) & 1) != 0) {
-      uint64_t polysh32 = (uint64_t)poly << (i - 32);
-      uint64_t mask = (UINT64_C(1) << i) - 1;
-      data = ((data & mask) ^ polysh32);
+// Slice-by-8 lookup tables for a bit-reflected CRC32 polynomial. `table_[k]`
+// holds the CRC of each byte followed by k zero bytes, so the CRC of up to
+// eight bytes can be computed with one lookup per byte.
+class Simulator::Crc32Tables {
+ public:
+  constexpr explicit Crc32Tables(uint32_t poly) : table_() {
+    uint32_t reflected = 0;
+    for (int i = 0; i < 32; i++) {
+      reflected |= ((poly >> i) & 1) << (31 - i);
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t crc = i;
+      for (int j = 0; j < 8; j++) {
+        crc = (crc >> 1) ^ (((crc & 1) != 0) ? reflected : 0);
+      }
+      table_[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+      for (int i = 0; i < 256; i++) {
+        uint32_t previous = table_[k - 1][i];
+        table_[k][i] = (previous >> 8) ^ table_[0][previous & 0xff];
+      }
     }
   }
-  return data & 0xffffffff;
-}
 
+  template <typename T>
+  uint32_t Update(uint32_t acc, T val) const {
+    const int bytes = sizeof(val);
+    // The accumulator is combined with the low bytes of the value. Any bytes
+    // of the accumulator beyond the value are shifted out unchanged.
+    uint64_t data = static_cast<uint64_t>(val) ^ acc;
+    uint32_t crc = (bytes < 4) ? (acc >> (bytes * 8)) : 0;
+    for (int i = 0; i < bytes; i++) {
+      crc ^= table_[bytes - 1 - i][(data >> (i * 8)) & 0xff];
+    }
+    return crc;
+  }
 
-template <typename T>
-uint32_t Simulator::Crc32Checksum(uint32_t acc, T val, uint32_t poly) {
-  unsigned size = sizeof(val) * 8;  // Number of bits in type T.
-  VIXL_ASSERT((size == 8) || (size == 16) || (size == 32));
-  uint64_t tempacc = static_cast<uint64_t>(ReverseBits(acc)) << size;
-  uint64_t tempval = static_cast<uint64_t>(ReverseBits(val)) << 32;
-  return ReverseBits(Poly32Mod2(32 + size, tempacc ^ tempval, poly));
+ private:
+  uint32_t table_[8][256];
+};
+
+// The constructor is constexpr, so these are initialised statically.
+const Simulator::Crc32Tables Simulator::kCrc32Tables(CRC32_POLY);
+const Simulator::Crc32Tables Simulator::kCrc32cTables(CRC32C_POLY);
+
+#ifdef VIXL_SIMULATOR_HOST_CRC32C
+// The host's CRC32 instruction uses the CRC32C polynomial.
+static uint32_t HostCrc32c(uint32_t acc, uint8_t val) {
+  return _mm_crc32_u8(acc, val);
+}
+static uint32_t HostCrc32c(uint32_t acc, uint16_t val) {
+  return _mm_crc32_u16(acc, val);
+}
+static uint32_t HostCrc32c(uint32_t acc, uint32_t val) {
+  return _mm_crc32_u32(acc, val);
 }
+static uint32_t HostCrc32c(uint32_t acc, uint64_t val) {
+  return static_cast<uint32_t>(_mm_crc32_u64(acc, val));
+}
+#endif
 
 
-uint32_t Simulator::Crc32Checksum(uint32_t acc, uint64_t val, uint32_t poly) {
-  // Poly32Mod2 cannot handle inputs with more than 32 bits, so compute
-  // the CRC of each 32-bit word sequentially.
-  acc = Crc32Checksum(acc, (uint32_t)(val & 0xffffffff), poly);
-  return Crc32Checksum(acc, (uint32_t)(val >> 32), poly);
+template <typename T>
+uint32_t Simulator::Crc32Checksum(uint32_t acc, T val, uint32_t poly) {
+  VIXL_ASSERT((poly == CRC32_POLY) || (poly == CRC32C_POLY));
+  if (poly == CRC32C_POLY) {
+#ifdef VIXL_SIMULATOR_HOST_CRC32C
+    return HostCrc32c(acc, val);
+#else
+    return kCrc32cTables.Update(acc, val);
+#endif
+  }
+  return kCrc32Tables.Update(acc, val);
 }
 
 
@@ -4164,9 +4402,26 @@ void Simulator::VisitFPDataProcessing1Source(const Instruction* instr) {
                      Float16ToRawbits(
                          FPToFloat16(ReadDRegister(fn), FPTieEven, ReadDN())));
       return;
-    case FSQRT_h:
     case FSQRT_s:
     case FSQRT_d:
+      // Unless the result is a NaN, the host result is the architected one.
+      if (vform == kFormatD) {
+        double result = sqrt(ReadDRegister(fn));
+        if (!IsNaN(result)) {
+          WriteDRegister(fd, result, NoRegLog);
+          LogVRegister(fd, GetPrintRegisterFormatFP(vform));
+          return;
+        }
+      } else {
+        float result = sqrt(ReadSRegister(fn));
+        if (!IsNaN(result)) {
+          WriteSRegister(fd, result, NoRegLog);
+          LogVRegister(fd, GetPrintRegisterFormatFP(vform));
+          return;
+        }
+      }
+      VIXL_FALLTHROUGH();
+    case FSQRT_h:
       fsqrt(vform, rd, rn);
       // Explicitly log the register update whilst we have type information.
       LogVRegister(fd, GetPrintRegisterFormatFP(vform));
@@ -4238,9 +4493,70 @@ void Simulator::VisitFPDataProcessing1Source(const Instruction* instr) {
 }
 
 
+// Compute `op1 <op> op2` with host arithmetic, for the operations where host
+// and architected results agree (see HostFPAdd()). NaN operands and
+// results need the architectural propagation rules, so in that case this
+// returns false, and the general path must be used.
+template <typename T>
+static bool HostFPDataProcessing2Source(uint32_t op, T op1, T op2, T* result) {
+  if (IsNaN(op1) || IsNaN(op2)) return false;
+  switch (op) {
+    case FADD:
+      *result = HostFPAdd(op1, op2);
+      break;
+    case FSUB:
+      *result = HostFPSub(op1, op2);
+      break;
+    case FMUL:
+      *result = HostFPMul(op1, op2);
+      break;
+    case FDIV:
+      *result = HostFPDiv(op1, op2);
+      break;
+    case FMAX:
+    case FMAXNM:
+      *result = HostFPMax(op1, op2);
+      break;
+    case FMIN:
+    case FMINNM:
+      *result = HostFPMin(op1, op2);
+      break;
+    default:
+      return false;
+  }
+  return !IsNaN(*result);
+}
+
+
 void Simulator::VisitFPDataProcessing2Source(const Instruction* instr) {
   AssertSupportedFPCR();
 
+  unsigned fd = instr->GetRd();
+  unsigned fn = instr->GetRn();
+  unsigned fm = instr->GetRm();
+  uint32_t op = instr->Mask(FPDataProcessing2SourceMask & ~FPTypeMask);
+  if (instr->Mask(FPTypeMask) == FP64) {
+    double result;
+    if (HostFPDataProcessing2Source(op,
+                                    ReadDRegister(fn),
+                                    ReadDRegister(fm),
+                                    &result)) {
+      WriteDRegister(fd, result, NoRegLog);
+      LogVRegister(fd, GetPrintRegisterFormatFP(kFormatD));
+      return;
+    }
+  } else if (instr->Mask(FPTypeMask) == FP32) {
+    float result;
+    if (HostFPDataProcessing2Source(op,
+                                    ReadSRegister(fn),
+                                    ReadSRegister(fm),
+                                    &result)) {
+      WriteSRegister(fd, result, NoRegLog);
+      LogVRegister(fd, GetPrintRegisterFormatFP(kFormatS));
+      return;
+    }
+  }
+
   VectorFormat vform;
   switch (instr->Mask(FPTypeMask)) {
     default:
@@ -4255,9 +4571,9 @@ void Simulator::VisitFPDataProcessing2Source(const Instruction* instr) {
       vform = kFormatH;
       break;
   }
-  SimVRegister& rd = ReadVRegister(instr->GetRd());
-  SimVRegister& rn = ReadVRegister(instr->GetRn());
-  SimVRegister& rm = ReadVRegister(instr->GetRm());
+  SimVRegister& rd = ReadVRegister(fd);
+  SimVRegister& rn = ReadVRegister(fn);
+  SimVRegister& rm = ReadVRegister(fm);
 
   switch (instr->Mask(FPDataProcessing2SourceMask)) {
     case FADD_h:
@@ -4309,7 +4625,7 @@ void Simulator::VisitFPDataProcessing2Source(const Instruction* instr) {
       VIXL_UNREACHABLE();
   }
   // Explicitly log the register update whilst we have type information.
-  LogVRegister(instr->GetRd(), GetPrintRegisterFormatFP(vform));
+  LogVRegister(fd, GetPrintRegisterFormatFP(vform));
 }
 
 
@@ -4548,9 +4864,19 @@ void Simulator::VisitSystem(const Instruction* instr) {
             break;
           case RNDR:
           case RNDRRS: {
-            uint64_t high = jrand48(rand_state_);
-            uint64_t low = jrand48(rand_state_);
-            uint64_t rand_num = (high << 32) | (low & 0xffffffff);
+            uint64_t rand_num;
+            if (replay_mode_ == kReplay) {
+              rand_num = replay_log_->ReplayValue<uint64_t>(
+                  SimReplayLog::kRandomNumber);
+            } else {
+              uint64_t high = jrand48(rand_state_);
+              uint64_t low = jrand48(rand_state_);
+              rand_num = (high << 32) | (low & 0xffffffff);
+              if (replay_mode_ == kRecord) {
+                replay_log_->RecordValue(SimReplayLog::kRandomNumber,
+                                         rand_num);
+              }
+            }
             WriteXRegister(instr->GetRt(), rand_num);
             // Simulate successful random number generation.
             // TODO: Return failure occasionally as a random number cannot be
@@ -4666,17 +4992,75 @@ void Simulator::VisitException(const Instruction* instr) {
 
 
 void Simulator::VisitCrypto2RegSHA(const Instruction* instr) {
-  VisitUnimplemented(instr);
+  SimVRegister& rd = ReadVRegister(instr->GetRd());
+  SimVRegister& rn = ReadVRegister(instr->GetRn());
+
+  switch (instr->Mask(Crypto2RegSHAMask)) {
+    case SHA1H:
+      sha1h(rd, rn);
+      break;
+    case SHA1SU1:
+      sha1su1(rd, rn);
+      break;
+    case SHA256SU0:
+      sha256su0(rd, rn);
+      break;
+    default:
+      VIXL_UNIMPLEMENTED();
+  }
 }
 
 
 void Simulator::VisitCrypto3RegSHA(const Instruction* instr) {
-  VisitUnimplemented(instr);
+  SimVRegister& rd = ReadVRegister(instr->GetRd());
+  SimVRegister& rn = ReadVRegister(instr->GetRn());
+  SimVRegister& rm = ReadVRegister(instr->GetRm());
+
+  Instr op = instr->Mask(Crypto3RegSHAMask);
+  switch (op) {
+    case SHA1C:
+    case SHA1P:
+    case SHA1M:
+      sha1(rd, rn, rm, op);
+      break;
+    case SHA1SU0:
+      sha1su0(rd, rn, rm);
+      break;
+    case SHA256H:
+      sha256h(rd, rn, rm, true);
+      break;
+    case SHA256H2:
+      sha256h(rd, rn, rm, false);
+      break;
+    case SHA256SU1:
+      sha256su1(rd, rn, rm);
+      break;
+    default:
+      VIXL_UNIMPLEMENTED();
+  }
 }
 
 
 void Simulator::VisitCryptoAES(const Instruction* instr) {
-  VisitUnimplemented(instr);
+  SimVRegister& rd = ReadVRegister(instr->GetRd());
+  SimVRegister& rn = ReadVRegister(instr->GetRn());
+
+  switch (instr->Mask(CryptoAESMask)) {
+    case AESE:
+      aes(rd, rn, false);
+      break;
+    case AESD:
+      aes(rd, rn, true);
+      break;
+    case AESMC:
+      aesmix(rd, rn, false);
+      break;
+    case AESIMC:
+      aesmix(rd, rn, true);
+      break;
+    default:
+      VIXL_UNIMPLEMENTED();
+  }
 }
 
 
@@ -5442,6 +5826,21 @@ void Simulator::VisitNEON3Different(const Instruction* instr) {
   SimVRegister& rn = ReadVRegister(instr->GetRn());
   SimVRegister& rm = ReadVRegister(instr->GetRm());
 
+  // PMULL and PMULL2 with 64-bit elements produce a single 128-bit element,
+  // which the long format map can't describe.
+  if (instr->GetNEONSize() == 3) {
+    switch (instr->Mask(NEON3DifferentMask)) {
+      case NEON_PMULL:
+        pmull64(rd, rn, rm, 0);
+        return;
+      case NEON_PMULL2:
+        pmull64(rd, rn, rm, 1);
+        return;
+      default:
+        break;
+    }
+  }
+
   switch (instr->Mask(NEON3DifferentMask)) {
     case NEON_PMULL:
       pmull(vf_l, rd, rn, rm);
@@ -11930,6 +12329,13 @@ void Simulator::DoPrintf(const Instruction* instr) {
 
   printf("%s", clr_normal);
 
+  // The result depends on the host's stdout.
+  if (replay_mode_ == kRecord) {
+    replay_log_->RecordValue(SimReplayLog::kPrintfResult, result);
+  } else if (replay_mode_ == kReplay) {
+    result = replay_log_->ReplayValue<int>(SimReplayLog::kPrintfResult);
+  }
+
   // Printf returns its result in x0 (just like the C library's printf).
   WriteXRegister(0, result);
 
@@ -27,6 +27,7 @@
 #ifndef VIXL_AARCH64_SIMULATOR_AARCH64_H_
 #define VIXL_AARCH64_SIMULATOR_AARCH64_H_
 
+#include <algorithm>
 #include <vector>
 
 #include "../globals-vixl.h"
@@ -109,7 +110,31 @@ class SimRegisterBase {
   static const unsigned kMaxSizeInBytes = kMaxSizeInBits / kBitsPerByte;
   VIXL_STATIC_ASSERT((kMaxSizeInBytes * kBitsPerByte) == kMaxSizeInBits);
 
-  SimRegisterBase() : size_in_bytes_(kMaxSizeInBytes) { Clear(); }
+  SimRegisterBase()
+      : size_in_bytes_(kMaxSizeInBytes), written_bytes_(kMaxSizeInBytes) {
+    Clear();
+  }
+
+  SimRegisterBase(const SimRegisterBase& other)
+      : size_in_bytes_(kMaxSizeInBytes), written_bytes_(kMaxSizeInBytes) {
+    Clear();
+    *this = other;
+  }
+
+  // Only the bytes which might be non-zero are copied, so copying a register
+  // that was only used for NEON or scalar values is cheap.
+  SimRegisterBase& operator=(const SimRegisterBase& other) {
+    if (written_bytes_ > other.written_bytes_) {
+      memset(&value_[other.written_bytes_],
+             0,
+             written_bytes_ - other.written_bytes_);
+    }
+    memcpy(value_, other.value_, other.written_bytes_);
+    size_in_bytes_ = other.size_in_bytes_;
+    written_bytes_ = other.written_bytes_;
+    NotifyRegisterWrite();
+    return *this;
+  }
 
   unsigned GetSizeInBits() const { return size_in_bytes_ * kBitsPerByte; }
   unsigned GetSizeInBytes() const { return size_in_bytes_; }
@@ -138,7 +163,20 @@ class SimRegisterBase {
   }
 
   void Clear() {
-    memset(value_, 0, kMaxSizeInBytes);
+    memset(value_, 0, written_bytes_);
+    written_bytes_ = 0;
+    NotifyRegisterWrite();
+  }
+
+  // Clear the bytes from `offset` up to the current size of the register, as
+  // for a zero-extending write of `offset` bytes.
+  void ClearUpperBytes(unsigned offset) {
+    if (offset >= size_in_bytes_) return;
+    unsigned end = std::min(written_bytes_, size_in_bytes_);
+    if (end > offset) {
+      memset(&value_[offset], 0, end - offset);
+      if (written_bytes_ == end) written_bytes_ = offset;
+    }
     NotifyRegisterWrite();
   }
 
@@ -194,6 +232,11 @@ class SimRegisterBase {
 
   unsigned size_in_bytes_;
 
+  // All bytes from this offset to the end of `value_` are zero, so they don't
+  // need to be cleared again. For example, a NEON-only program never writes
+  // beyond the first 16 bytes of a vector register.
+  unsigned written_bytes_;
+
   // Helpers to aid with register tracing.
   bool written_since_last_log_;
 
@@ -211,6 +254,8 @@ class SimRegisterBase {
   void WriteLane(T src, int lane) {
     VIXL_ASSERT(lane >= 0);
     VIXL_ASSERT((sizeof(src) + (lane * sizeof(src))) <= GetSizeInBytes());
+    unsigned end = static_cast<unsigned>((lane + 1) * sizeof(src));
+    written_bytes_ = std::max(written_bytes_, end);
     memcpy(&value_[lane * sizeof(src)], &src, sizeof(src));
   }
 
@@ -356,13 +401,13 @@ class LogicVRegister {
  public:
   inline LogicVRegister(
       SimVRegister& other)  // NOLINT(runtime/references)(runtime/explicit)
-      : register_(other) {
-    for (size_t i = 0; i < ArrayLength(saturated_); i++) {
-      saturated_[i] = kNotSaturated;
-    }
-    for (size_t i = 0; i < ArrayLength(round_); i++) {
-      round_[i] = 0;
-    }
+      : register_(other), state_lanes_(0) {}
+
+  // Only copy the lanes with saturation or rounding state.
+  LogicVRegister(const LogicVRegister& other)
+      : register_(other.register_), state_lanes_(other.state_lanes_) {
+    memcpy(saturated_, other.saturated_, state_lanes_ * sizeof(saturated_[0]));
+    memcpy(round_, other.round_, state_lanes_ * sizeof(round_[0]));
   }
 
   int64_t Int(VectorFormat vform, int index) const {
@@ -630,10 +675,7 @@ class LogicVRegister {
     // SVE destinations write whole registers, so we have nothing to clear.
     if (IsSVEFormat(vform)) return;
 
-    unsigned size = RegisterSizeInBytesFromFormat(vform);
-    for (unsigned i = size; i < register_.GetSizeInBytes(); i++) {
-      SetUint(kFormat16B, i, 0);
-    }
+    register_.ClearUpperBytes(RegisterSizeInBytesFromFormat(vform));
   }
 
   // Saturation state for each lane of a vector.
@@ -651,15 +693,17 @@ class LogicVRegister {
 
   // Getters for saturation state.
   Saturation GetSignedSaturation(int index) {
-    return static_cast<Saturation>(saturated_[index] & kSignedSatMask);
+    return static_cast<Saturation>(GetSaturation(index) & kSignedSatMask);
   }
 
   Saturation GetUnsignedSaturation(int index) {
-    return static_cast<Saturation>(saturated_[index] & kUnsignedSatMask);
+    return static_cast<Saturation>(GetSaturation(index) & kUnsignedSatMask);
   }
 
   // Setters for saturation state.
-  void ClearSat(int index) { saturated_[index] = kNotSaturated; }
+  void ClearSat(int index) {
+    if (index < state_lanes_) saturated_[index] = kNotSaturated;
+  }
 
   void SetSignedSat(int index, bool positive) {
     SetSatFlag(index, positive ? kSignedSatPositive : kSignedSatNegative);
@@ -670,6 +714,7 @@ class LogicVRegister {
   }
 
   void SetSatFlag(int index, Saturation sat) {
+    PrepareState(index);
     saturated_[index] = static_cast<Saturation>(saturated_[index] | sat);
     VIXL_ASSERT((sat & kUnsignedSatMask) != kUnsignedSatUndefined);
     VIXL_ASSERT((sat & kSignedSatMask) != kSignedSatUndefined);
@@ -701,10 +746,15 @@ class LogicVRegister {
   }
 
   // Getter for rounding state.
-  bool GetRounding(int index) { return round_[index]; }
+  bool GetRounding(int index) {
+    return (index < state_lanes_) && round_[index];
+  }
 
   // Setter for rounding state.
-  void SetRounding(int index, bool round) { round_[index] = round; }
+  void SetRounding(int index, bool round) {
+    PrepareState(index);
+    round_[index] = round;
+  }
 
   // Round lanes of a vector based on rounding state.
   LogicVRegister& Round(VectorFormat vform) {
@@ -758,8 +808,26 @@ class LogicVRegister {
   }
 
  private:
+  Saturation GetSaturation(int index) const {
+    return (index < state_lanes_) ? saturated_[index] : kNotSaturated;
+  }
+
+  // Initialise the state of the lanes up to `index`.
+  void PrepareState(int index) {
+    VIXL_ASSERT(index < static_cast<int>(ArrayLength(saturated_)));
+    for (; state_lanes_ <= index; state_lanes_++) {
+      saturated_[state_lanes_] = kNotSaturated;
+      round_[state_lanes_] = false;
+    }
+  }
+
   SimVRegister& register_;
 
+  // Most operations don't use the saturation and rounding state, so it is only
+  // initialised when it is first written. Lanes from `state_lanes_` onwards
+  // are neither saturated nor rounded.
+  int state_lanes_;
+
   // Allocate one saturation state entry per lane; largest register is type Q,
   // and lanes can be a minimum of one byte wide.
   Saturation saturated_[kZRegMaxSizeInBytes];
@@ -936,6 +1004,81 @@ class SimSystemRegister {
 };
 
 
+// The NZCV flags of the last flag-setting arithmetic or logical instruction,
+// recorded as its operands and result. Each flag is only computed when it is
+// read; in typical code, most of them are overwritten by the next
+// flag-setting instruction before anything reads them.
+class SimLazyNzcv {
+ public:
+  SimLazyNzcv() : kind_(kUpToDate) {}
+
+  // Return true if the flags have been recorded here, but not written back to
+  // the NZCV register.
+  bool IsPending() const { return kind_ != kUpToDate; }
+  void Clear() { kind_ = kUpToDate; }
+
+  // `left`, `right` and `result` must already be masked to `reg_size`.
+  void SetFromAddWithCarry(unsigned reg_size,
+                           uint64_t left,
+                           uint64_t right,
+                           int carry_in,
+                           uint64_t result) {
+    kind_ = kAddWithCarry;
+    sign_mask_ = GetSignMask(reg_size);
+    left_ = left;
+    right_ = right;
+    carry_in_ = carry_in;
+    result_ = result;
+  }
+
+  // Logical instructions set N and Z from the result, and clear C and V.
+  void SetFromLogical(unsigned reg_size, uint64_t result) {
+    kind_ = kLogical;
+    sign_mask_ = GetSignMask(reg_size);
+    result_ = result;
+  }
+
+  bool GetN() const {
+    VIXL_ASSERT(IsPending());
+    return (result_ & sign_mask_) != 0;
+  }
+
+  bool GetZ() const {
+    VIXL_ASSERT(IsPending());
+    return result_ == 0;
+  }
+
+  bool GetC() const {
+    VIXL_ASSERT(IsPending());
+    if (kind_ == kLogical) return false;
+    // Compare the result to the max unsigned integer.
+    uint64_t max_uint_2op = ((sign_mask_ << 1) - 1) - carry_in_;
+    return (left_ > max_uint_2op) || ((max_uint_2op - left_) < right_);
+  }
+
+  bool GetV() const {
+    VIXL_ASSERT(IsPending());
+    if (kind_ == kLogical) return false;
+    // Overflow iff the sign bit is the same for the two inputs and different
+    // for the result.
+    uint64_t left_sign = left_ & sign_mask_;
+    uint64_t right_sign = right_ & sign_mask_;
+    uint64_t result_sign = result_ & sign_mask_;
+    return (left_sign == right_sign) && (left_sign != result_sign);
+  }
+
+ private:
+  enum Kind { kUpToDate, kAddWithCarry, kLogical };
+
+  Kind kind_;
+  uint64_t sign_mask_;
+  uint64_t left_;
+  uint64_t right_;
+  uint64_t result_;
+  int carry_in_;
+};
+
+
 class SimExclusiveLocalMonitor {
  public:
   SimExclusiveLocalMonitor() : kSkipClearProbability(8), seed_(0x87654321) {
@@ -948,6 +1091,9 @@ class SimExclusiveLocalMonitor {
     size_ = 0;
   }
 
+  // Return true if an address range is marked for exclusive access.
+  bool IsMarked() const { return size_ != 0; }
+
   // Clear the exclusive monitor most of the time.
   void MaybeClear() {
     if ((seed_ % kSkipClearProbability) != 0) {
@@ -1003,6 +1149,169 @@ class SimExclusiveGlobalMonitor {
 };
 
 
+// A compact log of the inputs to a simulation that don't come from the
+// simulated code or memory:
+//  - the values returned by runtime calls and by the simulated printf,
+//  - the values read from RNDR and RNDRRS,
+//  - the pseudo-random decisions of the exclusive monitors.
+// A Simulator records these with `SetReplayLog(Simulator::kRecord, &log)`. The
+// log can be saved with `WriteTo()`, and loaded with `ReadFrom()`. Running the
+// same code from the same initial state with `SetReplayLog(Simulator::kReplay,
+// &log)` then reproduces the recorded run exactly, so a failure can be
+// replayed at full speed, and traced only near the point where it happens
+// (for example with `Simulator::RunFor()`).
+//
+// Functions called by runtime calls, and the simulated printf, still run during
+// replay, so their side effects happen again, but the results they returned
+// when the log was recorded are used.
+class SimReplayLog {
+ public:
+  enum EntryType : uint8_t {
+    kRuntimeCallResult,
+    kPrintfResult,
+    kRandomNumber
+  };
+
+  SimReplayLog() : bits_read_(0), bytes_read_(0) {}
+
+  void Clear() {
+    bits_.clear();
+    data_.clear();
+    Rewind();
+  }
+
+  // Replay from the start of the log.
+  void Rewind() {
+    bits_read_ = 0;
+    bytes_read_ = 0;
+  }
+
+  // Return true if every recorded input has been replayed.
+  bool IsAtEnd() const {
+    return (bits_read_ == bits_.size()) && (bytes_read_ == data_.size());
+  }
+
+  size_t GetSizeInBytes() const {
+    return ((bits_.size() + kBitsPerByte - 1) / kBitsPerByte) + data_.size();
+  }
+
+  void RecordBit(bool bit) { bits_.push_back(bit); }
+  bool ReplayBit() {
+    VIXL_CHECK(bits_read_ < bits_.size());
+    return bits_[bits_read_++];
+  }
+
+  template <typename T>
+  void RecordValue(EntryType type, T value) {
+    VIXL_STATIC_ASSERT(sizeof(value) <= sizeof(uint64_t));
+    uint64_t raw = 0;
+    memcpy(&raw, &value, sizeof(value));
+    RecordRawValue(type, raw);
+  }
+
+  // Abort if the next entry doesn't have the expected type, which means that
+  // the simulation has diverged from the recorded run.
+  template <typename T>
+  T ReplayValue(EntryType type) {
+    VIXL_STATIC_ASSERT(sizeof(T) <= sizeof(uint64_t));
+    uint64_t raw = ReplayRawValue(type);
+    T value;
+    memcpy(&value, &raw, sizeof(value));
+    return value;
+  }
+
+  // Return false if the file couldn't be written or read. Reading a log
+  // replaces the current content, and rewinds it.
+  bool WriteTo(FILE* file) const;
+  bool ReadFrom(FILE* file);
+
+ private:
+  void RecordRawValue(EntryType type, uint64_t raw);
+  uint64_t ReplayRawValue(EntryType type);
+
+  // Monitor decisions are single bits, and are kept apart from the values.
+  std::vector<bool> bits_;
+  // Each value is an EntryType followed by the value in ULEB128 format.
+  std::vector<uint8_t> data_;
+
+  size_t bits_read_;
+  size_t bytes_read_;
+};
+
+
+// The architectural state of a simulated thread of execution: its registers,
+// flags, FPCR and PC. Many contexts can share a single Simulator (and Decoder)
+// by swapping them in and out with `Simulator::RestoreContext()` and
+// `Simulator::SaveContext()`, and running each for a limited number of
+// instructions with `Simulator::RunFor()`:
+//
+//   simulator.RestoreContext(context);
+//   Simulator::RunStatus status = simulator.RunFor(1000);
+//   simulator.SaveContext(&context);
+//
+// A context is initialised by saving the state of a Simulator, after setting
+// up its registers and PC. Memory, including the stack, is not part of the
+// context, so each context needs its own stack if the code uses one.
+class SimContext {
+ public:
+  SimContext() : pc_(NULL), movprfx_(NULL), btype_(DefaultBType) {}
+
+  const Instruction* ReadPc() const { return pc_; }
+
+ private:
+  friend class Simulator;
+
+  SimRegister registers_[kNumberOfRegisters];
+  SimVRegister vregisters_[kNumberOfVRegisters];
+  SimPRegister pregisters_[kNumberOfPRegisters];
+  SimFFRRegister ffr_register_;
+  SimSystemRegister nzcv_;
+  SimSystemRegister fpcr_;
+  const Instruction* pc_;
+  const Instruction* movprfx_;
+  BType btype_;
+};
+
+
+// Host implementations of the simulated FP operations, for operands that
+// aren't NaNs. The simulator only supports FPCR.FZ == 0 and round-to-nearest,
+// so unless these return a NaN, their result is the architected one. NaN
+// results need the Simulator's FP<Op> helpers, such as Simulator::FPAdd().
+template <typename T>
+T HostFPAdd(T op1, T op2) {
+  return op1 + op2;
+}
+
+template <typename T>
+T HostFPSub(T op1, T op2) {
+  return op1 - op2;
+}
+
+template <typename T>
+T HostFPMul(T op1, T op2) {
+  return op1 * op2;
+}
+
+template <typename T>
+T HostFPDiv(T op1, T op2) {
+  return op1 / op2;
+}
+
+// Equal operands can only differ in the sign of zero, where +0.0 is the
+// maximum and -0.0 the minimum.
+template <typename T>
+T HostFPMax(T a, T b) {
+  if (a == b) return (copysign(1.0, a) < 0.0) ? b : a;
+  return (a > b) ? a : b;
+}
+
+template <typename T>
+T HostFPMin(T a, T b) {
+  if (a == b) return (copysign(1.0, a) < 0.0) ? a : b;
+  return (a < b) ? a : b;
+}
+
+
 class Simulator : public DecoderVisitor {
  public:
   explicit Simulator(Decoder* decoder, FILE* stream = stdout);
@@ -1014,6 +1323,29 @@ class Simulator : public DecoderVisitor {
   virtual void Run();
   void RunFrom(const Instruction* first);
 
+  enum RunStatus { kEndOfSimulationReached, kInstructionBudgetExhausted };
+
+  // Run at most `instruction_budget` instructions from the current PC. If the
+  // simulation hasn't ended, it can be resumed with another call to RunFor()
+  // or Run(), possibly after swapping contexts.
+  RunStatus RunFor(uint64_t instruction_budget);
+
+  // Swap the architectural state in and out of the simulator. Contexts must
+  // have been saved with the same vector length. Restoring a context clears
+  // the exclusive monitor, as a context switch would on hardware.
+  void SaveContext(SimContext* context);
+  void RestoreContext(const SimContext& context);
+
+  // Record the nondeterministic inputs to the simulation in `log`, or replay
+  // them from it (from its current position). See SimReplayLog.
+  enum ReplayMode { kReplayDisabled, kRecord, kReplay };
+  void SetReplayLog(ReplayMode mode, SimReplayLog* log) {
+    VIXL_ASSERT((mode == kReplayDisabled) == (log == NULL));
+    replay_mode_ = mode;
+    replay_log_ = log;
+  }
+  ReplayMode GetReplayMode() const { return replay_mode_; }
+
 
 #if defined(VIXL_HAS_ABI_SUPPORT) && __cplusplus >= 201103L && \
     (defined(__clang__) || GCC_VERSION_OR_NEWER(4, 9, 1))
@@ -1727,19 +2059,34 @@ class Simulator : public DecoderVisitor {
     }
   }
 
-  bool ReadN() const { return nzcv_.GetN() != 0; }
+  // The individual flags can be read without updating nzcv_, so conditional
+  // instructions leave pending flags pending.
+  bool ReadN() const {
+    return lazy_nzcv_.IsPending() ? lazy_nzcv_.GetN() : (nzcv_.GetN() != 0);
+  }
   VIXL_DEPRECATED("ReadN", bool N() const) { return ReadN(); }
 
-  bool ReadZ() const { return nzcv_.GetZ() != 0; }
+  bool ReadZ() const {
+    return lazy_nzcv_.IsPending() ? lazy_nzcv_.GetZ() : (nzcv_.GetZ() != 0);
+  }
   VIXL_DEPRECATED("ReadZ", bool Z() const) { return ReadZ(); }
 
-  bool ReadC() const { return nzcv_.GetC() != 0; }
+  bool ReadC() const {
+    return lazy_nzcv_.IsPending() ? lazy_nzcv_.GetC() : (nzcv_.GetC() != 0);
+  }
   VIXL_DEPRECATED("ReadC", bool C() const) { return ReadC(); }
 
-  bool ReadV() const { return nzcv_.GetV() != 0; }
+  bool ReadV() const {
+    return lazy_nzcv_.IsPending() ? lazy_nzcv_.GetV() : (nzcv_.GetV() != 0);
+  }
   VIXL_DEPRECATED("ReadV", bool V() const) { return ReadV(); }
 
-  SimSystemRegister& ReadNzcv() { return nzcv_; }
+  // Any pending flags are written back before the register is returned, so it
+  // can be read or modified directly.
+  SimSystemRegister& ReadNzcv() {
+    if (lazy_nzcv_.IsPending()) MaterializeNzcv();
+    return nzcv_;
+  }
   VIXL_DEPRECATED("ReadNzcv", SimSystemRegister& nzcv()) { return ReadNzcv(); }
 
   // TODO: Find a way to make the fpcr_ members return the proper types, so
@@ -2527,6 +2874,14 @@ class Simulator : public DecoderVisitor {
     R return_value = DoRuntimeCall(function,
                                    argument_operands,
                                    __local_index_sequence_for<P...>{});
+    // The function is still called during replay, for its side effects, but
+    // the result it returned when the log was recorded is used.
+    if (replay_mode_ == kRecord) {
+      replay_log_->RecordValue(SimReplayLog::kRuntimeCallResult, return_value);
+    } else if (replay_mode_ == kReplay) {
+      return_value =
+          replay_log_->ReplayValue<R>(SimReplayLog::kRuntimeCallResult);
+    }
     WriteGenericOperand(abi.GetReturnGenericOperand<R>(), return_value);
   }
 
@@ -2943,6 +3298,36 @@ class Simulator : public DecoderVisitor {
                       LogicVRegister dst,
                       const LogicVRegister& src1,
                       const LogicVRegister& src2);
+  // Crypto helpers. These always operate on the full Q register.
+  LogicVRegister aes(LogicVRegister srcdst,
+                     const LogicVRegister& src,
+                     bool decrypt);
+  LogicVRegister aesmix(LogicVRegister dst,
+                        const LogicVRegister& src,
+                        bool inverse);
+  LogicVRegister sha1(LogicVRegister srcdst,
+                      const LogicVRegister& src1,
+                      const LogicVRegister& src2,
+                      Instr op);
+  LogicVRegister sha1h(LogicVRegister dst, const LogicVRegister& src);
+  LogicVRegister sha1su0(LogicVRegister srcdst,
+                         const LogicVRegister& src1,
+                         const LogicVRegister& src2);
+  LogicVRegister sha1su1(LogicVRegister srcdst, const LogicVRegister& src);
+  LogicVRegister sha256h(LogicVRegister srcdst,
+                         const LogicVRegister& src1,
+                         const LogicVRegister& src2,
+                         bool part1);
+  LogicVRegister sha256su0(LogicVRegister srcdst, const LogicVRegister& src);
+  LogicVRegister sha256su1(LogicVRegister srcdst,
+                           const LogicVRegister& src1,
+                           const LogicVRegister& src2);
+  // Polynomial multiply of the 64-bit elements at `index`, producing a 128-bit
+  // result.
+  LogicVRegister pmull64(LogicVRegister dst,
+                         const LogicVRegister& src1,
+                         const LogicVRegister& src2,
+                         int index);
   LogicVRegister udiv(VectorFormat vform,
                       LogicVRegister dst,
                       const LogicVRegister& src1,
@@ -3882,26 +4267,26 @@ class Simulator : public DecoderVisitor {
   NEON_3VREG_LOGIC_LIST(DEFINE_LOGIC_FUNC)
 #undef DEFINE_LOGIC_FUNC
 
-#define NEON_FP3SAME_LIST(V) \
-  V(fadd, FPAdd, false)      \
-  V(fsub, FPSub, true)       \
-  V(fmul, FPMul, true)       \
-  V(fmulx, FPMulx, true)     \
-  V(fdiv, FPDiv, true)       \
-  V(fmax, FPMax, false)      \
-  V(fmin, FPMin, false)      \
-  V(fmaxnm, FPMaxNM, false)  \
-  V(fminnm, FPMinNM, false)
-
-#define DECLARE_NEON_FP_VECTOR_OP(FN, OP, PROCNAN) \
-  template <typename T>                            \
-  LogicVRegister FN(VectorFormat vform,            \
-                    LogicVRegister dst,            \
-                    const LogicVRegister& src1,    \
-                    const LogicVRegister& src2);   \
-  LogicVRegister FN(VectorFormat vform,            \
-                    LogicVRegister dst,            \
-                    const LogicVRegister& src1,    \
+#define NEON_FP3SAME_LIST(V)            \
+  V(fadd, FPAdd, false, HostFPAdd)      \
+  V(fsub, FPSub, true, HostFPSub)       \
+  V(fmul, FPMul, true, HostFPMul)       \
+  V(fmulx, FPMulx, true, HostFPMul)     \
+  V(fdiv, FPDiv, true, HostFPDiv)       \
+  V(fmax, FPMax, false, HostFPMax)      \
+  V(fmin, FPMin, false, HostFPMin)      \
+  V(fmaxnm, FPMaxNM, false, HostFPMax)  \
+  V(fminnm, FPMinNM, false, HostFPMin)
+
+#define DECLARE_NEON_FP_VECTOR_OP(FN, OP, PROCNAN, HOSTOP) \
+  template <typename T>                                    \
+  LogicVRegister FN(VectorFormat vform,                    \
+                    LogicVRegister dst,                    \
+                    const LogicVRegister& src1,            \
+                    const LogicVRegister& src2);           \
+  LogicVRegister FN(VectorFormat vform,                    \
+                    LogicVRegister dst,                    \
+                    const LogicVRegister& src1,            \
                     const LogicVRegister& src2);
   NEON_FP3SAME_LIST(DECLARE_NEON_FP_VECTOR_OP)
 #undef DECLARE_NEON_FP_VECTOR_OP
@@ -4227,10 +4612,11 @@ class Simulator : public DecoderVisitor {
 
   static const uint32_t CRC32_POLY = 0x04C11DB7;
   static const uint32_t CRC32C_POLY = 0x1EDC6F41;
-  uint32_t Poly32Mod2(unsigned n, uint64_t data, uint32_t poly);
+  class Crc32Tables;
+  static const Crc32Tables kCrc32Tables;
+  static const Crc32Tables kCrc32cTables;
   template <typename T>
   uint32_t Crc32Checksum(uint32_t acc, T val, uint32_t poly);
-  uint32_t Crc32Checksum(uint32_t acc, uint64_t val, uint32_t poly);
 
   void SysOp_W(int op, int64_t val);
 
@@ -4456,6 +4842,14 @@ class Simulator : public DecoderVisitor {
   SimExclusiveLocalMonitor local_monitor_;
   SimExclusiveGlobalMonitor global_monitor_;
 
+  // The exclusive monitors are pseudo-random, so their decisions go through
+  // these helpers, which record or replay them.
+  void MaybeClearLocalMonitor();
+  bool IsGlobalMonitorExclusive(uint64_t address, size_t size);
+
+  ReplayMode replay_mode_;
+  SimReplayLog* replay_log_;
+
   // Output stream.
   FILE* stream_;
   PrintDisassembler* print_disasm_;
@@ -4478,7 +4872,10 @@ class Simulator : public DecoderVisitor {
   // Program Status Register.
   // bits[31, 27]: Condition flags N, Z, C, and V.
   //               (Negative, Zero, Carry, Overflow)
+  // This is only up to date if `lazy_nzcv_` is not pending; use ReadNzcv().
   SimSystemRegister nzcv_;
+  SimLazyNzcv lazy_nzcv_;
+  void MaterializeNzcv();
 
   // Floating-Point Control Register
   SimSystemRegister fpcr_;
@@ -4554,6 +4951,21 @@ class Simulator : public DecoderVisitor {
   static const PACKey kPACKeyDB;
   static const PACKey kPACKeyGA;
 
+  // A direct-mapped cache of ComputePAC results, so that code which signs and
+  // authenticates the same pointers repeatedly (such as return addresses)
+  // doesn't recompute them. Entries are tagged with the whole key, so they
+  // never need to be invalidated.
+  struct PACCacheEntry {
+    uint64_t data;
+    uint64_t context;
+    uint64_t key_high;
+    uint64_t key_low;
+    uint64_t pac;
+    bool valid;
+  };
+  static const int kPACCacheSizeLog2 = 8;
+  PACCacheEntry pac_cache_[1 << kPACCacheSizeLog2];
+
   bool CanReadMemory(uintptr_t address, size_t size);
 
   // CanReadMemory needs dummy file descriptors, so we use a pipe. We can save
@@ -37,9 +37,33 @@ namespace vixl {
 CodeBuffer::CodeBuffer(size_t capacity)
     : buffer_(NULL),
       managed_(true),
-      cursor_(NULL),
+      cursor_(0),
       dirty_(false),
-      capacity_(capacity) {
+      capacity_(capacity),
+      size_only_(false) {
+  Allocate();
+}
+
+
+CodeBuffer::CodeBuffer(byte* buffer, size_t capacity)
+    : buffer_(reinterpret_cast<byte*>(buffer)),
+      managed_(false),
+      cursor_(0),
+      dirty_(false),
+      capacity_(capacity),
+      size_only_(false) {
+  VIXL_ASSERT(buffer_ != NULL);
+}
+
+
+CodeBuffer::~CodeBuffer() VIXL_NEGATIVE_TESTING_ALLOW_EXCEPTION {
+  VIXL_ASSERT(!IsDirty());
+  if (managed_) Deallocate();
+}
+
+
+void CodeBuffer::Allocate() {
+  VIXL_ASSERT(managed_ && (buffer_ == NULL));
   if (capacity_ == 0) {
     return;
   }
@@ -47,7 +71,7 @@ CodeBuffer::CodeBuffer(size_t capacity)
   buffer_ = reinterpret_cast<byte*>(malloc(capacity_));
 #elif defined(VIXL_CODE_BUFFER_MMAP)
   buffer_ = reinterpret_cast<byte*>(mmap(NULL,
-                                         capacity,
+                                         capacity_,
                                          PROT_READ | PROT_WRITE,
                                          MAP_PRIVATE | MAP_ANONYMOUS,
                                          -1,
@@ -59,36 +83,40 @@ CodeBuffer::CodeBuffer(size_t capacity)
   // Aarch64 instructions must be word aligned, we assert the default allocator
   // always returns word align memory.
   VIXL_ASSERT(IsWordAligned(buffer_));
-
-  cursor_ = buffer_;
-}
-
-
-CodeBuffer::CodeBuffer(byte* buffer, size_t capacity)
-    : buffer_(reinterpret_cast<byte*>(buffer)),
-      managed_(false),
-      cursor_(reinterpret_cast<byte*>(buffer)),
-      dirty_(false),
-      capacity_(capacity) {
-  VIXL_ASSERT(buffer_ != NULL);
 }
 
 
-CodeBuffer::~CodeBuffer() VIXL_NEGATIVE_TESTING_ALLOW_EXCEPTION {
-  VIXL_ASSERT(!IsDirty());
-  if (managed_) {
+void CodeBuffer::Deallocate() {
+  VIXL_ASSERT(managed_);
+  if (buffer_ == NULL) return;
 #ifdef VIXL_CODE_BUFFER_MALLOC
-    free(buffer_);
+  free(buffer_);
 #elif defined(VIXL_CODE_BUFFER_MMAP)
-    munmap(buffer_, capacity_);
+  munmap(buffer_, capacity_);
 #else
 #error Unknown code buffer allocator.
 #endif
+  buffer_ = NULL;
+}
+
+
+void CodeBuffer::SetSizeOnly(bool size_only) {
+  VIXL_ASSERT(managed_);
+  VIXL_ASSERT(cursor_ == 0);
+  if (size_only == size_only_) return;
+  // The capacity is kept, so that the buffer grows at the same points in both
+  // modes.
+  if (size_only) {
+    Deallocate();
+  } else {
+    Allocate();
   }
+  size_only_ = size_only;
 }
 
 
 void CodeBuffer::SetExecutable() {
+  VIXL_ASSERT(!size_only_);
 #ifdef VIXL_CODE_BUFFER_MMAP
   int ret = mprotect(buffer_, capacity_, PROT_READ | PROT_EXEC);
   VIXL_CHECK(ret == 0);
@@ -101,6 +129,7 @@ void CodeBuffer::SetExecutable() {
 
 
 void CodeBuffer::SetWritable() {
+  VIXL_ASSERT(!size_only_);
 #ifdef VIXL_CODE_BUFFER_MMAP
   int ret = mprotect(buffer_, capacity_, PROT_READ | PROT_WRITE);
   VIXL_CHECK(ret == 0);
@@ -113,33 +142,32 @@ void CodeBuffer::SetWritable() {
 
 
 void CodeBuffer::EmitString(const char* string) {
-  VIXL_ASSERT(HasSpaceFor(strlen(string) + 1));
-  char* dst = reinterpret_cast<char*>(cursor_);
+  size_t size = strlen(string) + 1;
+  VIXL_ASSERT(HasSpaceFor(size));
   dirty_ = true;
-  char* null_char = stpcpy(dst, string);
-  cursor_ = reinterpret_cast<byte*>(null_char) + 1;
+  if (!size_only_) memcpy(buffer_ + cursor_, string, size);
+  cursor_ += size;
 }
 
 
 void CodeBuffer::EmitData(const void* data, size_t size) {
   VIXL_ASSERT(HasSpaceFor(size));
   dirty_ = true;
-  memcpy(cursor_, data, size);
-  cursor_ = cursor_ + size;
+  if (!size_only_) memcpy(buffer_ + cursor_, data, size);
+  cursor_ += size;
 }
 
 
 void CodeBuffer::UpdateData(size_t offset, const void* data, size_t size) {
+  VIXL_ASSERT(!size_only_);
   dirty_ = true;
-  byte* dst = buffer_ + offset;
-  VIXL_ASSERT(dst + size <= cursor_);
-  memcpy(dst, data, size);
+  VIXL_ASSERT(offset + size <= static_cast<size_t>(cursor_));
+  memcpy(buffer_ + offset, data, size);
 }
 
 
 void CodeBuffer::Align() {
-  byte* end = AlignUp(cursor_, 4);
-  const size_t padding_size = end - cursor_;
+  const size_t padding_size = GetAlignmentPadding(4);
   VIXL_ASSERT(padding_size <= 4);
   EmitZeroedBytes(static_cast<int>(padding_size));
 }
@@ -147,18 +175,18 @@ void CodeBuffer::Align() {
 void CodeBuffer::EmitZeroedBytes(int n) {
   EnsureSpaceFor(n);
   dirty_ = true;
-  memset(cursor_, 0, n);
+  if (!size_only_) memset(buffer_ + cursor_, 0, n);
   cursor_ += n;
 }
 
 void CodeBuffer::Reset() {
 #ifdef VIXL_DEBUG
-  if (managed_) {
+  if (managed_ && !size_only_) {
     // Fill with zeros (there is no useful value common to A32 and T32).
     memset(buffer_, 0, capacity_);
   }
 #endif
-  cursor_ = buffer_;
+  cursor_ = 0;
   SetClean();
 }
 
@@ -166,7 +194,10 @@ void CodeBuffer::Reset() {
 void CodeBuffer::Grow(size_t new_capacity) {
   VIXL_ASSERT(managed_);
   VIXL_ASSERT(new_capacity > capacity_);
-  ptrdiff_t cursor_offset = GetCursorOffset();
+  if (size_only_) {
+    capacity_ = new_capacity;
+    return;
+  }
 #ifdef VIXL_CODE_BUFFER_MALLOC
   buffer_ = static_cast<byte*>(realloc(buffer_, new_capacity));
   VIXL_CHECK(buffer_ != NULL);
@@ -201,7 +232,6 @@ void CodeBuffer::Grow(size_t new_capacity) {
 #error Unknown code buffer allocator.
 #endif
 
-  cursor_ = buffer_ + cursor_offset;
   capacity_ = new_capacity;
 }
 
@@ -51,10 +51,20 @@ class CodeBuffer {
   void SetExecutable();
   void SetWritable();
 
+  // In size-only mode, the buffer has no backing store. Emission only advances
+  // the cursor, and growing the buffer only updates its capacity, so offsets,
+  // sizes and capacities are exactly the same as for real emission, but
+  // nothing can be read from the buffer, and it can't be executed. This is
+  // useful to measure code without generating it.
+  //
+  // The mode can only be changed when the buffer is empty, and only managed
+  // buffers support it.
+  void SetSizeOnly(bool size_only);
+  bool IsSizeOnly() const { return size_only_; }
+
   ptrdiff_t GetOffsetFrom(ptrdiff_t offset) const {
-    ptrdiff_t cursor_offset = cursor_ - buffer_;
-    VIXL_ASSERT((offset >= 0) && (offset <= cursor_offset));
-    return cursor_offset - offset;
+    VIXL_ASSERT((offset >= 0) && (offset <= cursor_));
+    return cursor_ - offset;
   }
   VIXL_DEPRECATED("GetOffsetFrom",
                   ptrdiff_t OffsetFrom(ptrdiff_t offset) const) {
@@ -67,15 +77,15 @@ class CodeBuffer {
   }
 
   void Rewind(ptrdiff_t offset) {
-    byte* rewound_cursor = buffer_ + offset;
-    VIXL_ASSERT((buffer_ <= rewound_cursor) && (rewound_cursor <= cursor_));
-    cursor_ = rewound_cursor;
+    VIXL_ASSERT((0 <= offset) && (offset <= cursor_));
+    cursor_ = offset;
   }
 
   template <typename T>
   T GetOffsetAddress(ptrdiff_t offset) const {
     VIXL_STATIC_ASSERT(sizeof(T) >= sizeof(uintptr_t));
-    VIXL_ASSERT((offset >= 0) && (offset <= (cursor_ - buffer_)));
+    VIXL_ASSERT(!size_only_);
+    VIXL_ASSERT((offset >= 0) && (offset <= cursor_));
     return reinterpret_cast<T>(buffer_ + offset);
   }
 
@@ -92,16 +102,16 @@ class CodeBuffer {
   }
 
   size_t GetRemainingBytes() const {
-    VIXL_ASSERT((cursor_ >= buffer_) && (cursor_ <= (buffer_ + capacity_)));
-    return (buffer_ + capacity_) - cursor_;
+    VIXL_ASSERT((cursor_ >= 0) && (static_cast<size_t>(cursor_) <= capacity_));
+    return capacity_ - cursor_;
   }
   VIXL_DEPRECATED("GetRemainingBytes", size_t RemainingBytes() const) {
     return GetRemainingBytes();
   }
 
   size_t GetSizeInBytes() const {
-    VIXL_ASSERT((cursor_ >= buffer_) && (cursor_ <= (buffer_ + capacity_)));
-    return cursor_ - buffer_;
+    VIXL_ASSERT((cursor_ >= 0) && (static_cast<size_t>(cursor_) <= capacity_));
+    return cursor_;
   }
 
   // A code buffer can emit:
@@ -124,21 +134,38 @@ class CodeBuffer {
   void Emit(T value) {
     VIXL_ASSERT(HasSpaceFor(sizeof(value)));
     dirty_ = true;
-    memcpy(cursor_, &value, sizeof(value));
+    if (!size_only_) memcpy(buffer_ + cursor_, &value, sizeof(value));
     cursor_ += sizeof(value);
   }
 
   void UpdateData(size_t offset, const void* data, size_t size);
 
+  // Move the cursor past `size` bytes that have already been written directly
+  // to the buffer, for example by an InstructionStreamScope. The space must
+  // have been reserved beforehand.
+  void Advance(size_t size) {
+    VIXL_ASSERT(HasSpaceFor(size));
+    dirty_ = true;
+    cursor_ += size;
+  }
+
   // Align to 32bit.
   void Align();
 
+  // Return the number of bytes needed to align the cursor to `alignment`,
+  // which must be a power of two.
+  size_t GetAlignmentPadding(size_t alignment) const {
+    VIXL_ASSERT(IsPowerOf2(alignment));
+    uintptr_t cursor = GetCursorAddress();
+    return AlignUp(cursor, alignment) - cursor;
+  }
+
   // Ensure there is enough space for and emit 'n' zero bytes.
   void EmitZeroedBytes(int n);
 
-  bool Is16bitAligned() const { return IsAligned<2>(cursor_); }
+  bool Is16bitAligned() const { return IsAligned<2>(GetCursorAddress()); }
 
-  bool Is32bitAligned() const { return IsAligned<4>(cursor_); }
+  bool Is32bitAligned() const { return IsAligned<4>(GetCursorAddress()); }
 
   size_t GetCapacity() const { return capacity_; }
   VIXL_DEPRECATED("GetCapacity", size_t capacity() const) {
@@ -169,18 +196,29 @@ class CodeBuffer {
   }
 
  private:
-  // Backing store of the buffer.
+  // The address of the cursor, for alignment. In size-only mode, this is the
+  // offset of the cursor, as if the buffer started at address 0.
+  uintptr_t GetCursorAddress() const {
+    return reinterpret_cast<uintptr_t>(buffer_) + cursor_;
+  }
+
+  void Allocate();
+  void Deallocate();
+
+  // Backing store of the buffer. This is NULL in size-only mode.
   byte* buffer_;
   // If true the backing store is allocated and deallocated by the buffer. The
   // backing store can then grow on demand. If false the backing store is
   // provided by the user and cannot be resized internally.
   bool managed_;
-  // Pointer to the next location to be written.
-  byte* cursor_;
+  // Offset of the next location to be written.
+  ptrdiff_t cursor_;
   // True if there has been any write since the buffer was created or cleaned.
   bool dirty_;
   // Capacity in bytes of the backing store.
   size_t capacity_;
+  // True if nothing is written to the buffer. See `SetSizeOnly()`.
+  bool size_only_;
 };
 
 }  // namespace vixl
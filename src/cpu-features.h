@@ -364,7 +364,7 @@ class CPUFeatures {
 
   // Check for equivalence.
   bool operator==(const CPUFeatures& other) const {
-    return Has(other) && other.Has(*this);
+    return features_ == other.features_;
   }
   bool operator!=(const CPUFeatures& other) const { return !(*this == other); }
 
@@ -740,6 +740,23 @@ TEST(move_immediate_helpers) {
   // not crash.
   MacroAssembler::MoveImmediateHelper(NULL, x0, 0x12345678);
   MacroAssembler::OneInstrMoveImmediateHelper(NULL, x1, 0xabcdef);
+
+  VIXL_CHECK(MacroAssembler::MoveImmediateHelper(NULL, w0, 0x12345678) == 2);
+  VIXL_CHECK(MacroAssembler::MoveImmediateHelper(NULL, x0, 0x123456789abc) ==
+             3);
+  VIXL_CHECK(
+      MacroAssembler::MoveImmediateHelper(NULL, x0, 0x123456789abcdef0) == 4);
+  // A logical immediate can be a better initial value than movz or movn.
+  VIXL_CHECK(
+      MacroAssembler::MoveImmediateHelper(NULL, x0, 0x5555123455555555) == 2);
+  VIXL_CHECK(
+      MacroAssembler::MoveImmediateHelper(NULL, x0, 0x000fff001234ff00) == 2);
+  VIXL_CHECK(
+      MacroAssembler::MoveImmediateHelper(NULL, x0, 0x00000fffffff1234) == 2);
+  VIXL_CHECK(
+      MacroAssembler::MoveImmediateHelper(NULL, x0, 0x1234567800ffff00) == 3);
+  VIXL_CHECK(
+      MacroAssembler::MoveImmediateHelper(NULL, sp, 0x0ff012340ff00ff0) == 3);
 }
 
 TEST(generic_operand_helpers) {
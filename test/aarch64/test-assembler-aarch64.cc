@@ -36,6 +36,7 @@
 #include "test-utils.h"
 #include "aarch64/test-utils-aarch64.h"
 
+#include "aarch64/branch-relaxation-aarch64.h"
 #include "aarch64/cpu-aarch64.h"
 #include "aarch64/disasm-aarch64.h"
 #include "aarch64/macro-assembler-aarch64.h"
@@ -315,6 +316,39 @@ TEST(mov_imm_x) {
 }
 
 
+TEST(mov_imm_logical_initial) {
+  SETUP();
+
+  // These immediates are shorter with a logical immediate as the initial
+  // value.
+  START();
+  __ Mov(x0, 0x5555123455555555);
+  __ Mov(x1, 0x00ff00ff123400ff);
+  __ Mov(x2, 0x000fff001234ff00);
+  __ Mov(x3, 0x00000fffffff1234);
+  __ Mov(x4, 0x1234567800ffff00);
+  // Repeat an immediate, to use the cached sequence.
+  __ Mov(x5, 0x000fff001234ff00);
+  __ Mov(x7, sp);
+  __ Mov(sp, 0x0ff012340ff00ff0);
+  __ Mov(x6, sp);
+  __ Mov(sp, x7);
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_64(0x5555123455555555, x0);
+    ASSERT_EQUAL_64(0x00ff00ff123400ff, x1);
+    ASSERT_EQUAL_64(0x000fff001234ff00, x2);
+    ASSERT_EQUAL_64(0x00000fffffff1234, x3);
+    ASSERT_EQUAL_64(0x1234567800ffff00, x4);
+    ASSERT_EQUAL_64(0x000fff001234ff00, x5);
+    ASSERT_EQUAL_64(0x0ff012340ff00ff0, x6);
+  }
+}
+
+
 TEST(mov) {
   SETUP();
 
@@ -12475,6 +12509,93 @@ TEST(crc32cx) {
   }
 }
 
+
+// A bitwise CRC of a buffer, with the usual initial value and final inversion.
+// `poly` is bit-reflected.
+static uint32_t ReferenceCrc32(const uint8_t* data,
+                               size_t size,
+                               uint32_t poly) {
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (((crc & 1) != 0) ? poly : 0);
+    }
+  }
+  return ~crc;
+}
+
+
+typedef void (MacroAssembler::*Crc32Signature)(const Register& rd,
+                                               const Register& rn,
+                                               const Register& rm);
+
+TEST(crc32_buffer) {
+  SETUP_WITH_FEATURES(CPUFeatures::kCRC32);
+
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  VIXL_CHECK(ReferenceCrc32(check, sizeof(check), 0xedb88320) == 0xcbf43926);
+  VIXL_CHECK(ReferenceCrc32(check, sizeof(check), 0x82f63b78) == 0xe3069283);
+
+  uint8_t data[64];
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = static_cast<uint8_t>((i * 0x9d) ^ (i >> 3));
+  }
+
+  // Indexed by operand size, then by polynomial.
+  const Crc32Signature ops[4][2] = {{&MacroAssembler::Crc32b,
+                                     &MacroAssembler::Crc32cb},
+                                    {&MacroAssembler::Crc32h,
+                                     &MacroAssembler::Crc32ch},
+                                    {&MacroAssembler::Crc32w,
+                                     &MacroAssembler::Crc32cw},
+                                    {&MacroAssembler::Crc32x,
+                                     &MacroAssembler::Crc32cx}};
+
+  START();
+  __ Mov(x0, reinterpret_cast<uintptr_t>(data));
+
+  // Checksum the buffer with each operand size, for both polynomials.
+  for (int poly = 0; poly < 2; poly++) {
+    for (int size_log2 = 0; size_log2 < 4; size_log2++) {
+      __ Mov(w1, 0xffffffff);
+      for (size_t offset = 0; offset < sizeof(data);
+           offset += (1 << size_log2)) {
+        MemOperand operand(x0, offset);
+        switch (size_log2) {
+          case 0:
+            __ Ldrb(w2, operand);
+            break;
+          case 1:
+            __ Ldrh(w2, operand);
+            break;
+          case 2:
+            __ Ldr(w2, operand);
+            break;
+          case 3:
+            __ Ldr(x2, operand);
+            break;
+        }
+        Register value = (size_log2 == 3) ? Register(x2) : Register(w2);
+        (masm.*ops[size_log2][poly])(w1, w1, value);
+      }
+      __ Mvn(WRegister(10 + (poly * 4) + size_log2), w1);
+    }
+  }
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    uint32_t crc32 = ReferenceCrc32(data, sizeof(data), 0xedb88320);
+    uint32_t crc32c = ReferenceCrc32(data, sizeof(data), 0x82f63b78);
+    for (int size_log2 = 0; size_log2 < 4; size_log2++) {
+      ASSERT_EQUAL_64(crc32, XRegister(10 + size_log2));
+      ASSERT_EQUAL_64(crc32c, XRegister(14 + size_log2));
+    }
+  }
+}
+
 TEST(regress_cmp_shift_imm) {
   SETUP();
 
@@ -12751,6 +12872,345 @@ TEST(veneers_stress) {
 }
 
 
+TEST(veneers_many_labels) {
+  SETUP();
+  START();
+
+  // Check the veneer pool bookkeeping when many unresolved branches are
+  // resolved out of order, by binding labels or by emitting veneers.
+
+  const int kLabels = 1024;
+  const int kBranchesPerLabel = 4;
+  Label labels[kLabels];
+
+  for (int i = 0; i < kBranchesPerLabel; i++) {
+    for (int j = 0; j < kLabels; j++) {
+      __ Cbz(x0, &labels[j]);
+    }
+  }
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() ==
+             kLabels * kBranchesPerLabel);
+
+  // Resolve every other label.
+  for (int j = 0; j < kLabels; j += 2) {
+    __ Bind(&labels[j]);
+  }
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() ==
+             (kLabels / 2) * kBranchesPerLabel);
+
+  // Add test branches; these will need veneers before the remaining `cbz`.
+  for (int j = 1; j < kLabels; j += 2) {
+    __ Tbz(x0, 0, &labels[j]);
+  }
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() ==
+             (kLabels / 2) * (kBranchesPerLabel + 1));
+
+  // Go beyond the range of the `tbz` branches.
+  const int range_tbz = Instruction::GetImmBranchForwardRange(TestBranchType);
+  ptrdiff_t end = masm.GetCursorOffset() + range_tbz;
+  while (masm.GetCursorOffset() < end) {
+    __ Nop();
+  }
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() ==
+             (kLabels / 2) * kBranchesPerLabel);
+
+  for (int j = 1; j < kLabels; j += 2) {
+    __ Bind(&labels[j]);
+  }
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() == 0);
+
+  END();
+}
+
+TEST(label_many_links) {
+  SETUP();
+  START();
+
+  // Link many instructions of different types to the same label, far enough
+  // away that most of them need veneers, and check that they all reach it.
+
+  const int kUses = 1024;
+  const int kAdrUses = 64;
+  const int kPadding = 256;
+  Label target, done;
+
+  __ Mov(x0, 0);
+  __ Mov(x1, 0);
+  __ Mov(x3, 0);
+  // Set Z, for `b.eq`.
+  __ Cmp(x1, 0);
+
+  for (int i = 0; i < kUses; i++) {
+    Label next;
+    __ Adr(lr, &next);
+    switch (i % 4) {
+      case 0:
+        __ B(&target);
+        break;
+      case 1:
+        __ B(&target, eq);
+        break;
+      case 2:
+        __ Cbz(x1, &target);
+        break;
+      case 3:
+        __ Tbz(x1, 0, &target);
+        break;
+    }
+    __ Bind(&next);
+    // `adr` has no veneers, so only use it near the target.
+    if (i >= (kUses - kAdrUses)) {
+      __ Adr(x2, &target);
+      __ Add(x3, x3, x2);
+    }
+    for (int j = 0; j < kPadding; j++) {
+      __ Nop();
+    }
+  }
+  __ B(&done);
+
+  __ Bind(&target);
+  __ Add(x0, x0, 1);
+  __ Ret();
+
+  __ Bind(&done);
+  __ Adr(x4, &target);
+  __ Mov(x5, kAdrUses);
+  __ Msub(x3, x4, x5, x3);
+
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_64(kUses, x0);
+    ASSERT_EQUAL_64(0, x3);
+  }
+}
+
+TEST(branch_relaxation) {
+  SETUP();
+  START();
+
+  // Only the branches that are out of range should be relaxed, and none of
+  // them should need veneers.
+  const int kPadding =
+      Instruction::GetImmBranchForwardRange(TestBranchType) / kInstructionSize;
+
+  __ Mov(x0, 0);
+  __ Mov(x1, 0);
+  __ Mov(x2, 1);
+
+  BranchRelaxation relaxation(&masm);
+  relaxation.Generate([kPadding](MacroAssembler* gen) {
+    Label near, far;
+    // Taken, in range.
+    gen->Tbnz(x2, 0, &near);
+    gen->Mov(x0, 0xbad);
+    gen->Bind(&near);
+    // Taken, out of range.
+    gen->Tbz(x1, 0, &far);
+    gen->Mov(x0, 0xbad);
+    for (int i = 0; i < kPadding; i++) {
+      gen->Nop();
+    }
+    gen->Bind(&far);
+    // Not taken, in range.
+    gen->Cbnz(x1, &far);
+    // Not taken, out of range.
+    gen->Tbnz(x1, 0, &near);
+    gen->Mov(x3, 42);
+  });
+
+  VIXL_CHECK(relaxation.GetNumberOfBranches() == 4);
+  VIXL_CHECK(relaxation.GetNumberOfRelaxedBranches() == 2);
+  VIXL_CHECK(relaxation.GetNumberOfPasses() == 3);
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() == 0);
+
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_64(0, x0);
+    ASSERT_EQUAL_64(42, x3);
+  }
+}
+
+// Generate code that needs literal pools and veneers, and record the layout
+// as it is generated.
+static void GenerateSizeOnlyTestCode(MacroAssembler* masm,
+                                     std::vector<ptrdiff_t>* layout) {
+  Label start, far;
+  masm->Bind(&start);
+  // This needs a veneer.
+  masm->Tbz(x0, 3, &far);
+  layout->push_back(masm->GetNumberOfPotentialVeneers());
+  for (int i = 0; i < 12000; i++) {
+    Label skip;
+    masm->Tbnz(x1, i % 64, &skip);
+    masm->Ldr(x2, UINT64_C(0x0123456789abcdef) + i);
+    masm->Add(x3, x3, i * 0x10001);
+    masm->Adr(x4, &far);
+    masm->Bind(&skip);
+    if ((i % 100) == 0) masm->Cbnz(x5, &start);
+    layout->push_back(masm->GetCursorOffset());
+    layout->push_back(masm->GetLiteralPoolSize());
+  }
+  layout->push_back(masm->GetNumberOfPotentialVeneers());
+  masm->Bind(&far);
+  masm->Ret();
+  masm->FinalizeCode();
+  layout->push_back(masm->GetCursorOffset());
+}
+
+TEST(size_only) {
+  MacroAssembler masm;
+  std::vector<ptrdiff_t> layout;
+  GenerateSizeOnlyTestCode(&masm, &layout);
+
+  MacroAssembler size_only_masm;
+  size_only_masm.SetSizeOnly(true);
+  VIXL_CHECK(size_only_masm.IsSizeOnly());
+  std::vector<ptrdiff_t> size_only_layout;
+  GenerateSizeOnlyTestCode(&size_only_masm, &size_only_layout);
+
+  // The veneer was emitted, and the literal pool was emitted several times.
+  VIXL_CHECK(layout.front() == 1);
+  VIXL_CHECK(layout[layout.size() - 2] == 0);
+  int literal_pools = 0;
+  for (size_t i = 4; i < (layout.size() - 2); i += 2) {
+    if (layout[i] < layout[i - 2]) literal_pools++;
+  }
+  VIXL_CHECK(literal_pools > 1);
+
+  VIXL_CHECK(size_only_layout == layout);
+  VIXL_CHECK(size_only_masm.GetSizeOfCodeGenerated() ==
+             masm.GetSizeOfCodeGenerated());
+  VIXL_CHECK(size_only_masm.GetBuffer()->GetCapacity() ==
+             masm.GetBuffer()->GetCapacity());
+}
+
+TEST(label_alignment) {
+  SETUP_WITH_FEATURES(CPUFeatures::kBTI);
+  masm.SetLabelAlignment(kLoopHeaderHint, 32);
+  masm.SetLabelAlignment(kHotBranchTargetHint, 16, 4);
+  VIXL_CHECK(masm.GetLabelAlignment(kLoopHeaderHint) == 32);
+  VIXL_CHECK(masm.GetMaxLabelPadding(kLoopHeaderHint) == 28);
+  VIXL_CHECK(masm.GetLabelAlignment(kNoAlignmentHint) == 4);
+
+  START();
+  Label loop, target, unaligned;
+  __ Mov(x0, 0);
+  __ Mov(x1, 10);
+
+  __ Bind(&loop, kLoopHeaderHint);
+  VIXL_CHECK(IsAligned(loop.GetLocation(), 32));
+  __ Add(x0, x0, x1);
+  __ Sub(x1, x1, 1);
+  __ Cbnz(x1, &loop);
+
+  // At most one `nop` is allowed for hot branch targets, and this would need
+  // three.
+  while (!IsAligned(masm.GetCursorOffset() - kInstructionSize, 16)) {
+    __ Nop();
+  }
+  __ Bind(&unaligned, kHotBranchTargetHint);
+  VIXL_CHECK(!IsAligned(unaligned.GetLocation(), 16));
+  __ Nop();
+  while (!IsAligned(masm.GetCursorOffset() + kInstructionSize, 16)) {
+    __ Nop();
+  }
+  ptrdiff_t before = masm.GetCursorOffset();
+  __ Bind(&target, kHotBranchTargetHint, EmitBTI_j);
+  VIXL_CHECK(target.GetLocation() == before + kInstructionSize);
+  VIXL_CHECK(IsAligned(target.GetLocation(), 16));
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+    ASSERT_EQUAL_64(55, x0);
+  }
+}
+
+TEST(label_alignment_pools) {
+  for (int size_only = 0; size_only < 2; size_only++) {
+    MacroAssembler masm;
+    masm.SetSizeOnly(size_only != 0);
+    masm.SetLabelAlignment(kLoopHeaderHint, 64);
+
+    // Make the literal pool due just after the padding.
+    masm.Ldr(x0, 0x0123456789abcdef);
+    while ((masm.GetCursorOffset() + 64) <
+           LiteralPool::kRecommendedLiteralPoolRange) {
+      masm.Nop();
+    }
+    VIXL_CHECK(!masm.GetLiteralPool()->IsEmpty());
+
+    Label loop;
+    masm.Bind(&loop, kLoopHeaderHint);
+    // The pool was emitted before the padding.
+    VIXL_CHECK(masm.GetLiteralPool()->IsEmpty());
+    VIXL_CHECK(IsAligned(loop.GetLocation(), 64));
+    masm.Sub(x0, x0, 1);
+    masm.Cbnz(x0, &loop);
+    masm.FinalizeCode();
+  }
+}
+
+TEST(instruction_stream) {
+  // Encode the instructions with a separate Assembler.
+  const int kCount = 64;
+  MacroAssembler encoder;
+  {
+    ExactAssemblyScope scope(&encoder, kCount * kInstructionSize);
+    for (int i = 0; i < kCount; i++) encoder.add(x2, x2, i);
+  }
+  encoder.FinalizeCode();
+  const Instr* encodings =
+      encoder.GetBuffer()->GetStartAddress<const Instr*>();
+
+  SETUP();
+  START();
+  __ Mov(x2, 0);
+  // This literal stays pending whilst the instructions are streamed.
+  __ Ldr(x3, 0x0123456789abcdef);
+  ptrdiff_t start = masm.GetCursorOffset();
+  {
+    // Leave some space unused.
+    InstructionStreamScope stream(&masm, (2 * kCount) + 4);
+    for (int i = 0; i < kCount; i++) stream.Emit(encodings[i]);
+    stream.Emit(encodings, kCount);
+    VIXL_CHECK(stream.GetSizeOfCodeEmitted() ==
+               (2 * kCount * kInstructionSize));
+    VIXL_CHECK(masm.GetCursorOffset() == start);
+  }
+  VIXL_CHECK(masm.GetCursorOffset() ==
+             start + static_cast<ptrdiff_t>(2 * kCount * kInstructionSize));
+  VIXL_CHECK(!masm.GetLiteralPool()->IsEmpty());
+  VIXL_CHECK(memcmp(masm.GetBuffer()->GetOffsetAddress<const void*>(start),
+                    encodings,
+                    kCount * kInstructionSize) == 0);
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+    ASSERT_EQUAL_64(2 * (kCount * (kCount - 1) / 2), x2);
+    ASSERT_EQUAL_64(0x0123456789abcdef, x3);
+  }
+
+  // In size-only mode, only the size is recorded.
+  MacroAssembler size_only_masm;
+  size_only_masm.SetSizeOnly(true);
+  {
+    InstructionStreamScope stream(&size_only_masm, kCount);
+    stream.Emit(encodings, kCount);
+  }
+  size_only_masm.FinalizeCode();
+  VIXL_CHECK(size_only_masm.GetSizeOfCodeGenerated() ==
+             (kCount * kInstructionSize));
+}
+
 TEST(veneers_two_out_of_range) {
   SETUP();
   START();
@@ -13106,6 +13566,78 @@ TEST(literal_deletion_policies) {
 }
 
 
+TEST(literal_deduplication) {
+  SETUP_WITH_FEATURES(CPUFeatures::kNEON, CPUFeatures::kFP);
+
+  START();
+  LiteralPool* literal_pool = masm.GetLiteralPool();
+  VIXL_CHECK(!literal_pool->IsDeduplicationEnabled());
+  literal_pool->SetDeduplication(true);
+
+  ASSERT_LITERAL_POOL_SIZE(0);
+  __ Ldr(x0, 0x1234567890abcdef);
+  __ Ldr(x1, 0x1234567890abcdef);
+  ASSERT_LITERAL_POOL_SIZE(8);
+  // Different sizes are not shared, even if the bits match.
+  __ Ldr(w2, 0x90abcdef);
+  __ Ldr(w3, 0x90abcdef);
+  __ Ldrsw(x4, 0x90abcdef);
+  ASSERT_LITERAL_POOL_SIZE(12);
+  __ Ldr(q5, 0x1234000056780000, 0xabcd0000ef000000);
+  __ Ldr(q6, 0x1234000056780000, 0xabcd0000ef000000);
+  ASSERT_LITERAL_POOL_SIZE(28);
+  __ Ldr(d7, 1.234);
+  __ Fmov(d8, 1.234);
+  // Doubles are shared with integers that have the same bits.
+  __ Ldr(x9, DoubleToRawbits(1.234));
+  ASSERT_LITERAL_POOL_SIZE(36);
+  __ Ldr(s10, 2.3f);
+  __ Fmov(s11, 2.3f);
+  ASSERT_LITERAL_POOL_SIZE(40);
+
+  // Explicitly-created literals are never shared.
+  Literal<uint64_t> explicit_literal(0x1234567890abcdef, literal_pool);
+  __ Ldr(x12, &explicit_literal);
+  __ Ldr(x13, 0x1234567890abcdef);
+  ASSERT_LITERAL_POOL_SIZE(48);
+
+  // x1, w3, x4, q6, d8, x9, s11 and x13 were shared.
+  VIXL_CHECK(literal_pool->GetDeduplicatedSize() ==
+             (8 + 4 + 4 + 16 + 8 + 8 + 4 + 8));
+
+  // Entries are only shared within a pool.
+  masm.EmitLiteralPool(LiteralPool::kBranchRequired);
+  ASSERT_LITERAL_POOL_SIZE(0);
+  __ Ldr(x14, 0x1234567890abcdef);
+  ASSERT_LITERAL_POOL_SIZE(8);
+
+  literal_pool->SetDeduplication(false);
+  __ Ldr(x15, 0x1234567890abcdef);
+  ASSERT_LITERAL_POOL_SIZE(16);
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_64(0x1234567890abcdef, x0);
+    ASSERT_EQUAL_64(0x1234567890abcdef, x1);
+    ASSERT_EQUAL_64(0x90abcdef, x2);
+    ASSERT_EQUAL_64(0x90abcdef, x3);
+    ASSERT_EQUAL_64(0xffffffff90abcdef, x4);
+    ASSERT_EQUAL_128(0x1234000056780000, 0xabcd0000ef000000, q5);
+    ASSERT_EQUAL_128(0x1234000056780000, 0xabcd0000ef000000, q6);
+    ASSERT_EQUAL_FP64(1.234, d7);
+    ASSERT_EQUAL_FP64(1.234, d8);
+    ASSERT_EQUAL_64(DoubleToRawbits(1.234), x9);
+    ASSERT_EQUAL_FP32(2.3f, s10);
+    ASSERT_EQUAL_FP32(2.3f, s11);
+    ASSERT_EQUAL_64(0x1234567890abcdef, x12);
+    ASSERT_EQUAL_64(0x1234567890abcdef, x13);
+    ASSERT_EQUAL_64(0x1234567890abcdef, x14);
+    ASSERT_EQUAL_64(0x1234567890abcdef, x15);
+  }
+}
+
 TEST(generic_operand) {
   SETUP_WITH_FEATURES(CPUFeatures::kFP);
 
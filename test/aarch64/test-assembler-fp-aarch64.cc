@@ -1156,6 +1156,83 @@ TEST(fdiv) {
 }
 
 
+TEST(fp_arithmetic_special_results) {
+  // Check results that the host computes directly, next to the special cases
+  // that need the architectural rules.
+  SETUP_WITH_FEATURES(CPUFeatures::kFP, CPUFeatures::kNEON);
+
+  START();
+  __ Fmov(d16, 1.0);
+  __ Fmov(d17, -0.0);
+  __ Fmov(d18, 0.0);
+  __ Fmov(d19, kFP64PositiveInfinity);
+  __ Fmov(d20, 1.0e300);
+  __ Fmov(s21, -1.0e30f);
+  __ Fmov(s22, 1.0e30f);
+  // Check that the top of the destination is cleared.
+  __ Movi(v0.V2D(), 0x0123456789abcdef, 0xfedcba9876543210);
+  __ Movi(v1.V2D(), 0x0123456789abcdef, 0xfedcba9876543210);
+
+  __ Fdiv(d0, d16, d17);
+  __ Fdiv(s1, s22, s21);
+  __ Fadd(d2, d17, d17);
+  __ Fsub(d3, d17, d17);
+  __ Fmul(d4, d20, d20);
+  __ Fmul(s5, s21, s22);
+  __ Fsub(d6, d19, d19);
+  __ Fmul(d7, d17, d20);
+  __ Fmadd(d8, d16, d16, d17);
+  __ Fmsub(d9, d16, d16, d16);
+  __ Fmadd(d10, d20, d20, d19);
+  __ Fmax(d11, d17, d18);
+  __ Fmin(d12, d18, d17);
+  __ Fmaxnm(s13, s21, s22);
+  __ Fsqrt(d14, d17);
+  __ Fneg(d23, d16);
+  __ Fsqrt(d15, d23);
+  // Vector lanes, with {-0.0, inf} in v26 and {0.0, inf} in v27.
+  __ Mov(v26.D(), 0, v17.D(), 0);
+  __ Mov(v26.D(), 1, v19.D(), 0);
+  __ Mov(v27.D(), 0, v18.D(), 0);
+  __ Mov(v27.D(), 1, v19.D(), 0);
+  __ Fmax(v28.V2D(), v26.V2D(), v27.V2D());
+  __ Fmin(v29.V2D(), v27.V2D(), v26.V2D());
+  __ Fsub(v30.V2D(), v27.V2D(), v27.V2D());
+  __ Fdiv(v31.V4S(), v1.V4S(), v1.V4S());
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_128(0, DoubleToRawbits(kFP64NegativeInfinity), q0);
+    ASSERT_EQUAL_128(0, FloatToRawbits(-1.0f), q1);
+    ASSERT_EQUAL_FP64(-0.0, d2);
+    ASSERT_EQUAL_FP64(0.0, d3);
+    ASSERT_EQUAL_FP64(kFP64PositiveInfinity, d4);
+    ASSERT_EQUAL_FP32(kFP32NegativeInfinity, s5);
+    ASSERT_EQUAL_FP64(kFP64DefaultNaN, d6);
+    ASSERT_EQUAL_FP64(-0.0, d7);
+    ASSERT_EQUAL_FP64(1.0, d8);
+    ASSERT_EQUAL_FP64(0.0, d9);
+    ASSERT_EQUAL_FP64(kFP64PositiveInfinity, d10);
+    ASSERT_EQUAL_FP64(0.0, d11);
+    ASSERT_EQUAL_FP64(-0.0, d12);
+    ASSERT_EQUAL_FP32(1.0e30f, s13);
+    ASSERT_EQUAL_FP64(-0.0, d14);
+    ASSERT_EQUAL_FP64(kFP64DefaultNaN, d15);
+    ASSERT_EQUAL_128(DoubleToRawbits(kFP64PositiveInfinity), 0, q28);
+    ASSERT_EQUAL_128(DoubleToRawbits(kFP64PositiveInfinity),
+                     DoubleToRawbits(-0.0),
+                     q29);
+    ASSERT_EQUAL_128(DoubleToRawbits(kFP64DefaultNaN), 0, q30);
+    // v1 holds -1.0f in its low lane, and zeros above.
+    ASSERT_EQUAL_128(0x7fc000007fc00000,
+                     0x7fc0000000000000 | FloatToRawbits(1.0f),
+                     q31);
+  }
+}
+
+
 TEST(fdiv_h) {
   SETUP_WITH_FEATURES(CPUFeatures::kFP, CPUFeatures::kFPHalf);
 
@@ -10819,5 +10819,194 @@ TEST(neon_tbl) {
 }
 
 
+TEST(neon_aes) {
+  SETUP_WITH_FEATURES(CPUFeatures::kNEON, CPUFeatures::kAES);
+
+  // The AES-128 example from FIPS-197, appendix C.1. The round keys are
+  // expanded from the key 0x000102030405060708090a0b0c0d0e0f.
+  const uint64_t round_keys[11][2] = {{0x0f0e0d0c0b0a0908, 0x0706050403020100},
+                                      {0xfe76abd6f178a6da, 0xfa72afd2fd74aad6},
+                                      {0xfeb3306800c59bbe, 0xf1bd3d640bcf92b6},
+                                      {0x41bf6904bf0c596c, 0xbfc9c2d24e74ffb6},
+                                      {0xfd8d05fdbc326cf9, 0x033e3595bcf7f747},
+                                      {0xaa22f6ad57aff350, 0xeb9d9fa9e8a3aa3c},
+                                      {0x6b1fa30ac13d55a7, 0x9692a6f77d0f395e},
+                                      {0x26c0a94e4ddf0a44, 0x8ce25fe31a70f914},
+                                      {0xd27abfaef4ba16e0, 0xb9651ca435874347},
+                                      {0x4e972cbe9ced9310, 0x685785f0d1329954},
+                                      {0xc5302b4d8ba707f3, 0x174a94e37f1d1113}};
+
+  START();
+  for (int i = 0; i <= 10; i++) {
+    __ Movi(VRegister(i + 16, kFormat16B), round_keys[i][0], round_keys[i][1]);
+  }
+
+  // Encrypt the plaintext into v0.
+  __ Movi(v0.V2D(), 0xffeeddccbbaa9988, 0x7766554433221100);
+  for (int i = 0; i < 9; i++) {
+    __ Aese(v0.V16B(), VRegister(i + 16, kFormat16B));
+    __ Aesmc(v0.V16B(), v0.V16B());
+  }
+  __ Aese(v0.V16B(), v25.V16B());
+  __ Eor(v0.V16B(), v0.V16B(), v26.V16B());
+
+  // Decrypt it again into v1, using the equivalent inverse cipher.
+  __ Mov(v1, v0);
+  __ Aesd(v1.V16B(), v26.V16B());
+  for (int i = 9; i >= 1; i--) {
+    __ Aesimc(v2.V16B(), VRegister(i + 16, kFormat16B));
+    __ Aesimc(v1.V16B(), v1.V16B());
+    __ Aesd(v1.V16B(), v2.V16B());
+  }
+  __ Eor(v1.V16B(), v1.V16B(), v16.V16B());
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_128(0x5ac5b47080b7cdd8, 0x30047b6ad8e0c469, q0);
+    ASSERT_EQUAL_128(0xffeeddccbbaa9988, 0x7766554433221100, q1);
+  }
+}
+
+
+TEST(neon_sha1) {
+  SETUP_WITH_FEATURES(CPUFeatures::kNEON, CPUFeatures::kSHA1);
+
+  // Hash the single, padded block for the message "abc".
+  const uint32_t block[16] = {0x61626380, 0, 0, 0, 0, 0, 0, 0,
+                              0,          0, 0, 0, 0, 0, 0, 0x18};
+  const uint32_t constants[4] = {0x5a827999,
+                                 0x6ed9eba1,
+                                 0x8f1bbcdc,
+                                 0xca62c1d6};
+
+  START();
+  __ Mov(x0, reinterpret_cast<uintptr_t>(block));
+  __ Mov(x1, reinterpret_cast<uintptr_t>(constants));
+  __ Ld1(v4.V4S(), v5.V4S(), v6.V4S(), v7.V4S(), MemOperand(x0));
+  __ Ld4r(v16.V4S(), v17.V4S(), v18.V4S(), v19.V4S(), MemOperand(x1));
+
+  // v0 holds {a, b, c, d}, and s1 holds e.
+  __ Movi(v0.V2D(), 0x1032547698badcfe, 0xefcdab8967452301);
+  __ Movi(v1.V2D(), 0, 0xc3d2e1f0);
+  __ Mov(v20, v0);
+  __ Mov(v21, v1);
+  for (int i = 0; i < 20; i++) {
+    VRegister w0 = VRegister(4 + (i % 4), kFormat4S);
+    VRegister w1 = VRegister(4 + ((i + 1) % 4), kFormat4S);
+    VRegister w2 = VRegister(4 + ((i + 2) % 4), kFormat4S);
+    VRegister w3 = VRegister(4 + ((i + 3) % 4), kFormat4S);
+    __ Add(v2.V4S(), w0, VRegister(16 + (i / 5), kFormat4S));
+    if (i < 16) {
+      __ Sha1su0(w0, w1, w2);
+      __ Sha1su1(w0, w3);
+    }
+    __ Sha1h(s3, s0);
+    if (i < 5) {
+      __ Sha1c(q0, s1, v2.V4S());
+    } else if ((i < 10) || (i >= 15)) {
+      __ Sha1p(q0, s1, v2.V4S());
+    } else {
+      __ Sha1m(q0, s1, v2.V4S());
+    }
+    __ Mov(v1, v3);
+  }
+  __ Add(v0.V4S(), v0.V4S(), v20.V4S());
+  __ Add(v1.V4S(), v1.V4S(), v21.V4S());
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    // a9993e36 4706816a ba3e2571 7850c26c 9cd0d89d
+    ASSERT_EQUAL_128(0x7850c26cba3e2571, 0x4706816aa9993e36, q0);
+    ASSERT_EQUAL_128(0, 0x9cd0d89d, q1);
+  }
+}
+
+
+TEST(neon_sha256) {
+  SETUP_WITH_FEATURES(CPUFeatures::kNEON, CPUFeatures::kSHA2);
+
+  // Hash the single, padded block for the message "abc".
+  const uint32_t block[16] = {0x61626380, 0, 0, 0, 0, 0, 0, 0,
+                              0,          0, 0, 0, 0, 0, 0, 0x18};
+  const uint32_t constants[64] =
+      {0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+       0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+       0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+       0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+       0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+       0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+       0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+       0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+       0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+       0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+       0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+  START();
+  __ Mov(x0, reinterpret_cast<uintptr_t>(block));
+  __ Mov(x1, reinterpret_cast<uintptr_t>(constants));
+  __ Ld1(v4.V4S(), v5.V4S(), v6.V4S(), v7.V4S(), MemOperand(x0));
+
+  // v0 holds {a, b, c, d}, and v1 holds {e, f, g, h}.
+  __ Movi(v0.V2D(), 0xa54ff53a3c6ef372, 0xbb67ae856a09e667);
+  __ Movi(v1.V2D(), 0x5be0cd191f83d9ab, 0x9b05688c510e527f);
+  __ Mov(v20, v0);
+  __ Mov(v21, v1);
+  for (int i = 0; i < 16; i++) {
+    VRegister w0 = VRegister(4 + (i % 4), kFormat4S);
+    VRegister w1 = VRegister(4 + ((i + 1) % 4), kFormat4S);
+    VRegister w2 = VRegister(4 + ((i + 2) % 4), kFormat4S);
+    VRegister w3 = VRegister(4 + ((i + 3) % 4), kFormat4S);
+    __ Ld1(v16.V4S(), MemOperand(x1, 16, PostIndex));
+    __ Add(v16.V4S(), v16.V4S(), w0);
+    if (i < 12) {
+      __ Sha256su0(w0, w1);
+      __ Sha256su1(w0, w2, w3);
+    }
+    __ Mov(v2, v0);
+    __ Sha256h(q0, q1, v16.V4S());
+    __ Sha256h2(q1, q2, v16.V4S());
+  }
+  __ Add(v0.V4S(), v0.V4S(), v20.V4S());
+  __ Add(v1.V4S(), v1.V4S(), v21.V4S());
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    // ba7816bf 8f01cfea 414140de 5dae2223 b00361a3 96177a9c b410ff61 f20015ad
+    ASSERT_EQUAL_128(0x5dae2223414140de, 0x8f01cfeaba7816bf, q0);
+    ASSERT_EQUAL_128(0xf20015adb410ff61, 0x96177a9cb00361a3, q1);
+  }
+}
+
+
+TEST(neon_pmull_1q) {
+  SETUP_WITH_FEATURES(CPUFeatures::kNEON, CPUFeatures::kPmull1Q);
+
+  START();
+  __ Movi(v0.V2D(), 0x8000000000000001, 0x0123456789abcdef);
+  __ Movi(v1.V2D(), 0xffffffffffffffff, 0xfedcba9876543210);
+
+  __ Pmull(q2, v0.V1D(), v1.V1D());
+  __ Pmull2(q3, v0.V2D(), v1.V2D());
+  // The destination can alias the sources.
+  __ Mov(v4, v0);
+  __ Pmull2(q4, v4.V2D(), v4.V2D());
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_128(0x00e038d8688850b0, 0x40a0789828c810f0, q2);
+    ASSERT_EQUAL_128(0x7fffffffffffffff, 0x7fffffffffffffff, q3);
+    ASSERT_EQUAL_128(0x4000000000000000, 0x0000000000000001, q4);
+  }
+}
+
+
 }  // namespace aarch64
 }  // namespace vixl
@@ -434,6 +434,49 @@ TEST_SVE(sve_v_write_clear) {
   }
 }
 
+TEST_SVE(sve_v_write_clear_repeated) {
+  SVE_SETUP_WITH_FEATURES(CPUFeatures::kNEON,
+                          CPUFeatures::kFP,
+                          CPUFeatures::kSVE);
+  START();
+
+  // The Simulator only clears the parts of a register that might have been
+  // written, so check that alternating Z and V writes are handled correctly.
+  __ Index(z0.VnB(), 0, 1);
+  __ Index(z1.VnB(), 0, 1);
+  __ Index(z2.VnB(), 0, 1);
+
+  // Clear the upper lanes, then write them again.
+  __ Fmov(d0, 1.5);
+  __ Index(z0.VnB(), 1, 1);
+  __ Fmov(d0, 2.5);
+
+  __ Movi(v1.V2D(), 0x0123456789abcdef, 0xfedcba9876543210);
+  __ Index(z1.VnB(), 1, 1);
+  __ Add(v1.V8B(), v1.V8B(), v1.V8B());
+
+  // A partial write, then a wider one.
+  __ Ins(v2.V16B(), 15, w0);
+  __ Index(z2.VnD(), 2, 3);
+  __ Mov(v2.V16B(), v0.V16B());
+
+  END();
+
+  if (CAN_RUN()) {
+    RUN();
+
+    ASSERT_EQUAL_128(0x0000000000000000, 0x4004000000000000, v0);  // 2.5
+    ASSERT_EQUAL_128(0x0000000000000000, 0x100e0c0a08060402, v1);
+    ASSERT_EQUAL_128(0x0000000000000000, 0x4004000000000000, v2);
+
+    for (int i = kQRegSizeInBytes; i < core.GetSVELaneCount(kBRegSize); i++) {
+      ASSERT_EQUAL_SVE_LANE(0x00, z0.VnB(), i);
+      ASSERT_EQUAL_SVE_LANE(0x00, z1.VnB(), i);
+      ASSERT_EQUAL_SVE_LANE(0x00, z2.VnB(), i);
+    }
+  }
+}
+
 static void MlaMlsHelper(Test* config, unsigned lane_size_in_bits) {
   SVE_SETUP_WITH_FEATURES(CPUFeatures::kSVE);
   START();
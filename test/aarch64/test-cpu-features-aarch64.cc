@@ -3447,6 +3447,42 @@ TEST_NEON_DOTPRODUCT(udot_1, udot(v0.V4S(), v1.V16B(), v2.S4B(), 1))
 TEST_NEON_DOTPRODUCT(udot_2, udot(v0.V2S(), v1.V8B(), v2.V8B()))
 TEST_NEON_DOTPRODUCT(udot_3, udot(v0.V4S(), v1.V16B(), v2.V16B()))
 
+#define TEST_NEON_AES(NAME, ASM)                                        \
+  TEST_TEMPLATE_A64(CPUFeatures(CPUFeatures::kNEON, CPUFeatures::kAES), \
+                    NEON_AES_##NAME,                                    \
+                    ASM)
+TEST_NEON_AES(aesd_0, aesd(v0.V16B(), v1.V16B()))
+TEST_NEON_AES(aese_0, aese(v0.V16B(), v1.V16B()))
+TEST_NEON_AES(aesimc_0, aesimc(v0.V16B(), v1.V16B()))
+TEST_NEON_AES(aesmc_0, aesmc(v0.V16B(), v1.V16B()))
+
+#define TEST_NEON_SHA1(NAME, ASM)                                        \
+  TEST_TEMPLATE_A64(CPUFeatures(CPUFeatures::kNEON, CPUFeatures::kSHA1), \
+                    NEON_SHA1_##NAME,                                    \
+                    ASM)
+TEST_NEON_SHA1(sha1c_0, sha1c(q0, s1, v2.V4S()))
+TEST_NEON_SHA1(sha1h_0, sha1h(s0, s1))
+TEST_NEON_SHA1(sha1m_0, sha1m(q0, s1, v2.V4S()))
+TEST_NEON_SHA1(sha1p_0, sha1p(q0, s1, v2.V4S()))
+TEST_NEON_SHA1(sha1su0_0, sha1su0(v0.V4S(), v1.V4S(), v2.V4S()))
+TEST_NEON_SHA1(sha1su1_0, sha1su1(v0.V4S(), v1.V4S()))
+
+#define TEST_NEON_SHA2(NAME, ASM)                                        \
+  TEST_TEMPLATE_A64(CPUFeatures(CPUFeatures::kNEON, CPUFeatures::kSHA2), \
+                    NEON_SHA2_##NAME,                                    \
+                    ASM)
+TEST_NEON_SHA2(sha256h_0, sha256h(q0, q1, v2.V4S()))
+TEST_NEON_SHA2(sha256h2_0, sha256h2(q0, q1, v2.V4S()))
+TEST_NEON_SHA2(sha256su0_0, sha256su0(v0.V4S(), v1.V4S()))
+TEST_NEON_SHA2(sha256su1_0, sha256su1(v0.V4S(), v1.V4S(), v2.V4S()))
+
+#define TEST_NEON_PMULL1Q(NAME, ASM)                                        \
+  TEST_TEMPLATE_A64(CPUFeatures(CPUFeatures::kNEON, CPUFeatures::kPmull1Q), \
+                    NEON_Pmull1Q_##NAME,                                    \
+                    ASM)
+TEST_NEON_PMULL1Q(pmull_0, pmull(q0, v1.V1D(), v2.V1D()))
+TEST_NEON_PMULL1Q(pmull2_0, pmull2(q0, v1.V2D(), v2.V2D()))
+
 #define TEST_FP_NEON_NEONHALF(NAME, ASM)                 \
   TEST_TEMPLATE_A64(CPUFeatures(CPUFeatures::kFP,        \
                                 CPUFeatures::kNEON,      \
@@ -3656,5 +3692,75 @@ TEST_FP_FCMA_NEON_NEONHALF(fcmla_1, fcmla(v0.V8H(), v1.V8H(), v2.H(), 2, 180))
 TEST_FP_FCMA_NEON_NEONHALF(fcmla_2, fcmla(v0.V4H(), v1.V4H(), v2.V4H(), 180))
 TEST_FP_FCMA_NEON_NEONHALF(fcmla_3, fcmla(v0.V8H(), v1.V8H(), v2.V8H(), 0))
 
+
+// The auditor caches the features of each instruction. Check that changes to
+// the available features, however they are made, are taken into account.
+TEST(auditor_cache_available_features) {
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  {
+    // This can be provided by either FP or NEON.
+    SingleEmissionCheckScope guard(&masm);
+    masm.ldr(s0, MemOperand(x0));
+  }
+  masm.FinalizeCode();
+  const Instruction* instr = masm.GetInstructionAt(0);
+
+  Decoder decoder;
+  CPUFeaturesAuditor auditor(&decoder);
+  decoder.Decode(instr);
+  VIXL_CHECK(auditor.GetInstructionFeatures() ==
+             CPUFeatures(CPUFeatures::kFP, CPUFeatures::kNEON));
+  VIXL_CHECK(!auditor.InstructionIsAvailable());
+
+  // Modify the available features in place.
+  auditor.GetCPUFeatures()->Combine(CPUFeatures::kFP);
+  VIXL_CHECK(!auditor.InstructionIsAvailable());
+  decoder.Decode(instr);
+  VIXL_CHECK(auditor.GetInstructionFeatures() ==
+             CPUFeatures(CPUFeatures::kFP));
+  VIXL_CHECK(auditor.InstructionIsAvailable());
+
+  auditor.SetAvailableFeatures(CPUFeatures::kNEON);
+  VIXL_CHECK(!auditor.InstructionIsAvailable());
+  decoder.Decode(instr);
+  VIXL_CHECK(auditor.GetInstructionFeatures() ==
+             CPUFeatures(CPUFeatures::kNEON));
+  VIXL_CHECK(auditor.InstructionIsAvailable());
+  decoder.Decode(instr);
+  VIXL_CHECK(auditor.InstructionIsAvailable());
+}
+
+
+TEST(auditor_cache_seen_features) {
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  {
+    SingleEmissionCheckScope guard(&masm);
+    masm.crc32b(w0, w1, w2);
+  }
+  masm.FinalizeCode();
+  const Instruction* instr = masm.GetInstructionAt(0);
+
+  Decoder decoder;
+  CPUFeaturesAuditor auditor(&decoder, CPUFeatures::All());
+  decoder.Decode(instr);
+  VIXL_CHECK(auditor.GetSeenFeatures() == CPUFeatures(CPUFeatures::kCRC32));
+
+  // Cached instructions must still be recorded as seen after a reset.
+  auditor.ResetSeenFeatures();
+  VIXL_CHECK(auditor.GetSeenFeatures() == CPUFeatures::None());
+  decoder.Decode(instr);
+  VIXL_CHECK(auditor.GetSeenFeatures() == CPUFeatures(CPUFeatures::kCRC32));
+
+  // The same encoding requires Morello in C64.
+  decoder.Decode(instr, ISA::C64);
+  VIXL_CHECK(auditor.GetInstructionFeatures() ==
+             CPUFeatures(CPUFeatures::kCRC32, CPUFeatures::kMorello));
+  decoder.Decode(instr, ISA::A64);
+  VIXL_CHECK(auditor.GetInstructionFeatures() ==
+             CPUFeatures(CPUFeatures::kCRC32));
+}
+
 }  // namespace aarch64
 }  // namespace vixl
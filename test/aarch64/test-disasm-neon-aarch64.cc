@@ -2807,6 +2807,35 @@ TEST(neon_3different) {
                 "pmull v0.8h, v1.8b, v2.8b");
   COMPARE_MACRO(Pmull2(v2.V8H(), v3.V16B(), v4.V16B()),
                 "pmull2 v2.8h, v3.16b, v4.16b");
+  COMPARE_MACRO(Pmull(q0, v1.V1D(), v2.V1D()), "pmull v0.1q, v1.1d, v2.1d");
+  COMPARE_MACRO(Pmull2(q2, v3.V2D(), v4.V2D()),
+                "pmull2 v2.1q, v3.2d, v4.2d");
+
+  CLEANUP();
+}
+
+
+TEST(neon_crypto) {
+  SETUP();
+
+  COMPARE_MACRO(Aese(v0.V16B(), v1.V16B()), "aese v0.16b, v1.16b");
+  COMPARE_MACRO(Aesd(v2.V16B(), v3.V16B()), "aesd v2.16b, v3.16b");
+  COMPARE_MACRO(Aesmc(v4.V16B(), v5.V16B()), "aesmc v4.16b, v5.16b");
+  COMPARE_MACRO(Aesimc(v6.V16B(), v31.V16B()), "aesimc v6.16b, v31.16b");
+
+  COMPARE_MACRO(Sha1c(q0, s1, v2.V4S()), "sha1c q0, s1, v2.4s");
+  COMPARE_MACRO(Sha1p(q3, s4, v5.V4S()), "sha1p q3, s4, v5.4s");
+  COMPARE_MACRO(Sha1m(q6, s7, v8.V4S()), "sha1m q6, s7, v8.4s");
+  COMPARE_MACRO(Sha1h(s9, s10), "sha1h s9, s10");
+  COMPARE_MACRO(Sha1su0(v11.V4S(), v12.V4S(), v13.V4S()),
+                "sha1su0 v11.4s, v12.4s, v13.4s");
+  COMPARE_MACRO(Sha1su1(v14.V4S(), v15.V4S()), "sha1su1 v14.4s, v15.4s");
+
+  COMPARE_MACRO(Sha256h(q16, q17, v18.V4S()), "sha256h q16, q17, v18.4s");
+  COMPARE_MACRO(Sha256h2(q19, q20, v21.V4S()), "sha256h2 q19, q20, v21.4s");
+  COMPARE_MACRO(Sha256su0(v22.V4S(), v23.V4S()), "sha256su0 v22.4s, v23.4s");
+  COMPARE_MACRO(Sha256su1(v24.V4S(), v25.V4S(), v26.V4S()),
+                "sha256su1 v24.4s, v25.4s, v26.4s");
 
   CLEANUP();
 }
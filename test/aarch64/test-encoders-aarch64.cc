@@ -0,0 +1,169 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <array>
+#include <functional>
+
+#include "test-runner.h"
+
+#include "aarch64/encoders-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#define TEST(name) TEST_(AARCH64_ENCODERS_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+using encoding::CReg;
+using encoding::WReg;
+using encoding::XReg;
+
+// Assemble one instruction with the Assembler, and return its encoding.
+static Instr Assemble(const std::function<void(MacroAssembler*)>& emit,
+                      ISA isa = ISA::A64) {
+  MacroAssembler masm(PageOffsetDependentCode);
+  masm.SetCPUFeatures(CPUFeatures::All());
+  masm.SetISA(isa);
+  {
+    ExactAssemblyScope scope(&masm, kInstructionSize);
+    emit(&masm);
+  }
+  masm.FinalizeCode();
+  return *masm.GetBuffer()->GetStartAddress<const Instr*>();
+}
+
+#define CHECK_ENCODING(ENCODER, ASM)                                   \
+  VIXL_CHECK(encoding::ENCODER ==                                      \
+             Assemble([](MacroAssembler* masm) { masm->ASM; }, ISA::A64))
+
+#define CHECK_ENCODING_C64(ENCODER, ASM)                               \
+  VIXL_CHECK(encoding::ENCODER ==                                      \
+             Assemble([](MacroAssembler* masm) { masm->ASM; }, ISA::C64))
+
+
+TEST(a64) {
+  CHECK_ENCODING(Nop(), nop());
+  CHECK_ENCODING(Brk(0x1234), brk(0x1234));
+
+  CHECK_ENCODING(B(42), b(42));
+  CHECK_ENCODING(B(-(1 << 25)), b(-(1 << 25)));
+  CHECK_ENCODING(Bl(-3), bl(-3));
+  CHECK_ENCODING(B(ne, 1000), b(1000, ne));
+  CHECK_ENCODING(Cbz(XReg(3), -5), cbz(x3, -5));
+  CHECK_ENCODING(Cbnz(WReg(30), 7), cbnz(w30, 7));
+  CHECK_ENCODING(Tbz(XReg(1), 63, 12), tbz(x1, 63, 12));
+  CHECK_ENCODING(Tbnz(WReg(2), 5, -12), tbnz(w2, 5, -12));
+
+  CHECK_ENCODING(Br(XReg(16)), br(x16));
+  CHECK_ENCODING(Blr(XReg(1)), blr(x1));
+  CHECK_ENCODING(Ret(), ret());
+  CHECK_ENCODING(Ret(XReg(2)), ret(x2));
+
+  CHECK_ENCODING(Add(XReg(0), XReg(31), 16), add(x0, sp, 16));
+  CHECK_ENCODING(Add(WReg(1), WReg(2), 0x5000), add(w1, w2, 0x5000));
+  CHECK_ENCODING(Sub(XReg(31), XReg(31), 32), sub(sp, sp, 32));
+  CHECK_ENCODING(Adds(XReg(31), XReg(4), 4095), adds(xzr, x4, 4095));
+  CHECK_ENCODING(Subs(WReg(5), WReg(6), 1), subs(w5, w6, 1));
+  CHECK_ENCODING(Mov(XReg(7), XReg(8)), mov(x7, x8));
+  CHECK_ENCODING(Mov(WReg(7), WReg(31)), mov(w7, wzr));
+
+  CHECK_ENCODING(Movz(XReg(9), 0xabcd, 48), movz(x9, 0xabcd, 48));
+  CHECK_ENCODING(Movk(WReg(10), 0x1234, 16), movk(w10, 0x1234, 16));
+  CHECK_ENCODING(Movn(XReg(11), 0xffff), movn(x11, 0xffff));
+
+  CHECK_ENCODING(Adr(XReg(12), -(1 << 20)), adr(x12, -(1 << 20)));
+  CHECK_ENCODING(Adrp(XReg(13), 0x1234), adrp(x13, 0x1234));
+
+  CHECK_ENCODING(Ldr(XReg(0), XReg(31), 32760),
+                 ldr(x0, MemOperand(sp, 32760)));
+  CHECK_ENCODING(Ldr(WReg(1), XReg(2), 8), ldr(w1, MemOperand(x2, 8)));
+  CHECK_ENCODING(Str(XReg(3), XReg(4)), str(x3, MemOperand(x4)));
+  CHECK_ENCODING(Str(WReg(5), XReg(6), 16380),
+                 str(w5, MemOperand(x6, 16380)));
+  CHECK_ENCODING(LdrLiteral(XReg(7), -2), ldr(x7, -2));
+  CHECK_ENCODING(LdrLiteral(WReg(8), 100), ldr(w8, 100));
+
+  CHECK_ENCODING(Stp(XReg(29), XReg(30), XReg(31), -16, PreIndex),
+                 stp(x29, x30, MemOperand(sp, -16, PreIndex)));
+  CHECK_ENCODING(Ldp(XReg(29), XReg(30), XReg(31), 16, PostIndex),
+                 ldp(x29, x30, MemOperand(sp, 16, PostIndex)));
+  CHECK_ENCODING(Ldp(XReg(0), XReg(1), XReg(2), 504),
+                 ldp(x0, x1, MemOperand(x2, 504)));
+  CHECK_ENCODING(Stp(XReg(0), XReg(1), XReg(2), -512),
+                 stp(x0, x1, MemOperand(x2, -512)));
+}
+
+
+TEST(c64) {
+  CHECK_ENCODING(Br(CReg(16)), br(c16));
+  CHECK_ENCODING(Blr(CReg(1)), blr(c1));
+  CHECK_ENCODING(Ret(CReg(30)), ret(c30));
+  CHECK_ENCODING(Mov(CReg(0), CReg(31)), cpy(c0, csp));
+  CHECK_ENCODING(Add(CReg(1), CReg(2), 0x123000), add(c1, c2, 0x123000));
+  CHECK_ENCODING(Ldr(CReg(3), XReg(4), 64), ldr(c3, MemOperand(x4, 64)));
+  CHECK_ENCODING(Str(CReg(5), XReg(31), 16 * 4095),
+                 str(c5, MemOperand(sp, 16 * 4095)));
+
+  CHECK_ENCODING_C64(Adr(CReg(6), -42), adr(c6, -42));
+  CHECK_ENCODING_C64(Adrp(CReg(7), 0x7ffff), adrp(c7, 0x7ffff));
+  CHECK_ENCODING_C64(Adrp(CReg(8), -0x80000), adrp(c8, -0x80000));
+  CHECK_ENCODING_C64(Ldr(CReg(9), CReg(10), 32), ldr(c9, MemOperand(c10, 32)));
+}
+
+
+// A template built at compile time, with a hole for a 32-bit constant.
+constexpr std::array<Instr, 3> kTemplate = {{
+    encoding::Movz(XReg(0), 0),
+    encoding::Movk(XReg(0), 0, 16),
+    encoding::Ret(),
+}};
+VIXL_STATIC_ASSERT(kTemplate[2] == 0xd65f03c0);
+
+TEST(template) {
+  std::array<Instr, 3> code = kTemplate;
+  uint32_t value = 0x12345678;
+  code[0] |= encoding::ImmMoveWide(value & 0xffff);
+  code[1] |= encoding::ImmMoveWide(value >> 16);
+
+  MacroAssembler masm;
+  {
+    InstructionStreamScope stream(&masm, code.size());
+    stream.Emit(code.data(), code.size());
+  }
+  masm.FinalizeCode();
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+  VIXL_CHECK(simulator.ReadXRegister(0) == value);
+#endif
+}
+
+}  // namespace aarch64
+}  // namespace vixl
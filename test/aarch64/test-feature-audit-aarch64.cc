@@ -0,0 +1,204 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "test-runner.h"
+
+#include "aarch64/feature-audit-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+
+#define __ masm.
+#define TEST(name) TEST_(AARCH64_FEATURE_AUDIT_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+typedef std::vector<std::pair<std::string, const Label*>> LabelList;
+
+TEST(functions) {
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  Label plain, fp_crc, data;
+
+  __ Bind(&plain);
+  __ Add(x0, x1, x2);
+  __ Ret();
+
+  __ Bind(&fp_crc);
+  __ Add(x0, x1, x2);
+  __ Fadd(d0, d1, d2);
+  __ Crc32b(w0, w1, w2);
+  __ Fadd(d3, d4, d5);
+  __ Ret();
+
+  __ Bind(&data);
+  __ Ret();
+  {
+    // Data that happens to look like an SVE instruction isn't audited.
+    ISAScope isa(&masm, ISA::Data);
+    ExactAssemblyScope scope(&masm, kInstructionSize);
+    __ dc32(0x04a00000);  // add z0.s, z0.s, z0.s
+  }
+  masm.FinalizeCode();
+
+  FeatureAudit audit(CPUFeatures(CPUFeatures::kFP));
+  LabelList labels;
+  labels.push_back(std::make_pair("data", &data));
+  labels.push_back(std::make_pair("plain", &plain));
+  labels.push_back(std::make_pair("fp_crc", &fp_crc));
+  audit.AddFunctions(masm, labels);
+  audit.Run();
+
+  // Functions are sorted by their position in the code.
+  VIXL_CHECK(audit.GetNumberOfFunctions() == 3);
+  const FeatureAudit::Function& f0 = audit.GetFunction(0);
+  const FeatureAudit::Function& f1 = audit.GetFunction(1);
+  const FeatureAudit::Function& f2 = audit.GetFunction(2);
+  VIXL_CHECK(f0.name == "plain");
+  VIXL_CHECK(f1.name == "fp_crc");
+  VIXL_CHECK(f2.name == "data");
+
+  VIXL_CHECK(f0.features.HasNoFeatures());
+  VIXL_CHECK(f0.first_uses.empty());
+
+  VIXL_CHECK(f1.features ==
+             CPUFeatures(CPUFeatures::kFP, CPUFeatures::kCRC32));
+  VIXL_CHECK(f1.first_uses.size() == 2);
+  VIXL_CHECK(f1.first_uses[0].first == CPUFeatures::kFP);
+  VIXL_CHECK(f1.first_uses[1].first == CPUFeatures::kCRC32);
+  VIXL_CHECK(f1.GetFirstUse(CPUFeatures::kFP) ==
+             f1.start + kInstructionSize);
+  VIXL_CHECK(f1.GetFirstUse(CPUFeatures::kCRC32) ==
+             f1.start + (2 * kInstructionSize));
+  VIXL_CHECK(f1.GetFirstUse(CPUFeatures::kSVE) == NULL);
+
+  VIXL_CHECK(f2.features.HasNoFeatures());
+
+  VIXL_CHECK(audit.GetRequiredFeatures() ==
+             CPUFeatures(CPUFeatures::kFP, CPUFeatures::kCRC32));
+  VIXL_CHECK(!audit.IsCompatible());
+
+  std::ostringstream report;
+  audit.PrintReport(report);
+  VIXL_CHECK(report.str() ==
+             "plain: { }\n"
+             "fp_crc: { FP, CRC32 }\n"
+             "  CRC32 is not in the baseline; first used at +0x8\n"
+             "data: { }\n");
+}
+
+
+TEST(isa) {
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  Label a64, c64;
+  __ Bind(&a64);
+  __ Nop();
+  __ Nop();
+  {
+    ISAScope isa(&masm, ISA::C64);
+    __ Bind(&c64);
+    __ Nop();
+  }
+  masm.FinalizeCode();
+
+  FeatureAudit audit(CPUFeatures::AArch64LegacyBaseline());
+  audit.AddFunctions(masm, {{"a64", &a64}, {"c64", &c64}});
+  // The whole buffer as one function, using the ISA map.
+  audit.AddFunction("all",
+                    masm.GetBuffer()->GetStartAddress<const Instruction*>(),
+                    masm.GetBuffer()->GetEndAddress<const Instruction*>(),
+                    masm.GetISAMap());
+  audit.Run();
+
+  VIXL_CHECK(audit.GetFunction(0).features.HasNoFeatures());
+  VIXL_CHECK(audit.GetFunction(1).features ==
+             CPUFeatures(CPUFeatures::kMorello));
+  VIXL_CHECK(audit.GetFunction(2).features ==
+             CPUFeatures(CPUFeatures::kMorello));
+  VIXL_CHECK(audit.GetFunction(2).GetFirstUse(CPUFeatures::kMorello) ==
+             audit.GetFunction(2).start + (2 * kInstructionSize));
+  VIXL_CHECK(!audit.IsCompatible());
+}
+
+
+TEST(parallel) {
+  // Many functions, each using a different feature part way through, split
+  // into many small chunks.
+  const int kFunctions = 64;
+  const int kInstructions = 100;
+  MacroAssembler masm;
+  masm.SetCPUFeatures(CPUFeatures::All());
+  std::vector<Label> labels(kFunctions);
+  for (int i = 0; i < kFunctions; i++) {
+    __ Bind(&labels[i]);
+    for (int j = 0; j < kInstructions; j++) {
+      if (j == i) {
+        __ Crc32w(w0, w1, w2);
+      } else if (j == (kInstructions - i - 1)) {
+        __ Fadd(s0, s1, s2);
+      } else {
+        __ Add(x0, x1, x2);
+      }
+    }
+  }
+  masm.FinalizeCode();
+
+  LabelList names;
+  for (int i = 0; i < kFunctions; i++) {
+    std::string name = "f" + std::to_string(i);
+    names.push_back(std::make_pair(name, &labels[i]));
+  }
+
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    FeatureAudit audit(CPUFeatures(CPUFeatures::kFP, CPUFeatures::kCRC32));
+    audit.SetChunkSize(7);
+    audit.AddFunctions(masm, names);
+    audit.Run(threads);
+    VIXL_CHECK(audit.IsCompatible());
+    VIXL_CHECK(audit.GetNumberOfFunctions() == kFunctions);
+    for (int i = 0; i < kFunctions; i++) {
+      const FeatureAudit::Function& f = audit.GetFunction(i);
+      VIXL_CHECK((f.end - f.start) == (kInstructions * kInstructionSize));
+      VIXL_CHECK(f.features ==
+                 CPUFeatures(CPUFeatures::kFP, CPUFeatures::kCRC32));
+      VIXL_CHECK(f.GetFirstUse(CPUFeatures::kCRC32) ==
+                 f.start + (i * kInstructionSize));
+      VIXL_CHECK(f.GetFirstUse(CPUFeatures::kFP) ==
+                 f.start + ((kInstructions - i - 1) * kInstructionSize));
+      // `first_uses` is in code order.
+      CPUFeatures::Feature first =
+          (i < (kInstructions / 2)) ? CPUFeatures::kCRC32 : CPUFeatures::kFP;
+      VIXL_CHECK(f.first_uses[0].first == first);
+    }
+  }
+}
+
+}  // namespace aarch64
+}  // namespace vixl
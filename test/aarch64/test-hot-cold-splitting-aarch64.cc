@@ -0,0 +1,270 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "test-runner.h"
+
+#include "aarch64/branch-relaxation-aarch64.h"
+#include "aarch64/hot-cold-splitting-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#define TEST(name) TEST_(AARCH64_HOTCOLD_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+// Run the function at `offset` in the buffer with one argument, and return x0.
+// If `profiler` is not NULL, it is attached to the decoder.
+static int64_t Run(MacroAssembler* masm,
+                   ptrdiff_t offset,
+                   int64_t arg,
+                   ExecutionProfiler* profiler = NULL) {
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  if (profiler != NULL) decoder.AppendVisitor(profiler);
+  simulator.WriteXRegister(0, arg);
+  simulator.RunFrom(masm->GetBuffer()->GetOffsetAddress<Instruction*>(offset));
+  return simulator.ReadXRegister(0);
+}
+#endif
+
+
+// Add the blocks of a function with two slow paths:
+//   x0 == 0: 1000
+//   x0 > 100: x0
+//   otherwise: x0 + 1
+static void AddTestBlocks(HotColdSplitter* splitter) {
+  int entry = splitter->AddBlock();
+  int fast = splitter->AddBlock();
+  int zero = splitter->AddBlock();
+  int big = splitter->AddBlock();
+  int done = splitter->AddBlock();
+  splitter->SetGenerator(entry, [=](MacroAssembler* masm) {
+    masm->Mov(x1, 0);
+    masm->Cbz(x0, splitter->GetLabel(zero));
+    masm->Cmp(x0, 100);
+    masm->B(hi, splitter->GetLabel(big));
+  });
+  splitter->SetGenerator(fast, [=](MacroAssembler* masm) {
+    masm->Add(x1, x0, 1);
+    masm->B(splitter->GetLabel(done));
+  });
+  splitter->SetFallsThrough(fast, false);
+  splitter->SetGenerator(zero, [=](MacroAssembler* masm) {
+    masm->Mov(x1, 1000);
+    masm->Mov(x0, 0);
+  });
+  // `zero` falls through to `big`.
+  splitter->SetGenerator(big, [=](MacroAssembler* masm) {
+    masm->Add(x1, x1, x0);
+  });
+  splitter->SetGenerator(done, [=](MacroAssembler* masm) {
+    masm->Mov(x0, x1);
+    masm->Ret();
+  });
+  splitter->SetFallsThrough(done, false);
+}
+
+
+TEST(explicit_cold_blocks) {
+  MacroAssembler masm;
+  HotColdSplitter splitter;
+  AddTestBlocks(&splitter);
+  splitter.SetCold(2, true);
+  splitter.SetCold(3, true);
+  VIXL_CHECK(splitter.GetNumberOfColdBlocks() == 2);
+  splitter.Generate(&masm);
+  masm.FinalizeCode();
+
+  // The hot blocks are in order, followed by the cold blocks.
+  VIXL_CHECK(splitter.GetBlockOffset(0) == 0);
+  VIXL_CHECK(splitter.GetBlockOffset(1) < splitter.GetBlockOffset(4));
+  VIXL_CHECK(splitter.GetBlockOffset(4) < splitter.GetColdRegionOffset());
+  VIXL_CHECK(splitter.GetBlockOffset(2) == splitter.GetColdRegionOffset());
+  VIXL_CHECK(splitter.GetBlockOffset(3) > splitter.GetBlockOffset(2));
+  // `big` falls through to `done`, which is now in the hot region.
+  VIXL_CHECK(splitter.GetNumberOfAddedBranches() == 1);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 0, 5) == 6);
+  VIXL_CHECK(Run(&masm, 0, 0) == 1000);
+  VIXL_CHECK(Run(&masm, 0, 200) == 200);
+#endif
+}
+
+
+TEST(no_cold_blocks) {
+  MacroAssembler masm;
+  HotColdSplitter splitter;
+  AddTestBlocks(&splitter);
+  splitter.Generate(&masm);
+  masm.FinalizeCode();
+
+  // Without cold blocks, the layout is unchanged.
+  VIXL_CHECK(splitter.GetNumberOfAddedBranches() == 0);
+  VIXL_CHECK(splitter.GetColdRegionOffset() ==
+             static_cast<ptrdiff_t>(masm.GetSizeOfCodeGenerated()));
+  for (int i = 1; i < splitter.GetNumberOfBlocks(); i++) {
+    VIXL_CHECK(splitter.GetBlockOffset(i) > splitter.GetBlockOffset(i - 1));
+  }
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 0, 5) == 6);
+  VIXL_CHECK(Run(&masm, 0, 0) == 1000);
+  VIXL_CHECK(Run(&masm, 0, 200) == 200);
+#endif
+}
+
+
+TEST(fall_through) {
+  MacroAssembler masm;
+  HotColdSplitter splitter;
+  int entry = splitter.AddBlock();
+  int cold = splitter.AddBlock();
+  int last = splitter.AddBlock();
+  splitter.SetGenerator(entry, [&](MacroAssembler* m) {
+    m->Mov(x1, 0);
+    m->Cbz(x0, splitter.GetLabel(last));
+  });
+  splitter.SetGenerator(cold, [](MacroAssembler* m) { m->Mov(x1, 42); });
+  splitter.SetGenerator(last, [](MacroAssembler* m) { m->Add(x1, x1, 1); });
+  splitter.SetCold(cold, true);
+  splitter.Generate(&masm);
+  // Control that falls through the last block continues here.
+  masm.Mov(x0, x1);
+  masm.Ret();
+  masm.FinalizeCode();
+
+  // `entry` falls through to `cold`, which falls through to `last`, which
+  // falls through to the end of the function.
+  VIXL_CHECK(splitter.GetNumberOfAddedBranches() == 3);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 0, 0) == 1);
+  VIXL_CHECK(Run(&masm, 0, 3) == 43);
+#endif
+}
+
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+TEST(profile) {
+  HotColdSplitter splitter;
+  AddTestBlocks(&splitter);
+
+  // Generate and profile the function with every block hot.
+  MacroAssembler profiled;
+  splitter.Generate(&profiled);
+  profiled.FinalizeCode();
+  ExecutionProfiler profiler(
+      profiled.GetBuffer()->GetStartAddress<Instruction*>(),
+      profiled.GetBuffer()->GetEndAddress<Instruction*>());
+  for (int i = 1; i <= 50; i++) {
+    VIXL_CHECK(Run(&profiled, 0, i, &profiler) == i + 1);
+  }
+  VIXL_CHECK(Run(&profiled, 0, 500, &profiler) == 500);
+  VIXL_CHECK(profiler.GetExecutionCount(splitter.GetBlockOffset(0)) == 51);
+  VIXL_CHECK(profiler.GetExecutionCount(splitter.GetBlockOffset(1)) == 50);
+  VIXL_CHECK(profiler.GetExecutionCount(splitter.GetBlockOffset(2)) == 0);
+  VIXL_CHECK(profiler.GetExecutionCount(splitter.GetBlockOffset(3)) == 1);
+
+  // Only `zero` was never entered.
+  VIXL_CHECK(splitter.ClassifyFromProfile(profiler) == 1);
+  VIXL_CHECK(splitter.IsCold(2));
+  // With a higher threshold, `big` is cold too.
+  VIXL_CHECK(splitter.ClassifyFromProfile(profiler, 1) == 2);
+  VIXL_CHECK(splitter.IsCold(3));
+
+  // Generate the function again, after some other code.
+  MacroAssembler masm;
+  masm.Mov(x0, 0xbad);
+  masm.Ret();
+  splitter.Generate(&masm);
+  masm.FinalizeCode();
+  ptrdiff_t start = splitter.GetFunctionStart();
+  VIXL_CHECK(start == 2 * kInstructionSize);
+  VIXL_CHECK(Run(&masm, start, 5) == 6);
+  VIXL_CHECK(Run(&masm, start, 0) == 1000);
+  VIXL_CHECK(Run(&masm, start, 200) == 200);
+
+  // Profile the new layout; the hot blocks are still hot.
+  ExecutionProfiler split_profiler(
+      masm.GetBuffer()->GetOffsetAddress<Instruction*>(start),
+      masm.GetBuffer()->GetEndAddress<Instruction*>());
+  VIXL_CHECK(Run(&masm, start, 7, &split_profiler) == 8);
+  VIXL_CHECK(split_profiler.GetExecutionCount(splitter.GetBlockOffset(1)) ==
+             1);
+  VIXL_CHECK(splitter.ClassifyFromProfile(split_profiler) == 2);
+  VIXL_CHECK(!splitter.IsCold(1));
+  VIXL_CHECK(splitter.IsCold(2));
+  VIXL_CHECK(splitter.IsCold(3));
+  VIXL_CHECK(!splitter.IsCold(4));
+}
+#endif
+
+
+TEST(relaxation) {
+  // Pad the hot region so that branches to the cold region are out of range of
+  // `tbz`.
+  const int kPadding =
+      Instruction::GetImmBranchForwardRange(TestBranchType) / kInstructionSize;
+  HotColdSplitter splitter;
+  int entry = splitter.AddBlock();
+  int cold = splitter.AddBlock();
+  int done = splitter.AddBlock();
+  splitter.SetGenerator(entry, [&](MacroAssembler* m) {
+    m->Mov(x1, 1);
+    m->Tbnz(x0, 0, splitter.GetLabel(cold));
+    for (int i = 0; i < kPadding; i++) m->Add(x1, x1, 1);
+    m->B(splitter.GetLabel(done));
+  });
+  splitter.SetFallsThrough(entry, false);
+  splitter.SetGenerator(cold, [](MacroAssembler* m) { m->Mov(x1, 42); });
+  splitter.SetGenerator(done, [](MacroAssembler* m) {
+    m->Mov(x0, x1);
+    m->Ret();
+  });
+  splitter.SetFallsThrough(done, false);
+  splitter.SetCold(cold, true);
+
+  MacroAssembler masm;
+  BranchRelaxation relaxation(&masm);
+  relaxation.Generate([&](MacroAssembler* m) { splitter.Generate(m); });
+  masm.FinalizeCode();
+
+  // The branch to the cold block was relaxed rather than given a veneer.
+  VIXL_CHECK(relaxation.GetNumberOfRelaxedBranches() == 1);
+  VIXL_CHECK(masm.GetNumberOfPotentialVeneers() == 0);
+  VIXL_CHECK(splitter.GetNumberOfAddedBranches() == 1);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 0, 1) == 42);
+  VIXL_CHECK(Run(&masm, 0, 2) == kPadding + 1);
+#endif
+}
+
+}  // namespace aarch64
+}  // namespace vixl
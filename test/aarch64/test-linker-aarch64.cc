@@ -0,0 +1,223 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <vector>
+
+#include "test-runner.h"
+
+#include "aarch64/linker-aarch64.h"
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#define TEST(name) TEST_(AARCH64_LINKER_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+// Run the linked code from `symbol`, with one X argument, and return x0.
+static int64_t Run(const MacroAssembler* masm,
+                   const Linker* linker,
+                   LinkSymbol symbol,
+                   int64_t arg) {
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.WriteXRegister(0, arg);
+  simulator.RunFrom(masm->GetBuffer().GetOffsetAddress<Instruction*>(
+      linker->GetSymbolOffset(symbol)));
+  return simulator.ReadXRegister(0);
+}
+#endif
+
+
+TEST(calls) {
+  Linker linker;
+  LinkSymbol entry = linker.AddSymbol("entry");
+  LinkSymbol add_one = linker.AddSymbol("add_one");
+  LinkSymbol twice = linker.AddSymbol("twice");
+
+  // entry(x) = twice(add_one(x)) + 0x1234567890
+  linker.AddUnit([=](LinkUnit* unit) {
+    MacroAssembler* masm = unit->GetMacroAssembler();
+    unit->Bind(entry);
+    masm->Push(lr, x19);
+    // This uses a literal pool, so the unit contains data.
+    masm->Ldr(x19, 0x1234567890);
+    unit->Bl(add_one);
+    unit->Bl(twice);
+    masm->Add(x0, x0, x19);
+    masm->Pop(x19, lr);
+    masm->Ret();
+  });
+  linker.AddUnit([=](LinkUnit* unit) {
+    MacroAssembler* masm = unit->GetMacroAssembler();
+    unit->Bind(add_one);
+    masm->Add(x0, x0, 1);
+    masm->Ret();
+    // Units can define more than one symbol.
+    unit->Bind(twice);
+    masm->Lsl(x0, x0, 1);
+    masm->Ret();
+  });
+  linker.SetUnitAlignment(64);
+  linker.GenerateInParallel(2);
+
+  MacroAssembler masm;
+  masm.Nop();
+  linker.Link(&masm);
+  masm.FinalizeCode();
+
+  VIXL_CHECK(linker.GetNumberOfTrampolines() == 0);
+  VIXL_CHECK(linker.GetUnit(0)->GetLinkedOffset() == 64);
+  VIXL_CHECK(linker.GetSymbolOffset(entry) == 64);
+  VIXL_CHECK(IsAligned(linker.GetSymbolOffset(add_one), 64));
+  VIXL_CHECK(linker.GetSymbolOffset(twice) ==
+             linker.GetSymbolOffset(add_one) + 2 * kInstructionSize);
+  VIXL_CHECK(masm.GetSizeOfCodeGenerated() ==
+             kInstructionSize + linker.GetLinkedSize());
+
+  // The literal pool of the first unit is described as data.
+  const ISAMap* isa_map = masm.GetISAMap();
+  const LinkUnit* first = linker.GetUnit(0);
+  const ISAMap* first_isa_map = first->GetMacroAssembler()->GetISAMap();
+  size_t first_size = first->GetMacroAssembler()->GetSizeOfCodeGenerated();
+  int data = 0;
+  for (size_t offset = 0; offset < first_size; offset += kInstructionSize) {
+    ISA isa = first_isa_map->GetISAAt(offset);
+    if (isa == ISA::Data) data++;
+    VIXL_CHECK(isa_map->GetISAAt(first->GetLinkedOffset() + offset) == isa);
+  }
+  VIXL_CHECK(data > 0);
+  VIXL_CHECK(isa_map->GetISAAt(linker.GetSymbolOffset(add_one)) == ISA::A64);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, &linker, entry, 20) == 42 + 0x1234567890);
+  VIXL_CHECK(Run(&masm, &linker, twice, 21) == 42);
+#endif
+}
+
+
+TEST(trampolines) {
+  Linker linker;
+  LinkSymbol entry = linker.AddSymbol("entry");
+  LinkSymbol near = linker.AddSymbol("near");
+  LinkSymbol far = linker.AddSymbol("far");
+
+  // entry(x) = far(near(x)), with a tail call to `far`.
+  linker.AddUnit([=](LinkUnit* unit) {
+    MacroAssembler* masm = unit->GetMacroAssembler();
+    unit->Bind(entry);
+    masm->Push(lr, xzr);
+    unit->Bl(near);
+    masm->Pop(xzr, lr);
+    unit->B(far);
+  });
+  linker.AddUnit([=](LinkUnit* unit) {
+    MacroAssembler* masm = unit->GetMacroAssembler();
+    unit->Bind(near);
+    masm->Add(x0, x0, 2);
+    masm->Ret();
+    for (int i = 0; i < 1024; i++) masm->Brk(i);
+  });
+  linker.AddUnit([=](LinkUnit* unit) {
+    MacroAssembler* masm = unit->GetMacroAssembler();
+    unit->Bind(far);
+    masm->Mov(x1, 10);
+    masm->Mul(x0, x0, x1);
+    // `near` is out of range backwards too.
+    masm->Push(lr, xzr);
+    unit->Bl(near);
+    masm->Pop(xzr, lr);
+    masm->Ret();
+  });
+  linker.SetMaxCallDistance(1024);
+  linker.GenerateInParallel();
+
+  MacroAssembler masm;
+  linker.Link(&masm);
+  masm.FinalizeCode();
+
+  // The first unit reaches `near` directly, but `far` through a trampoline.
+  // The third unit reaches `near` through a trampoline.
+  VIXL_CHECK(linker.GetNumberOfTrampolines() == 2);
+  VIXL_CHECK(linker.GetSymbolOffset(far) - linker.GetSymbolOffset(entry) >
+             1024);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  // ((3 + 2) * 10) + 2
+  VIXL_CHECK(Run(&masm, &linker, entry, 3) == 52);
+#endif
+}
+
+
+TEST(parallel) {
+  // A chain of functions, each calling the next one: f_i(x) = f_{i+1}(x + i).
+  // The functions are laid out out of order, so that some calls are out of
+  // range.
+  const int kCount = 100;
+  const int kStride = 37;
+  Linker linker;
+  std::vector<LinkSymbol> symbols;
+  for (int i = 0; i < kCount; i++) {
+    symbols.push_back(linker.AddSymbol("f"));
+  }
+  for (int u = 0; u < kCount; u++) {
+    int i = (u * kStride) % kCount;
+    linker.AddUnit([=](LinkUnit* unit) {
+      MacroAssembler* masm = unit->GetMacroAssembler();
+      unit->Bind(symbols[i]);
+      masm->Add(x0, x0, i);
+      if (i + 1 < kCount) {
+        unit->B(symbols[i + 1]);
+      } else {
+        masm->Ret();
+      }
+      for (int j = 0; j < 8; j++) masm->Brk(j);
+    });
+  }
+  linker.SetMaxCallDistance(2048);
+  linker.GenerateInParallel(8);
+
+  MacroAssembler masm;
+  linker.Link(&masm);
+  masm.FinalizeCode();
+
+  VIXL_CHECK(linker.GetNumberOfTrampolines() > 0);
+  VIXL_CHECK(linker.GetNumberOfTrampolines() < kCount - 1);
+  for (int u = 1; u < kCount; u++) {
+    VIXL_CHECK(linker.GetUnit(u)->GetLinkedOffset() >
+               linker.GetUnit(u - 1)->GetLinkedOffset());
+  }
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, &linker, symbols[0], 7) ==
+             7 + (kCount * (kCount - 1) / 2));
+#endif
+}
+
+}  // namespace aarch64
+}  // namespace vixl
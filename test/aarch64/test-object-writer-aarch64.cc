@@ -0,0 +1,332 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "test-runner.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/object-writer-aarch64.h"
+
+#define __ masm.
+#define TEST(name) TEST_(AARCH64_OBJECT_WRITER_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+// A minimal reader for the objects produced by ElfObjectWriter. It only
+// understands the layout that the writer produces.
+class ElfObjectReader {
+ public:
+  explicit ElfObjectReader(const std::vector<byte>& data) : data_(data) {}
+
+  bool HasValidHeader() const {
+    if (data_.size() < 64) return false;
+    if ((data_[0] != 0x7f) || (data_[1] != 'E') || (data_[2] != 'L') ||
+        (data_[3] != 'F')) {
+      return false;
+    }
+    // ELFCLASS64, ELFDATA2LSB, ET_REL, EM_AARCH64.
+    return (data_[4] == 2) && (data_[5] == 1) && (Read<uint16_t>(16) == 1) &&
+           (Read<uint16_t>(18) == 183);
+  }
+
+  int GetSectionCount() const { return Read<uint16_t>(60); }
+
+  // Return the index of the named section, or -1.
+  int FindSection(const char* name) const {
+    uint64_t shstrtab = GetSectionOffset(Read<uint16_t>(62));
+    for (int i = 0; i < GetSectionCount(); i++) {
+      uint32_t name_index = Read<uint32_t>(GetSectionHeader(i));
+      const char* section_name =
+          reinterpret_cast<const char*>(&data_[shstrtab + name_index]);
+      if (strcmp(section_name, name) == 0) return i;
+    }
+    return -1;
+  }
+
+  uint64_t GetSectionHeader(int index) const {
+    return Read<uint64_t>(40) + (index * 64);
+  }
+  uint32_t GetSectionType(int index) const {
+    return Read<uint32_t>(GetSectionHeader(index) + 4);
+  }
+  uint64_t GetSectionOffset(int index) const {
+    return Read<uint64_t>(GetSectionHeader(index) + 24);
+  }
+  uint64_t GetSectionSize(int index) const {
+    return Read<uint64_t>(GetSectionHeader(index) + 32);
+  }
+  uint32_t GetSectionInfo(int index) const {
+    return Read<uint32_t>(GetSectionHeader(index) + 44);
+  }
+
+  struct Symbol {
+    std::string name;
+    uint64_t value;
+    uint64_t size;
+    int bind;
+    int type;
+    int shndx;
+  };
+
+  std::vector<Symbol> GetSymbols() const {
+    std::vector<Symbol> result;
+    int symtab = FindSection(".symtab");
+    uint64_t strtab = GetSectionOffset(FindSection(".strtab"));
+    uint64_t offset = GetSectionOffset(symtab);
+    uint64_t count = GetSectionSize(symtab) / 24;
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t entry = offset + (i * 24);
+      Symbol symbol;
+      symbol.name = reinterpret_cast<const char*>(
+          &data_[strtab + Read<uint32_t>(entry)]);
+      symbol.bind = data_[entry + 4] >> 4;
+      symbol.type = data_[entry + 4] & 0xf;
+      symbol.shndx = Read<uint16_t>(entry + 6);
+      symbol.value = Read<uint64_t>(entry + 8);
+      symbol.size = Read<uint64_t>(entry + 16);
+      result.push_back(symbol);
+    }
+    return result;
+  }
+
+  template <typename T>
+  T Read(uint64_t offset) const {
+    T value;
+    VIXL_CHECK(offset + sizeof(value) <= data_.size());
+    memcpy(&value, &data_[offset], sizeof(value));
+    return value;
+  }
+
+ private:
+  const std::vector<byte>& data_;
+};
+
+
+static const ElfObjectReader::Symbol* FindSymbol(
+    const std::vector<ElfObjectReader::Symbol>& symbols,
+    const char* name,
+    uint64_t value) {
+  for (size_t i = 0; i < symbols.size(); i++) {
+    if ((symbols[i].name == name) && (symbols[i].value == value)) {
+      return &symbols[i];
+    }
+  }
+  return NULL;
+}
+
+
+TEST(symbols_and_relocations) {
+  MacroAssembler masm;
+  Label entry, helper;
+  ptrdiff_t call_site;
+
+  __ Bind(&entry);
+  __ Mov(x0, 42);
+  {
+    ExactAssemblyScope scope(&masm, kInstructionSize);
+    call_site = masm.GetCursorOffset();
+    __ bl(static_cast<int64_t>(0));
+  }
+  __ Ret();
+  __ Bind(&helper);
+  __ Ret();
+  masm.FinalizeCode();
+
+  ElfObjectWriter writer(&masm);
+  writer.AddSymbol("entry", &entry, helper.GetLocation());
+  writer.AddSymbol("helper", &helper, 4, ElfObjectWriter::kLocalSymbol);
+  writer.AddExternalReference("external_fn", call_site, kRelocCall26);
+  writer.AddExternalReference("external_fn", call_site, kRelocCall26);
+
+  std::vector<byte> object;
+  writer.Write(&object);
+
+  ElfObjectReader reader(object);
+  VIXL_CHECK(reader.HasValidHeader());
+
+  int text = reader.FindSection(".text");
+  VIXL_CHECK(text > 0);
+  VIXL_CHECK(reader.GetSectionSize(text) == masm.GetSizeOfCodeGenerated());
+  VIXL_CHECK(memcmp(&object[reader.GetSectionOffset(text)],
+                    masm.GetBuffer()->GetStartAddress<byte*>(),
+                    masm.GetSizeOfCodeGenerated()) == 0);
+
+  std::vector<ElfObjectReader::Symbol> symbols = reader.GetSymbols();
+  // Null, "$x", "helper", "entry", "external_fn".
+  VIXL_CHECK(symbols.size() == 5);
+
+  // Locals must come before globals, and sh_info must point to the first
+  // global.
+  uint32_t first_global = reader.GetSectionInfo(reader.FindSection(".symtab"));
+  for (size_t i = 1; i < symbols.size(); i++) {
+    VIXL_CHECK((symbols[i].bind == 0) == (i < first_global));
+  }
+
+  const ElfObjectReader::Symbol* mapping = FindSymbol(symbols, "$x", 0);
+  VIXL_CHECK(mapping != NULL);
+  VIXL_CHECK(mapping->bind == 0);
+
+  const ElfObjectReader::Symbol* entry_sym = FindSymbol(symbols, "entry", 0);
+  VIXL_CHECK(entry_sym != NULL);
+  VIXL_CHECK(entry_sym->bind == 1);
+  VIXL_CHECK(entry_sym->type == 2);  // STT_FUNC
+  VIXL_CHECK(entry_sym->size == static_cast<uint64_t>(helper.GetLocation()));
+  VIXL_CHECK(entry_sym->shndx == text);
+
+  const ElfObjectReader::Symbol* helper_sym =
+      FindSymbol(symbols, "helper", helper.GetLocation());
+  VIXL_CHECK(helper_sym != NULL);
+  VIXL_CHECK(helper_sym->bind == 0);
+
+  const ElfObjectReader::Symbol* external =
+      FindSymbol(symbols, "external_fn", 0);
+  VIXL_CHECK(external != NULL);
+  VIXL_CHECK(external->bind == 1);
+  VIXL_CHECK(external->shndx == 0);  // SHN_UNDEF
+
+  // Both references share the same undefined symbol.
+  int rela = reader.FindSection(".rela.text");
+  VIXL_CHECK(reader.GetSectionSize(rela) == 2 * 24);
+  uint64_t rela_offset = reader.GetSectionOffset(rela);
+  for (int i = 0; i < 2; i++) {
+    uint64_t entry_offset = rela_offset + (i * 24);
+    VIXL_CHECK(reader.Read<uint64_t>(entry_offset) ==
+               static_cast<uint64_t>(call_site));
+    uint64_t info = reader.Read<uint64_t>(entry_offset + 8);
+    VIXL_CHECK((info & 0xffffffff) == kRelocCall26);
+    VIXL_CHECK(symbols[info >> 32].name == "external_fn");
+  }
+}
+
+
+TEST(mapping_symbols) {
+  MacroAssembler masm;
+  Label data;
+
+  __ Mov(x0, 1);
+  {
+    ISAScope isa(&masm, ISA::Data);
+    ExactAssemblyScope guard(&masm, 2 * sizeof(uint32_t));
+    __ bind(&data);
+    __ dc32(0xdeadbeef);
+    __ dc32(0xcafef00d);
+  }
+  __ Mov(x1, 2);
+  masm.FinalizeCode();
+
+  ElfObjectWriter writer(&masm);
+  writer.AddSymbol("data", &data, 8);
+  VIXL_CHECK(writer.GetNumberOfSymbols() == 4);
+  std::vector<byte> object;
+  writer.Write(&object);
+
+  ElfObjectReader reader(object);
+  std::vector<ElfObjectReader::Symbol> symbols = reader.GetSymbols();
+  VIXL_CHECK(FindSymbol(symbols, "$x", 0) != NULL);
+  VIXL_CHECK(FindSymbol(symbols, "$d", data.GetLocation()) != NULL);
+  VIXL_CHECK(FindSymbol(symbols, "$x", data.GetLocation() + 8) != NULL);
+
+  const ElfObjectReader::Symbol* data_sym =
+      FindSymbol(symbols, "data", data.GetLocation());
+  VIXL_CHECK(data_sym != NULL);
+  VIXL_CHECK(data_sym->type == 1);  // STT_OBJECT
+}
+
+
+TEST(mapping_symbols_c64) {
+  // Use a raw buffer so that Morello support isn't required to assemble it.
+  uint32_t code[6] = {0};
+  ISAMap map(ISA::C64);
+  map.SetISAAt(8, ISA::A64);
+  map.SetISAAt(12, ISA::A64);  // Redundant: no new mapping symbol.
+  map.SetISAAt(16, ISA::C64);
+
+  ElfObjectWriter writer(reinterpret_cast<const byte*>(code),
+                         sizeof(code),
+                         &map);
+  writer.AddSymbol("c64_fn", static_cast<ptrdiff_t>(0));
+  writer.AddSymbol("a64_fn", 8);
+  std::vector<byte> object;
+  writer.Write(&object);
+
+  ElfObjectReader reader(object);
+  std::vector<ElfObjectReader::Symbol> symbols = reader.GetSymbols();
+  VIXL_CHECK(FindSymbol(symbols, "$c", 0) != NULL);
+  VIXL_CHECK(FindSymbol(symbols, "$x", 8) != NULL);
+  VIXL_CHECK(FindSymbol(symbols, "$x", 12) == NULL);
+  VIXL_CHECK(FindSymbol(symbols, "$c", 16) != NULL);
+  // C64 function symbols have their bottom bit set.
+  VIXL_CHECK(FindSymbol(symbols, "c64_fn", 1) != NULL);
+  VIXL_CHECK(FindSymbol(symbols, "a64_fn", 8) != NULL);
+}
+
+
+TEST(perf_jitdump) {
+  FILE* file = tmpfile();
+  VIXL_CHECK(file != NULL);
+
+  const uint32_t code[2] = {0xd2800540,   // mov x0, #42
+                            0xd65f03c0};  // ret
+  {
+    PerfJitDumpWriter jitdump;
+    VIXL_CHECK(jitdump.Open(file));
+    VIXL_CHECK(jitdump.AddCodeLoad("answer", code, sizeof(code)));
+    jitdump.Close();
+    VIXL_CHECK(!jitdump.IsOpen());
+  }
+
+  long size = ftell(file);  // NOLINT(runtime/int)
+  // Header (40), code load record (56 + "answer\0" + code), close record (16).
+  VIXL_CHECK(size == 40 + 56 + 7 + 8 + 16);
+
+  std::vector<byte> data(size);
+  rewind(file);
+  VIXL_CHECK(fread(data.data(), 1, size, file) == static_cast<size_t>(size));
+  fclose(file);
+
+  uint32_t magic, mach, record_id, record_size;
+  memcpy(&magic, &data[0], sizeof(magic));
+  memcpy(&mach, &data[12], sizeof(mach));
+  memcpy(&record_id, &data[40], sizeof(record_id));
+  memcpy(&record_size, &data[44], sizeof(record_size));
+  VIXL_CHECK(magic == 0x4A695444);
+  VIXL_CHECK(mach == 183);
+  VIXL_CHECK(record_id == 0);
+  VIXL_CHECK(record_size == 56 + 7 + 8);
+  VIXL_CHECK(strcmp(reinterpret_cast<const char*>(&data[40 + 56]), "answer") ==
+             0);
+  VIXL_CHECK(memcmp(&data[40 + 56 + 7], code, sizeof(code)) == 0);
+  memcpy(&record_id, &data[40 + 56 + 7 + 8], sizeof(record_id));
+  VIXL_CHECK(record_id == 3);
+}
+
+}  // namespace aarch64
+}  // namespace vixl
@@ -0,0 +1,320 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdio>
+
+#include "test-runner.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/peephole-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#define __ masm.
+#define TEST(name) TEST_(AARCH64_PEEPHOLE_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+// Check that the code generated by `masm` matches `expected`, instruction by
+// instruction.
+static void CheckCode(MacroAssembler* masm, MacroAssembler* expected) {
+  VIXL_CHECK(masm->GetSizeOfCodeGenerated() ==
+             expected->GetSizeOfCodeGenerated());
+  for (ptrdiff_t offset = 0; offset < masm->GetCursorOffset();
+       offset += kInstructionSize) {
+    Instr actual = masm->GetInstructionAt(offset)->GetInstructionBits();
+    Instr wanted = expected->GetInstructionAt(offset)->GetInstructionBits();
+    if (actual != wanted) {
+      printf("At offset %" PRId64 ": expected 0x%08" PRIx32
+             ", found 0x%08" PRIx32 ".\n",
+             static_cast<int64_t>(offset),
+             wanted,
+             actual);
+      VIXL_ABORT();
+    }
+  }
+}
+
+
+TEST(redundant_moves) {
+  MacroAssembler masm;
+  {
+    ExactAssemblyScope scope(&masm, 6 * kInstructionSize);
+    __ mov(x0, x0);
+    __ mov(w1, w1);
+    __ add(x2, x2, 0);
+    __ add(w3, w3, 0);
+    __ add(sp, sp, 0);
+    __ adds(x4, x4, 0);
+  }
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  VIXL_CHECK(peephole.Optimise() == 3);
+
+  MacroAssembler expected;
+  {
+    ExactAssemblyScope scope(&expected, 6 * kInstructionSize);
+    expected.nop();
+    expected.mov(w1, w1);
+    expected.nop();
+    expected.add(w3, w3, 0);
+    expected.nop();
+    expected.adds(x4, x4, 0);
+  }
+  expected.FinalizeCode();
+  CheckCode(&masm, &expected);
+}
+
+
+TEST(combine_add_sub) {
+  MacroAssembler masm;
+  {
+    ExactAssemblyScope scope(&masm, 9 * kInstructionSize);
+    __ add(x0, x1, 1);
+    __ add(x0, x0, 2);
+    __ sub(x0, x0, 8);
+    // Flag-setting instructions are not combined.
+    __ add(x2, x2, 1);
+    __ adds(x2, x2, 1);
+    // Nor are instructions that write different registers.
+    __ add(x3, x4, 1);
+    __ add(x5, x3, 1);
+    // The result must be encodable.
+    __ add(w6, w6, 0xfff);
+    __ add(w6, w6, 2);
+  }
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  VIXL_CHECK(peephole.Optimise() == 2);
+
+  MacroAssembler expected;
+  {
+    ExactAssemblyScope scope(&expected, 9 * kInstructionSize);
+    expected.sub(x0, x1, 5);
+    expected.nop();
+    expected.nop();
+    expected.add(x2, x2, 1);
+    expected.adds(x2, x2, 1);
+    expected.add(x3, x4, 1);
+    expected.add(x5, x3, 1);
+    expected.add(w6, w6, 0xfff);
+    expected.add(w6, w6, 2);
+  }
+  expected.FinalizeCode();
+  CheckCode(&masm, &expected);
+}
+
+
+TEST(fold_move_immediate) {
+  MacroAssembler masm;
+  {
+    ExactAssemblyScope scope(&masm, 16 * kInstructionSize);
+    // x16 is overwritten before it is read again.
+    __ movz(x16, 42);
+    __ add(x0, x1, x16);
+    // The register is overwritten by the instruction that reads it.
+    __ movn(x17, 0);
+    __ add(x17, x2, x17);
+    // `adds` can't be turned into `subs`.
+    __ movn(x16, 0);
+    __ adds(x3, x4, x16);
+    // Flag-setting forms keep setting the flags, and `cmp` keeps writing to
+    // the zero register rather than to the stack pointer.
+    __ movz(x16, 5);
+    __ adds(x3, x4, x16);
+    __ movz(x16, 7);
+    __ cmp(x4, x16);
+    // Logical immediates.
+    __ orr(w16, wzr, 0xff00ff00);
+    __ and_(w5, w6, w16);
+    // The register is read again.
+    __ movz(x16, 1);
+    __ eor(x7, x8, x16);
+    __ add(x9, x16, 2);
+    __ ret();
+  }
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  VIXL_CHECK(peephole.Optimise() == 5);
+
+  MacroAssembler expected;
+  {
+    ExactAssemblyScope scope(&expected, 16 * kInstructionSize);
+    expected.nop();
+    expected.add(x0, x1, 42);
+    expected.nop();
+    expected.sub(x17, x2, 1);
+    expected.movn(x16, 0);
+    expected.adds(x3, x4, x16);
+    expected.nop();
+    expected.adds(x3, x4, 5);
+    expected.nop();
+    expected.cmp(x4, 7);
+    expected.nop();
+    expected.and_(w5, w6, 0xff00ff00);
+    expected.movz(x16, 1);
+    expected.eor(x7, x8, x16);
+    expected.add(x9, x16, 2);
+    expected.ret();
+  }
+  expected.FinalizeCode();
+  CheckCode(&masm, &expected);
+}
+
+
+TEST(block_local_registers) {
+  MacroAssembler masm;
+  {
+    ExactAssemblyScope scope(&masm, 5 * kInstructionSize);
+    __ movz(x16, 1);
+    __ orr(x0, x1, x16);
+    __ movz(x17, 2);
+    __ orr(x2, x3, x17);
+    __ ret();
+  }
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  peephole.SetBlockLocalRegisters(CPURegList(x16));
+  VIXL_CHECK(peephole.Optimise() == 1);
+
+  MacroAssembler expected;
+  {
+    ExactAssemblyScope scope(&expected, 5 * kInstructionSize);
+    expected.nop();
+    expected.orr(x0, x1, 1);
+    expected.movz(x17, 2);
+    expected.orr(x2, x3, x17);
+    expected.ret();
+  }
+  expected.FinalizeCode();
+  CheckCode(&masm, &expected);
+}
+
+
+TEST(branch_targets) {
+  MacroAssembler masm;
+  Label target;
+  {
+    ExactAssemblyScope scope(&masm, 8 * kInstructionSize);
+    __ movz(x16, 1);
+    __ bind(&target);
+    __ add(x0, x1, x16);
+    __ movz(x16, 0);
+    __ cbnz(x0, &target);
+    // This target is only known to the caller.
+    __ add(x2, x2, 1);
+    __ add(x2, x2, 1);
+    __ mov(x3, x3);
+    __ ret();
+  }
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  peephole.AddBranchTarget(5 * kInstructionSize);
+  VIXL_CHECK(peephole.Optimise() == 1);
+
+  MacroAssembler expected;
+  Label expected_target;
+  {
+    ExactAssemblyScope scope(&expected, 8 * kInstructionSize);
+    expected.movz(x16, 1);
+    expected.bind(&expected_target);
+    expected.add(x0, x1, x16);
+    expected.movz(x16, 0);
+    expected.cbnz(x0, &expected_target);
+    expected.add(x2, x2, 1);
+    expected.add(x2, x2, 1);
+    expected.nop();
+    expected.ret();
+  }
+  expected.FinalizeCode();
+  CheckCode(&masm, &expected);
+}
+
+
+TEST(data_is_not_modified) {
+  MacroAssembler masm;
+  {
+    ExactAssemblyScope scope(&masm, 2 * kInstructionSize);
+    __ mov(x0, x0);
+    __ ret();
+  }
+  {
+    // `mov x0, x0`, as data.
+    ISAScope isa(&masm, ISA::Data);
+    ExactAssemblyScope scope(&masm, kInstructionSize);
+    __ dc32(0xaa0003e0);
+  }
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  VIXL_CHECK(peephole.Optimise() == 1);
+  VIXL_CHECK(masm.GetInstructionAt(0)->GetInstructionBits() == 0xd503201f);
+  VIXL_CHECK(masm.GetInstructionAt(2 * kInstructionSize)
+                 ->GetInstructionBits() == 0xaa0003e0);
+}
+
+
+TEST(simulate_macro_output) {
+  MacroAssembler masm;
+  masm.SetGenerateSimulatorCode(true);
+  Label loop;
+  // The arguments of simulator pseudo-instructions must not be optimised.
+  __ Trace(LOG_DISASM, TRACE_DISABLE);
+  __ Mov(x0, 0);
+  __ Mov(x1, 10);
+  __ Bind(&loop);
+  {
+    UseScratchRegisterScope temps(&masm);
+    Register temp = temps.AcquireX();
+    __ Mov(temp, 3);
+    __ Add(x0, x0, temp);
+  }
+  __ Add(x0, x0, 1);
+  __ Add(x0, x0, 2);
+  __ Sub(x1, x1, 1);
+  __ Cbnz(x1, &loop);
+  __ Ret();
+  masm.FinalizeCode();
+
+  PeepholeOptimiser peephole(&masm);
+  peephole.SetBlockLocalRegisters(*masm.GetScratchRegisterList());
+  VIXL_CHECK(peephole.Optimise() == 3);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+  VIXL_CHECK(simulator.ReadXRegister(0) == 60);
+#endif
+}
+
+}  // namespace aarch64
+}  // namespace vixl
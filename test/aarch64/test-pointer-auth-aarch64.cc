@@ -52,6 +52,34 @@ TEST(compute_pac) {
   VIXL_CHECK(pac1 != pac2);
 }
 
+TEST(compute_pac_values) {
+  Decoder decoder;
+  Simulator sim(&decoder);
+
+  uint64_t context = 0x477d469dec0b8762;
+  Simulator::PACKey key_a = {0x84be85ce9804e94b, 0xec2802d4e0a488e9, 0};
+  Simulator::PACKey key_b = {0xec1119e288704d13, 0xd7f6b76e1cea585e, 1};
+
+  // Each result is computed twice, so that the second comes from the cache.
+  // The cache must distinguish between keys.
+  for (int i = 0; i < 2; i++) {
+    VIXL_CHECK(sim.ComputePAC(0xfb623599da6e8127, context, key_a) ==
+               0x760f0eaa39d24578);
+    VIXL_CHECK(sim.ComputePAC(0xfb623599da6e8127, context, key_b) ==
+               0xe153ef8a975b1c09);
+    VIXL_CHECK(sim.ComputePAC(0x27979fadf7d53cb7, context, key_a) ==
+               0x406b83ddd639a2ca);
+    VIXL_CHECK(sim.ComputePAC(0x27979fadf7d53cb7, context, key_b) ==
+               0x64bd0b26bf22cf81);
+    VIXL_CHECK(sim.ComputePAC(0, context, key_a) == 0x753a79b5f3a71110);
+    VIXL_CHECK(sim.ComputePAC(0, context, key_b) == 0x1f5768426bdef5a5);
+    VIXL_CHECK(sim.ComputePAC(0xffffffffffffffff, context, key_a) ==
+               0x370ee258332e8f80);
+    VIXL_CHECK(sim.ComputePAC(0xffffffffffffffff, context, key_b) ==
+               0xc4b43d28b295ccf4);
+  }
+}
+
 TEST(add_and_auth_pac) {
   Decoder decoder;
   Simulator sim(&decoder);
@@ -0,0 +1,262 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+
+#include "test-runner.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/register-allocator-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#define __ masm.
+#define TEST(name) TEST_(AARCH64_REGALLOC_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+typedef RegisterAllocator::Allocation Allocation;
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+// Run the code at the start of the buffer with two X arguments, and return x0.
+// Callee-saved registers are checked for preservation.
+static int64_t Run(MacroAssembler* masm, int64_t a, int64_t b) {
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.WriteXRegister(0, a);
+  simulator.WriteXRegister(1, b);
+  for (int i = 19; i <= 28; i++) simulator.WriteXRegister(i, 0x1900 + i);
+  int64_t original_sp = simulator.ReadXRegister(31, Reg31IsStackPointer);
+  simulator.RunFrom(masm->GetBuffer()->GetStartAddress<Instruction*>());
+  for (int i = 19; i <= 28; i++) {
+    VIXL_CHECK(simulator.ReadXRegister(i) == 0x1900 + i);
+  }
+  VIXL_CHECK(simulator.ReadXRegister(31, Reg31IsStackPointer) == original_sp);
+  return simulator.ReadXRegister(0);
+}
+#endif
+
+
+TEST(loop) {
+  MacroAssembler masm;
+  RegisterAllocator ra(&masm);
+  VirtualRegister n = ra.AddParameter<int64_t>();
+  VirtualRegister sum = ra.NewX();
+  ra.Emit({sum}, {}, [=](MacroAssembler* m, const Allocation& a) {
+    m->Mov(a.X(sum), 0);
+  });
+  Label loop, done;
+  ra.Branch(&done, {n}, [=, &done](MacroAssembler* m, const Allocation& a) {
+    m->Cbz(a.X(n), &done);
+  });
+  ra.Bind(&loop);
+  ra.Emit({sum, n}, {sum, n}, [=](MacroAssembler* m, const Allocation& a) {
+    m->Add(a.X(sum), a.X(sum), a.X(n));
+    m->Subs(a.X(n), a.X(n), 1);
+  });
+  ra.B(&loop, ne);
+  ra.Bind(&done);
+  ra.Return(sum);
+  ra.Generate();
+  masm.FinalizeCode();
+
+  // `n` stays in x0, so `sum` can't use it, and is moved there at the end.
+  VIXL_CHECK(ra.GetAssignedRegister(n).Is(x0));
+  VIXL_CHECK(!ra.GetAssignedRegister(sum).Is(x0));
+  VIXL_CHECK(ra.GetNumberOfSpilledRegisters() == 0);
+  VIXL_CHECK(ra.GetFrameSize() == 0);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 10, 0) == 55);
+  VIXL_CHECK(Run(&masm, 0, 0) == 0);
+#endif
+}
+
+
+TEST(coalesce) {
+  MacroAssembler masm;
+  RegisterAllocator ra(&masm);
+  VirtualRegister a = ra.AddParameter<int64_t>();
+  VirtualRegister b = ra.AddParameter<int64_t>();
+  VirtualRegister c = ra.NewX();
+  VirtualRegister d = ra.NewX();
+  // Each copy ends the life of its source, so no code is needed.
+  ra.Mov(c, a);
+  ra.Emit({c}, {c, b}, [=](MacroAssembler* m, const Allocation& al) {
+    m->Sub(al.X(c), al.X(c), al.X(b));
+  });
+  ra.Mov(d, c);
+  ra.Return(d);
+  ra.Generate();
+  masm.FinalizeCode();
+
+  VIXL_CHECK(ra.GetNumberOfCoalescedMoves() == 3);
+  VIXL_CHECK(ra.GetAssignedRegister(d).Is(x0));
+  // sub x0, x0, x1; ret
+  VIXL_CHECK(masm.GetSizeOfCodeGenerated() == 2 * kInstructionSize);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 50, 8) == 42);
+#endif
+}
+
+
+TEST(spill) {
+  MacroAssembler masm;
+  RegisterAllocator ra(&masm);
+  VirtualRegister seed = ra.AddParameter<int64_t>();
+  // More values than there are registers are live at once.
+  const int kCount = 40;
+  std::vector<VirtualRegister> values;
+  for (int i = 0; i < kCount; i++) {
+    VirtualRegister value = ra.NewX();
+    ra.Emit({value}, {seed}, [=](MacroAssembler* m, const Allocation& a) {
+      m->Add(a.X(value), a.X(seed), i);
+    });
+    values.push_back(value);
+  }
+  VirtualRegister sum = ra.NewX();
+  ra.Mov(sum, seed);
+  for (int i = 0; i < kCount; i++) {
+    VirtualRegister value = values[i];
+    ra.Emit({sum}, {sum, value}, [=](MacroAssembler* m, const Allocation& a) {
+      m->Add(a.X(sum), a.X(sum), a.X(value));
+    });
+  }
+  ra.Return(sum);
+  ra.Generate();
+  masm.FinalizeCode();
+
+  VIXL_CHECK(ra.GetNumberOfSpilledRegisters() > 0);
+  VIXL_CHECK(ra.GetFrameSize() > 0);
+  VIXL_CHECK((ra.GetFrameSize() % 16) == 0);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  // seed + sum(seed + i)
+  int64_t expected = 3 + (kCount * 3) + ((kCount - 1) * kCount / 2);
+  VIXL_CHECK(Run(&masm, 3, 0) == expected);
+#endif
+}
+
+
+TEST(call) {
+  MacroAssembler masm;
+  Label callee;
+  RegisterAllocator ra(&masm);
+  VirtualRegister a = ra.AddParameter<int64_t>();
+  VirtualRegister b = ra.AddParameter<int64_t>();
+  VirtualRegister result = ra.NewX();
+  // Both parameters are live across the call, so they have to be moved to
+  // callee-saved registers.
+  ra.Call(&callee, {b, a}, result);
+  ra.Emit({result},
+          {result, a, b},
+          [=](MacroAssembler* m, const Allocation& al) {
+            m->Add(al.X(result), al.X(result), al.X(a));
+            m->Add(al.X(result), al.X(result), Operand(al.X(b), LSL, 8));
+          });
+  ra.Return(result);
+  ra.Generate();
+
+  VIXL_CHECK(ra.GetAssignedRegister(a).IsValid());
+  VIXL_CHECK(ra.GetAssignedRegister(a).GetCode() >= 19);
+  VIXL_CHECK(ra.GetAssignedRegister(b).GetCode() >= 19);
+  VIXL_CHECK(ra.GetNumberOfSpilledRegisters() == 0);
+
+  // The callee computes x0 - 2 * x1, and clobbers every caller-saved register
+  // that it can.
+  __ Bind(&callee);
+  __ Sub(x0, x0, Operand(x1, LSL, 1));
+  for (int i = 1; i <= 17; i++) __ Mov(XRegister(i), 0xdead);
+  __ Ret();
+  masm.FinalizeCode();
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  // (b - 2a) + a + (b << 8)
+  VIXL_CHECK(Run(&masm, 5, 100) == (100 - 10) + 5 + (100 << 8));
+#endif
+}
+
+
+TEST(parallel_move_cycle) {
+  MacroAssembler masm;
+  Label callee;
+  RegisterAllocator ra(&masm);
+  VirtualRegister a = ra.AddParameter<int64_t>();
+  VirtualRegister b = ra.AddParameter<int64_t>();
+  VirtualRegister result = ra.NewX();
+  // Neither parameter is used afterwards, so both stay in their argument
+  // registers, and x0 and x1 have to be exchanged.
+  ra.Call(&callee, {b, a}, result);
+  ra.Return(result);
+  ra.Generate();
+
+  VIXL_CHECK(ra.GetAssignedRegister(a).Is(x0));
+  VIXL_CHECK(ra.GetAssignedRegister(b).Is(x1));
+
+  __ Bind(&callee);
+  __ Sub(x0, x0, x1);
+  __ Ret();
+  masm.FinalizeCode();
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  VIXL_CHECK(Run(&masm, 5, 100) == 95);
+#endif
+}
+
+
+TEST(fp) {
+  MacroAssembler masm;
+  RegisterAllocator ra(&masm);
+  VirtualRegister scale = ra.AddParameter<double>();
+  VirtualRegister n = ra.AddParameter<int64_t>();
+  VirtualRegister x = ra.NewV();
+  VirtualRegister product = ra.NewV();
+  ra.Emit({x}, {n}, [=](MacroAssembler* m, const Allocation& a) {
+    m->Scvtf(a.D(x), a.X(n));
+  });
+  ra.Emit({product}, {x, scale}, [=](MacroAssembler* m, const Allocation& a) {
+    m->Fmul(a.D(product), a.D(x), a.D(scale));
+  });
+  ra.Return(product);
+  ra.Generate();
+  masm.FinalizeCode();
+
+  VIXL_CHECK(ra.GetAssignedRegister(n).Is(x0));
+  VIXL_CHECK(ra.GetAssignedRegister(scale).GetCode() == 0);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  simulator.WriteDRegister(0, 1.5);
+  simulator.WriteXRegister(0, 6);
+  simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+  VIXL_CHECK(simulator.ReadDRegister(0) == 9.0);
+#endif
+}
+
+}  // namespace aarch64
+}  // namespace vixl
@@ -0,0 +1,336 @@
+// Copyright 2021, VIXL authors
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice,
+//     this list of conditions and the following disclaimer.
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//   * Neither the name of ARM Limited nor the names of its contributors may be
+//     used to endorse or promote products derived from this software without
+//     specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdlib>
+#include <cstring>
+
+#include "test-runner.h"
+
+#include "aarch64/macro-assembler-aarch64.h"
+#include "aarch64/scheduler-aarch64.h"
+#include "aarch64/simulator-aarch64.h"
+
+#define __ masm.
+#define TEST(name) TEST_(AARCH64_SCHED_##name)
+
+namespace vixl {
+namespace aarch64 {
+
+static const SchedulingModel* kModels[] = {&kCortexA55SchedulingModel,
+                                           &kCortexA76SchedulingModel,
+                                           &kNeoverseN1SchedulingModel};
+
+// Two independent load-use pairs.
+static void GenerateLoadUse(MacroAssembler* masm, Label* second) {
+  masm->Ldr(x0, MemOperand(x10));
+  masm->Add(x0, x0, 1);
+  masm->Bind(second);
+  masm->Ldr(x1, MemOperand(x10, 8));
+  masm->Add(x1, x1, 1);
+  masm->Ret();
+  masm->FinalizeCode();
+}
+
+
+TEST(load_use) {
+  for (size_t i = 0; i < ArrayLength(kModels); i++) {
+    MacroAssembler masm;
+    Label second;
+    GenerateLoadUse(&masm, &second);
+
+    InstructionScheduler scheduler(&masm, *kModels[i]);
+    int before = scheduler.EstimateCycles(0, 4);
+    int saved = scheduler.Schedule();
+    VIXL_CHECK(saved > 0);
+    VIXL_CHECK(scheduler.EstimateCycles(0, 4) == (before - saved));
+    // Both loads issue first.
+    VIXL_CHECK(masm.GetInstructionAt(0)->IsLoad());
+    VIXL_CHECK(masm.GetInstructionAt(kInstructionSize)->IsLoad());
+    VIXL_CHECK(masm.GetInstructionAt(4 * kInstructionSize)->Mask(
+                   UnconditionalBranchToRegisterMask) == RET);
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+    uint64_t data[] = {41, 99};
+    Decoder decoder;
+    Simulator simulator(&decoder);
+    simulator.WriteXRegister(10, reinterpret_cast<uintptr_t>(data));
+    simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+    VIXL_CHECK(simulator.ReadXRegister(0) == 42);
+    VIXL_CHECK(simulator.ReadXRegister(1) == 100);
+#endif
+  }
+}
+
+
+TEST(branch_targets) {
+  MacroAssembler masm;
+  Label second;
+  GenerateLoadUse(&masm, &second);
+
+  // Neither half can be improved on its own.
+  InstructionScheduler scheduler(&masm, kCortexA55SchedulingModel);
+  scheduler.AddBranchTarget(&second);
+  VIXL_CHECK(scheduler.Schedule() == 0);
+  VIXL_CHECK(masm.GetInstructionAt(0)->IsLoad());
+  VIXL_CHECK(!masm.GetInstructionAt(kInstructionSize)->IsLoad());
+}
+
+
+TEST(custom_model) {
+  MacroAssembler masm;
+  Label second;
+  GenerateLoadUse(&masm, &second);
+
+  // On a single-issue core without any latency, there's nothing to gain.
+  SchedulingModel model = kCortexA55SchedulingModel;
+  model.name = "Ideal";
+  model.issue_width = 1;
+  for (int i = 0; i < SchedulingModel::kNumberOfInstructionClasses; i++) {
+    model.timing[i].latency = 1;
+    model.timing[i].occupancy = 1;
+  }
+  InstructionScheduler scheduler(&masm, model);
+  VIXL_CHECK(scheduler.EstimateCycles(0, 4) == 4);
+  VIXL_CHECK(scheduler.Schedule() == 0);
+  VIXL_CHECK(!masm.GetInstructionAt(kInstructionSize)->IsLoad());
+}
+
+
+TEST(unknown_instructions_end_blocks) {
+  MacroAssembler masm;
+  masm.Ldr(x0, MemOperand(x10));
+  masm.Add(x0, x0, 1);
+  masm.Dmb(InnerShareable, BarrierAll);
+  masm.Ldr(x1, MemOperand(x10, 8));
+  masm.Add(x1, x1, 1);
+  masm.FinalizeCode();
+
+  InstructionScheduler scheduler(&masm, kCortexA55SchedulingModel);
+  VIXL_CHECK(scheduler.Schedule() == 0);
+  VIXL_CHECK(masm.GetInstructionAt(2 * kInstructionSize)->Mask(
+                 MemBarrierMask) == DMB);
+}
+
+
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+TEST(literals) {
+  for (size_t i = 0; i < ArrayLength(kModels); i++) {
+    MacroAssembler masm;
+    masm.Ldr(x0, MemOperand(x10));
+    masm.Add(x0, x0, 1);
+    masm.Ldr(x1, 0x0123456789abcdef);
+    masm.Ldr(d0, 1.25);
+    masm.Add(x1, x1, x0);
+    masm.Fadd(d0, d0, d0);
+    masm.Ret();
+    masm.FinalizeCode();
+
+    InstructionScheduler scheduler(&masm, *kModels[i]);
+    VIXL_CHECK(scheduler.Schedule() > 0);
+
+    uint64_t data[] = {41};
+    Decoder decoder;
+    Simulator simulator(&decoder);
+    simulator.WriteXRegister(10, reinterpret_cast<uintptr_t>(data));
+    simulator.RunFrom(masm.GetBuffer()->GetStartAddress<Instruction*>());
+    VIXL_CHECK(simulator.ReadXRegister(0) == 42);
+    VIXL_CHECK(simulator.ReadXRegister(1) == 0x0123456789abcdef + 42);
+    VIXL_CHECK(simulator.ReadDRegister(0) == 2.5);
+  }
+}
+
+
+// Generate a block of random instructions that use a few registers, the flags
+// and two small buffers.
+static void GenerateRandomBlock(MacroAssembler* masm,
+                                unsigned short seed[3],  // NOLINT(runtime/int)
+                                int count) {
+  const Register data[] = {x0, x1, x2, x3, x4, x5, x6, x7};
+  const VRegister fp[] = {d0, d1, d2, d3};
+  const int kDataCount = ArrayLength(data);
+  const int kFPCount = ArrayLength(fp);
+  for (int i = 0; i < count; i++) {
+    int rd_index = nrand48(seed) % kDataCount;
+    Register rd = data[rd_index];
+    // A different register, for load pairs.
+    Register rd2 = data[(rd_index + 1 + (nrand48(seed) % (kDataCount - 1))) %
+                        kDataCount];
+    Register rn = data[nrand48(seed) % kDataCount];
+    Register rm = data[nrand48(seed) % kDataCount];
+    VRegister vd = fp[nrand48(seed) % kFPCount];
+    VRegister vn = fp[nrand48(seed) % kFPCount];
+    VRegister vm = fp[nrand48(seed) % kFPCount];
+    // Offsets into the buffer at x10, which has eight X-sized slots.
+    int slot = nrand48(seed) % 7;
+    MemOperand slot_operand(x10, slot * kXRegSizeInBytes);
+    switch (nrand48(seed) % 24) {
+      case 0:
+        masm->Add(rd, rn, rm);
+        break;
+      case 1:
+        masm->Sub(rd, rn, Operand(rm, LSL, 3));
+        break;
+      case 2:
+        masm->Adds(rd, rn, 7);
+        break;
+      case 3:
+        masm->Cmp(rn, rm);
+        break;
+      case 4:
+        masm->Csel(rd, rn, rm, lo);
+        break;
+      case 5:
+        masm->Adc(rd, rn, rm);
+        break;
+      case 6:
+        masm->Mul(rd, rn, rm);
+        break;
+      case 7:
+        masm->Udiv(rd, rn, rm);
+        break;
+      case 8:
+        masm->Movk(rd, 0x1234, 16);
+        break;
+      case 9:
+        masm->Ubfx(rd, rn, 4, 12);
+        break;
+      case 10:
+        masm->Ldr(rd, slot_operand);
+        break;
+      case 11:
+        masm->Str(rn, slot_operand);
+        break;
+      case 12:
+        masm->Ldp(rd, rd2, slot_operand);
+        break;
+      case 13:
+        masm->Stp(rn, rm, slot_operand);
+        break;
+      case 14:
+        // Unaligned and overlapping accesses.
+        masm->Ldr(rd.W(), MemOperand(x10, slot * kXRegSizeInBytes + 4));
+        break;
+      case 15:
+        masm->Str(rn.W(), MemOperand(x10, slot * kXRegSizeInBytes + 2));
+        break;
+      case 16:
+        // Walk the buffer at x11 up and down.
+        masm->Ldr(rd, MemOperand(x11, 8, PostIndex));
+        break;
+      case 17:
+        masm->Str(rn, MemOperand(x11, -8, PreIndex));
+        break;
+      case 18:
+        masm->Ldr(rd, MemOperand(x10, x12, LSL, 3));
+        break;
+      case 19:
+        masm->Fadd(vd, vn, vm);
+        break;
+      case 20:
+        masm->Fmadd(vd, vn, vm, vd);
+        break;
+      case 21:
+        masm->Scvtf(vd, rn);
+        break;
+      case 22:
+        masm->Ldr(vd, slot_operand);
+        break;
+      case 23:
+        masm->Str(vn, slot_operand);
+        break;
+    }
+  }
+  masm->Ret();
+  masm->FinalizeCode();
+}
+
+
+struct RandomBlockState {
+  uint64_t buffer[8];
+  // x11 starts in the middle, and moves by at most one slot per instruction.
+  uint64_t stack[80];
+  uint64_t x[13];
+  uint64_t d[4];
+  uint32_t nzcv;
+};
+
+
+static void RunRandomBlock(MacroAssembler* masm, RandomBlockState* state) {
+  memset(state, 0, sizeof(*state));
+  for (size_t i = 0; i < ArrayLength(state->buffer); i++) {
+    state->buffer[i] = 0x0101010101010101 * (i + 1);
+  }
+
+  Decoder decoder;
+  Simulator simulator(&decoder);
+  for (int i = 0; i < 8; i++) simulator.WriteXRegister(i, 0x1000 * i + 3);
+  for (int i = 0; i < 4; i++) simulator.WriteDRegister(i, 1.5 * i);
+  simulator.WriteXRegister(10, reinterpret_cast<uintptr_t>(state->buffer));
+  simulator.WriteXRegister(11, reinterpret_cast<uintptr_t>(&state->stack[40]));
+  simulator.WriteXRegister(12, 3);
+  simulator.RunFrom(masm->GetBuffer()->GetStartAddress<Instruction*>());
+
+  for (int i = 0; i < 13; i++) state->x[i] = simulator.ReadXRegister(i);
+  state->x[10] -= reinterpret_cast<uintptr_t>(state->buffer);
+  state->x[11] -= reinterpret_cast<uintptr_t>(state->stack);
+  for (int i = 0; i < 4; i++) {
+    state->d[i] = simulator.ReadDRegisterBits(i);
+  }
+  state->nzcv = simulator.ReadNzcv().GetRawValue();
+}
+
+
+TEST(random_blocks) {
+  const int kBlocks = 64;
+  const int kBlockLength = 32;
+  int total_saved = 0;
+  for (size_t model = 0; model < ArrayLength(kModels); model++) {
+    unsigned short seed[3] = {1, 2, 3};  // NOLINT(runtime/int)
+    for (int block = 0; block < kBlocks; block++) {
+      // Generate the same block twice, and only schedule the second.
+      unsigned short original_seed[3];  // NOLINT(runtime/int)
+      memcpy(original_seed, seed, sizeof(seed));
+      MacroAssembler original;
+      GenerateRandomBlock(&original, original_seed, kBlockLength);
+      MacroAssembler masm;
+      GenerateRandomBlock(&masm, seed, kBlockLength);
+
+      InstructionScheduler scheduler(&masm, *kModels[model]);
+      total_saved += scheduler.Schedule();
+
+      RandomBlockState expected;
+      RandomBlockState actual;
+      RunRandomBlock(&original, &expected);
+      RunRandomBlock(&masm, &actual);
+      VIXL_CHECK(memcmp(&expected, &actual, sizeof(expected)) == 0);
+    }
+  }
+  VIXL_CHECK(total_saved > 0);
+}
+#endif
+
+}  // namespace aarch64
+}  // namespace vixl
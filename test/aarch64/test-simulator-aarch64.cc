@@ -5097,5 +5097,232 @@ TEST(RunFrom) {
 #endif
 
 
+#ifdef VIXL_INCLUDE_SIMULATOR_AARCH64
+// Generate a function that adds `count` to x0, one at a time. For small
+// counts, this executes (3 * count) + 2 instructions.
+static Instruction* GenerateCountUp(MacroAssembler* masm, int count) {
+  masm->Reset();
+
+  Label loop;
+  masm->Mov(x1, count);
+  masm->Bind(&loop);
+  masm->Add(x0, x0, 1);
+  masm->Subs(x1, x1, 1);
+  masm->B(ne, &loop);
+  masm->Ret();
+
+  masm->FinalizeCode();
+  return masm->GetBuffer()->GetStartAddress<Instruction*>();
+}
+
+
+TEST(RunFor) {
+  SETUP();
+
+  const int kCount = 10;
+  const uint64_t kInstructionCount = (3 * kCount) + 2;
+  Instruction* code = GenerateCountUp(&masm, kCount);
+
+  simulator.WriteXRegister(0, 0);
+  simulator.WritePc(code, Simulator::NoBranchLog);
+  VIXL_CHECK(simulator.RunFor(kInstructionCount - 1) ==
+             Simulator::kInstructionBudgetExhausted);
+  VIXL_CHECK(simulator.ReadXRegister(0) == kCount);
+  VIXL_CHECK(simulator.ReadPc() != Simulator::kEndOfSimAddress);
+  VIXL_CHECK(simulator.RunFor(1) == Simulator::kEndOfSimulationReached);
+  // Nothing is executed once the simulation has ended.
+  VIXL_CHECK(simulator.RunFor(100) == Simulator::kEndOfSimulationReached);
+  VIXL_CHECK(simulator.ReadPc() == Simulator::kEndOfSimAddress);
+
+  // Run the same code in small slices. Loop iterations are split between
+  // slices, including between the `subs` and the `b.ne`.
+  simulator.WriteXRegister(0, 0);
+  simulator.WritePc(code, Simulator::NoBranchLog);
+  uint64_t slices = 0;
+  while (simulator.RunFor(5) == Simulator::kInstructionBudgetExhausted) {
+    slices++;
+  }
+  VIXL_CHECK(slices == (kInstructionCount / 5));
+  VIXL_CHECK(simulator.ReadXRegister(0) == kCount);
+
+  // The simulation can also be finished with Run().
+  simulator.WriteXRegister(0, 0);
+  simulator.WritePc(code, Simulator::NoBranchLog);
+  VIXL_CHECK(simulator.RunFor(4) == Simulator::kInstructionBudgetExhausted);
+  simulator.Run();
+  VIXL_CHECK(simulator.ReadXRegister(0) == kCount);
+}
+
+
+TEST(contexts) {
+  SETUP();
+
+  const int kCount = 50;
+  Instruction* code = GenerateCountUp(&masm, kCount);
+
+  // Each context counts up from a different value, and has some other state
+  // that the code doesn't touch.
+  const int kContextCount = 4;
+  SimContext contexts[kContextCount];
+  for (int i = 0; i < kContextCount; i++) {
+    simulator.ResetState();
+    simulator.WriteXRegister(0, i * 1000);
+    simulator.WriteDRegister(1, i + 0.5);
+    simulator.WriteSRegister(2, i * 2.0f);
+    simulator.WritePc(code, Simulator::NoBranchLog);
+    simulator.SaveContext(&contexts[i]);
+    VIXL_CHECK(contexts[i].ReadPc() == code);
+  }
+
+  // Run them in turn, with different slice sizes, so that the contexts are
+  // swapped at different points in the loop.
+  bool finished[kContextCount] = {};
+  int remaining = kContextCount;
+  while (remaining > 0) {
+    for (int i = 0; i < kContextCount; i++) {
+      if (finished[i]) continue;
+      simulator.RestoreContext(contexts[i]);
+      if (simulator.RunFor(i + 2) == Simulator::kEndOfSimulationReached) {
+        finished[i] = true;
+        remaining--;
+      }
+      simulator.SaveContext(&contexts[i]);
+    }
+  }
+
+  for (int i = 0; i < kContextCount; i++) {
+    simulator.RestoreContext(contexts[i]);
+    VIXL_CHECK(simulator.ReadPc() == Simulator::kEndOfSimAddress);
+    VIXL_CHECK(simulator.ReadXRegister(0) == (i * 1000) + kCount);
+    VIXL_CHECK(simulator.ReadDRegister(1) == (i + 0.5));
+    VIXL_CHECK(simulator.ReadSRegister(2) == (i * 2.0f));
+  }
+}
+
+
+#ifdef VIXL_HAS_SIMULATED_RUNTIME_CALL_SUPPORT
+static int replay_runtime_call_count = 0;
+static int64_t ReplayRuntimeCall(int64_t value) {
+  replay_runtime_call_count++;
+  return value + replay_runtime_call_count;
+}
+
+static void ReplayRuntimeStore(int64_t* address, int64_t value) {
+  *address += value;
+}
+#endif
+
+
+// Generate a loop whose results depend on RNDR, on the exclusive monitors and,
+// if supported, on a runtime call. The results are accumulated in x19 (the
+// number of failed exclusive stores), x20 (the random numbers) and x21 (the
+// results of the runtime call). If supported, a void runtime call also adds
+// the loop counter to `stored`.
+static Instruction* GenerateNondeterministicLoop(MacroAssembler* masm,
+                                                 uint64_t* exclusive,
+                                                 uint64_t* other,
+                                                 int64_t* stored) {
+  masm->Reset();
+
+  Label loop, retry;
+  masm->Mov(x25, lr);
+  masm->Mov(x19, 0);
+  masm->Mov(x20, 0);
+  masm->Mov(x21, 0);
+  masm->Mov(x22, reinterpret_cast<uintptr_t>(exclusive));
+  masm->Mov(x23, reinterpret_cast<uintptr_t>(other));
+  masm->Mov(x26, reinterpret_cast<uintptr_t>(stored));
+  masm->Mov(x24, 100);
+  masm->Bind(&loop);
+  masm->Mrs(x0, RNDR);
+  masm->Eor(x20, x0, Operand(x20, ROR, 1));
+  masm->Bind(&retry);
+  masm->Ldxr(x1, MemOperand(x22));
+  // This store can clear the local monitor.
+  masm->Str(x1, MemOperand(x23));
+  masm->Add(x1, x1, 1);
+  masm->Stxr(w2, x1, MemOperand(x22));
+  masm->Add(x19, x19, x2);
+  masm->Cbnz(w2, &retry);
+#ifdef VIXL_HAS_SIMULATED_RUNTIME_CALL_SUPPORT
+  masm->Mov(x0, x24);
+  masm->CallRuntime(ReplayRuntimeCall);
+  masm->Add(x21, x21, x0);
+  masm->Mov(x0, x26);
+  masm->Mov(x1, x24);
+  masm->CallRuntime(ReplayRuntimeStore);
+#endif
+  masm->Subs(x24, x24, 1);
+  masm->B(ne, &loop);
+  masm->Mov(lr, x25);
+  masm->Ret();
+
+  masm->FinalizeCode();
+  return masm->GetBuffer()->GetStartAddress<Instruction*>();
+}
+
+
+TEST(record_replay) {
+  SETUP_WITH_FEATURES(CPUFeatures::kRNG);
+
+  uint64_t exclusive = 0;
+  uint64_t other = 0;
+  int64_t stored = 0;
+  Instruction* code =
+      GenerateNondeterministicLoop(&masm, &exclusive, &other, &stored);
+
+  SimReplayLog log;
+  simulator.SetReplayLog(Simulator::kRecord, &log);
+  simulator.RunFrom(code);
+  simulator.SetReplayLog(Simulator::kReplayDisabled, NULL);
+  int64_t failures = simulator.ReadXRegister(19);
+  int64_t random = simulator.ReadXRegister(20);
+  int64_t calls = simulator.ReadXRegister(21);
+  VIXL_CHECK(exclusive == 100);
+  VIXL_CHECK(failures > 0);
+  VIXL_CHECK(log.GetSizeInBytes() > 0);
+#ifdef VIXL_HAS_SIMULATED_RUNTIME_CALL_SUPPORT
+  VIXL_CHECK(stored == 5050);
+#endif
+
+  // Save the log and load it into a new one.
+  FILE* file = tmpfile();
+  VIXL_CHECK(file != NULL);
+  VIXL_CHECK(log.WriteTo(file));
+  rewind(file);
+  SimReplayLog loaded;
+  VIXL_CHECK(loaded.ReadFrom(file));
+  fclose(file);
+
+  // The simulator's random state has moved on, but the replayed run has the
+  // same results as the recorded one.
+  exclusive = 0;
+  stored = 0;
+#ifdef VIXL_HAS_SIMULATED_RUNTIME_CALL_SUPPORT
+  int runtime_call_count = replay_runtime_call_count;
+#endif
+  simulator.SetReplayLog(Simulator::kReplay, &loaded);
+  simulator.RunFrom(code);
+  simulator.SetReplayLog(Simulator::kReplayDisabled, NULL);
+  VIXL_CHECK(loaded.IsAtEnd());
+  VIXL_CHECK(exclusive == 100);
+  VIXL_CHECK(simulator.ReadXRegister(19) == failures);
+  VIXL_CHECK(simulator.ReadXRegister(20) == random);
+  VIXL_CHECK(simulator.ReadXRegister(21) == calls);
+#ifdef VIXL_HAS_SIMULATED_RUNTIME_CALL_SUPPORT
+  // Runtime calls are still made during replay, and their side effects happen
+  // again, but the recorded results are used.
+  VIXL_CHECK(replay_runtime_call_count == runtime_call_count + 100);
+  VIXL_CHECK(stored == 5050);
+#endif
+
+  // Without replay, the results differ.
+  exclusive = 0;
+  simulator.RunFrom(code);
+  VIXL_CHECK(simulator.ReadXRegister(20) != random);
+}
+#endif
+
+
 }  // namespace aarch64
 }  // namespace vixl
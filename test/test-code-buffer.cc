@@ -163,4 +163,36 @@ TEST(emit) {
                     expected_size) == 0);
 }
 
+TEST(size_only) {
+  CodeBuffer buffer(16);
+  buffer.SetSizeOnly(true);
+  VIXL_CHECK(buffer.IsSizeOnly());
+  VIXL_CHECK(buffer.GetCapacity() == 16);
+
+  buffer.Emit8(1);
+  VIXL_CHECK(!buffer.Is16bitAligned());
+  buffer.Align();
+  VIXL_CHECK(buffer.Is32bitAligned());
+  buffer.EmitString("size");
+  buffer.EmitZeroedBytes(3);
+  buffer.Emit32(2);
+  VIXL_CHECK(buffer.GetSizeInBytes() == 16);
+  VIXL_CHECK(buffer.GetRemainingBytes() == 0);
+
+  // The buffer grows exactly as a real buffer would.
+  buffer.EnsureSpaceFor(8);
+  VIXL_CHECK(buffer.GetCapacity() == (2 * 16) + 8);
+  buffer.Emit64(3);
+  VIXL_CHECK(buffer.GetCursorOffset() == 24);
+  VIXL_CHECK(buffer.IsDirty());
+
+  // Switching back to real emission requires an empty buffer.
+  buffer.Reset();
+  buffer.SetSizeOnly(false);
+  VIXL_CHECK(!buffer.IsSizeOnly());
+  buffer.Emit32(0x12345678);
+  VIXL_CHECK(*buffer.GetStartAddress<uint32_t*>() == 0x12345678);
+  buffer.SetClean();
+}
+
 }  // namespace vixl
@@ -396,6 +396,16 @@ if __name__ == '__main__':
         std = args.std,
         mode = 'debug',
         target = ['a32', 't32', 'a64'])
+
+    # Simulator builds using the host's crypto instructions.
+    if platform.machine() == 'x86_64':
+      list_options += ListCombinations(
+          compiler = args.compiler[0],
+          negative_testing = 'off',
+          std = args.std,
+          mode = 'debug',
+          target = 'a64',
+          host_crypto = ['aes', 'aes_pclmul'])
   else:
     list_options = ListCombinations(
         compiler = args.compiler,